@@ -200,6 +200,8 @@ __attribute__((always_inline)) INLINE int cache_read_particles(
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
   const double loc[3] = {ci->loc[0], ci->loc[1], ci->loc[2]};
+  part_frame_t frame[3];
+  part_get_relative_frame(loc, ci->top->loc, frame);
   const double max_dx = ci->hydro.dx_max_part;
   const float pos_padded[3] = {-(2. * ci->width[0] + max_dx),
                                -(2. * ci->width[1] + max_dx),
@@ -220,9 +222,9 @@ __attribute__((always_inline)) INLINE int cache_read_particles(
       continue;
     }
 
-    x[i] = (float)(parts[i].x[0] - loc[0]);
-    y[i] = (float)(parts[i].x[1] - loc[1]);
-    z[i] = (float)(parts[i].x[2] - loc[2]);
+    x[i] = part_get_frame_position(&parts[i], frame, 0);
+    y[i] = part_get_frame_position(&parts[i], frame, 1);
+    z[i] = part_get_frame_position(&parts[i], frame, 2);
     h[i] = parts[i].h;
     m[i] = parts[i].mass;
     vx[i] = parts[i].v[0];
@@ -280,6 +282,8 @@ __attribute__((always_inline)) INLINE int cache_read_particles_subset_self(
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
   const double loc[3] = {ci->loc[0], ci->loc[1], ci->loc[2]};
+  part_frame_t frame[3];
+  part_get_relative_frame(loc, ci->top->loc, frame);
   const double max_dx = ci->hydro.dx_max_part;
   const float pos_padded[3] = {-(2. * ci->width[0] + max_dx),
                                -(2. * ci->width[1] + max_dx),
@@ -298,9 +302,9 @@ __attribute__((always_inline)) INLINE int cache_read_particles_subset_self(
       continue;
     }
 
-    x[i] = (float)(parts[i].x[0] - loc[0]);
-    y[i] = (float)(parts[i].x[1] - loc[1]);
-    z[i] = (float)(parts[i].x[2] - loc[2]);
+    x[i] = part_get_frame_position(&parts[i], frame, 0);
+    y[i] = part_get_frame_position(&parts[i], frame, 1);
+    z[i] = part_get_frame_position(&parts[i], frame, 2);
     m[i] = parts[i].mass;
     vx[i] = parts[i].v[0];
     vy[i] = parts[i].v[1];
@@ -361,6 +365,8 @@ __attribute__((always_inline)) INLINE void cache_read_particles_subset_pair(
   swift_declare_aligned_ptr(float, vz, ci_cache->vz, SWIFT_CACHE_ALIGNMENT);
 
   const struct part *restrict parts = ci->hydro.parts;
+  part_frame_t frame[3];
+  part_get_relative_frame(loc, ci->top->loc, frame);
 
   /* The cell is on the right so read the particles
    * into the cache from the start of the cell. */
@@ -396,9 +402,9 @@ __attribute__((always_inline)) INLINE void cache_read_particles_subset_pair(
         continue;
       }
 
-      x[i] = (float)(parts[idx].x[0] - loc[0]);
-      y[i] = (float)(parts[idx].x[1] - loc[1]);
-      z[i] = (float)(parts[idx].x[2] - loc[2]);
+      x[i] = part_get_frame_position(&parts[idx], frame, 0);
+      y[i] = part_get_frame_position(&parts[idx], frame, 1);
+      z[i] = part_get_frame_position(&parts[idx], frame, 2);
       m[i] = parts[idx].mass;
       vx[i] = parts[idx].v[0];
       vy[i] = parts[idx].v[1];
@@ -455,9 +461,9 @@ __attribute__((always_inline)) INLINE void cache_read_particles_subset_pair(
         continue;
       }
 
-      x[i] = (float)(parts[idx].x[0] - loc[0]);
-      y[i] = (float)(parts[idx].x[1] - loc[1]);
-      z[i] = (float)(parts[idx].x[2] - loc[2]);
+      x[i] = part_get_frame_position(&parts[idx], frame, 0);
+      y[i] = part_get_frame_position(&parts[idx], frame, 1);
+      z[i] = part_get_frame_position(&parts[idx], frame, 2);
       m[i] = parts[idx].mass;
       vx[i] = parts[idx].v[0];
       vy[i] = parts[idx].v[1];
@@ -520,6 +526,8 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
   const int count = ci->hydro.count;
   const struct part *restrict parts = ci->hydro.parts;
   const double loc[3] = {ci->loc[0], ci->loc[1], ci->loc[2]};
+  part_frame_t frame[3];
+  part_get_relative_frame(loc, ci->top->loc, frame);
   const double max_dx = ci->hydro.dx_max_part;
   const float pos_padded[3] = {-(2. * ci->width[0] + max_dx),
                                -(2. * ci->width[1] + max_dx),
@@ -545,9 +553,9 @@ __attribute__((always_inline)) INLINE int cache_read_force_particles(
       continue;
     }
 
-    x[i] = (float)(parts[i].x[0] - loc[0]);
-    y[i] = (float)(parts[i].x[1] - loc[1]);
-    z[i] = (float)(parts[i].x[2] - loc[2]);
+    x[i] = part_get_frame_position(&parts[i], frame, 0);
+    y[i] = part_get_frame_position(&parts[i], frame, 1);
+    z[i] = part_get_frame_position(&parts[i], frame, 2);
     h[i] = parts[i].h;
     m[i] = parts[i].mass;
     vx[i] = parts[i].v[0];
@@ -643,6 +651,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
   const double total_ci_shift[3] = {
       cj->loc[0] + shift[0], cj->loc[1] + shift[1], cj->loc[2] + shift[2]};
   const double total_cj_shift[3] = {cj->loc[0], cj->loc[1], cj->loc[2]};
+  part_frame_t frame_i[3], frame_j[3];
+  part_get_relative_frame(total_ci_shift, ci->top->loc, frame_i);
+  part_get_relative_frame(total_cj_shift, cj->top->loc, frame_j);
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -682,9 +693,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
       continue;
     }
 
-    x[i] = (float)(parts_i[idx].x[0] - total_ci_shift[0]);
-    y[i] = (float)(parts_i[idx].x[1] - total_ci_shift[1]);
-    z[i] = (float)(parts_i[idx].x[2] - total_ci_shift[2]);
+    x[i] = part_get_frame_position(&parts_i[idx], frame_i, 0);
+    y[i] = part_get_frame_position(&parts_i[idx], frame_i, 1);
+    z[i] = part_get_frame_position(&parts_i[idx], frame_i, 2);
     h[i] = parts_i[idx].h;
     vx[i] = parts_i[idx].v[0];
     vy[i] = parts_i[idx].v[1];
@@ -784,9 +795,9 @@ __attribute__((always_inline)) INLINE void cache_read_two_partial_cells_sorted(
       continue;
     }
 
-    xj[i] = (float)(parts_j[idx].x[0] - total_cj_shift[0]);
-    yj[i] = (float)(parts_j[idx].x[1] - total_cj_shift[1]);
-    zj[i] = (float)(parts_j[idx].x[2] - total_cj_shift[2]);
+    xj[i] = part_get_frame_position(&parts_j[idx], frame_j, 0);
+    yj[i] = part_get_frame_position(&parts_j[idx], frame_j, 1);
+    zj[i] = part_get_frame_position(&parts_j[idx], frame_j, 2);
     hj[i] = parts_j[idx].h;
     vxj[i] = parts_j[idx].v[0];
     vyj[i] = parts_j[idx].v[1];
@@ -895,6 +906,9 @@ cache_read_two_partial_cells_sorted_force(
   const double total_ci_shift[3] = {
       cj->loc[0] + shift[0], cj->loc[1] + shift[1], cj->loc[2] + shift[2]};
   const double total_cj_shift[3] = {cj->loc[0], cj->loc[1], cj->loc[2]};
+  part_frame_t frame_i[3], frame_j[3];
+  part_get_relative_frame(total_ci_shift, ci->top->loc, frame_i);
+  part_get_relative_frame(total_cj_shift, cj->top->loc, frame_j);
 
   /* Let the compiler know that the data is aligned and create pointers to the
    * arrays inside the cache. */
@@ -948,9 +962,9 @@ cache_read_two_partial_cells_sorted_force(
       continue;
     }
 
-    x[i] = (float)(parts_i[idx].x[0] - total_ci_shift[0]);
-    y[i] = (float)(parts_i[idx].x[1] - total_ci_shift[1]);
-    z[i] = (float)(parts_i[idx].x[2] - total_ci_shift[2]);
+    x[i] = part_get_frame_position(&parts_i[idx], frame_i, 0);
+    y[i] = part_get_frame_position(&parts_i[idx], frame_i, 1);
+    z[i] = part_get_frame_position(&parts_i[idx], frame_i, 2);
     h[i] = parts_i[idx].h;
     vx[i] = parts_i[idx].v[0];
     vy[i] = parts_i[idx].v[1];
@@ -1032,9 +1046,9 @@ cache_read_two_partial_cells_sorted_force(
       continue;
     }
 
-    xj[i] = (float)(parts_j[idx].x[0] - total_cj_shift[0]);
-    yj[i] = (float)(parts_j[idx].x[1] - total_cj_shift[1]);
-    zj[i] = (float)(parts_j[idx].x[2] - total_cj_shift[2]);
+    xj[i] = part_get_frame_position(&parts_j[idx], frame_j, 0);
+    yj[i] = part_get_frame_position(&parts_j[idx], frame_j, 1);
+    zj[i] = part_get_frame_position(&parts_j[idx], frame_j, 2);
     hj[i] = parts_j[idx].h;
     vxj[i] = parts_j[idx].v[0];
     vyj[i] = parts_j[idx].v[1];
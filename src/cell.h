@@ -550,6 +550,8 @@ void cell_pack_bpart_swallow(const struct cell *c,
                              struct black_holes_bpart_data *data);
 void cell_unpack_bpart_swallow(struct cell *c,
                                const struct black_holes_bpart_data *data);
+void cell_pack_part_updates(const struct cell *c, char *buff);
+void cell_unpack_part_updates(struct cell *c, const char *buff);
 int cell_pack_tags(const struct cell *c, int *tags);
 int cell_unpack_tags(const int *tags, struct cell *c);
 int cell_pack_grid_extra(const struct cell *c,
@@ -274,6 +274,9 @@ void cell_drift_part(struct cell *c, const struct engine *e, int force,
       drift_part(p, xp, dt_drift, dt_kick_hydro, dt_kick_grav, dt_therm,
                  ti_old_part, ti_current, e, replication_list, c->loc);
 
+      /* Refresh the position relative to the top-level cell */
+      part_update_relative_position(p, c->top->loc);
+
       /* Update the tracers properties */
       tracers_after_drift(p, xp, e->internal_units, e->physical_constants,
                           with_cosmology, e->cosmology, e->hydro_properties,
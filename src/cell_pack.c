@@ -22,6 +22,9 @@
 /* Config parameters. */
 #include <config.h>
 
+/* Some standard headers. */
+#include <string.h>
+
 /* This object's header. */
 #include "cell.h"
 
@@ -227,6 +230,63 @@ void cell_unpack_bpart_swallow(struct cell *c,
   }
 }
 
+/**
+ * @brief Pack the fields of the #part of a cell that are sent to update the
+ * foreign particles (see #part_mpi_fields).
+ *
+ * @param c The #cell.
+ * @param buff (output) The buffer of size c->hydro.count *
+ * part_mpi_update_fields.size we pack into.
+ */
+void cell_pack_part_updates(const struct cell *c, char *buff) {
+
+#ifdef WITH_MPI
+
+  const struct part_mpi_fields *fields = &part_mpi_update_fields;
+  const size_t count = c->hydro.count;
+  const char *parts = (const char *)c->hydro.parts;
+
+  for (size_t i = 0; i < count; ++i) {
+    const char *p = parts + i * sizeof(struct part);
+    for (int k = 0; k < fields->nr_blocks; ++k) {
+      memcpy(buff, p + fields->offset[k], fields->length[k]);
+      buff += fields->length[k];
+    }
+  }
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Unpack the fields of the #part of a cell sent to update the foreign
+ * particles (see #part_mpi_fields).
+ *
+ * @param c The #cell.
+ * @param buff The buffer we unpack from.
+ */
+void cell_unpack_part_updates(struct cell *c, const char *buff) {
+
+#ifdef WITH_MPI
+
+  const struct part_mpi_fields *fields = &part_mpi_update_fields;
+  const size_t count = c->hydro.count;
+  char *parts = (char *)c->hydro.parts;
+
+  for (size_t i = 0; i < count; ++i) {
+    char *p = parts + i * sizeof(struct part);
+    for (int k = 0; k < fields->nr_blocks; ++k) {
+      memcpy(p + fields->offset[k], buff, fields->length[k]);
+      buff += fields->length[k];
+    }
+  }
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
 /**
  * @brief Unpack the data of a given cell and its sub-cells.
  *
@@ -2697,7 +2697,8 @@ int cell_unskip_black_holes_tasks(struct cell *c, struct scheduler *s) {
         if (cj_active) {
 
           /* Receive the foreign parts to compute BH accretion rates and do the
-           * swallowing */
+           * swallowing (the rho message only updates the xv one) */
+          scheduler_activate_recv(s, ci->mpi.recv, task_subtype_xv);
           scheduler_activate_recv(s, ci->mpi.recv, task_subtype_rho);
           scheduler_activate_recv(s, ci->mpi.recv, task_subtype_part_swallow);
           scheduler_activate_recv(s, ci->mpi.recv, task_subtype_bpart_merger);
@@ -2716,6 +2717,7 @@ int cell_unskip_black_holes_tasks(struct cell *c, struct scheduler *s) {
           scheduler_activate_recv(s, ci->mpi.recv, task_subtype_bpart_feedback);
 
           /* Send the local part information */
+          scheduler_activate_send(s, cj->mpi.send, task_subtype_xv, ci_nodeID);
           scheduler_activate_send(s, cj->mpi.send, task_subtype_rho, ci_nodeID);
           scheduler_activate_send(s, cj->mpi.send, task_subtype_part_swallow,
                                   ci_nodeID);
@@ -2742,7 +2744,8 @@ int cell_unskip_black_holes_tasks(struct cell *c, struct scheduler *s) {
         if (ci_active) {
 
           /* Receive the foreign parts to compute BH accretion rates and do the
-           * swallowing */
+           * swallowing (the rho message only updates the xv one) */
+          scheduler_activate_recv(s, cj->mpi.recv, task_subtype_xv);
           scheduler_activate_recv(s, cj->mpi.recv, task_subtype_rho);
           scheduler_activate_recv(s, cj->mpi.recv, task_subtype_part_swallow);
           scheduler_activate_recv(s, cj->mpi.recv, task_subtype_bpart_merger);
@@ -2761,6 +2764,7 @@ int cell_unskip_black_holes_tasks(struct cell *c, struct scheduler *s) {
           scheduler_activate_recv(s, cj->mpi.recv, task_subtype_bpart_feedback);
 
           /* Send the local part information */
+          scheduler_activate_send(s, ci->mpi.send, task_subtype_xv, cj_nodeID);
           scheduler_activate_send(s, ci->mpi.send, task_subtype_rho, cj_nodeID);
           scheduler_activate_send(s, ci->mpi.send, task_subtype_part_swallow,
                                   cj_nodeID);
@@ -25,6 +25,7 @@
 #include "common_io.h"
 
 /* Local includes. */
+#include "cell.h"
 #include "engine.h"
 #include "error.h"
 #include "kernel_hydro.h"
@@ -45,6 +46,7 @@
 #include "hydro_io.h"
 #include "mhd_io.h"
 #include "neutrino_io.h"
+#include "output_options.h"
 #include "particle_splitting.h"
 #include "rt_io.h"
 #include "sink_io.h"
@@ -849,6 +851,42 @@ void io_write_part_type_names(hid_t h_grp) {
   H5Sclose(space);
 }
 
+/**
+ * @brief Write the attributes describing which part of the simulation the
+ * snapshot contains.
+ *
+ * @param h_grp The (open) HDF5 group to write to.
+ * @param subsample_any Are any particle types being subsampled?
+ * @param subsample_fraction The fraction of particles kept for each type.
+ * @param region The region of interest the output is restricted to (NULL for
+ * the full volume).
+ */
+void io_write_output_type(hid_t h_grp, const int subsample_any,
+                          const float subsample_fraction[swift_type_count],
+                          const struct output_region* region) {
+
+  if (region != NULL) {
+    io_write_attribute_s(h_grp, "OutputType", "RegionOfInterest");
+    io_write_attribute(h_grp, "RegionCentre", DOUBLE, region->centre, 3);
+    if (region->type == output_region_sphere) {
+      io_write_attribute_s(h_grp, "RegionShape", "Sphere");
+      io_write_attribute_d(h_grp, "RegionRadius", region->radius);
+    } else {
+      io_write_attribute_s(h_grp, "RegionShape", "Box");
+      io_write_attribute(h_grp, "RegionHalfSize", DOUBLE, region->half_size,
+                         3);
+    }
+  } else if (subsample_any) {
+    io_write_attribute_s(h_grp, "OutputType", "SubSampled");
+  } else {
+    io_write_attribute_s(h_grp, "OutputType", "FullVolume");
+  }
+
+  if (subsample_any)
+    io_write_attribute(h_grp, "SubSampleFractions", FLOAT, subsample_fraction,
+                       swift_type_count);
+}
+
 #endif /* HAVE_HDF5 */
 
 /**
@@ -1241,381 +1279,592 @@ void io_duplicate_black_holes_gparts(struct threadpool* tp,
                  &data);
 }
 
+/*! Number of particles processed per block when collecting particles. */
+#define io_collect_block_size 16384
+
 /**
- * @brief Copy every non-inhibited #part into the parts_written array.
- *
- * Also takes into account possible downsampling.
- *
- * @param parts The array of #part containing all particles.
- * @param xparts The array of #xpart containing all particles.
- * @param parts_written The array of #part to fill with particles we want to
- * write.
- * @param xparts_written The array of #xpart  to fill with particles we want to
- * write.
- * @param subsample Are we subsampling the particles?
- * @param subsample_ratio The fraction of particles to write if subsampling.
- * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Nparts The total number of #part.
- * @param Nparts_written The total number of #part to write.
+ * @brief The kind of particle array we are collecting from.
  */
-void io_collect_parts_to_write(const struct part* restrict parts,
-                               const struct xpart* restrict xparts,
-                               struct part* restrict parts_written,
-                               struct xpart* restrict xparts_written,
-                               const int subsample, const float subsample_ratio,
-                               const int snap_num, const size_t Nparts,
-                               const size_t Nparts_written) {
+enum io_collect_kind {
+  io_collect_part,
+  io_collect_spart,
+  io_collect_sink,
+  io_collect_bpart,
+  io_collect_gpart,
+};
 
-  size_t count = 0;
+/**
+ * @brief A contiguous range of particles to collect from.
+ */
+struct io_collect_range {
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Nparts; ++i) {
+  /*! Index of the first particle in the range */
+  size_t first;
 
-    /* And collect the ones that have not been removed */
-    if (parts[i].time_bin != time_bin_inhibited &&
-        parts[i].time_bin != time_bin_not_created) {
+  /*! Index one past the last particle in the range */
+  size_t last;
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r = random_unit_interval(parts[i].id, snap_num,
-                                             random_number_snapshot_sampling);
+  /*! Do the particles need to be tested against the region of interest? */
+  int test_region;
+};
 
-        if (r > subsample_ratio) continue;
-      }
+/**
+ * @brief Data passed to the particle collection mappers.
+ */
+struct io_collect_data {
 
-      parts_written[count] = parts[i];
-      xparts_written[count] = xparts[i];
-      count++;
-    }
-  }
+  /*! The particle array (of type #kind) */
+  const void* parts;
 
-  /* Check that everything is fine */
-  if (count != Nparts_written)
-    error("Collected the wrong number of particles (%zu vs. %zu expected)",
-          count, Nparts_written);
-}
+  /*! The kind of particles in the array */
+  enum io_collect_kind kind;
 
-/**
- * @brief Copy every non-inhibited #spart into the sparts_written array.
- *
- * Also takes into account possible downsampling.
- *
- * @param sparts The array of #spart containing all particles.
- * @param sparts_written The array of #spart to fill with particles we want to
- * write.
- * @param subsample Are we subsampling the particles?
- * @param subsample_ratio The fraction of particles to write if subsampling.
- * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Nsparts The total number of #part.
- * @param Nsparts_written The total number of #part to write.
- */
-void io_collect_sparts_to_write(const struct spart* restrict sparts,
-                                struct spart* restrict sparts_written,
-                                const int subsample,
-                                const float subsample_ratio, const int snap_num,
-                                const size_t Nsparts,
-                                const size_t Nsparts_written) {
+  /*! The type of #gpart to collect (only for io_collect_gpart) */
+  enum part_type gpart_type;
 
-  size_t count = 0;
+  /*! Are we subsampling the particles? */
+  int subsample;
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Nsparts; ++i) {
+  /*! The fraction of particles to write if subsampling */
+  float subsample_ratio;
 
-    /* And collect the ones that have not been removed */
-    if (sparts[i].time_bin != time_bin_inhibited &&
-        sparts[i].time_bin != time_bin_not_created) {
+  /*! The snapshot ID (used to seed the RNG when sub-sampling) */
+  int snap_num;
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r = random_unit_interval(sparts[i].id, snap_num,
-                                             random_number_snapshot_sampling);
+  /*! The region of interest to restrict the output to (NULL if none) */
+  const struct output_region* region;
 
-        if (r > subsample_ratio) continue;
-      }
+  /*! The ranges of the array overlapping the region of interest (NULL when
+   * going through the whole array in blocks) */
+  struct io_collect_range* ranges;
 
-      sparts_written[count] = sparts[i];
-      count++;
-    }
+  /*! The total number of particles in the array */
+  size_t N;
+
+  /*! Number of particles selected in each block (then their offsets) */
+  size_t* counts;
+
+  /*! The list of indices to fill */
+  size_t* index;
+};
+
+/**
+ * @brief Is a given particle to be written to the snapshot?
+ *
+ * @param data The #io_collect_data.
+ * @param i The index of the particle in the array.
+ * @param test_region Do we need to check the particle is in the region of
+ * interest?
+ */
+__attribute__((always_inline)) INLINE static int io_collect_is_selected(
+    const struct io_collect_data* data, const size_t i, const int test_region) {
+
+  timebin_t time_bin;
+  long long id;
+  const double* x;
+
+  switch (data->kind) {
+    case io_collect_part: {
+      const struct part* p = &((const struct part*)data->parts)[i];
+      time_bin = p->time_bin;
+      id = p->id;
+      x = p->x;
+    } break;
+    case io_collect_spart: {
+      const struct spart* sp = &((const struct spart*)data->parts)[i];
+      time_bin = sp->time_bin;
+      id = sp->id;
+      x = sp->x;
+    } break;
+    case io_collect_sink: {
+      const struct sink* sink = &((const struct sink*)data->parts)[i];
+      time_bin = sink->time_bin;
+      id = sink->id;
+      x = sink->x;
+    } break;
+    case io_collect_bpart: {
+      const struct bpart* bp = &((const struct bpart*)data->parts)[i];
+      time_bin = bp->time_bin;
+      id = bp->id;
+      x = bp->x;
+    } break;
+    case io_collect_gpart: {
+      const struct gpart* gp = &((const struct gpart*)data->parts)[i];
+      if (gp->type != data->gpart_type) return 0;
+      time_bin = gp->time_bin;
+      id = gp->id_or_neg_offset;
+      x = gp->x;
+    } break;
+    default:
+      error("Invalid particle kind");
+      return 0;
   }
 
-  /* Check that everything is fine */
-  if (count != Nsparts_written)
-    error("Collected the wrong number of s-particles (%zu vs. %zu expected)",
-          count, Nsparts_written);
+  /* Collect the ones that have not been removed */
+  if (time_bin == time_bin_inhibited || time_bin == time_bin_not_created)
+    return 0;
+
+  /* When subsampling, select particles at random */
+  if (data->subsample) {
+    const float r = random_unit_interval(id, data->snap_num,
+                                         random_number_snapshot_sampling);
+    if (r > data->subsample_ratio) return 0;
+  }
+
+  /* Only keep the particles inside the region of interest */
+  if (test_region && !output_region_contains(data->region, x)) return 0;
+
+  return 1;
 }
 
 /**
- * @brief Copy every non-inhibited #sink into the sinks_written array.
+ * @brief Get the range of particles to collect in a given block.
  *
- * Also takes into account possible downsampling.
+ * @param data The #io_collect_data.
+ * @param b The index of the block.
+ * @param first (return) The index of the first particle in the block.
+ * @param last (return) The index one past the last particle in the block.
  *
- * @param sinks The array of #sink containing all particles.
- * @param sinks_written The array of #sink to fill with particles we want to
- * write.
- * @param subsample Are we subsampling the particles?
- * @param subsample_ratio The fraction of particles to write if subsampling.
- * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Nsinks The total number of #sink.
- * @param Nsinks_written The total number of #sink to write.
+ * @return Do the particles need to be tested against the region of interest?
  */
-void io_collect_sinks_to_write(const struct sink* restrict sinks,
-                               struct sink* restrict sinks_written,
-                               const int subsample, const float subsample_ratio,
-                               const int snap_num, const size_t Nsinks,
-                               const size_t Nsinks_written) {
+__attribute__((always_inline)) INLINE static int io_collect_block_range(
+    const struct io_collect_data* data, const size_t b, size_t* first,
+    size_t* last) {
+
+  if (data->ranges != NULL) {
+    *first = data->ranges[b].first;
+    *last = data->ranges[b].last;
+    return data->ranges[b].test_region;
+  }
 
-  size_t count = 0;
+  *first = b * io_collect_block_size;
+  *last = min(*first + io_collect_block_size, data->N);
+  return 0;
+}
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Nsinks; ++i) {
+/**
+ * @brief Mapper function counting the particles to write in each block.
+ */
+void io_collect_count_mapper(void* restrict map_data, int num_blocks,
+                             void* restrict extra_data) {
 
-    /* And collect the ones that have not been removed */
-    if (sinks[i].time_bin != time_bin_inhibited &&
-        sinks[i].time_bin != time_bin_not_created) {
+  const struct io_collect_data* data =
+      (const struct io_collect_data*)extra_data;
+  size_t* counts = (size_t*)map_data;
+  const size_t first_block = counts - data->counts;
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r = random_unit_interval(sinks[i].id, snap_num,
-                                             random_number_snapshot_sampling);
+  for (int b = 0; b < num_blocks; ++b) {
 
-        if (r > subsample_ratio) continue;
-      }
+    size_t first, last;
+    const int test_region =
+        io_collect_block_range(data, first_block + b, &first, &last);
 
-      sinks_written[count] = sinks[i];
-      count++;
-    }
+    size_t count = 0;
+    for (size_t i = first; i < last; ++i)
+      count += io_collect_is_selected(data, i, test_region);
+    counts[b] = count;
   }
-
-  /* Check that everything is fine */
-  if (count != Nsinks_written)
-    error("Collected the wrong number of sink-particles (%zu vs. %zu expected)",
-          count, Nsinks_written);
 }
 
 /**
- * @brief Copy every non-inhibited #bpart into the bparts_written array.
- *
- * Also takes into account possible downsampling.
- *
- * @param bparts The array of #bpart containing all particles.
- * @param bparts_written The array of #bpart to fill with particles we want to
- * write.
- * @param subsample Are we subsampling the particles?
- * @param subsample_ratio The fraction of particles to write if subsampling.
- * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Nbparts The total number of #part.
- * @param Nbparts_written The total number of #part to write.
+ * @brief Mapper function writing the indices of the particles to write in
+ * each block, starting at the block's offset.
  */
-void io_collect_bparts_to_write(const struct bpart* restrict bparts,
-                                struct bpart* restrict bparts_written,
-                                const int subsample,
-                                const float subsample_ratio, const int snap_num,
-                                const size_t Nbparts,
-                                const size_t Nbparts_written) {
+void io_collect_fill_mapper(void* restrict map_data, int num_blocks,
+                            void* restrict extra_data) {
 
-  size_t count = 0;
+  const struct io_collect_data* data =
+      (const struct io_collect_data*)extra_data;
+  const size_t* offsets = (const size_t*)map_data;
+  const size_t first_block = offsets - data->counts;
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Nbparts; ++i) {
+  for (int b = 0; b < num_blocks; ++b) {
 
-    /* And collect the ones that have not been removed */
-    if (bparts[i].time_bin != time_bin_inhibited &&
-        bparts[i].time_bin != time_bin_not_created) {
+    size_t first, last;
+    const int test_region =
+        io_collect_block_range(data, first_block + b, &first, &last);
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r = random_unit_interval(bparts[i].id, snap_num,
-                                             random_number_snapshot_sampling);
+    size_t* restrict index = data->index + offsets[b];
+    for (size_t i = first; i < last; ++i)
+      if (io_collect_is_selected(data, i, test_region)) *(index++) = i;
+  }
+}
 
-        if (r > subsample_ratio) continue;
-      }
+/**
+ * @brief Sort #io_collect_range by increasing first index.
+ */
+static int io_collect_range_cmp(const void* a, const void* b) {
 
-      bparts_written[count] = bparts[i];
-      count++;
-    }
-  }
+  const struct io_collect_range* ra = (const struct io_collect_range*)a;
+  const struct io_collect_range* rb = (const struct io_collect_range*)b;
+  return (ra->first > rb->first) - (ra->first < rb->first);
+}
 
-  /* Check that everything is fine */
-  if (count != Nbparts_written)
-    error("Collected the wrong number of s-particles (%zu vs. %zu expected)",
-          count, Nbparts_written);
+/**
+ * @brief Get the particles of a given kind in a top-level cell as a range of
+ * the array we are collecting from.
+ *
+ * @param data The #io_collect_data.
+ * @param c The top-level #cell.
+ * @param first (return) The index of the cell's first particle in the array.
+ *
+ * @return The number of particles in the cell.
+ */
+static size_t io_collect_cell_range(const struct io_collect_data* data,
+                                    const struct cell* c, size_t* first) {
+
+  switch (data->kind) {
+    case io_collect_part:
+      *first = c->hydro.parts - (const struct part*)data->parts;
+      return c->hydro.count;
+    case io_collect_spart:
+      *first = c->stars.parts - (const struct spart*)data->parts;
+      return c->stars.count;
+    case io_collect_sink:
+      *first = c->sinks.parts - (const struct sink*)data->parts;
+      return c->sinks.count;
+    case io_collect_bpart:
+      *first = c->black_holes.parts - (const struct bpart*)data->parts;
+      return c->black_holes.count;
+    case io_collect_gpart:
+      *first = c->grav.parts - (const struct gpart*)data->parts;
+      return c->grav.count;
+    default:
+      error("Invalid particle kind");
+      return 0;
+  }
 }
 
 /**
- * @brief Copy every non-inhibited regulat DM #gpart into the gparts_written
- * array.
+ * @brief Build the ranges of the array that can contain particles in the
+ * region of interest.
  *
- * Also takes into account possible downsampling.
+ * Only the local top-level cells overlapping the region are considered and
+ * only the particles of the cells straddling the region's edge will have
+ * their position tested. The ranges are split into blocks of at most
+ * #io_collect_block_size particles and sorted to preserve the order of the
+ * particles in the array.
  *
- * @param gparts The array of #gpart containing all particles.
- * @param vr_data The array of gpart-related VELOCIraptor output.
- * @param gparts_written The array of #gpart to fill with particles we want to
- * write.
- * @param vr_data_written The array of gpart-related VELOCIraptor with particles
- * we want to write.
- * @param subsample Are we subsampling the particles?
- * @param subsample_ratio The fraction of particles to write if subsampling.
- * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Ngparts The total number of #part.
- * @param Ngparts_written The total number of #part to write.
- * @param with_stf Are we running with STF? i.e. do we want to collect vr data?
+ * @param data The #io_collect_data.
+ * @param name The name of the particle type (for error messages).
+ *
+ * @return The number of ranges.
  */
-void io_collect_gparts_to_write(
-    const struct gpart* restrict gparts,
-    const struct velociraptor_gpart_data* restrict vr_data,
-    struct gpart* restrict gparts_written,
-    struct velociraptor_gpart_data* restrict vr_data_written,
-    const int subsample, const float subsample_ratio, const int snap_num,
-    const size_t Ngparts, const size_t Ngparts_written, const int with_stf) {
+static size_t io_collect_region_ranges(struct io_collect_data* data,
+                                       const char* name) {
+
+  const struct space* s = data->region->s;
+  const struct cell* cells_top = s->cells_top;
+  const int* local_cells_top = s->local_cells_top;
+
+  /* Count the blocks we need */
+  size_t num_ranges = 0;
+  for (int k = 0; k < s->nr_local_cells; ++k) {
+    const struct cell* c = &cells_top[local_cells_top[k]];
+    size_t first;
+    const size_t count = io_collect_cell_range(data, c, &first);
+    if (count == 0 || io_cell_region_overlap(data->region, c) == 0) continue;
+    num_ranges += (count + io_collect_block_size - 1) / io_collect_block_size;
+  }
 
-  size_t count = 0;
+  data->ranges = (struct io_collect_range*)malloc(
+      (num_ranges + 1) * sizeof(struct io_collect_range));
+  if (data->ranges == NULL)
+    error("Error while allocating temporary memory for the %s ranges", name);
+
+  /* And fill them */
+  size_t r = 0;
+  for (int k = 0; k < s->nr_local_cells; ++k) {
+    const struct cell* c = &cells_top[local_cells_top[k]];
+    size_t first;
+    const size_t count = io_collect_cell_range(data, c, &first);
+    if (count == 0) continue;
+    const int overlap = io_cell_region_overlap(data->region, c);
+    if (overlap == 0) continue;
+
+#ifdef SWIFT_DEBUG_CHECKS
+    if (first + count > data->N)
+      error("Cell %d's %s are not in the array being written",
+            local_cells_top[k], name);
+#endif
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Ngparts; ++i) {
+    for (size_t i = first; i < first + count; i += io_collect_block_size) {
+      data->ranges[r].first = i;
+      data->ranges[r].last = min(i + io_collect_block_size, first + count);
+      data->ranges[r].test_region = (overlap == 1);
+      ++r;
+    }
+  }
 
-    /* And collect the ones that have not been removed */
-    if ((gparts[i].time_bin != time_bin_inhibited) &&
-        (gparts[i].time_bin != time_bin_not_created) &&
-        (gparts[i].type == swift_type_dark_matter)) {
+  qsort(data->ranges, num_ranges, sizeof(struct io_collect_range),
+        io_collect_range_cmp);
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r =
-            random_unit_interval(gparts[i].id_or_neg_offset, snap_num,
-                                 random_number_snapshot_sampling);
+  return num_ranges;
+}
 
-        if (r > subsample_ratio) continue;
-      }
+/**
+ * @brief Build the (ordered) list of particles to write from an array.
+ *
+ * This is a two-pass compaction: we first count the particles to write in
+ * blocks of the array, turn that into offsets and then let each block write
+ * its own indices. When the output is restricted to a region of interest,
+ * the blocks are built from the top-level cells overlapping the region such
+ * that the rest of the array is never touched.
+ *
+ * @param tp The #threadpool.
+ * @param data The #io_collect_data describing the array and the selection.
+ * @param N_written The number of particles we expect to collect.
+ * @param name The name of the particle type (for error messages).
+ */
+static void io_collect_indices(struct threadpool* tp,
+                               struct io_collect_data* data,
+                               const size_t N_written, const char* name) {
 
-      if (with_stf) vr_data_written[count] = vr_data[i];
+  const size_t num_blocks =
+      data->region != NULL
+          ? io_collect_region_ranges(data, name)
+          : (data->N + io_collect_block_size - 1) / io_collect_block_size;
 
-      gparts_written[count] = gparts[i];
-      count++;
-    }
+  data->counts = (size_t*)malloc((num_blocks + 1) * sizeof(size_t));
+  if (data->counts == NULL)
+    error("Error while allocating temporary memory for the %s counts", name);
+
+  /* Count the particles in each block */
+  threadpool_map(tp, io_collect_count_mapper, data->counts, num_blocks,
+                 sizeof(size_t), threadpool_auto_chunk_size, data);
+
+  /* Turn the counts into offsets */
+  size_t count = 0;
+  for (size_t b = 0; b < num_blocks; ++b) {
+    const size_t this_count = data->counts[b];
+    data->counts[b] = count;
+    count += this_count;
   }
 
   /* Check that everything is fine */
-  if (count != Ngparts_written)
-    error("Collected the wrong number of g-particles (%zu vs. %zu expected)",
-          count, Ngparts_written);
+  if (count != N_written)
+    error("Collected the wrong number of %s (%zu vs. %zu expected)", name,
+          count, N_written);
+
+  /* And collect the indices */
+  threadpool_map(tp, io_collect_fill_mapper, data->counts, num_blocks,
+                 sizeof(size_t), threadpool_auto_chunk_size, data);
+
+  free(data->counts);
+  data->counts = NULL;
+  free(data->ranges);
+  data->ranges = NULL;
 }
 
 /**
- * @brief Copy every non-inhibited background DM #gpart into the gparts_written
- * array.
+ * @brief Build the list of non-inhibited #part to write.
  *
- * Also takes into account possible downsampling.
+ * Also takes into account possible downsampling. The particles are not copied;
+ * the index list is instead attached to the #io_props of the fields
+ * (see io_props_set_index()).
  *
- * @param gparts The array of #gpart containing all particles.
- * @param vr_data The array of gpart-related VELOCIraptor output.
- * @param gparts_written The array of #gpart to fill with particles we want to
- * write.
- * @param vr_data_written The array of gpart-related VELOCIraptor with particles
- * we want to write.
+ * @param tp The #threadpool.
+ * @param parts The array of #part containing all particles.
+ * @param index (return) The indices in parts of the particles to write.
  * @param subsample Are we subsampling the particles?
  * @param subsample_ratio The fraction of particles to write if subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
  * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Ngparts The total number of #part.
- * @param Ngparts_written The total number of #part to write.
- * @param with_stf Are we running with STF? i.e. do we want to collect vr data?
+ * @param Nparts The total number of #part.
+ * @param Nparts_written The total number of #part to write.
  */
-void io_collect_gparts_background_to_write(
-    const struct gpart* restrict gparts,
-    const struct velociraptor_gpart_data* restrict vr_data,
-    struct gpart* restrict gparts_written,
-    struct velociraptor_gpart_data* restrict vr_data_written,
-    const int subsample, const float subsample_ratio, const int snap_num,
-    const size_t Ngparts, const size_t Ngparts_written, const int with_stf) {
-
-  size_t count = 0;
-
-  /* Loop over all parts */
-  for (size_t i = 0; i < Ngparts; ++i) {
-
-    /* And collect the ones that have not been removed */
-    if ((gparts[i].time_bin != time_bin_inhibited) &&
-        (gparts[i].time_bin != time_bin_not_created) &&
-        (gparts[i].type == swift_type_dark_matter_background)) {
-
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r =
-            random_unit_interval(gparts[i].id_or_neg_offset, snap_num,
-                                 random_number_snapshot_sampling);
-
-        if (r > subsample_ratio) continue;
-      }
-
-      if (with_stf) vr_data_written[count] = vr_data[i];
-
-      gparts_written[count] = gparts[i];
-      count++;
-    }
-  }
+void io_collect_parts_to_write(struct threadpool* tp,
+                               const struct part* restrict parts,
+                               size_t* restrict index, const int subsample,
+                               const float subsample_ratio,
+                               const struct output_region* region,
+                               const int snap_num, const size_t Nparts,
+                               const size_t Nparts_written) {
 
-  /* Check that everything is fine */
-  if (count != Ngparts_written)
-    error("Collected the wrong number of g-particles (%zu vs. %zu expected)",
-          count, Ngparts_written);
+  struct io_collect_data data;
+  bzero(&data, sizeof(struct io_collect_data));
+  data.parts = parts;
+  data.kind = io_collect_part;
+  data.subsample = subsample;
+  data.subsample_ratio = subsample_ratio;
+  data.region = region;
+  data.snap_num = snap_num;
+  data.N = Nparts;
+  data.index = index;
+
+  io_collect_indices(tp, &data, Nparts_written, "particles");
 }
 
 /**
- * @brief Copy every non-inhibited neutrino DM #gpart into the gparts_written
- * array.
+ * @brief Build the list of non-inhibited #spart to write.
  *
  * Also takes into account possible downsampling.
  *
- * @param gparts The array of #gpart containing all particles.
- * @param vr_data The array of gpart-related VELOCIraptor output.
- * @param gparts_written The array of #gpart to fill with particles we want to
- * write.
- * @param vr_data_written The array of gpart-related VELOCIraptor with particles
- * we want to write.
+ * @param tp The #threadpool.
+ * @param sparts The array of #spart containing all particles.
+ * @param index (return) The indices in sparts of the particles to write.
  * @param subsample Are we subsampling the particles?
  * @param subsample_ratio The fraction of particles to write if subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
  * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
- * @param Ngparts The total number of #part.
- * @param Ngparts_written The total number of #part to write.
- * @param with_stf Are we running with STF? i.e. do we want to collect vr data?
+ * @param Nsparts The total number of #spart.
+ * @param Nsparts_written The total number of #spart to write.
  */
-void io_collect_gparts_neutrino_to_write(
-    const struct gpart* restrict gparts,
-    const struct velociraptor_gpart_data* restrict vr_data,
-    struct gpart* restrict gparts_written,
-    struct velociraptor_gpart_data* restrict vr_data_written,
-    const int subsample, const float subsample_ratio, const int snap_num,
-    const size_t Ngparts, const size_t Ngparts_written, const int with_stf) {
+void io_collect_sparts_to_write(struct threadpool* tp,
+                                const struct spart* restrict sparts,
+                                size_t* restrict index, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Nsparts,
+                                const size_t Nsparts_written) {
 
-  size_t count = 0;
+  struct io_collect_data data;
+  bzero(&data, sizeof(struct io_collect_data));
+  data.parts = sparts;
+  data.kind = io_collect_spart;
+  data.subsample = subsample;
+  data.subsample_ratio = subsample_ratio;
+  data.region = region;
+  data.snap_num = snap_num;
+  data.N = Nsparts;
+  data.index = index;
+
+  io_collect_indices(tp, &data, Nsparts_written, "s-particles");
+}
 
-  /* Loop over all parts */
-  for (size_t i = 0; i < Ngparts; ++i) {
+/**
+ * @brief Build the list of non-inhibited #sink to write.
+ *
+ * Also takes into account possible downsampling.
+ *
+ * @param tp The #threadpool.
+ * @param sinks The array of #sink containing all particles.
+ * @param index (return) The indices in sinks of the particles to write.
+ * @param subsample Are we subsampling the particles?
+ * @param subsample_ratio The fraction of particles to write if subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
+ * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
+ * @param Nsinks The total number of #sink.
+ * @param Nsinks_written The total number of #sink to write.
+ */
+void io_collect_sinks_to_write(struct threadpool* tp,
+                               const struct sink* restrict sinks,
+                               size_t* restrict index, const int subsample,
+                               const float subsample_ratio,
+                               const struct output_region* region,
+                               const int snap_num, const size_t Nsinks,
+                               const size_t Nsinks_written) {
 
-    /* And collect the ones that have not been removed */
-    if ((gparts[i].time_bin != time_bin_inhibited) &&
-        (gparts[i].time_bin != time_bin_not_created) &&
-        (gparts[i].type == swift_type_neutrino)) {
+  struct io_collect_data data;
+  bzero(&data, sizeof(struct io_collect_data));
+  data.parts = sinks;
+  data.kind = io_collect_sink;
+  data.subsample = subsample;
+  data.subsample_ratio = subsample_ratio;
+  data.region = region;
+  data.snap_num = snap_num;
+  data.N = Nsinks;
+  data.index = index;
+
+  io_collect_indices(tp, &data, Nsinks_written, "sink-particles");
+}
 
-      /* When subsampling, select particles at random */
-      if (subsample) {
-        const float r =
-            random_unit_interval(gparts[i].id_or_neg_offset, snap_num,
-                                 random_number_snapshot_sampling);
+/**
+ * @brief Build the list of non-inhibited #bpart to write.
+ *
+ * Also takes into account possible downsampling.
+ *
+ * @param tp The #threadpool.
+ * @param bparts The array of #bpart containing all particles.
+ * @param index (return) The indices in bparts of the particles to write.
+ * @param subsample Are we subsampling the particles?
+ * @param subsample_ratio The fraction of particles to write if subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
+ * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
+ * @param Nbparts The total number of #bpart.
+ * @param Nbparts_written The total number of #bpart to write.
+ */
+void io_collect_bparts_to_write(struct threadpool* tp,
+                                const struct bpart* restrict bparts,
+                                size_t* restrict index, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Nbparts,
+                                const size_t Nbparts_written) {
 
-        if (r > subsample_ratio) continue;
-      }
+  struct io_collect_data data;
+  bzero(&data, sizeof(struct io_collect_data));
+  data.parts = bparts;
+  data.kind = io_collect_bpart;
+  data.subsample = subsample;
+  data.subsample_ratio = subsample_ratio;
+  data.region = region;
+  data.snap_num = snap_num;
+  data.N = Nbparts;
+  data.index = index;
+
+  io_collect_indices(tp, &data, Nbparts_written, "b-particles");
+}
 
-      if (with_stf) vr_data_written[count] = vr_data[i];
+/**
+ * @brief Build the list of non-inhibited #gpart of a given type to write.
+ *
+ * Also takes into account possible downsampling. The same indices apply to
+ * the gpart-related VELOCIraptor output.
+ *
+ * @param tp The #threadpool.
+ * @param gparts The array of #gpart containing all particles.
+ * @param index (return) The indices in gparts of the particles to write.
+ * @param type The type of particles to collect (DM, background DM or
+ * neutrinos).
+ * @param subsample Are we subsampling the particles?
+ * @param subsample_ratio The fraction of particles to write if subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
+ * @param snap_num The snapshot ID (used to seed the RNG when sub-sampling).
+ * @param Ngparts The total number of #gpart.
+ * @param Ngparts_written The total number of #gpart to write.
+ */
+void io_collect_gparts_to_write(struct threadpool* tp,
+                                const struct gpart* restrict gparts,
+                                size_t* restrict index,
+                                const enum part_type type, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Ngparts,
+                                const size_t Ngparts_written) {
+
+  struct io_collect_data data;
+  bzero(&data, sizeof(struct io_collect_data));
+  data.parts = gparts;
+  data.kind = io_collect_gpart;
+  data.gpart_type = type;
+  data.subsample = subsample;
+  data.subsample_ratio = subsample_ratio;
+  data.region = region;
+  data.snap_num = snap_num;
+  data.N = Ngparts;
+  data.index = index;
+
+  io_collect_indices(tp, &data, Ngparts_written, "g-particles");
+}
 
-      gparts_written[count] = gparts[i];
-      count++;
-    }
-  }
+/**
+ * @brief Make the fields of a list read the particles through an index list.
+ *
+ * @param list The list of #io_props.
+ * @param num_fields The number of fields in the list.
+ * @param index The indices of the particles to write (NULL to write the whole
+ * arrays).
+ */
+void io_props_set_index(struct io_props* list, const int num_fields,
+                        const size_t* index) {
 
-  /* Check that everything is fine */
-  if (count != Ngparts_written)
-    error("Collected the wrong number of g-particles (%zu vs. %zu expected)",
-          count, Ngparts_written);
+  for (int i = 0; i < num_fields; ++i) list[i].index = index;
 }
 
 /**
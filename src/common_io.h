@@ -23,6 +23,11 @@
 /* Config parameters. */
 #include <config.h>
 
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
 /* Local includes. */
 #include "part_type.h"
 
@@ -31,6 +36,8 @@
 #define PARTICLE_GROUP_BUFFER_SIZE 50
 #define FILENAME_BUFFER_SIZE 150
 #define IO_BUFFER_ALIGNMENT 1024
+#define IO_CELL_CHUNK_SIZE_MIN 1024LL
+#define IO_CELL_CHUNK_SIZE_MAX (1LL << 20)
 #define HDF5_LOWEST_FILE_FORMAT_VERSION H5F_LIBVER_V18
 #define HDF5_HIGHEST_FILE_FORMAT_VERSION H5F_LIBVER_LATEST
 
@@ -49,6 +56,7 @@ struct engine;
 struct threadpool;
 struct output_list;
 struct output_options;
+struct output_region;
 struct unit_system;
 
 /**
@@ -112,19 +120,39 @@ void io_write_code_description(hid_t h_file);
 void io_write_engine_policy(hid_t h_file, const struct engine* e);
 void io_write_part_type_names(hid_t h_grp);
 
+void io_get_cell_aligned_chunk_sizes(
+    const struct cell* cells_top, const int nr_cells, const int nodeID,
+    const int chunks_per_cell, const long long N_total[swift_type_count],
+#ifdef WITH_MPI
+    long long chunk_sizes[swift_type_count], MPI_Comm comm);
+#else
+    long long chunk_sizes[swift_type_count]);
+#endif
+
 void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                            const struct cell* cells_top, const int nr_cells,
                            const double width[3], const int nodeID,
                            const int distributed,
                            const int subsample[swift_type_count],
                            const float subsample_fraction[swift_type_count],
+                           const struct output_region* region,
                            const int snap_num,
                            const long long global_counts[swift_type_count],
                            const long long global_offsets[swift_type_count],
                            const int to_write[swift_type_count],
                            const int num_fields[swift_type_count],
+                           const long long chunk_sizes[swift_type_count],
                            const struct unit_system* internal_units,
+#ifdef WITH_MPI
+                           const struct unit_system* snapshot_units,
+                           MPI_Comm comm);
+#else
                            const struct unit_system* snapshot_units);
+#endif
+
+void io_write_output_type(hid_t h_grp, const int subsample_any,
+                          const float subsample_fraction[swift_type_count],
+                          const struct output_region* region);
 
 void io_read_unit_system(hid_t h_file, struct unit_system* ic_units,
                          const struct unit_system* internal_units,
@@ -142,84 +170,84 @@ void io_copy_temp_buffer(void* temp, const struct engine* e,
 size_t io_sizeof_type(enum IO_DATA_TYPE type);
 int io_is_double_precision(enum IO_DATA_TYPE type);
 
+int io_cell_region_overlap(const struct output_region* region,
+                           const struct cell* c);
+
 long long io_count_gas_to_write(const struct space* s, const int subsample,
                                 const float subsample_ratio,
+                                const struct output_region* region,
                                 const int snap_num);
 
 long long io_count_dark_matter_to_write(const struct space* s,
                                         const int subsample,
                                         const float subsample_ratio,
+                                        const struct output_region* region,
                                         const int snap_num);
 
-long long io_count_background_dark_matter_to_write(const struct space* s,
-                                                   const int subsample,
-                                                   const float subsample_ratio,
-                                                   const int snap_num);
+long long io_count_background_dark_matter_to_write(
+    const struct space* s, const int subsample, const float subsample_ratio,
+    const struct output_region* region, const int snap_num);
 
 long long io_count_stars_to_write(const struct space* s, const int subsample,
                                   const float subsample_ratio,
+                                  const struct output_region* region,
                                   const int snap_num);
 
 long long io_count_sinks_to_write(const struct space* s, const int subsample,
                                   const float subsample_ratio,
+                                  const struct output_region* region,
                                   const int snap_num);
 
 long long io_count_black_holes_to_write(const struct space* s,
                                         const int subsample,
                                         const float subsample_ratio,
+                                        const struct output_region* region,
                                         const int snap_num);
 
 long long io_count_neutrinos_to_write(const struct space* s,
                                       const int subsample,
                                       const float subsample_ratio,
+                                      const struct output_region* region,
                                       const int snap_num);
 
-void io_collect_parts_to_write(const struct part* restrict parts,
-                               const struct xpart* restrict xparts,
-                               struct part* restrict parts_written,
-                               struct xpart* restrict xparts_written,
-                               const int subsample, const float subsample_ratio,
+void io_collect_parts_to_write(struct threadpool* tp,
+                               const struct part* restrict parts,
+                               size_t* restrict index, const int subsample,
+                               const float subsample_ratio,
+                               const struct output_region* region,
                                const int snap_num, const size_t Nparts,
                                const size_t Nparts_written);
-void io_collect_sinks_to_write(const struct sink* restrict sinks,
-                               struct sink* restrict sinks_written,
-                               const int subsample, const float subsample_ratio,
+void io_collect_sinks_to_write(struct threadpool* tp,
+                               const struct sink* restrict sinks,
+                               size_t* restrict index, const int subsample,
+                               const float subsample_ratio,
+                               const struct output_region* region,
                                const int snap_num, const size_t Nsinks,
                                const size_t Nsinks_written);
-void io_collect_sparts_to_write(const struct spart* restrict sparts,
-                                struct spart* restrict sparts_written,
-                                const int subsample,
-                                const float subsample_ratio, const int snap_num,
-                                const size_t Nsparts,
+void io_collect_sparts_to_write(struct threadpool* tp,
+                                const struct spart* restrict sparts,
+                                size_t* restrict index, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Nsparts,
                                 const size_t Nsparts_written);
-void io_collect_bparts_to_write(const struct bpart* restrict bparts,
-                                struct bpart* restrict bparts_written,
-                                const int subsample,
-                                const float subsample_ratio, const int snap_num,
-                                const size_t Nbparts,
+void io_collect_bparts_to_write(struct threadpool* tp,
+                                const struct bpart* restrict bparts,
+                                size_t* restrict index, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Nbparts,
                                 const size_t Nbparts_written);
-void io_collect_gparts_to_write(const struct gpart* restrict gparts,
-                                const struct velociraptor_gpart_data* vr_data,
-                                struct gpart* restrict gparts_written,
-                                struct velociraptor_gpart_data* vr_data_written,
-                                const int subsample,
-                                const float subsample_ratio, const int snap_num,
-                                const size_t Ngparts,
-                                const size_t Ngparts_written, int with_stf);
-void io_collect_gparts_background_to_write(
-    const struct gpart* restrict gparts,
-    const struct velociraptor_gpart_data* vr_data,
-    struct gpart* restrict gparts_written,
-    struct velociraptor_gpart_data* vr_data_written, const int subsample,
-    const float subsample_ratio, const int snap_num, const size_t Ngparts,
-    const size_t Ngparts_written, int with_stf);
-void io_collect_gparts_neutrino_to_write(
-    const struct gpart* restrict gparts,
-    const struct velociraptor_gpart_data* vr_data,
-    struct gpart* restrict gparts_written,
-    struct velociraptor_gpart_data* vr_data_written, const int subsample,
-    const float subsample_ratio, const int snap_num, const size_t Ngparts,
-    const size_t Ngparts_written, int with_stf);
+void io_collect_gparts_to_write(struct threadpool* tp,
+                                const struct gpart* restrict gparts,
+                                size_t* restrict index,
+                                const enum part_type type, const int subsample,
+                                const float subsample_ratio,
+                                const struct output_region* region,
+                                const int snap_num, const size_t Ngparts,
+                                const size_t Ngparts_written);
+void io_props_set_index(struct io_props* list, const int num_fields,
+                        const size_t* index);
 
 void io_prepare_dm_gparts(struct threadpool* tp, struct gpart* const gparts,
                           size_t Ndm);
@@ -25,6 +25,8 @@
 
 /* Local includes. */
 #include "cell.h"
+#include "minmax.h"
+#include "output_options.h"
 #include "random.h"
 #include "timeline.h"
 #include "units.h"
@@ -32,6 +34,33 @@
 /* Standard includes */
 #include <float.h>
 
+/**
+ * @brief How does a top-level cell overlap a region of interest?
+ *
+ * The particles can have drifted out of their cell since the last rebuild so
+ * the cell is grown by half its width on each side before being compared to
+ * the region.
+ *
+ * @param region The #output_region (can be NULL for the full volume).
+ * @param c The top-level #cell.
+ *
+ * @return 0 if no particle of the cell can be in the region, 2 if all of
+ * them are and 1 if the particles have to be tested individually.
+ */
+int io_cell_region_overlap(const struct output_region* region,
+                           const struct cell* c) {
+
+  if (region == NULL) return 2;
+
+  const double loc[3] = {c->loc[0] - 0.5 * c->width[0],
+                         c->loc[1] - 0.5 * c->width[1],
+                         c->loc[2] - 0.5 * c->width[2]};
+  const double width[3] = {2. * c->width[0], 2. * c->width[1],
+                           2. * c->width[2]};
+
+  return output_region_overlap(region, loc, width);
+}
+
 /**
  * @brief Count the non-inhibted particles in the cell and return the
  * min/max positions
@@ -39,6 +68,8 @@
  * @param c The #cell.
  * @param subsample Are we subsampling the output?
  * @param susample_ratio Fraction of particles to write when sub-sampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
  * @param snap_num The snapshot number (used for the sampling random draws).
  * @param min_pos (return) The min position of all particles to write.
  * @param max_pos (return) The max position of all particles to write.
@@ -46,7 +77,8 @@
 #define CELL_COUNT_NON_INHIBITED_PARTICLES(TYPE, CELL_TYPE)                   \
   cell_count_non_inhibited_##TYPE(                                            \
       const struct cell* c, const int subsample, const float subsample_ratio, \
-      const int snap_num, double min_pos[3], double max_pos[3]) {             \
+      const struct output_region* region, const int snap_num,                 \
+      double min_pos[3], double max_pos[3]) {                                 \
                                                                               \
     const int total_count = c->CELL_TYPE.count;                               \
     const struct TYPE* parts = c->CELL_TYPE.parts;                            \
@@ -54,6 +86,12 @@
     min_pos[0] = min_pos[1] = min_pos[2] = DBL_MAX;                           \
     max_pos[0] = max_pos[1] = max_pos[2] = -DBL_MAX;                          \
                                                                               \
+    /* Skip the cells outside the region and only test the particles of       \
+     * the cells straddling its edge */                                       \
+    const int overlap = io_cell_region_overlap(region, c);                    \
+    if (overlap == 0) return 0;                                               \
+    const int test_region = (overlap == 1);                                   \
+                                                                              \
     for (int i = 0; i < total_count; ++i) {                                   \
       if ((parts[i].time_bin != time_bin_inhibited) &&                        \
           (parts[i].time_bin != time_bin_not_created)) {                      \
@@ -65,6 +103,10 @@
           if (r > subsample_ratio) continue;                                  \
         }                                                                     \
                                                                               \
+        /* Only keep the particles inside the region of interest */           \
+        if (test_region && !output_region_contains(region, parts[i].x))       \
+          continue;                                                           \
+                                                                              \
         ++count;                                                              \
                                                                               \
         min_pos[0] = min(parts[i].x[0], min_pos[0]);                          \
@@ -91,6 +133,8 @@ static long long CELL_COUNT_NON_INHIBITED_PARTICLES(sink, sinks);
  * @param c The #cell.
  * @param subsample Are we subsampling the output?
  * @param susample_ratio Fraction of particles to write when sub-sampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
  * @param snap_num The snapshot number (used for the sampling random draws).
  * @param min_pos (return) The min position of all particles to write.
  * @param max_pos (return) The max position of all particles to write.
@@ -98,7 +142,8 @@ static long long CELL_COUNT_NON_INHIBITED_PARTICLES(sink, sinks);
 #define CELL_COUNT_NON_INHIBITED_GPARTICLES(TYPE, PART_TYPE)                  \
   cell_count_non_inhibited_##TYPE(                                            \
       const struct cell* c, const int subsample, const float subsample_ratio, \
-      const int snap_num, double min_pos[3], double max_pos[3]) {             \
+      const struct output_region* region, const int snap_num,                 \
+      double min_pos[3], double max_pos[3]) {                                 \
                                                                               \
     const int total_count = c->grav.count;                                    \
     const struct gpart* gparts = c->grav.parts;                               \
@@ -106,6 +151,12 @@ static long long CELL_COUNT_NON_INHIBITED_PARTICLES(sink, sinks);
     min_pos[0] = min_pos[1] = min_pos[2] = DBL_MAX;                           \
     max_pos[0] = max_pos[1] = max_pos[2] = -DBL_MAX;                          \
                                                                               \
+    /* Skip the cells outside the region and only test the particles of       \
+     * the cells straddling its edge */                                       \
+    const int overlap = io_cell_region_overlap(region, c);                    \
+    if (overlap == 0) return 0;                                               \
+    const int test_region = (overlap == 1);                                   \
+                                                                              \
     for (int i = 0; i < total_count; ++i) {                                   \
       if ((gparts[i].time_bin != time_bin_inhibited) &&                       \
           (gparts[i].time_bin != time_bin_not_created) &&                     \
@@ -119,6 +170,10 @@ static long long CELL_COUNT_NON_INHIBITED_PARTICLES(sink, sinks);
           if (r > subsample_ratio) continue;                                  \
         }                                                                     \
                                                                               \
+        /* Only keep the particles inside the region of interest */           \
+        if (test_region && !output_region_contains(region, gparts[i].x))      \
+          continue;                                                           \
+                                                                              \
         ++count;                                                              \
                                                                               \
         min_pos[0] = min(gparts[i].x[0], min_pos[0]);                         \
@@ -148,18 +203,22 @@ static long long CELL_COUNT_NON_INHIBITED_GPARTICLES(neutrinos,
  * @param s The #space.
  * @param subsample Are we subsampling?
  * @param subsample_ratio The fraction of particle to keep when subsampling.
+ * @param region The region of interest to restrict the output to (NULL for
+ * the full volume).
  * @param snap_num The snapshot number to use as random seed.
  */
 #define IO_COUNT_PARTICLES_TO_WRITE(NAME, TYPE)                               \
   io_count_##NAME##_to_write(const struct space* s, const int subsample,      \
                              const float subsample_ratio,                     \
+                             const struct output_region* region,              \
                              const int snap_num) {                            \
     long long count = 0;                                                      \
     for (int i = 0; i < s->nr_local_cells; ++i) {                             \
       double dummy1[3], dummy2[3];                                            \
       const struct cell* c = &s->cells_top[s->local_cells_top[i]];            \
       count += cell_count_non_inhibited_##TYPE(c, subsample, subsample_ratio, \
-                                               snap_num, dummy1, dummy2);     \
+                                               region, snap_num, dummy1,      \
+                                               dummy2);                       \
     }                                                                         \
     return count;                                                             \
   }
@@ -251,6 +310,120 @@ void io_write_array(hid_t h_grp, const int n, const int dim, const void* array,
   H5Sclose(h_space);
 }
 
+/**
+ * @brief Write the range of chunks of a particle array in which the particles
+ * of each top-level cell are located.
+ *
+ * For each cell, we write the index of the first chunk and the number of
+ * chunks containing the cell's particles.
+ *
+ * @param h_grp The open hdf5 group.
+ * @param nr_cells The number of top-level cells.
+ * @param offsets The offset of each cell's particles in the array.
+ * @param counts The number of particles of each cell in the array.
+ * @param chunk_size The number of particles in each chunk.
+ * @param name The name of the array.
+ */
+static void io_write_cell_chunks(hid_t h_grp, const int nr_cells,
+                                 const long long* offsets,
+                                 const long long* counts,
+                                 const long long chunk_size,
+                                 const char* name) {
+
+  long long* chunks = (long long*)malloc(2 * nr_cells * sizeof(long long));
+  if (chunks == NULL) error("Unable to allocate memory for the chunk index");
+
+  for (int i = 0; i < nr_cells; ++i) {
+    const long long first = offsets[i] / chunk_size;
+    if (counts[i] > 0) {
+      const long long last = (offsets[i] + counts[i] - 1) / chunk_size;
+      chunks[2 * i + 0] = first;
+      chunks[2 * i + 1] = last - first + 1;
+    } else {
+      chunks[2 * i + 0] = first;
+      chunks[2 * i + 1] = 0;
+    }
+  }
+
+  io_write_array(h_grp, nr_cells, /*dim=*/2, chunks, LONGLONG, name,
+                 "chunks");
+  free(chunks);
+}
+
+/**
+ * @brief Compute the size of the chunks of the particle arrays such that the
+ * particles of a top-level cell span a fixed number of chunks.
+ *
+ * HDF5 chunks all have the same size so they cannot follow the cell
+ * boundaries exactly. Instead, we size them based on the mean number of
+ * particles in the top-level cells that contain particles of a given type.
+ * Reading a single cell then only requires decompressing a small number of
+ * chunks (see the /Cells/Chunks index written by io_write_cell_offsets()).
+ *
+ * @param cells_top The top-level cells.
+ * @param nr_cells The number of top-level cells.
+ * @param nodeID The rank of this node.
+ * @param chunks_per_cell The number of chunks per cell we aim for. 0 to use
+ * the default chunk size.
+ * @param N_total The total number of particles of each type to write across
+ * all nodes.
+ * @param chunk_sizes (return) The number of particles in a chunk for each
+ * particle type. 0 if the default size is to be used.
+ * @param comm The MPI communicator to use for the reductions (MPI only).
+ */
+void io_get_cell_aligned_chunk_sizes(
+    const struct cell* cells_top, const int nr_cells, const int nodeID,
+    const int chunks_per_cell, const long long N_total[swift_type_count],
+#ifdef WITH_MPI
+    long long chunk_sizes[swift_type_count], MPI_Comm comm) {
+#else
+    long long chunk_sizes[swift_type_count]) {
+#endif
+
+  for (int ptype = 0; ptype < swift_type_count; ++ptype)
+    chunk_sizes[ptype] = 0;
+
+  if (chunks_per_cell <= 0 || nr_cells == 0) return;
+
+  /* Count the local cells containing particles of each type. The gravity
+   * counts do not distinguish between the types of dark matter so all the
+   * cells with gravity particles are used for them. */
+  long long non_empty[swift_type_count] = {0};
+  for (int i = 0; i < nr_cells; ++i) {
+    const struct cell* c = &cells_top[i];
+    if (c->nodeID != nodeID) continue;
+
+    if (c->hydro.count > 0) non_empty[swift_type_gas]++;
+    if (c->sinks.count > 0) non_empty[swift_type_sink]++;
+    if (c->stars.count > 0) non_empty[swift_type_stars]++;
+    if (c->black_holes.count > 0) non_empty[swift_type_black_hole]++;
+    if (c->grav.count > 0) {
+      non_empty[swift_type_dark_matter]++;
+      non_empty[swift_type_dark_matter_background]++;
+      non_empty[swift_type_neutrino]++;
+    }
+  }
+
+#ifdef WITH_MPI
+  MPI_Allreduce(MPI_IN_PLACE, non_empty, swift_type_count, MPI_LONG_LONG_INT,
+                MPI_SUM, comm);
+#endif
+
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+
+    if (N_total[ptype] == 0 || non_empty[ptype] == 0) continue;
+
+    const long long num_chunks = non_empty[ptype] * chunks_per_cell;
+    long long size = (N_total[ptype] + num_chunks - 1) / num_chunks;
+
+    /* Avoid tiny chunks (large overheads) and huge ones (slow reads) */
+    size = max(size, IO_CELL_CHUNK_SIZE_MIN);
+    size = min(size, IO_CELL_CHUNK_SIZE_MAX);
+
+    chunk_sizes[ptype] = size;
+  }
+}
+
 /**
  * @brief Compute and write the top-level cell counts and offsets meta-data.
  *
@@ -262,6 +435,8 @@ void io_write_array(hid_t h_grp, const int n, const int dim, const void* array,
  * @param distributed Is this a distributed snapshot?
  * @param subsample Are we subsampling the different particle types?
  * @param subsample_fraction The fraction of particles to keep when subsampling.
+ * @param region The region of interest the output is restricted to (NULL for
+ * the full volume).
  * @param snap_num The snapshot number used as subsampling random seed.
  * @param global_counts The total number of particles across all nodes.
  * @param global_offsets The offsets of this node into the global list of
@@ -269,8 +444,12 @@ void io_write_array(hid_t h_grp, const int n, const int dim, const void* array,
  * @param to_write Whether a given particle type should be written to the cell
  * info.
  * @param numFields The number of fields to write for each particle type.
+ * @param chunk_sizes The size of the chunks of the particle arrays when they
+ * are aligned on the cells (see io_get_cell_aligned_chunk_sizes()). NULL if
+ * no chunk index is to be written.
  * @param internal_units The internal unit system.
  * @param snapshot_units The snapshot unit system.
+ * @param comm The MPI communicator to use for the reductions (MPI only).
  */
 void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                            const struct cell* cells_top, const int nr_cells,
@@ -278,13 +457,20 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                            const int distributed,
                            const int subsample[swift_type_count],
                            const float subsample_fraction[swift_type_count],
+                           const struct output_region* region,
                            const int snap_num,
                            const long long global_counts[swift_type_count],
                            const long long global_offsets[swift_type_count],
                            const int to_write[swift_type_count],
                            const int num_fields[swift_type_count],
+                           const long long chunk_sizes[swift_type_count],
                            const struct unit_system* internal_units,
+#ifdef WITH_MPI
+                           const struct unit_system* snapshot_units,
+                           MPI_Comm comm) {
+#else
                            const struct unit_system* snapshot_units) {
+#endif
 
 #ifdef SWIFT_DEBUG_CHECKS
   if (distributed) {
@@ -401,39 +587,39 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
        * positions */
       count_part[i] = cell_count_non_inhibited_part(
           &cells_top[i], subsample[swift_type_gas],
-          subsample_fraction[swift_type_gas], snap_num, &min_part_pos[i * 3],
-          &max_part_pos[i * 3]);
+          subsample_fraction[swift_type_gas], region, snap_num,
+          &min_part_pos[i * 3], &max_part_pos[i * 3]);
 
       count_gpart[i] = cell_count_non_inhibited_dark_matter(
           &cells_top[i], subsample[swift_type_dark_matter],
-          subsample_fraction[swift_type_dark_matter], snap_num,
+          subsample_fraction[swift_type_dark_matter], region, snap_num,
           &min_gpart_pos[i * 3], &max_gpart_pos[i * 3]);
 
       count_background_gpart[i] =
           cell_count_non_inhibited_background_dark_matter(
               &cells_top[i], subsample[swift_type_dark_matter_background],
-              subsample_fraction[swift_type_dark_matter_background], snap_num,
-              &min_gpart_background_pos[i * 3],
+              subsample_fraction[swift_type_dark_matter_background], region,
+              snap_num, &min_gpart_background_pos[i * 3],
               &max_gpart_background_pos[i * 3]);
 
       count_spart[i] = cell_count_non_inhibited_spart(
           &cells_top[i], subsample[swift_type_stars],
-          subsample_fraction[swift_type_stars], snap_num, &min_spart_pos[i * 3],
-          &max_spart_pos[i * 3]);
+          subsample_fraction[swift_type_stars], region, snap_num,
+          &min_spart_pos[i * 3], &max_spart_pos[i * 3]);
 
       count_bpart[i] = cell_count_non_inhibited_bpart(
           &cells_top[i], subsample[swift_type_black_hole],
-          subsample_fraction[swift_type_black_hole], snap_num,
+          subsample_fraction[swift_type_black_hole], region, snap_num,
           &min_bpart_pos[i * 3], &max_bpart_pos[i * 3]);
 
       count_sink[i] = cell_count_non_inhibited_sink(
           &cells_top[i], subsample[swift_type_sink],
-          subsample_fraction[swift_type_sink], snap_num, &min_sink_pos[i * 3],
-          &max_sink_pos[i * 3]);
+          subsample_fraction[swift_type_sink], region, snap_num,
+          &min_sink_pos[i * 3], &max_sink_pos[i * 3]);
 
       count_nupart[i] = cell_count_non_inhibited_neutrinos(
           &cells_top[i], subsample[swift_type_neutrino],
-          subsample_fraction[swift_type_neutrino], snap_num,
+          subsample_fraction[swift_type_neutrino], region, snap_num,
           &min_nupart_pos[i * 3], &max_nupart_pos[i * 3]);
 
       /* Offsets including the global offset of all particles on this MPI rank
@@ -490,69 +676,69 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
   /* Now, reduce all the arrays. Note that we use a bit-wise OR here. This
      is safe as we made sure only local cells have non-zero values. */
   MPI_Allreduce(MPI_IN_PLACE, count_part, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, count_gpart, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, count_background_gpart, nr_cells,
-                MPI_LONG_LONG_INT, MPI_BOR, MPI_COMM_WORLD);
+                MPI_LONG_LONG_INT, MPI_BOR, comm);
   MPI_Allreduce(MPI_IN_PLACE, count_sink, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, count_spart, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, count_bpart, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, count_nupart, nr_cells, MPI_LONG_LONG_INT,
-                MPI_BOR, MPI_COMM_WORLD);
+                MPI_BOR, comm);
 
   MPI_Allreduce(MPI_IN_PLACE, offset_part, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_gpart, nr_cells, MPI_LONG_LONG_INT,
-                MPI_BOR, MPI_COMM_WORLD);
+                MPI_BOR, comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_background_gpart, nr_cells,
-                MPI_LONG_LONG_INT, MPI_BOR, MPI_COMM_WORLD);
+                MPI_LONG_LONG_INT, MPI_BOR, comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_sink, nr_cells, MPI_LONG_LONG_INT, MPI_BOR,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_spart, nr_cells, MPI_LONG_LONG_INT,
-                MPI_BOR, MPI_COMM_WORLD);
+                MPI_BOR, comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_bpart, nr_cells, MPI_LONG_LONG_INT,
-                MPI_BOR, MPI_COMM_WORLD);
+                MPI_BOR, comm);
   MPI_Allreduce(MPI_IN_PLACE, offset_nupart, nr_cells, MPI_LONG_LONG_INT,
-                MPI_BOR, MPI_COMM_WORLD);
+                MPI_BOR, comm);
 
   /* For the centres we use a sum as MPI does not like bit-wise operations
      on floating point numbers */
   MPI_Allreduce(MPI_IN_PLACE, centres, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
 
   MPI_Allreduce(MPI_IN_PLACE, min_part_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, min_gpart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, min_gpart_background_pos, 3 * nr_cells,
-                MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+                MPI_DOUBLE, MPI_SUM, comm);
   MPI_Allreduce(MPI_IN_PLACE, min_spart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, min_bpart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, min_sink_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, min_nupart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
 
   MPI_Allreduce(MPI_IN_PLACE, max_part_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, max_gpart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, max_gpart_background_pos, 3 * nr_cells,
-                MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+                MPI_DOUBLE, MPI_SUM, comm);
   MPI_Allreduce(MPI_IN_PLACE, max_spart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, max_bpart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, max_sink_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
   MPI_Allreduce(MPI_IN_PLACE, max_nupart_pos, 3 * nr_cells, MPI_DOUBLE, MPI_SUM,
-                MPI_COMM_WORLD);
+                comm);
 #endif
 
   /* When writing a single file, only rank 0 writes the meta-data */
@@ -624,6 +810,16 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
         H5Gcreate(h_grp, "MaxPositions", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
     if (h_grp_counts < 0) error("Error while creating counts sub-group");
 
+    /* Group containing the chunks in which each cell's particles are */
+    hid_t h_grp_chunks = -1;
+    if (chunk_sizes != NULL) {
+      h_grp_chunks =
+          H5Gcreate(h_grp, "Chunks", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      if (h_grp_chunks < 0) error("Error while creating chunks sub-group");
+      io_write_attribute(h_grp_chunks, "chunk_sizes", LONGLONG, chunk_sizes,
+                         swift_type_count);
+    }
+
     if (to_write[swift_type_gas] > 0 && num_fields[swift_type_gas] > 0) {
       io_write_array(h_grp_files, nr_cells, /*dim=*/1, files, INT, "PartType0",
                      "files");
@@ -635,6 +831,9 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType0", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_part_pos, DOUBLE,
                      "PartType0", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_gas] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_part, count_part,
+                             chunk_sizes[swift_type_gas], "PartType0");
     }
 
     if (to_write[swift_type_dark_matter] > 0 &&
@@ -649,6 +848,9 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType1", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_gpart_pos, DOUBLE,
                      "PartType1", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_dark_matter] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_gpart, count_gpart,
+                             chunk_sizes[swift_type_dark_matter], "PartType1");
     }
 
     if (to_write[swift_type_dark_matter_background] > 0 &&
@@ -663,6 +865,12 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      min_gpart_background_pos, DOUBLE, "PartType2", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3,
                      max_gpart_background_pos, DOUBLE, "PartType2", "max_pos");
+      if (chunk_sizes != NULL &&
+          chunk_sizes[swift_type_dark_matter_background] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_background_gpart,
+                             count_background_gpart,
+                             chunk_sizes[swift_type_dark_matter_background],
+                             "PartType2");
     }
 
     if (to_write[swift_type_sink] > 0 && num_fields[swift_type_sink] > 0) {
@@ -676,6 +884,9 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType3", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_sink_pos, DOUBLE,
                      "PartType3", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_sink] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_sink, count_sink,
+                             chunk_sizes[swift_type_sink], "PartType3");
     }
 
     if (to_write[swift_type_stars] > 0 && num_fields[swift_type_stars] > 0) {
@@ -689,6 +900,9 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType4", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_spart_pos, DOUBLE,
                      "PartType4", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_stars] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_spart, count_spart,
+                             chunk_sizes[swift_type_stars], "PartType4");
     }
 
     if (to_write[swift_type_black_hole] > 0 &&
@@ -703,6 +917,9 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType5", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_bpart_pos, DOUBLE,
                      "PartType5", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_black_hole] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_bpart, count_bpart,
+                             chunk_sizes[swift_type_black_hole], "PartType5");
     }
 
     if (to_write[swift_type_neutrino] > 0 &&
@@ -717,6 +934,10 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
                      "PartType6", "min_pos");
       io_write_array(h_grp_max_pos, nr_cells, /*dim=*/3, max_nupart_pos, DOUBLE,
                      "PartType6", "max_pos");
+      if (chunk_sizes != NULL && chunk_sizes[swift_type_neutrino] > 0)
+        io_write_cell_chunks(h_grp_chunks, nr_cells, offset_nupart,
+                             count_nupart,
+                             chunk_sizes[swift_type_neutrino], "PartType6");
     }
 
     H5Gclose(h_grp_offsets);
@@ -724,6 +945,7 @@ void io_write_cell_offsets(hid_t h_grp, const int cdim[3], const double dim[3],
     H5Gclose(h_grp_counts);
     H5Gclose(h_grp_min_pos);
     H5Gclose(h_grp_max_pos);
+    if (chunk_sizes != NULL) H5Gclose(h_grp_chunks);
   }
 
   /* Free everything we allocated */
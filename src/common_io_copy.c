@@ -42,8 +42,8 @@ void io_copy_mapper(void* restrict temp, int N, void* restrict extra_data) {
   const ptrdiff_t delta = (temp_c - props.start_temp_c) / copySize;
 
   for (int k = 0; k < N; k++) {
-    memcpy(&temp_c[k * copySize], props.field + (delta + k) * props.partSize,
-           copySize);
+    const size_t j = io_props_index(&props, delta + k);
+    memcpy(&temp_c[k * copySize], props.field + j * props.partSize, copySize);
   }
 }
 
@@ -64,9 +64,10 @@ void io_convert_part_f_mapper(void* restrict temp, int N,
   float* restrict temp_f = (float*)temp;
   const ptrdiff_t delta = (temp_f - props.start_temp_f) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_part_f(e, parts + delta + i, xparts + delta + i,
-                         &temp_f[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_part_f(e, parts + j, xparts + j, &temp_f[i * dim]);
+  }
 }
 
 /**
@@ -86,9 +87,10 @@ void io_convert_part_i_mapper(void* restrict temp, int N,
   int* restrict temp_i = (int*)temp;
   const ptrdiff_t delta = (temp_i - props.start_temp_i) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_part_i(e, parts + delta + i, xparts + delta + i,
-                         &temp_i[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_part_i(e, parts + j, xparts + j, &temp_i[i * dim]);
+  }
 }
 
 /**
@@ -108,9 +110,10 @@ void io_convert_part_d_mapper(void* restrict temp, int N,
   double* restrict temp_d = (double*)temp;
   const ptrdiff_t delta = (temp_d - props.start_temp_d) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_part_d(e, parts + delta + i, xparts + delta + i,
-                         &temp_d[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_part_d(e, parts + j, xparts + j, &temp_d[i * dim]);
+  }
 }
 
 /**
@@ -130,9 +133,10 @@ void io_convert_part_l_mapper(void* restrict temp, int N,
   long long* restrict temp_l = (long long*)temp;
   const ptrdiff_t delta = (temp_l - props.start_temp_l) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_part_l(e, parts + delta + i, xparts + delta + i,
-                         &temp_l[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_part_l(e, parts + j, xparts + j, &temp_l[i * dim]);
+  }
 }
 
 /**
@@ -151,8 +155,10 @@ void io_convert_gpart_f_mapper(void* restrict temp, int N,
   float* restrict temp_f = (float*)temp;
   const ptrdiff_t delta = (temp_f - props.start_temp_f) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_gpart_f(e, gparts + delta + i, &temp_f[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_gpart_f(e, gparts + j, &temp_f[i * dim]);
+  }
 }
 
 /**
@@ -171,8 +177,10 @@ void io_convert_gpart_i_mapper(void* restrict temp, int N,
   int* restrict temp_i = (int*)temp;
   const ptrdiff_t delta = (temp_i - props.start_temp_i) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_gpart_i(e, gparts + delta + i, &temp_i[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_gpart_i(e, gparts + j, &temp_i[i * dim]);
+  }
 }
 
 /**
@@ -191,8 +199,10 @@ void io_convert_gpart_d_mapper(void* restrict temp, int N,
   double* restrict temp_d = (double*)temp;
   const ptrdiff_t delta = (temp_d - props.start_temp_d) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_gpart_d(e, gparts + delta + i, &temp_d[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_gpart_d(e, gparts + j, &temp_d[i * dim]);
+  }
 }
 
 /**
@@ -211,8 +221,10 @@ void io_convert_gpart_l_mapper(void* restrict temp, int N,
   long long* restrict temp_l = (long long*)temp;
   const ptrdiff_t delta = (temp_l - props.start_temp_l) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_gpart_l(e, gparts + delta + i, &temp_l[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_gpart_l(e, gparts + j, &temp_l[i * dim]);
+  }
 }
 
 /**
@@ -231,8 +243,10 @@ void io_convert_spart_f_mapper(void* restrict temp, int N,
   float* restrict temp_f = (float*)temp;
   const ptrdiff_t delta = (temp_f - props.start_temp_f) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_spart_f(e, sparts + delta + i, &temp_f[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_spart_f(e, sparts + j, &temp_f[i * dim]);
+  }
 }
 
 /**
@@ -251,8 +265,10 @@ void io_convert_spart_i_mapper(void* restrict temp, int N,
   int* restrict temp_i = (int*)temp;
   const ptrdiff_t delta = (temp_i - props.start_temp_i) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_spart_i(e, sparts + delta + i, &temp_i[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_spart_i(e, sparts + j, &temp_i[i * dim]);
+  }
 }
 
 /**
@@ -271,8 +287,10 @@ void io_convert_spart_d_mapper(void* restrict temp, int N,
   double* restrict temp_d = (double*)temp;
   const ptrdiff_t delta = (temp_d - props.start_temp_d) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_spart_d(e, sparts + delta + i, &temp_d[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_spart_d(e, sparts + j, &temp_d[i * dim]);
+  }
 }
 
 /**
@@ -291,8 +309,10 @@ void io_convert_spart_l_mapper(void* restrict temp, int N,
   long long* restrict temp_l = (long long*)temp;
   const ptrdiff_t delta = (temp_l - props.start_temp_l) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_spart_l(e, sparts + delta + i, &temp_l[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_spart_l(e, sparts + j, &temp_l[i * dim]);
+  }
 }
 
 /**
@@ -311,8 +331,10 @@ void io_convert_bpart_f_mapper(void* restrict temp, int N,
   float* restrict temp_f = (float*)temp;
   const ptrdiff_t delta = (temp_f - props.start_temp_f) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_bpart_f(e, bparts + delta + i, &temp_f[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_bpart_f(e, bparts + j, &temp_f[i * dim]);
+  }
 }
 
 /**
@@ -331,8 +353,10 @@ void io_convert_bpart_i_mapper(void* restrict temp, int N,
   int* restrict temp_i = (int*)temp;
   const ptrdiff_t delta = (temp_i - props.start_temp_i) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_bpart_i(e, bparts + delta + i, &temp_i[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_bpart_i(e, bparts + j, &temp_i[i * dim]);
+  }
 }
 
 /**
@@ -351,8 +375,10 @@ void io_convert_bpart_d_mapper(void* restrict temp, int N,
   double* restrict temp_d = (double*)temp;
   const ptrdiff_t delta = (temp_d - props.start_temp_d) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_bpart_d(e, bparts + delta + i, &temp_d[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_bpart_d(e, bparts + j, &temp_d[i * dim]);
+  }
 }
 
 /**
@@ -371,8 +397,10 @@ void io_convert_bpart_l_mapper(void* restrict temp, int N,
   long long* restrict temp_l = (long long*)temp;
   const ptrdiff_t delta = (temp_l - props.start_temp_l) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_bpart_l(e, bparts + delta + i, &temp_l[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_bpart_l(e, bparts + j, &temp_l[i * dim]);
+  }
 }
 
 /**
@@ -391,8 +419,10 @@ void io_convert_sink_f_mapper(void* restrict temp, int N,
   float* restrict temp_f = (float*)temp;
   const ptrdiff_t delta = (temp_f - props.start_temp_f) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_sink_f(e, sinks + delta + i, &temp_f[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_sink_f(e, sinks + j, &temp_f[i * dim]);
+  }
 }
 
 /**
@@ -411,8 +441,10 @@ void io_convert_sink_i_mapper(void* restrict temp, int N,
   int* restrict temp_i = (int*)temp;
   const ptrdiff_t delta = (temp_i - props.start_temp_i) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_sink_i(e, sinks + delta + i, &temp_i[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_sink_i(e, sinks + j, &temp_i[i * dim]);
+  }
 }
 
 /**
@@ -431,8 +463,10 @@ void io_convert_sink_d_mapper(void* restrict temp, int N,
   double* restrict temp_d = (double*)temp;
   const ptrdiff_t delta = (temp_d - props.start_temp_d) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_sink_d(e, sinks + delta + i, &temp_d[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_sink_d(e, sinks + j, &temp_d[i * dim]);
+  }
 }
 
 /**
@@ -451,8 +485,10 @@ void io_convert_sink_l_mapper(void* restrict temp, int N,
   long long* restrict temp_l = (long long*)temp;
   const ptrdiff_t delta = (temp_l - props.start_temp_l) / dim;
 
-  for (int i = 0; i < N; i++)
-    props.convert_sink_l(e, sinks + delta + i, &temp_l[i * dim]);
+  for (int i = 0; i < N; i++) {
+    const size_t j = io_props_index(&props, delta + i);
+    props.convert_sink_l(e, sinks + j, &temp_l[i * dim]);
+  }
 }
 
 /**
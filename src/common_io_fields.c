@@ -176,6 +176,12 @@ void io_prepare_output_fields(struct output_options* output_options,
     for (int i = 0; i < swift_type_count; ++i)
       subsample_fraction[i] = select_output_default_subsample_fraction;
 
+    /* Default region of interest (i.e. the full volume) */
+    struct output_region region;
+    bzero(&region, sizeof(struct output_region));
+    region.type = output_region_none;
+    int have_region_centre = 0;
+
     /* Initialise section-specific writing counters for each particle type.
      * If default is 'write', then we start from the total to deduct any fields
      * that are switched off. If the default is 'off', we have to start from
@@ -228,6 +234,38 @@ void io_prepare_output_fields(struct output_options* output_options,
         continue;
       }
 
+      /* Deal with a possible region of interest */
+      if (strstr(param_name, ":region_centre") != NULL) {
+        parser_get_param_double_array(params, param_name, 3, region.centre);
+        have_region_centre = 1;
+        continue;
+      }
+      if (strstr(param_name, ":region_radius") != NULL) {
+        if (region.type != output_region_none)
+          error("Output selection '%s' defines more than one region shape.",
+                section_name);
+        region.type = output_region_sphere;
+        region.radius = parser_get_param_double(params, param_name);
+        if (region.radius <= 0.)
+          error("The region radius of output selection '%s' must be positive.",
+                section_name);
+        continue;
+      }
+      if (strstr(param_name, ":region_half_size") != NULL) {
+        if (region.type != output_region_none)
+          error("Output selection '%s' defines more than one region shape.",
+                section_name);
+        region.type = output_region_box;
+        parser_get_param_double_array(params, param_name, 3, region.half_size);
+        for (int k = 0; k < 3; ++k)
+          if (region.half_size[k] <= 0.)
+            error(
+                "The region half-sizes of output selection '%s' must be "
+                "positive.",
+                section_name);
+        continue;
+      }
+
       /* Deal with a possible non-standard subsampling option */
       if (strstr(param_name, ":subsample") != NULL) {
         parser_get_param_int_array(params, param_name, swift_type_count,
@@ -304,6 +342,13 @@ void io_prepare_output_fields(struct output_options* output_options,
       }
     } /* ends loop over parameters */
 
+    /* A region of interest needs both a centre and a shape */
+    if (have_region_centre != (region.type != output_region_none))
+      error(
+          "Output selection '%s' must specify a region_centre together with "
+          "either a region_radius or a region_half_size.",
+          section_name);
+
     /* Second loop over ptypes, to write out total number of fields to write */
     for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -326,6 +371,8 @@ void io_prepare_output_fields(struct output_options* output_options,
            swift_type_count * sizeof(int));
     memcpy(output_options->subsample_fractions[section_id], subsample_fraction,
            swift_type_count * sizeof(float));
+    memcpy(&output_options->regions[section_id], &region,
+           sizeof(struct output_region));
 
   } /* Ends loop over sections, for different output classes */
 
@@ -346,6 +393,8 @@ void io_prepare_output_fields(struct output_options* output_options,
     for (int i = 0; i < swift_type_count; ++i)
       output_options->subsample_fractions[default_id][i] =
           select_output_default_subsample_fraction;
+    bzero(&output_options->regions[default_id], sizeof(struct output_region));
+    output_options->regions[default_id].type = output_region_none;
   }
 }
 
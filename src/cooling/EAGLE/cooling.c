@@ -190,6 +190,25 @@ void cooling_update(const struct phys_const *phys_const,
   cooling->z_index = z_index;
 }
 
+/**
+ * @brief Would a call to cooling_update() at the current redshift modify
+ * the cooling tables in place?
+ *
+ * That is the case when we need to read a new pair of redshift tables.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ */
+int cooling_update_modifies_tables(const struct cosmology *cosmo,
+                                   struct cooling_function_data *cooling) {
+
+  int z_index = -1;
+  float dz = 0.f;
+  get_redshift_index(cosmo->z, &z_index, &dz, cooling);
+
+  return cooling->z_index != z_index;
+}
+
 /**
  * @brief Bisection integration scheme
  *
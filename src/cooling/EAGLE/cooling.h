@@ -43,6 +43,9 @@ void cooling_update(const struct phys_const *phys_const,
                     struct cooling_function_data *cooling, struct space *s,
                     const double time);
 
+int cooling_update_modifies_tables(const struct cosmology *cosmo,
+                                   struct cooling_function_data *cooling);
+
 void cooling_cool_part(const struct phys_const *phys_const,
                        const struct unit_system *us,
                        const struct cosmology *cosmo,
@@ -61,6 +61,14 @@ static const float explicit_tolerance = 0.05;
 static const float bisection_tolerance = 1.0e-6;
 static const double bracket_factor = 1.5;
 
+/* Maximum number of iterations of the Newton-Raphson fast path */
+static const int newton_max_iterations = 10;
+
+/* Step (in log10(u)) used to evaluate the derivative of the cooling rate and
+ * largest change of log10(u) allowed in one Newton-Raphson iteration */
+static const double newton_log_u_step = 1.0e-3;
+static const double newton_max_log_u_change = 1.;
+
 /**
  * @brief Common operations performed on the cooling function at a
  * given time-step or redshift. Predominantly used to read cooling tables
@@ -80,6 +88,18 @@ void cooling_update(const struct phys_const *phys_const,
                     struct cooling_function_data *cooling, struct space *s,
                     const double time) {
 
+  /* Interpolate the tables to the current redshift if it changed */
+  if (cooling->use_redshift_slice) {
+
+    int red_index;
+    float d_red;
+    get_index_1d(cooling->Redshifts, colibre_cooling_N_redshifts, cosmo->z,
+                 &red_index, &d_red);
+
+    if (red_index != cooling->slice_red_index || d_red != cooling->slice_d_red)
+      compute_cooling_redshift_slices(cooling, red_index, d_red);
+  }
+
   /* Extra energy for reionization? */
   if (!cooling->H_reion_done) {
 
@@ -98,6 +118,30 @@ void cooling_update(const struct phys_const *phys_const,
   }
 }
 
+/**
+ * @brief Would a call to cooling_update() at the current redshift modify
+ * the cooling tables in place?
+ *
+ * That is the case when the tables are interpolated to the current redshift
+ * (see compute_cooling_redshift_slices()) and the redshift changed.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ */
+int cooling_update_modifies_tables(const struct cosmology *cosmo,
+                                   struct cooling_function_data *cooling) {
+
+  if (!cooling->use_redshift_slice) return 0;
+
+  int red_index;
+  float d_red;
+  get_index_1d(cooling->Redshifts, colibre_cooling_N_redshifts, cosmo->z,
+               &red_index, &d_red);
+
+  return red_index != cooling->slice_red_index ||
+         d_red != cooling->slice_d_red;
+}
+
 /**
  * @brief Compute the internal energy of a #part based on the cooling function
  * but for a given temperature.
@@ -512,6 +556,87 @@ double cooling_get_ycompton(const struct phys_const *phys_const,
   return cooling->y_compton_factor * exp10(log10_T) * m * n_e / rho_phys;
 }
 
+/**
+ * @brief Newton-Raphson integration scheme
+ *
+ * Solves the same implicit problem as bisection_iter() but iterates on
+ * log(u) using the local slope of the cooling rate, which takes a handful
+ * of iterations when the rate is smooth around the solution.
+ * This is only an attempt: if the iterations do not converge quickly, leave
+ * the allowed range of energies or hit a non-monotonic part of the rate,
+ * we give up and the caller falls back to the bisection.
+ *
+ * @param u_ini_cgs Internal energy at beginning of hydro step in CGS.
+ * @param n_H_cgs Hydrogen number density in CGS.
+ * @param redshift Current redshift.
+ * @param n_H_index Particle hydrogen number density index.
+ * @param d_n_H Particle hydrogen number density offset.
+ * @param met_index Particle metallicity index.
+ * @param d_met Particle metallicity offset.
+ * @param red_index Redshift index.
+ * @param d_red Redshift offset.
+ * @param Lambda_He_reion_cgs Cooling rate coming from He reionization.
+ * @param ratefact_cgs Multiplication factor to get a cooling rate.
+ * @param cooling #cooling_function_data structure.
+ * @param abundance_ratio Array of ratios of metal abundance to solar.
+ * @param dt_cgs timestep in CGS.
+ * @return The final internal energy in CGS or -1 if we did not converge.
+ */
+static INLINE double newton_iter(
+    const double u_ini_cgs, const double n_H_cgs, const double redshift,
+    int n_H_index, float d_n_H, int met_index, float d_met, int red_index,
+    float d_red, double Lambda_He_reion_cgs, double ratefact_cgs,
+    const struct cooling_function_data *cooling,
+    const float abundance_ratio[colibre_cooling_N_elementtypes],
+    double dt_cgs) {
+
+  const double rate_to_du = ratefact_cgs * dt_cgs;
+  const double log10_umin_cgs = log10(cooling->umin_cgs);
+
+  double log10_u_cgs = log10(max(u_ini_cgs, cooling->umin_cgs));
+
+  for (int i = 0; i < newton_max_iterations; i++) {
+
+    const double u_cgs = exp10(log10_u_cgs);
+
+    /* Rate and its slope w.r.t. log10(u) */
+    const double LambdaNet_cgs =
+        Lambda_He_reion_cgs +
+        colibre_cooling_rate(log10_u_cgs, redshift, n_H_cgs, abundance_ratio,
+                             n_H_index, d_n_H, met_index, d_met, red_index,
+                             d_red, cooling, 0, 0, 0, 0);
+    const double LambdaNet_step_cgs =
+        Lambda_He_reion_cgs +
+        colibre_cooling_rate(log10_u_cgs + newton_log_u_step, redshift,
+                             n_H_cgs, abundance_ratio, n_H_index, d_n_H,
+                             met_index, d_met, red_index, d_red, cooling, 0, 0,
+                             0, 0);
+    const double dLambdaNet_dlog10u =
+        (LambdaNet_step_cgs - LambdaNet_cgs) / newton_log_u_step;
+
+    /* f(u) = u - u_ini - dt * du/dt(u) and its derivative w.r.t. log10(u) */
+    const double f = u_cgs - u_ini_cgs - LambdaNet_cgs * rate_to_du;
+    const double df = u_cgs * M_LN10 - dLambdaNet_dlog10u * rate_to_du;
+
+    /* Heating growing faster than u: leave this to the bisection */
+    if (df <= 0.) return -1.;
+
+    double delta_log10_u = -f / df;
+    delta_log10_u = min(delta_log10_u, newton_max_log_u_change);
+    delta_log10_u = max(delta_log10_u, -newton_max_log_u_change);
+
+    log10_u_cgs += delta_log10_u;
+
+    /* The floor is handled by the bisection */
+    if (log10_u_cgs <= log10_umin_cgs) return -1.;
+
+    if (fabs(delta_log10_u) * M_LN10 < bisection_tolerance)
+      return exp10(log10_u_cgs);
+  }
+
+  return -1.;
+}
+
 /**
  * @brief Bisection integration scheme
  *
@@ -716,6 +841,9 @@ static INLINE double bisection_iter(
  * A bisection scheme is used.
  * This is done by first bracketing the solution and then iterating
  * towards the solution by reducing the window down to a certain tolerance.
+ * If PS2020Cooling:use_newton_raphson is set, a few Newton-Raphson
+ * iterations are attempted first and the bisection is only used if they
+ * fail to converge.
  * Note there is always at least one solution since
  * f(+inf) is < 0 and f(-inf) is > 0.
  *
@@ -844,10 +972,19 @@ void cooling_cool_part(const struct phys_const *phys_const,
 
   } else {
 
-    u_final_cgs =
-        bisection_iter(u_0_cgs, n_H_cgs, cosmo->z, n_H_index, d_n_H, met_index,
-                       d_met, red_index, d_red, Lambda_He_reion_cgs,
-                       ratefact_cgs, cooling, abundance_ratio, dt_cgs, p->id);
+    /* Try the fast path first, if requested */
+    u_final_cgs = -1.;
+    if (cooling->use_newton_raphson)
+      u_final_cgs =
+          newton_iter(u_0_cgs, n_H_cgs, cosmo->z, n_H_index, d_n_H, met_index,
+                      d_met, red_index, d_red, Lambda_He_reion_cgs,
+                      ratefact_cgs, cooling, abundance_ratio, dt_cgs);
+
+    if (u_final_cgs < 0.)
+      u_final_cgs = bisection_iter(u_0_cgs, n_H_cgs, cosmo->z, n_H_index,
+                                   d_n_H, met_index, d_met, red_index, d_red,
+                                   Lambda_He_reion_cgs, ratefact_cgs, cooling,
+                                   abundance_ratio, dt_cgs, p->id);
   }
 
   /* Convert back to internal units */
@@ -1588,9 +1725,18 @@ void cooling_init_backend(struct swift_params *parameter_file,
   cooling->rapid_cooling_threshold = parser_get_param_double(
       parameter_file, "PS2020Cooling:rapid_cooling_threshold");
 
+  /* Optional speed-ups of the implicit solver */
+  cooling->use_redshift_slice = parser_get_opt_param_int(
+      parameter_file, "PS2020Cooling:use_redshift_slice", 0);
+  cooling->use_newton_raphson = parser_get_opt_param_int(
+      parameter_file, "PS2020Cooling:use_newton_raphson", 0);
+
   /* Finally, read the tables */
   read_cooling_header(cooling);
   read_cooling_tables(cooling);
+
+  cooling->slice_red_index = -1;
+  if (cooling->use_redshift_slice) allocate_cooling_redshift_slices(cooling);
 }
 
 /**
@@ -1606,6 +1752,9 @@ void cooling_restore_tables(struct cooling_function_data *cooling,
   read_cooling_header(cooling);
   read_cooling_tables(cooling);
 
+  cooling->slice_red_index = -1;
+  if (cooling->use_redshift_slice) allocate_cooling_redshift_slices(cooling);
+
   cooling_update(/*phys_const=*/NULL, cosmo, /*pfloor=*/NULL, cooling,
                  /*space=*/NULL, /*time=*/0);
 }
@@ -1663,6 +1812,8 @@ void cooling_clean(struct cooling_function_data *cooling) {
   swift_free("cooling_table.Hfracs", cooling->table.logHfracs_all);
   swift_free("cooling_table.Teq", cooling->table.logTeq);
   swift_free("cooling_table.Peq", cooling->table.logPeq);
+
+  if (cooling->use_redshift_slice) free_cooling_redshift_slices(cooling);
 }
 
 /**
@@ -1698,6 +1849,10 @@ void cooling_struct_dump(const struct cooling_function_data *cooling,
   cooling_copy.table.Uelectron_fraction = NULL;
   cooling_copy.table.T_from_U = NULL;
   cooling_copy.table.U_from_T = NULL;
+  cooling_copy.table.Ucooling_z = NULL;
+  cooling_copy.table.Uheating_z = NULL;
+  cooling_copy.table.Uelectron_fraction_z = NULL;
+  cooling_copy.table.T_from_U_z = NULL;
 
   restart_write_blocks((void *)&cooling_copy,
                        sizeof(struct cooling_function_data), 1, stream,
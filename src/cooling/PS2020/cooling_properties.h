@@ -70,6 +70,18 @@ struct cooling_tables {
 
   /* array of all hydrogen fractions */
   float *logHfracs_all;
+
+  /* Ucooling interpolated to the current redshift */
+  float *Ucooling_z;
+
+  /* Uheating interpolated to the current redshift */
+  float *Uheating_z;
+
+  /* Uelectron_fraction interpolated to the current redshift */
+  float *Uelectron_fraction_z;
+
+  /* T_from_U interpolated to the current redshift */
+  float *T_from_U_z;
 };
 
 /**
@@ -197,6 +209,19 @@ struct cooling_function_data {
 
   /*! Threshold to switch between rapid and slow cooling regimes. */
   double rapid_cooling_threshold;
+
+  /*! Interpolate the u-dependent tables to the current redshift once per
+   * step? */
+  int use_redshift_slice;
+
+  /*! Redshift index the slices of the tables were built for (-1 if none) */
+  int slice_red_index;
+
+  /*! Offset from the redshift index the slices were built for */
+  float slice_d_red;
+
+  /*! Try Newton-Raphson iterations before bisecting the implicit solution? */
+  int use_newton_raphson;
 };
 
 /**
@@ -583,52 +583,103 @@ INLINE static double colibre_cooling_rate(
   get_index_1d(cooling->Therm, colibre_cooling_N_internalenergy, log_u_cgs,
                &U_index, &d_U);
 
-  /* n_e / n_H */
-  const double electron_fraction = interpolation4d_plus_summation(
-      cooling->table.Uelectron_fraction, abundance_ratio, /* */
-      element_H, colibre_cooling_N_electrontypes - 4,     /* */
-      red_index, U_index, met_index, n_H_index,           /* */
-      d_red, d_U, d_met, d_n_H,                           /* */
-      colibre_cooling_N_redshifts,                        /* */
-      colibre_cooling_N_internalenergy,                   /* */
-      colibre_cooling_N_metallicity,                      /* */
-      colibre_cooling_N_density,                          /* */
-      colibre_cooling_N_electrontypes);                   /* */
-
-  /* Lambda / n_H**2 */
-  const double cooling_rate = interpolation4d_plus_summation(
-      cooling->table.Ucooling, weights_cooling,   /* */
-      element_H, colibre_cooling_N_cooltypes - 3, /* */
-      red_index, U_index, met_index, n_H_index,   /* */
-      d_red, d_U, d_met, d_n_H,                   /* */
-      colibre_cooling_N_redshifts,                /* */
-      colibre_cooling_N_internalenergy,           /* */
-      colibre_cooling_N_metallicity,              /* */
-      colibre_cooling_N_density,                  /* */
-      colibre_cooling_N_cooltypes);               /* */
-
-  /* Gamma / n_H**2 */
-  const double heating_rate = interpolation4d_plus_summation(
-      cooling->table.Uheating, weights_heating,   /* */
-      element_H, colibre_cooling_N_heattypes - 3, /* */
-      red_index, U_index, met_index, n_H_index,   /* */
-      d_red, d_U, d_met, d_n_H,                   /* */
-      colibre_cooling_N_redshifts,                /* */
-      colibre_cooling_N_internalenergy,           /* */
-      colibre_cooling_N_metallicity,              /* */
-      colibre_cooling_N_density,                  /* */
-      colibre_cooling_N_heattypes);               /* */
+  double electron_fraction, cooling_rate, heating_rate, logtemp;
+
+  if (cooling->use_redshift_slice && red_index == cooling->slice_red_index &&
+      d_red == cooling->slice_d_red) {
+
+    /* The tables have already been interpolated to this redshift
+     * (see cooling_update()) */
+
+    /* n_e / n_H */
+    electron_fraction = interpolation3d_plus_summation(
+        cooling->table.Uelectron_fraction_z, abundance_ratio, /* */
+        element_H, colibre_cooling_N_electrontypes - 4,       /* */
+        U_index, met_index, n_H_index,                        /* */
+        d_U, d_met, d_n_H,                                    /* */
+        colibre_cooling_N_internalenergy,                     /* */
+        colibre_cooling_N_metallicity,                        /* */
+        colibre_cooling_N_density,                            /* */
+        colibre_cooling_N_electrontypes);                     /* */
+
+    /* Lambda / n_H**2 */
+    cooling_rate = interpolation3d_plus_summation(
+        cooling->table.Ucooling_z, weights_cooling, /* */
+        element_H, colibre_cooling_N_cooltypes - 3, /* */
+        U_index, met_index, n_H_index,              /* */
+        d_U, d_met, d_n_H,                          /* */
+        colibre_cooling_N_internalenergy,           /* */
+        colibre_cooling_N_metallicity,              /* */
+        colibre_cooling_N_density,                  /* */
+        colibre_cooling_N_cooltypes);               /* */
+
+    /* Gamma / n_H**2 */
+    heating_rate = interpolation3d_plus_summation(
+        cooling->table.Uheating_z, weights_heating, /* */
+        element_H, colibre_cooling_N_heattypes - 3, /* */
+        U_index, met_index, n_H_index,              /* */
+        d_U, d_met, d_n_H,                          /* */
+        colibre_cooling_N_internalenergy,           /* */
+        colibre_cooling_N_metallicity,              /* */
+        colibre_cooling_N_density,                  /* */
+        colibre_cooling_N_heattypes);               /* */
+
+    /* Temperature from internal energy */
+    logtemp = interpolation_3d(cooling->table.T_from_U_z,        /* */
+                               U_index, met_index, n_H_index,    /* */
+                               d_U, d_met, d_n_H,                /* */
+                               colibre_cooling_N_internalenergy, /* */
+                               colibre_cooling_N_metallicity,    /* */
+                               colibre_cooling_N_density);       /* */
+
+  } else {
+
+    /* n_e / n_H */
+    electron_fraction = interpolation4d_plus_summation(
+        cooling->table.Uelectron_fraction, abundance_ratio, /* */
+        element_H, colibre_cooling_N_electrontypes - 4,     /* */
+        red_index, U_index, met_index, n_H_index,           /* */
+        d_red, d_U, d_met, d_n_H,                           /* */
+        colibre_cooling_N_redshifts,                        /* */
+        colibre_cooling_N_internalenergy,                   /* */
+        colibre_cooling_N_metallicity,                      /* */
+        colibre_cooling_N_density,                          /* */
+        colibre_cooling_N_electrontypes);                   /* */
+
+    /* Lambda / n_H**2 */
+    cooling_rate = interpolation4d_plus_summation(
+        cooling->table.Ucooling, weights_cooling,   /* */
+        element_H, colibre_cooling_N_cooltypes - 3, /* */
+        red_index, U_index, met_index, n_H_index,   /* */
+        d_red, d_U, d_met, d_n_H,                   /* */
+        colibre_cooling_N_redshifts,                /* */
+        colibre_cooling_N_internalenergy,           /* */
+        colibre_cooling_N_metallicity,              /* */
+        colibre_cooling_N_density,                  /* */
+        colibre_cooling_N_cooltypes);               /* */
+
+    /* Gamma / n_H**2 */
+    heating_rate = interpolation4d_plus_summation(
+        cooling->table.Uheating, weights_heating,   /* */
+        element_H, colibre_cooling_N_heattypes - 3, /* */
+        red_index, U_index, met_index, n_H_index,   /* */
+        d_red, d_U, d_met, d_n_H,                   /* */
+        colibre_cooling_N_redshifts,                /* */
+        colibre_cooling_N_internalenergy,           /* */
+        colibre_cooling_N_metallicity,              /* */
+        colibre_cooling_N_density,                  /* */
+        colibre_cooling_N_heattypes);               /* */
+
+    /* Temperature from internal energy */
+    logtemp = interpolation_4d(cooling->table.T_from_U,                  /* */
+                               red_index, U_index, met_index, n_H_index, /* */
+                               d_red, d_U, d_met, d_n_H,                 /* */
+                               colibre_cooling_N_redshifts,              /* */
+                               colibre_cooling_N_internalenergy,         /* */
+                               colibre_cooling_N_metallicity,            /* */
+                               colibre_cooling_N_density);               /* */
+  }
 
-  /* Temperature from internal energy */
-  const double logtemp =
-      interpolation_4d(cooling->table.T_from_U,                  /* */
-                       red_index, U_index, met_index, n_H_index, /* */
-                       d_red, d_U, d_met, d_n_H,                 /* */
-                       colibre_cooling_N_redshifts,              /* */
-                       colibre_cooling_N_internalenergy,         /* */
-                       colibre_cooling_N_metallicity,            /* */
-                       colibre_cooling_N_density);               /* */
-                                                                 /* */
   const double temp = exp10(logtemp);
 
   /* Compton cooling/heating */
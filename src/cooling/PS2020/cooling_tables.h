@@ -114,5 +114,9 @@ struct cooling_function_data;
 void get_cooling_redshifts(struct cooling_function_data *cooling);
 void read_cooling_header(struct cooling_function_data *cooling);
 void read_cooling_tables(struct cooling_function_data *cooling);
+void allocate_cooling_redshift_slices(struct cooling_function_data *cooling);
+void compute_cooling_redshift_slices(struct cooling_function_data *cooling,
+                                     const int red_index, const float d_red);
+void free_cooling_redshift_slices(struct cooling_function_data *cooling);
 
 #endif
@@ -569,6 +569,74 @@ __attribute__((always_inline)) INLINE double interpolation4d_plus_summation(
   return result_global;
 }
 
+/**
+ * @brief Interpolates a 4 dimensional array in the first 3 dimensions and
+ * adds the individual contributions from the 4th dimension according to their
+ * weights
+ *
+ * This is the counterpart of interpolation4d_plus_summation() for tables from
+ * which one dimension has already been interpolated out.
+ *
+ * @param table The table to interpolate
+ * @param weights The weights for summing up the individual contributions
+ * @param istart, iend Start and stop index for 4th dimension
+ * @param xi, yi, zi Indices of table element
+ * @param dx, dy, dz Distance between the point and the index in units of
+ * the grid spacing.
+ * @param Nx, Ny, Nz, Nw Sizes of array dimensions
+ */
+__attribute__((always_inline)) INLINE double interpolation3d_plus_summation(
+    const float *table, const float *weights, const int istart, const int iend,
+    const int xi, const int yi, const int zi, const float dx, const float dy,
+    const float dz, const int Nx, const int Ny, const int Nz, const int Nw) {
+
+  const float tx = 1.f - dx;
+  const float ty = 1.f - dy;
+  const float tz = 1.f - dz;
+
+  /* Indicate that the whole array is aligned on boundaries */
+  swift_align_information(float, table, SWIFT_STRUCT_ALIGNMENT);
+
+  float result;
+  double result_global = 0.;
+
+  for (int i = istart; i <= iend; i++) {
+
+    /* Linear interpolation along each axis. We read the table 2^3=8 times */
+    result = tx * ty * tz *
+             table[row_major_index_4d(xi + 0, yi + 0, zi + 0, i, Nx, Ny, Nz,
+                                      Nw)];
+
+    result += tx * ty * dz *
+              table[row_major_index_4d(xi + 0, yi + 0, zi + 1, i, Nx, Ny, Nz,
+                                       Nw)];
+    result += tx * dy * tz *
+              table[row_major_index_4d(xi + 0, yi + 1, zi + 0, i, Nx, Ny, Nz,
+                                       Nw)];
+    result += dx * ty * tz *
+              table[row_major_index_4d(xi + 1, yi + 0, zi + 0, i, Nx, Ny, Nz,
+                                       Nw)];
+
+    result += tx * dy * dz *
+              table[row_major_index_4d(xi + 0, yi + 1, zi + 1, i, Nx, Ny, Nz,
+                                       Nw)];
+    result += dx * ty * dz *
+              table[row_major_index_4d(xi + 1, yi + 0, zi + 1, i, Nx, Ny, Nz,
+                                       Nw)];
+    result += dx * dy * tz *
+              table[row_major_index_4d(xi + 1, yi + 1, zi + 0, i, Nx, Ny, Nz,
+                                       Nw)];
+
+    result += dx * dy * dz *
+              table[row_major_index_4d(xi + 1, yi + 1, zi + 1, i, Nx, Ny, Nz,
+                                       Nw)];
+
+    result_global += weights[i] * exp10f(result);
+  }
+
+  return result_global;
+}
+
 /**
  * @brief Interpolate a flattened 4D table at a given position but avoid the
  * x-dimension.
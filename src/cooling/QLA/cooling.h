@@ -44,6 +44,20 @@ void cooling_update(const struct phys_const *phys_const,
                     struct cooling_function_data *cooling, struct space *s,
                     const double time);
 
+/**
+ * @brief Would a call to cooling_update() at the current redshift modify
+ * the cooling tables in place?
+ *
+ * The tables of this model are read once and for all at the start.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ */
+INLINE static int cooling_update_modifies_tables(
+    const struct cosmology *cosmo, struct cooling_function_data *cooling) {
+  return 0;
+}
+
 void cooling_cool_part(const struct phys_const *phys_const,
                        const struct unit_system *us,
                        const struct cosmology *cosmo,
@@ -63,6 +63,20 @@ INLINE static void cooling_update(
   // Add content if required.
 }
 
+/**
+ * @brief Would a call to cooling_update() at the current redshift modify
+ * the cooling tables in place?
+ *
+ * There are no tables here.
+ *
+ * @param cosmo The current cosmological model.
+ * @param cooling The #cooling_function_data used in the run.
+ */
+INLINE static int cooling_update_modifies_tables(
+    const struct cosmology* cosmo, struct cooling_function_data* cooling) {
+  return 0;
+}
+
 /**
  * @brief Calculates du/dt in CGS units for a particle.
  *
@@ -78,6 +78,7 @@ static const int io_max_size_output_list = 100;
  * @param props The #io_props of the field to read
  * @param N The number of particles to write.
  * @param lossy_compression Level of lossy compression to use for this field.
+ * @param chunk_size The number of particles per chunk (0 for the default).
  * @param internal_units The #unit_system used internally
  * @param snapshot_units The #unit_system used in the snapshots
  *
@@ -88,7 +89,7 @@ void write_distributed_array(
     const struct engine* e, hid_t grp, const char* fileName,
     const char* partTypeGroupName, const struct io_props props, const size_t N,
     const enum lossy_compression_schemes lossy_compression,
-    const struct unit_system* internal_units,
+    const long long chunk_size, const struct unit_system* internal_units,
     const struct unit_system* snapshot_units) {
 
 #ifdef IO_SPEED_MEASUREMENT
@@ -150,6 +151,9 @@ void write_distributed_array(
     chunk_shape[1] = 0;
   }
 
+  /* Use the chunk size aligned on the top-level cells if we have one */
+  if (chunk_size > 0) chunk_shape[0] = chunk_size;
+
   /* Make sure the chunks are not larger than the dataset */
   if (chunk_shape[0] > N) chunk_shape[0] = N;
 
@@ -208,10 +212,19 @@ void write_distributed_array(
   tic = getticks();
 #endif
 
-  /* Write temporary buffer to HDF5 dataspace */
-  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
-                   H5P_DEFAULT, temp);
-  if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  /* Compress the chunks on the threadpool if we can */
+  int written = 0;
+  if (e->snapshot_compress_on_threads)
+    written = io_write_compressed_chunks(
+        (struct threadpool*)&e->threadpool, h_data, io_hdf5_type(props.type),
+        h_type, temp, N, props.dimension);
+
+  /* Otherwise, write temporary buffer to HDF5 dataspace */
+  if (!written) {
+    h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
+                     H5P_DEFAULT, temp);
+    if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  }
 
 #ifdef IO_SPEED_MEASUREMENT
   ticks toc = getticks();
@@ -277,9 +290,34 @@ void write_distributed_array(
 #endif
 }
 
+/**
+ * @brief Number of ranks whose files are gathered by each aggregator rank in
+ * a virtual group of its own file.
+ *
+ * @param group_size The requested size (Snapshots:virtual_group_size).
+ * @param mpi_size The number of MPI ranks.
+ * @return The size of the groups, 0 if the virtual file maps all the files
+ * directly.
+ */
+static int distributed_io_virtual_group_size(const int group_size,
+                                             const int mpi_size) {
+
+  /* Automatic choice: groups of sqrt(N) ranks on large runs */
+  if (group_size == 0) {
+    if (mpi_size < 1024) return 0;
+    return (int)ceil(sqrt((double)mpi_size));
+  }
+
+  if (group_size == 1 || group_size >= mpi_size) return 0;
+  return group_size;
+}
+
 /**
  * @brief Prepares an array in the snapshot.
  *
+ * The virtual dataset maps the same array in a series of source files, one
+ * slab per source.
+ *
  * @param e The #engine we are writing from.
  * @param grp The HDF5 grp to write to.
  * @param fileName The name of the file we are writing to.
@@ -287,13 +325,24 @@ void write_distributed_array(
  * @param partTypeGroupName The name of the group we are writing to.
  * @param props The #io_props of the field to write.
  * @param N_total The total number of particles to write in this array.
+ * @param N_counts The number of particles of each type in each source.
+ * @param file_ids The number of each source file (i.e. of the rank that wrote
+ * it).
+ * @param num_sources The number of sources.
+ * @param source_group The group in the source files containing the particle
+ * groups ("" for the root).
+ * @param self_file_id The number of the file we are writing to, if it is
+ * one of the sources (-1 otherwise).
+ * @param ptype The particle type.
+ * @param lossy_compression The lossy compression filter used for this field.
  * @param snapshot_units The units used for the data in this snapshot.
  */
 void write_array_virtual(struct engine* e, hid_t grp, const char* fileName_base,
                          FILE* xmfFile, char* partTypeGroupName,
                          struct io_props props, long long N_total,
-                         const long long* N_counts, const int num_ranks,
-                         const int ptype,
+                         const long long* N_counts, const int* file_ids,
+                         const int num_sources, const char* source_group,
+                         const int self_file_id, const int ptype,
                          const enum lossy_compression_schemes lossy_compression,
                          const struct unit_system* snapshot_units) {
 
@@ -347,7 +396,8 @@ void write_array_virtual(struct engine* e, hid_t grp, const char* fileName_base,
 
   /* The name of the dataset to map to in the other files */
   char source_dataset_name[256];
-  sprintf(source_dataset_name, "PartType%d/%s", ptype, props.name);
+  sprintf(source_dataset_name, "%sPartType%d/%s", source_group, ptype,
+          props.name);
 
   /* Construct a relative base name */
   char fileName_relative_base[256];
@@ -358,9 +408,9 @@ void write_array_virtual(struct engine* e, hid_t grp, const char* fileName_base,
   sprintf(fileName_relative_base, "%s", &fileName_base[pos_last_slash + 1]);
 
   /* Create all the virtual mappings */
-  for (int i = 0; i < num_ranks; ++i) {
+  for (int i = 0; i < num_sources; ++i) {
 
-    /* Get the number of particles of this type written on this rank */
+    /* Get the number of particles of this type in this source */
     count[0] = N_counts[i * swift_type_count + ptype];
 
     /* Select the space in the virtual file */
@@ -373,8 +423,12 @@ void write_array_virtual(struct engine* e, hid_t grp, const char* fileName_base,
     hid_t h_source_space = H5Screate_simple(rank, source_shape, NULL);
     if (h_source_space < 0) error("Error creating space in the source file");
 
+    /* "." refers to the file the virtual dataset is in */
     char fileName[1024];
-    sprintf(fileName, "%s.%d.hdf5", fileName_relative_base, i);
+    if (file_ids[i] == self_file_id)
+      sprintf(fileName, ".");
+    else
+      sprintf(fileName, "%s.%d.hdf5", fileName_relative_base, file_ids[i]);
 
     /* Make the virtual link */
     h_err = H5Pset_virtual(h_prop, h_space, fileName, source_dataset_name,
@@ -453,29 +507,42 @@ void write_array_virtual(struct engine* e, hid_t grp, const char* fileName_base,
 }
 
 /**
- * @brief Prepares a file for a parallel write.
+ * @brief Writes the virtual meta-file mapping the arrays of all the files.
+ *
+ * The sources are either the files written by all the ranks or, on large
+ * runs, the virtual groups gathering the files of a group of ranks written
+ * by the first rank of each group.
  *
  * @param e The #engine.
  * @param fileName The file name to write to.
  * @param N_total The total number of particles of each type to write.
+ * @param N_counts The number of particles of each type in each source.
+ * @param file_ids The number of each source file.
+ * @param num_sources The number of sources.
+ * @param source_group The group in the source files containing the particle
+ * groups ("" for the root).
  * @param numFields The number of fields to write for each particle type.
  * @param internal_units The #unit_system used internally.
  * @param snapshot_units The #unit_system used in the snapshots.
  * @param fof Is this a snapshot related to a stand-alone FOF call?
  * @param subsample_any Are any fields being subsampled?
  * @param subsample_fraction The subsampling fraction of each particle type.
+ * @param region The region of interest the output is restricted to (NULL for
+ * the full volume).
  */
 void write_virtual_file(struct engine* e, const char* fileName_base,
                         const char* xmfFileName,
                         const long long N_total[swift_type_count],
-                        const long long* N_counts, const int num_ranks,
+                        const long long* N_counts, const int* file_ids,
+                        const int num_sources, const char* source_group,
                         const int to_write[swift_type_count],
                         const int numFields[swift_type_count],
                         char current_selection_name[FIELD_BUFFER_SIZE],
                         const struct unit_system* internal_units,
                         const struct unit_system* snapshot_units, const int fof,
                         const int subsample_any,
-                        const float subsample_fraction[swift_type_count]) {
+                        const float subsample_fraction[swift_type_count],
+                        const struct output_region* region) {
 
 #if H5_VERSION_GE(1, 10, 0)
 
@@ -605,13 +672,7 @@ void write_virtual_file(struct engine* e, const char* fileName_base,
   io_write_attribute_i(h_grp, "Virtual", 1);
   io_write_attribute(h_grp, "CanHaveTypes", INT, to_write, swift_type_count);
 
-  if (subsample_any) {
-    io_write_attribute_s(h_grp, "OutputType", "SubSampled");
-    io_write_attribute(h_grp, "SubSampleFractions", FLOAT, subsample_fraction,
-                       swift_type_count);
-  } else {
-    io_write_attribute_s(h_grp, "OutputType", "FullVolume");
-  }
+  io_write_output_type(h_grp, subsample_any, subsample_fraction, region);
 
   /* Close header */
   H5Gclose(h_grp);
@@ -728,8 +789,9 @@ void write_virtual_file(struct engine* e, const char* fileName_base,
 
       if (compression_level != compression_do_not_write) {
         write_array_virtual(e, h_grp, fileName_base, xmfFile, partTypeGroupName,
-                            list[i], N_total[ptype], N_counts, num_ranks, ptype,
-                            compression_level, snapshot_units);
+                            list[i], N_total[ptype], N_counts, file_ids,
+                            num_sources, source_group, /*self_file_id=*/-1,
+                            ptype, compression_level, snapshot_units);
         num_fields_written++;
       }
     }
@@ -906,41 +968,47 @@ void write_output_distributed(struct engine* e,
     if (!subsample[i]) subsample_fraction[i] = 1.f;
   }
 
+  /* Are we restricting the output to a region of interest? */
+  struct output_region region_buffer;
+  const struct output_region* region = output_options_get_region(
+      output_options, current_selection_name, e->s, &region_buffer);
+
   /* Number of particles that we will write */
   size_t Ngas_written, Ndm_written, Ndm_background, Ndm_neutrino,
       Nsinks_written, Nstars_written, Nblackholes_written;
 
-  if (subsample[swift_type_gas]) {
-    Ngas_written = io_count_gas_to_write(e->s, /*subsample=*/1,
+  if (subsample[swift_type_gas] || region != NULL) {
+    Ngas_written = io_count_gas_to_write(e->s, subsample[swift_type_gas],
                                          subsample_fraction[swift_type_gas],
-                                         e->snapshot_output_count);
+                                         region, e->snapshot_output_count);
   } else {
     Ngas_written =
         e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
   }
 
-  if (subsample[swift_type_stars]) {
+  if (subsample[swift_type_stars] || region != NULL) {
     Nstars_written = io_count_stars_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_stars],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_stars], subsample_fraction[swift_type_stars],
+        region, e->snapshot_output_count);
   } else {
     Nstars_written =
         e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
   }
 
-  if (subsample[swift_type_black_hole]) {
+  if (subsample[swift_type_black_hole] || region != NULL) {
     Nblackholes_written = io_count_black_holes_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_black_hole],
+        e->s, subsample[swift_type_black_hole],
+        subsample_fraction[swift_type_black_hole], region,
         e->snapshot_output_count);
   } else {
     Nblackholes_written =
         e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   }
 
-  if (subsample[swift_type_sink]) {
+  if (subsample[swift_type_sink] || region != NULL) {
     Nsinks_written = io_count_sinks_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_sink],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_sink], subsample_fraction[swift_type_sink],
+        region, e->snapshot_output_count);
   } else {
     Nsinks_written =
         e->s->nr_sinks - e->s->nr_inhibited_sinks - e->s->nr_extra_sinks;
@@ -948,13 +1016,14 @@ void write_output_distributed(struct engine* e,
 
   Ndm_written = io_count_dark_matter_to_write(
       e->s, subsample[swift_type_dark_matter],
-      subsample_fraction[swift_type_dark_matter], e->snapshot_output_count);
+      subsample_fraction[swift_type_dark_matter], region,
+      e->snapshot_output_count);
 
   if (with_DM_background) {
     Ndm_background = io_count_background_dark_matter_to_write(
         e->s, subsample[swift_type_dark_matter_background],
         subsample_fraction[swift_type_dark_matter_background],
-        e->snapshot_output_count);
+        region, e->snapshot_output_count);
   } else {
     Ndm_background = 0;
   }
@@ -962,7 +1031,8 @@ void write_output_distributed(struct engine* e,
   if (with_neutrinos) {
     Ndm_neutrino = io_count_neutrinos_to_write(
         e->s, subsample[swift_type_neutrino],
-        subsample_fraction[swift_type_neutrino], e->snapshot_output_count);
+        subsample_fraction[swift_type_neutrino], region,
+        e->snapshot_output_count);
   } else {
     Ndm_neutrino = 0;
   }
@@ -976,11 +1046,25 @@ void write_output_distributed(struct engine* e,
   long long N_total[swift_type_count] = {0};
   MPI_Allreduce(N, N_total, swift_type_count, MPI_LONG_LONG_INT, MPI_SUM, comm);
 
-  /* Collect the number of particles written by each rank */
+  /* Collect the number of particles written by each rank. Every rank needs
+   * them as the virtual mappings are spread over the first rank of each
+   * group of files. */
   long long* N_counts =
       (long long*)malloc(mpi_size * swift_type_count * sizeof(long long));
-  MPI_Gather(N, swift_type_count, MPI_LONG_LONG_INT, N_counts, swift_type_count,
-             MPI_LONG_LONG_INT, 0, comm);
+  MPI_Allgather(N, swift_type_count, MPI_LONG_LONG_INT, N_counts,
+                swift_type_count, MPI_LONG_LONG_INT, comm);
+
+  /* Are the files gathered in groups before being mapped in the virtual
+   * file? The first rank of each group maps the files of its group in its
+   * own file. */
+  const int virtual_group_size = distributed_io_virtual_group_size(
+      e->snapshot_virtual_group_size, mpi_size);
+#if H5_VERSION_GE(1, 10, 0)
+  const int virtual_aggregator =
+      virtual_group_size > 0 && (mpi_rank % virtual_group_size) == 0;
+#else
+  const int virtual_aggregator = 0;
+#endif
 
   /* List what fields to write.
    * Note that we want to want to write a 0-size dataset for some species
@@ -991,6 +1075,13 @@ void write_output_distributed(struct engine* e,
 
   };
 
+  /* Size the chunks of the arrays after the top-level cells if requested.
+   * All the files use the same size. */
+  long long chunk_sizes[swift_type_count];
+  io_get_cell_aligned_chunk_sizes(e->s->cells_top, e->s->nr_cells, mpi_rank,
+                                  e->snapshot_chunks_per_cell, N_total,
+                                  chunk_sizes, comm);
+
   /* Use a single Lustre stripe with a rank-based OST offset? */
   if (e->snapshot_lustre_OST_count != 0) {
 
@@ -998,7 +1089,7 @@ void write_output_distributed(struct engine* e,
      * this to keep the use of OSTs balanced, much like using -1 for the
      * stripe. */
     int offset = rand() % e->snapshot_lustre_OST_count;
-    MPI_Bcast(&offset, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&offset, 1, MPI_INT, 0, comm);
 
     char string[1200];
     sprintf(string, "lfs setstripe -c 1 -i %d %s",
@@ -1116,13 +1207,7 @@ void write_output_distributed(struct engine* e,
   io_write_attribute_i(h_grp, "Virtual", 0);
   io_write_attribute(h_grp, "CanHaveTypes", INT, to_write, swift_type_count);
 
-  if (subsample_any) {
-    io_write_attribute_s(h_grp, "OutputType", "SubSampled");
-    io_write_attribute(h_grp, "SubSampleFractions", FLOAT, subsample_fraction,
-                       swift_type_count);
-  } else {
-    io_write_attribute_s(h_grp, "OutputType", "FullVolume");
-  }
+  io_write_output_type(h_grp, subsample_any, subsample_fraction, region);
 
   /* Close header */
   H5Gclose(h_grp);
@@ -1142,13 +1227,39 @@ void write_output_distributed(struct engine* e,
   if (h_grp < 0) error("Error while creating cells group");
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp, e->s->cdim, e->s->dim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, mpi_rank,
-                        /*distributed=*/1, subsample, subsample_fraction,
-                        e->snapshot_output_count, N_total, global_offsets,
-                        to_write, numFields, internal_units, snapshot_units);
+  io_write_cell_offsets(
+      h_grp, e->s->cdim, e->s->dim, e->s->cells_top, e->s->nr_cells,
+      e->s->width, mpi_rank, /*distributed=*/1, subsample, subsample_fraction,
+      region, e->snapshot_output_count, N_total, global_offsets, to_write,
+      numFields, e->snapshot_chunks_per_cell ? chunk_sizes : NULL,
+      internal_units, snapshot_units, comm);
   H5Gclose(h_grp);
 
+  /* The files of the group we map in this file */
+  int group_num_files = 0;
+  int* group_file_ids = NULL;
+  long long group_N_total[swift_type_count] = {0};
+  hid_t h_grp_group = 0;
+  if (virtual_aggregator) {
+    group_num_files = virtual_group_size;
+    if (mpi_rank + group_num_files > mpi_size)
+      group_num_files = mpi_size - mpi_rank;
+
+    group_file_ids = (int*)malloc(group_num_files * sizeof(int));
+    for (int i = 0; i < group_num_files; ++i) {
+      group_file_ids[i] = mpi_rank + i;
+      for (int ptype = 0; ptype < swift_type_count; ++ptype)
+        group_N_total[ptype] +=
+            N_counts[(mpi_rank + i) * swift_type_count + ptype];
+    }
+
+    h_grp_group = H5Gcreate(h_file, "/VirtualGroup", H5P_DEFAULT,
+                            H5P_DEFAULT, H5P_DEFAULT);
+    if (h_grp_group < 0) error("Error while creating virtual group.");
+    io_write_attribute_i(h_grp_group, "FirstFile", mpi_rank);
+    io_write_attribute_i(h_grp_group, "NumFiles", group_num_files);
+  }
+
   /* Loop over all particle types */
   for (int ptype = 0; ptype < swift_type_count; ptype++) {
 
@@ -1165,6 +1276,15 @@ void write_output_distributed(struct engine* e,
                       H5P_DEFAULT);
     if (h_grp < 0) error("Error while creating particle group.\n");
 
+    /* Open the particle group of the virtual group */
+    hid_t h_grp_virtual = 0;
+    if (virtual_aggregator) {
+      h_grp_virtual = H5Gcreate(h_grp_group, &partTypeGroupName[1],
+                                H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      if (h_grp_virtual < 0)
+        error("Error while creating virtual particle group.\n");
+    }
+
     /* Add an alias name for convenience */
     char aliasName[PARTICLE_GROUP_BUFFER_SIZE];
     snprintf(aliasName, PARTICLE_GROUP_BUFFER_SIZE, "/%sParticles",
@@ -1182,13 +1302,9 @@ void write_output_distributed(struct engine* e,
     bzero(list, io_max_size_output_list * sizeof(struct io_props));
     size_t Nparticles = 0;
 
-    struct part* parts_written = NULL;
-    struct xpart* xparts_written = NULL;
-    struct gpart* gparts_written = NULL;
-    struct velociraptor_gpart_data* gpart_group_data_written = NULL;
-    struct sink* sinks_written = NULL;
-    struct spart* sparts_written = NULL;
-    struct bpart* bparts_written = NULL;
+    /* The particle collection runs on the threadpool */
+    struct threadpool* tp = (struct threadpool*)&e->threadpool;
+    size_t* index_written = NULL;
 
     /* Write particle fields from the particle structure */
     switch (ptype) {
@@ -1199,37 +1315,28 @@ void write_output_distributed(struct engine* e,
           /* No inhibted particles: easy case */
           Nparticles = Ngas;
 
-          /* Select the fields to write */
-          io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
-                                 with_temperature, with_fof, with_stf, with_rt,
-                                 e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Ngas_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("parts_written", (void**)&parts_written,
-                             part_align,
-                             Ngas_written * sizeof(struct part)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ngas_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for parts");
-          if (swift_memalign("xparts_written", (void**)&xparts_written,
-                             xpart_align,
-                             Ngas_written * sizeof(struct xpart)) != 0)
-            error("Error while allocating temporary memory for xparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_parts_to_write(
-              parts, xparts, parts_written, xparts_written,
-              subsample[swift_type_gas], subsample_fraction[swift_type_gas],
+              tp, parts, index_written, subsample[swift_type_gas],
+              subsample_fraction[swift_type_gas], region,
               e->snapshot_output_count, Ngas, Ngas_written);
-
-          /* Select the fields to write */
-          io_select_hydro_fields(parts_written, xparts_written, with_cosmology,
-                                 with_cooling, with_temperature, with_fof,
-                                 with_stf, with_rt, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
+                               with_temperature, with_fof, with_stf, with_rt,
+                               e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter: {
@@ -1239,42 +1346,28 @@ void write_output_distributed(struct engine* e,
            * or neutrinos */
           Nparticles = Ntot;
 
-          /* Select the fields to write */
-          io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
-                              with_stf, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Ndm_written;
 
           /* Allocate temporary array */
-          if (swift_memalign("gparts_written", (void**)&gparts_written,
-                             gpart_align,
-                             Ndm_written * sizeof(struct gpart)) != 0)
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ndm_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for gparts");
 
-          if (with_stf) {
-            if (swift_memalign(
-                    "gpart_group_written", (void**)&gpart_group_data_written,
-                    gpart_align,
-                    Ndm_written * sizeof(struct velociraptor_gpart_data)) != 0)
-              error(
-                  "Error while allocating temporary memory for gparts STF "
-                  "data");
-          }
-
-          /* Collect the non-inhibited DM particles from gpart */
+          /* Collect the indices of the non-inhibited DM particles */
           io_collect_gparts_to_write(
-              gparts, e->s->gpart_group_data, gparts_written,
-              gpart_group_data_written, subsample[swift_type_dark_matter],
+              tp, gparts, index_written, swift_type_dark_matter,
+              subsample[swift_type_dark_matter],
               subsample_fraction[swift_type_dark_matter],
-              e->snapshot_output_count, Ntot, Ndm_written, with_stf);
-
-          /* Select the fields to write */
-          io_select_dm_fields(gparts_written, gpart_group_data_written,
-                              with_fof, with_stf, e, &num_fields, list);
+              region, e->snapshot_output_count, Ntot, Ndm_written);
         }
+
+        /* Select the fields to write */
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
+                            with_stf, e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter_background: {
@@ -1283,32 +1376,22 @@ void write_output_distributed(struct engine* e,
         Nparticles = Ndm_background;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_background * sizeof(struct gpart)) != 0)
-          error("Error while allocating temporart memory for gparts");
-
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_background * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporart memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_background_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written,
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_background * sizeof(size_t)) != 0)
+          error("Error while allocating temporary memory for gparts");
+
+        /* Collect the indices of the non-inhibited background particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_dark_matter_background,
             subsample[swift_type_dark_matter_background],
             subsample_fraction[swift_type_dark_matter_background],
-            e->snapshot_output_count, Ntot, Ndm_background, with_stf);
+            region, e->snapshot_output_count, Ntot, Ndm_background);
 
         /* Select the fields to write */
-        io_select_dm_fields(gparts_written, gpart_group_data_written, with_fof,
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
                             with_stf, e, &num_fields, list);
+
       } break;
 
       case swift_type_neutrino: {
@@ -1317,31 +1400,22 @@ void write_output_distributed(struct engine* e,
         Nparticles = Ndm_neutrino;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_neutrino * sizeof(struct gpart)) != 0)
-          error("Error while allocating temporart memory for gparts");
-
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_neutrino * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporart memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_neutrino_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written, subsample[swift_type_neutrino],
-            subsample_fraction[swift_type_neutrino], e->snapshot_output_count,
-            Ntot, Ndm_neutrino, with_stf);
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_neutrino * sizeof(size_t)) != 0)
+          error("Error while allocating temporary memory for gparts");
+
+        /* Collect the indices of the non-inhibited neutrino particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_neutrino,
+            subsample[swift_type_neutrino],
+            subsample_fraction[swift_type_neutrino],
+            region, e->snapshot_output_count, Ntot, Ndm_neutrino);
 
         /* Select the fields to write */
-        io_select_neutrino_fields(gparts_written, gpart_group_data_written,
-                                  with_fof, with_stf, e, &num_fields, list);
+        io_select_neutrino_fields(gparts, e->s->gpart_group_data, with_fof,
+                                  with_stf, e, &num_fields, list);
+
       } break;
 
       case swift_type_sink: {
@@ -1350,103 +1424,94 @@ void write_output_distributed(struct engine* e,
           /* No inhibted particles: easy case */
           Nparticles = Nsinks;
 
-          /* Select the fields to write */
-          io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
-                                &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nsinks_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sinks_written", (void**)&sinks_written,
-                             sink_align,
-                             Nsinks_written * sizeof(struct sink)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nsinks_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for sinks");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sinks_to_write(
-              sinks, sinks_written, subsample[swift_type_sink],
-              subsample_fraction[swift_type_sink], e->snapshot_output_count,
-              Nsinks, Nsinks_written);
-
-          /* Select the fields to write */
-          io_select_sink_fields(sinks_written, with_cosmology, with_fof,
-                                with_stf, e, &num_fields, list);
+              tp, sinks, index_written, subsample[swift_type_sink],
+              subsample_fraction[swift_type_sink], region,
+              e->snapshot_output_count, Nsinks, Nsinks_written);
         }
+
+        /* Select the fields to write */
+        io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
+                              &num_fields, list);
       } break;
 
       case swift_type_stars: {
         if (Nstars == Nstars_written) {
 
-          /* No inhibted particles: easy case */
+          /* No inhibited particles: easy case */
           Nparticles = Nstars;
 
-          /* Select the fields to write */
-          io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
-                                with_rt, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nstars_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sparts_written", (void**)&sparts_written,
-                             spart_align,
-                             Nstars_written * sizeof(struct spart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nstars_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for sparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sparts_to_write(
-              sparts, sparts_written, subsample[swift_type_stars],
-              subsample_fraction[swift_type_stars], e->snapshot_output_count,
-              Nstars, Nstars_written);
-
-          /* Select the fields to write */
-          io_select_star_fields(sparts_written, with_cosmology, with_fof,
-                                with_stf, with_rt, e, &num_fields, list);
+              tp, sparts, index_written, subsample[swift_type_stars],
+              subsample_fraction[swift_type_stars], region,
+              e->snapshot_output_count, Nstars, Nstars_written);
         }
+
+        /* Select the fields to write */
+        io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
+                              with_rt, e, &num_fields, list);
       } break;
 
       case swift_type_black_hole: {
         if (Nblackholes == Nblackholes_written) {
 
-          /* No inhibted particles: easy case */
+          /* No inhibited particles: easy case */
           Nparticles = Nblackholes;
 
-          /* Select the fields to write */
-          io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
-                              &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nblackholes_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("bparts_written", (void**)&bparts_written,
-                             bpart_align,
-                             Nblackholes_written * sizeof(struct bpart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nblackholes_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for bparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_bparts_to_write(
-              bparts, bparts_written, subsample[swift_type_black_hole],
-              subsample_fraction[swift_type_black_hole],
+              tp, bparts, index_written, subsample[swift_type_black_hole],
+              subsample_fraction[swift_type_black_hole], region,
               e->snapshot_output_count, Nblackholes, Nblackholes_written);
-
-          /* Select the fields to write */
-          io_select_bh_fields(bparts_written, with_cosmology, with_fof,
-                              with_stf, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
+                            &num_fields, list);
       } break;
 
       default:
         error("Particle Type %d not yet supported. Aborting", ptype);
     }
 
+    /* Read the particles through the index list if we collected one */
+    io_props_set_index(list, num_fields, index_written);
+
     /* Verify we are not going to crash when writing below */
     if (num_fields >= io_max_size_output_list)
       error("Too many fields to write for particle type %d", ptype);
@@ -1476,8 +1541,17 @@ void write_output_distributed(struct engine* e,
 
       if (compression_level != compression_do_not_write) {
         write_distributed_array(e, h_grp, fileName, partTypeGroupName, list[i],
-                                Nparticles, compression_level, internal_units,
+                                Nparticles, compression_level,
+                                chunk_sizes[ptype], internal_units,
                                 snapshot_units);
+        if (virtual_aggregator)
+          write_array_virtual(e, h_grp_virtual, fileName_base,
+                              /*xmfFile=*/NULL, partTypeGroupName, list[i],
+                              group_N_total[ptype],
+                              &N_counts[mpi_rank * swift_type_count],
+                              group_file_ids, group_num_files,
+                              /*source_group=*/"", /*self_file_id=*/mpi_rank,
+                              ptype, compression_level, snapshot_units);
         num_fields_written++;
       }
     }
@@ -1485,20 +1559,17 @@ void write_output_distributed(struct engine* e,
     /* Only write this now that we know exactly how many fields there are. */
     io_write_attribute_i(h_grp, "NumberOfFields", num_fields_written);
 
-    /* Free temporary arrays */
-    if (parts_written) swift_free("parts_written", parts_written);
-    if (xparts_written) swift_free("xparts_written", xparts_written);
-    if (gparts_written) swift_free("gparts_written", gparts_written);
-    if (gpart_group_data_written)
-      swift_free("gpart_group_written", gpart_group_data_written);
-    if (sinks_written) swift_free("sinks_written", sinks_written);
-    if (sparts_written) swift_free("sparts_written", sparts_written);
-    if (bparts_written) swift_free("bparts_written", bparts_written);
+    /* Free temporary array */
+    if (index_written) swift_free("index_written", index_written);
 
     /* Close particle group */
+    if (virtual_aggregator) H5Gclose(h_grp_virtual);
     H5Gclose(h_grp);
   }
 
+  if (virtual_aggregator) H5Gclose(h_grp_group);
+  free(group_file_ids);
+
   /* message("Done writing particles..."); */
 
   /* Close file */
@@ -1508,11 +1579,37 @@ void write_output_distributed(struct engine* e,
 #if H5_VERSION_GE(1, 10, 0)
 
   /* Write the virtual meta-file */
-  if (mpi_rank == 0)
-    write_virtual_file(e, fileName_base, xmfFileName, N_total, N_counts,
-                       mpi_size, to_write, numFields, current_selection_name,
-                       internal_units, snapshot_units, fof, subsample_any,
-                       subsample_fraction);
+  if (mpi_rank == 0) {
+
+    /* Either map the files of all the ranks or the virtual groups */
+    const int num_sources =
+        virtual_group_size > 0
+            ? (mpi_size + virtual_group_size - 1) / virtual_group_size
+            : mpi_size;
+    const int stride = virtual_group_size > 0 ? virtual_group_size : 1;
+
+    long long* source_counts = (long long*)calloc(
+        num_sources * swift_type_count, sizeof(long long));
+    int* source_file_ids = (int*)malloc(num_sources * sizeof(int));
+    if (source_counts == NULL || source_file_ids == NULL)
+      error("Error allocating memory for the virtual mappings.");
+
+    for (int i = 0; i < num_sources; ++i) source_file_ids[i] = i * stride;
+    for (int i = 0; i < mpi_size; ++i)
+      for (int ptype = 0; ptype < swift_type_count; ++ptype)
+        source_counts[(i / stride) * swift_type_count + ptype] +=
+            N_counts[i * swift_type_count + ptype];
+
+    write_virtual_file(e, fileName_base, xmfFileName, N_total, source_counts,
+                       source_file_ids, num_sources,
+                       virtual_group_size > 0 ? "VirtualGroup/" : "", to_write,
+                       numFields, current_selection_name, internal_units,
+                       snapshot_units, fof, subsample_any, subsample_fraction,
+                       region);
+
+    free(source_counts);
+    free(source_file_ids);
+  }
 
   /* Make sure nobody is allowed to progress until rank 0 is done. */
   MPI_Barrier(comm);
@@ -1550,11 +1647,11 @@ void write_output_distributed(struct engine* e,
              comm);
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->dim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, mpi_rank,
-                        /*distributed=*/0, subsample, subsample_fraction,
-                        e->snapshot_output_count, N_total, global_offsets,
-                        to_write, numFields, internal_units, snapshot_units);
+  io_write_cell_offsets(
+      h_grp_cells, e->s->cdim, e->s->dim, e->s->cells_top, e->s->nr_cells,
+      e->s->width, mpi_rank, /*distributed=*/0, subsample, subsample_fraction,
+      region, e->snapshot_output_count, N_total, global_offsets, to_write,
+      numFields, /*chunk_sizes=*/NULL, internal_units, snapshot_units, comm);
 
   /* Close everything */
   if (mpi_rank == 0) {
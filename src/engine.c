@@ -80,6 +80,8 @@
 #include "map.h"
 #include "memuse.h"
 #include "minmax.h"
+#include "mpiaggregate.h"
+#include "mpirma.h"
 #include "mpiuse.h"
 #include "multipole_struct.h"
 #include "neutrino.h"
@@ -184,7 +186,7 @@ void engine_addlink(struct engine *e, struct link **l, struct task *t) {
  */
 void engine_repartition(struct engine *e) {
 
-#if defined(WITH_MPI) && (defined(HAVE_PARMETIS) || defined(HAVE_METIS))
+#if defined(WITH_MPI)
 
   ticks tic = getticks();
 
@@ -256,7 +258,7 @@ void engine_repartition(struct engine *e) {
             clocks_getunit());
 #else
   if (e->reparttype->type != REPART_NONE)
-    error("SWIFT was not compiled with MPI and METIS or ParMETIS support.");
+    error("SWIFT was not compiled with MPI support.");
 
   /* Clear the repartition flag. */
   e->forcerepart = 0;
@@ -470,19 +472,46 @@ void engine_repartition_trigger(struct engine *e) {
 }
 
 /**
- * @brief Exchange cell structures with other nodes.
+ * @brief Start exchanging the cell structures with other nodes.
+ *
+ * The foreign cells are only valid after a call to
+ * engine_exchange_cells_end().
+ *
+ * @param e The #engine.
+ */
+void engine_exchange_cells_begin(struct engine *e) {
+
+#ifdef WITH_MPI
+
+  const int with_gravity = e->policy & engine_policy_self_gravity;
+  const ticks tic = getticks();
+
+  /* Send our cells to the neighbouring ranks and post the recvs of theirs. */
+  proxy_cells_exchange_begin(e->proxies, e->nr_proxies, e->s, with_gravity);
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Complete the exchange of the cell structures with other nodes.
  *
  * @param e The #engine.
  */
-void engine_exchange_cells(struct engine *e) {
+void engine_exchange_cells_end(struct engine *e) {
 
 #ifdef WITH_MPI
 
   const int with_gravity = e->policy & engine_policy_self_gravity;
   const ticks tic = getticks();
 
-  /* Exchange the cell structure with neighbouring ranks. */
-  proxy_cells_exchange(e->proxies, e->nr_proxies, e->s, with_gravity);
+  /* Wait for the cells of the neighbouring ranks and unpack them. */
+  proxy_cells_exchange_end(e->proxies, e->nr_proxies, e->s, with_gravity);
 
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
@@ -521,13 +550,149 @@ void engine_exchange_grid_extra(struct engine *e) {
 #endif
 }
 
+#ifdef WITH_MPI
+
+/**
+ * @brief Start gathering the non-empty top-level multipoles in compact form.
+ *
+ * Every node packs the multipoles of its local cells containing particles,
+ * with their positions in single precision relative to the centre of the
+ * cells, and gathers the ones of all the other nodes.
+ *
+ * @param e The #engine.
+ */
+static void engine_exchange_top_multipoles_compact_begin(struct engine *e) {
+
+  const struct space *s = e->s;
+  const int nr_nodes = e->nr_nodes;
+
+  /* Count the local cells to send. */
+  int nr_send = 0;
+  for (int k = 0; k < s->nr_local_cells_with_particles; ++k) {
+    const int cid = s->local_cells_with_particles_top[k];
+    if (s->cells_top[cid].grav.count > 0) nr_send++;
+  }
+
+  if (swift_memalign("multipoles_top_compact",
+                     (void **)&e->multipoles_top_compact_send,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     (nr_send + 1) * sizeof(struct gravity_tensors_compact)) !=
+      0)
+    error("Failed to allocate compact top-level multipoles send buffer.");
+
+  /* Pack them. */
+  nr_send = 0;
+  for (int k = 0; k < s->nr_local_cells_with_particles; ++k) {
+    const int cid = s->local_cells_with_particles_top[k];
+    const struct cell *c = &s->cells_top[cid];
+    if (c->grav.count == 0) continue;
+
+    const struct gravity_tensors *m = &s->multipoles_top[cid];
+    struct gravity_tensors_compact *mc =
+        &e->multipoles_top_compact_send[nr_send++];
+    mc->cid = cid;
+    mc->m_pole = m->m_pole;
+    for (int j = 0; j < 3; j++) {
+      const double centre = c->loc[j] + 0.5 * c->width[j];
+      mc->CoM[j] = m->CoM[j] - centre;
+      mc->CoM_rebuild[j] = m->CoM_rebuild[j] - centre;
+    }
+    mc->r_max = m->r_max;
+    mc->r_max_rebuild = m->r_max_rebuild;
+  }
+
+  /* Tell everybody how many multipoles we send. */
+  int *counts = (int *)malloc(2 * nr_nodes * sizeof(int));
+  if (counts == NULL) error("Failed to allocate compact multipole counts.");
+  int *displs = &counts[nr_nodes];
+  int err = MPI_Allgather(&nr_send, 1, MPI_INT, counts, 1, MPI_INT,
+                          MPI_COMM_WORLD);
+  if (err != MPI_SUCCESS)
+    mpi_error(err, "Failed to gather the numbers of top-level multipoles.");
+  int nr_recv = 0;
+  for (int k = 0; k < nr_nodes; k++) {
+    displs[k] = nr_recv;
+    nr_recv += counts[k];
+  }
+
+  if (swift_memalign("multipoles_top_compact",
+                     (void **)&e->multipoles_top_compact_recv,
+                     SWIFT_STRUCT_ALIGNMENT,
+                     (nr_recv + 1) * sizeof(struct gravity_tensors_compact)) !=
+      0)
+    error("Failed to allocate compact top-level multipoles receive buffer.");
+
+  err = MPI_Iallgatherv(e->multipoles_top_compact_send, nr_send,
+                        multipole_compact_mpi_type,
+                        e->multipoles_top_compact_recv, counts, displs,
+                        multipole_compact_mpi_type, MPI_COMM_WORLD,
+                        &e->multipoles_top_req);
+  if (err != MPI_SUCCESS)
+    mpi_error(err, "Failed to gather the top-level multipoles.");
+
+  e->multipoles_top_compact_counts = counts;
+
+  if (e->verbose)
+    message("Sending %d and receiving %d top-level multipoles (%.3f MB).",
+            nr_send, nr_recv - nr_send,
+            (double)nr_recv * sizeof(struct gravity_tensors_compact) /
+                (1024. * 1024.));
+}
+
+/**
+ * @brief Unpack the compact top-level multipoles of the other nodes once
+ * gathered.
+ *
+ * The multipoles of the empty foreign cells are left untouched, i.e. zero.
+ *
+ * @param e The #engine.
+ */
+static void engine_exchange_top_multipoles_compact_end(struct engine *e) {
+
+  struct space *s = e->s;
+  const int nodeID = e->nodeID;
+
+  int nr_recv = 0;
+  for (int k = 0; k < e->nr_nodes; k++)
+    nr_recv += e->multipoles_top_compact_counts[k];
+
+  for (int k = 0; k < nr_recv; k++) {
+    const struct gravity_tensors_compact *mc =
+        &e->multipoles_top_compact_recv[k];
+    const struct cell *c = &s->cells_top[mc->cid];
+    if (c->nodeID == nodeID) continue;
+
+    struct gravity_tensors *m = &s->multipoles_top[mc->cid];
+    m->m_pole = mc->m_pole;
+    for (int j = 0; j < 3; j++) {
+      const double centre = c->loc[j] + 0.5 * c->width[j];
+      m->CoM[j] = centre + mc->CoM[j];
+      m->CoM_rebuild[j] = centre + mc->CoM_rebuild[j];
+    }
+    m->r_max = mc->r_max;
+    m->r_max_rebuild = mc->r_max_rebuild;
+  }
+
+  swift_free("multipoles_top_compact", e->multipoles_top_compact_send);
+  swift_free("multipoles_top_compact", e->multipoles_top_compact_recv);
+  free(e->multipoles_top_compact_counts);
+  e->multipoles_top_compact_send = NULL;
+  e->multipoles_top_compact_recv = NULL;
+  e->multipoles_top_compact_counts = NULL;
+}
+
+#endif /* WITH_MPI */
+
 /**
- * @brief Exchanges the top-level multipoles between all the nodes
+ * @brief Start exchanging the top-level multipoles between all the nodes
  * such that every node has a multipole for each top-level cell.
  *
+ * The multipoles of the local cells can be read, but not modified, until
+ * engine_exchange_top_multipoles_end() is called.
+ *
  * @param e The #engine.
  */
-void engine_exchange_top_multipoles(struct engine *e) {
+void engine_exchange_top_multipoles_begin(struct engine *e) {
 
 #ifdef WITH_MPI
 
@@ -563,12 +728,58 @@ void engine_exchange_top_multipoles(struct engine *e) {
    * operation on the multipoles. Since only local multipoles are non-zero and
    * each multipole is only present once, the bit-by-bit XOR will
    * create the desired result.
-   */
-  int err = MPI_Allreduce(MPI_IN_PLACE, e->s->multipoles_top, e->s->nr_cells,
-                          multipole_mpi_type, multipole_mpi_reduce_op,
-                          MPI_COMM_WORLD);
+   *
+   * The result goes to a separate buffer so that the local multipoles stay
+   * readable while the reduction is in flight.
+   *
+   * Alternatively, each node only sends its non-empty cells in compact form
+   * and everybody gathers them. */
+  if (e->mpi_compact_multipoles) {
+    engine_exchange_top_multipoles_compact_begin(e);
+  } else {
+    if (swift_memalign("multipoles_top_recv",
+                       (void **)&e->multipoles_top_recv, SWIFT_STRUCT_ALIGNMENT,
+                       e->s->nr_cells * sizeof(struct gravity_tensors)) != 0)
+      error("Failed to allocate top-level multipoles receive buffer.");
+    int err = MPI_Iallreduce(e->s->multipoles_top, e->multipoles_top_recv,
+                             e->s->nr_cells, multipole_mpi_type,
+                             multipole_mpi_reduce_op, MPI_COMM_WORLD,
+                             &e->multipoles_top_req);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to all-reduce the top-level multipoles.");
+  }
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Complete the exchange of the top-level multipoles.
+ *
+ * @param e The #engine.
+ */
+void engine_exchange_top_multipoles_end(struct engine *e) {
+
+#ifdef WITH_MPI
+
+  ticks tic = getticks();
+
+  int err = MPI_Wait(&e->multipoles_top_req, MPI_STATUS_IGNORE);
   if (err != MPI_SUCCESS)
-    mpi_error(err, "Failed to all-reduce the top-level multipoles.");
+    mpi_error(err, "Failed to exchange the top-level multipoles.");
+  if (e->mpi_compact_multipoles) {
+    engine_exchange_top_multipoles_compact_end(e);
+  } else {
+    memcpy(e->s->multipoles_top, e->multipoles_top_recv,
+           e->s->nr_cells * sizeof(struct gravity_tensors));
+    swift_free("multipoles_top_recv", e->multipoles_top_recv);
+    e->multipoles_top_recv = NULL;
+  }
 
 #ifdef SWIFT_DEBUG_CHECKS
   long long counter = 0;
@@ -1421,13 +1632,24 @@ void engine_rebuild(struct engine *e, const int repartitioned,
   }
 
 /* If in parallel, exchange the cell structure, top-level and neighbouring
- * multipoles. To achieve this, free the foreign particle buffers first. */
+ * multipoles. To achieve this, free the foreign particle buffers first.
+ * The tasks between local cells are made while the exchanges proceed. */
 #ifdef WITH_MPI
-  if (e->policy & engine_policy_self_gravity) engine_exchange_top_multipoles(e);
+  if (e->policy & engine_policy_self_gravity)
+    engine_exchange_top_multipoles_begin(e);
 
   space_free_foreign_parts(e->s, /*clear_cell_pointers=*/1);
 
-  engine_exchange_cells(e);
+  engine_exchange_cells_begin(e);
+#endif
+
+  engine_maketasks_local(e);
+
+#ifdef WITH_MPI
+  if (e->policy & engine_policy_self_gravity)
+    engine_exchange_top_multipoles_end(e);
+
+  engine_exchange_cells_end(e);
 #endif
 
 #ifdef SWIFT_DEBUG_CHECKS
@@ -1471,6 +1693,9 @@ void engine_rebuild(struct engine *e, const int repartitioned,
 #ifdef WITH_MPI
   if (e->free_foreign_when_rebuilding)
     engine_allocate_foreign_particles(e, /*fof=*/0);
+
+  /* Lay out the RMA window for the new recv tasks. */
+  if (e->sched.mpi_rma != NULL) mpirma_rebuild(e->sched.mpi_rma, e->verbose);
 #endif
 
   /* Make the list of top-level cells that have tasks */
@@ -1866,6 +2091,16 @@ void engine_launch(struct engine *e, const char *call) {
   if (e->verbose)
     message("(%s) took %.3f %s.", call, clocks_from_ticks(getticks() - tic),
             clocks_getunit());
+
+#ifdef WITH_MPI
+  if (e->verbose && e->sched.mpi_aggregate != NULL)
+    message("%lld task messages sent in %lld aggregated messages so far.",
+            e->sched.mpi_aggregate->nr_messages,
+            e->sched.mpi_aggregate->nr_aggregates);
+  if (e->verbose && e->sched.mpi_rma != NULL)
+    message("%lld task messages put into RMA windows so far.",
+            e->sched.mpi_rma->nr_messages);
+#endif
 }
 
 /**
@@ -2172,9 +2407,15 @@ void engine_init_particles(struct engine *e, int flag_entropy_ICs,
 
   /* Update the cooling function */
   if ((e->policy & engine_policy_cooling) ||
-      (e->policy & engine_policy_temperature))
+      (e->policy & engine_policy_temperature)) {
+
+    /* A snapshot still being written may need the current tables */
+    if (cooling_update_modifies_tables(e->cosmology, e->cooling_func))
+      snapshot_writer_wait(&e->snapshot_writer, e->verbose);
+
     cooling_update(e->physical_constants, e->cosmology, e->pressure_floor_props,
                    e->cooling_func, e->s, e->time);
+  }
 
   if (e->policy & engine_policy_rt)
     rt_props_update(e->rt_props, e->internal_units, e->cosmology);
@@ -2599,9 +2840,15 @@ int engine_step(struct engine *e) {
 
   /* Update the cooling function */
   if ((e->policy & engine_policy_cooling) ||
-      (e->policy & engine_policy_temperature))
+      (e->policy & engine_policy_temperature)) {
+
+    /* A snapshot still being written may need the current tables */
+    if (cooling_update_modifies_tables(e->cosmology, e->cooling_func))
+      snapshot_writer_wait(&e->snapshot_writer, e->verbose);
+
     cooling_update(e->physical_constants, e->cosmology, e->pressure_floor_props,
                    e->cooling_func, e->s, e->time);
+  }
 
   /* Update the softening lengths */
   if (e->policy & engine_policy_self_gravity)
@@ -2923,6 +3170,7 @@ int engine_step(struct engine *e) {
 #ifdef WITH_LIGHTCONE
   /* Flush lightcone buffers if necessary */
   const int flush = e->flush_lightcone_maps;
+  snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
   lightcone_array_flush(e->lightcone_array_properties, &(e->threadpool),
                         e->cosmology, e->internal_units, e->snapshot_units,
                         /*flush_map_updates=*/flush, /*flush_particles=*/0,
@@ -3371,8 +3619,18 @@ void engine_init(
   }
   e->snapshot_compression =
       parser_get_opt_param_int(params, "Snapshots:compression", 0);
+  e->snapshot_compress_on_threads =
+      parser_get_opt_param_int(params, "Snapshots:compress_on_threads", 0);
+  e->snapshot_chunks_per_cell =
+      parser_get_opt_param_int(params, "Snapshots:chunks_per_cell", 0);
+  if (e->snapshot_chunks_per_cell < 0)
+    error("Snapshots:chunks_per_cell must be >= 0");
   e->snapshot_distributed =
       parser_get_opt_param_int(params, "Snapshots:distributed", 0);
+  e->snapshot_virtual_group_size =
+      parser_get_opt_param_int(params, "Snapshots:virtual_group_size", 0);
+  if (e->snapshot_virtual_group_size < 0)
+    error("Snapshots:virtual_group_size must be >= 0");
   e->snapshot_lustre_OST_count =
       parser_get_opt_param_int(params, "Snapshots:lustre_OST_count", 0);
   e->snapshot_invoke_stf =
@@ -3807,6 +4065,9 @@ void engine_recompute_displacement_constraint(struct engine *e) {
  * @param restart Was this a run that was restarted from check-point files?
  */
 void engine_clean(struct engine *e, const int fof, const int restart) {
+  /* Finish writing the snapshots first. */
+  snapshot_writer_clean(&e->snapshot_writer);
+
   /* Start by telling the runners to stop. */
   e->step_props = engine_step_prop_done;
   swift_barrier_wait(&e->run_barrier);
@@ -45,6 +45,7 @@
 #include "partition.h"
 #include "runner.h"
 #include "scheduler.h"
+#include "snapshot_writer.h"
 #include "space.h"
 #include "task.h"
 #include "tracers_triggers.h"
@@ -340,6 +341,9 @@ struct engine {
   /* Output_List for the snapshots */
   struct output_list *output_list_snapshots;
 
+  /* The background snapshot writer */
+  struct snapshot_writer snapshot_writer;
+
   /* Integer time of the next snapshot */
   integertime_t ti_next_snapshot;
 
@@ -350,8 +354,11 @@ struct engine {
   float snapshot_subsample_fraction[swift_type_count];
   int snapshot_run_on_dump;
   int snapshot_distributed;
+  int snapshot_virtual_group_size;
   int snapshot_lustre_OST_count;
   int snapshot_compression;
+  int snapshot_compress_on_threads;
+  int snapshot_chunks_per_cell;
   int snapshot_invoke_stf;
   int snapshot_invoke_fof;
   int snapshot_invoke_ps;
@@ -467,6 +474,21 @@ struct engine {
   /* Use synchronous redistributes. */
   int syncredist;
 
+  /* Largest message of in-place redistributes, in bytes (0 for none). */
+  size_t redist_chunk;
+
+  /* Exchange only the non-empty top-level multipoles, in compact form? */
+  int mpi_compact_multipoles;
+
+  /* Pending exchange of the top-level multipoles and its receive buffer. */
+  MPI_Request multipoles_top_req;
+  struct gravity_tensors *multipoles_top_recv;
+
+  /* Buffers and counts of the compact exchange of the top-level multipoles. */
+  struct gravity_tensors_compact *multipoles_top_compact_send;
+  struct gravity_tensors_compact *multipoles_top_compact_recv;
+  int *multipoles_top_compact_counts;
+
 #endif
 
   /* Wallclock time of the last time-step */
@@ -592,6 +614,18 @@ struct engine {
   /* Number of Lustre OSTs on the system to use as rank-based striping offset */
   int restart_lustre_OST_count;
 
+  /* Deflate level used to compress the particle arrays in the restart files. */
+  int restart_compression;
+
+  /* Do we store check-sums of the particle arrays in the restart files? */
+  int restart_checksums;
+
+  /* Number of incremental restart dumps between two full ones. */
+  int restart_incremental_dumps;
+
+  /* Do we align the particle arrays in the restart files? */
+  int restart_page_aligned;
+
   /* Do we free the foreign data before writing restart files? */
   int free_foreign_when_dumping_restart;
 
@@ -770,6 +804,7 @@ void engine_activate_gpart_comms(struct engine *e);
 void engine_activate_fof_attach_tasks(struct engine *e);
 
 /* Function prototypes, engine_maketasks.c. */
+void engine_maketasks_local(struct engine *e);
 void engine_maketasks(struct engine *e);
 
 /* Function prototypes, engine_maketasks.c. */
@@ -38,6 +38,8 @@
 /* Local headers. */
 #include "fof.h"
 #include "line_of_sight.h"
+#include "mpiaggregate.h"
+#include "mpirma.h"
 #include "mpiuse.h"
 #include "part.h"
 #include "pressure_floor.h"
@@ -418,6 +420,17 @@ void engine_config(int restart, int fof, struct engine *e,
     e->syncredist =
         parser_get_opt_param_int(params, "DomainDecomposition:synchronous", 0);
 
+    /* Redistribute in place, in messages of bounded size? */
+    const double stream_chunk_MB = parser_get_opt_param_double(
+        params, "DomainDecomposition:stream_chunk_MB", 0.);
+    if (stream_chunk_MB < 0.)
+      error("DomainDecomposition:stream_chunk_MB must be positive or zero.");
+    e->redist_chunk = (size_t)(stream_chunk_MB * 1024. * 1024.);
+
+    /* Only exchange the non-empty top-level multipoles, in compact form? */
+    e->mpi_compact_multipoles = parser_get_opt_param_int(
+        params, "Scheduler:mpi_compact_multipoles", 0);
+
     /* Collect the hostname of each rank into a file */
 
     const int hostname_buffer_length = 256;
@@ -835,6 +848,30 @@ void engine_config(int restart, int fof, struct engine *e,
     e->restart_lustre_OST_count =
         parser_get_opt_param_int(params, "Restarts:lustre_OST_count", 0);
 
+    /* Options of the restart files written in blocks. Can be changed on
+     * restart. */
+    e->restart_compression =
+        parser_get_opt_param_int(params, "Restarts:compression", 0);
+    e->restart_checksums =
+        parser_get_opt_param_int(params, "Restarts:checksums", 0);
+    e->restart_incremental_dumps =
+        parser_get_opt_param_int(params, "Restarts:incremental_dumps", 0);
+    e->restart_page_aligned =
+        parser_get_opt_param_int(params, "Restarts:page_aligned", 1);
+    if (e->restart_compression < 0 || e->restart_compression > 9)
+      error("Restarts:compression must be between 0 and 9 (not %d)",
+            e->restart_compression);
+    if (e->restart_incremental_dumps < 0)
+      error("Restarts:incremental_dumps must be >= 0 (not %d)",
+            e->restart_incremental_dumps);
+#ifndef HAVE_LIBZ
+    if (e->restart_compression > 0 || e->restart_checksums ||
+        e->restart_incremental_dumps > 0)
+      error(
+          "Compressed, check-summed or incremental restart files require "
+          "SWIFT to be compiled with zlib.");
+#endif
+
     /* Hours between restart dumps. Can be changed on restart. */
     float dhours =
         parser_get_opt_param_float(params, "Restarts:delta_hours", 5.0f);
@@ -880,6 +917,12 @@ void engine_config(int restart, int fof, struct engine *e,
   if (e->nodeID == 0)
     message("Using %d threads in the thread-pool", nr_pool_threads);
 
+  /* Start the background snapshot writer (if any). */
+  if (!fof)
+    snapshot_writer_init(&e->snapshot_writer, params, e);
+  else
+    memset(&e->snapshot_writer, 0, sizeof(struct snapshot_writer));
+
   /* Cells per thread buffer. */
   e->s->cells_sub =
       (struct cell **)calloc(nr_pool_threads + 1, sizeof(struct cell *));
@@ -920,6 +963,49 @@ void engine_config(int restart, int fof, struct engine *e,
   e->sched.mpi_message_limit =
       parser_get_opt_param_int(params, "Scheduler:mpi_message_limit", 4) * 1024;
 
+#ifdef WITH_MPI
+  /* Task messages up to this size, in KB, are aggregated per rank and
+   * exchanged by a dedicated progress thread. Off by default. */
+  const int mpi_aggregate_limit =
+      parser_get_opt_param_int(params, "Scheduler:mpi_aggregate_limit", 0);
+  if (mpi_aggregate_limit > 0 && e->nr_nodes > 1) {
+    const double mpi_aggregate_window = parser_get_opt_param_double(
+        params, "Scheduler:mpi_aggregate_window", 20.);
+    if (mpi_aggregate_window < 0.)
+      error("Scheduler:mpi_aggregate_window must be positive.");
+    e->sched.mpi_aggregate =
+        (struct mpiaggregate *)malloc(sizeof(struct mpiaggregate));
+    if (e->sched.mpi_aggregate == NULL)
+      error("Failed to allocate the MPI aggregation layer.");
+    mpiaggregate_init(e->sched.mpi_aggregate, &e->sched, e->nr_nodes,
+                      (size_t)mpi_aggregate_limit * 1024, mpi_aggregate_window);
+    if (e->nodeID == 0)
+      message(
+          "Aggregating the task messages up to %d KB over windows of %.1f "
+          "us.",
+          mpi_aggregate_limit, mpi_aggregate_window);
+  }
+
+  /* Task messages up to this size, in KB, are put straight into a window of
+   * the receiving rank using one-sided MPI. Off by default. */
+  const int mpi_rma_limit =
+      parser_get_opt_param_int(params, "Scheduler:mpi_rma_limit", 0);
+  if (mpi_rma_limit > 0 && e->nr_nodes > 1) {
+    if (mpi_aggregate_limit > 0)
+      error(
+          "Scheduler:mpi_rma_limit and Scheduler:mpi_aggregate_limit cannot "
+          "be used together.");
+    e->sched.mpi_rma = (struct mpirma *)malloc(sizeof(struct mpirma));
+    if (e->sched.mpi_rma == NULL)
+      error("Failed to allocate the MPI one-sided transport.");
+    mpirma_init(e->sched.mpi_rma, &e->sched, e->nr_nodes,
+                (size_t)mpi_rma_limit * 1024);
+    if (e->nodeID == 0)
+      message("Putting the task messages up to %d KB into RMA windows.",
+              mpi_rma_limit);
+  }
+#endif
+
   if (restart) {
 
     /* Overwrite the constants for the scheduler */
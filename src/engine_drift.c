@@ -437,6 +437,7 @@ void engine_drift_all(struct engine *e, const int drift_mpoles) {
 #ifdef WITH_LIGHTCONE
   /* Drifting all of the particles can cause many particles to cross
      the lightcone, so flush buffers now to reduce peak memory use . */
+  snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
   lightcone_array_flush(e->lightcone_array_properties, &e->threadpool,
                         e->cosmology, e->internal_units, e->snapshot_units,
                         /*flush_map_updates=*/1, /*flush_particles=*/1,
@@ -203,6 +203,10 @@ void engine_fof(struct engine *e, const int dump_results,
   fof_link_foreign_fragments(e->fof_properties, e->s);
 #endif
 
+  /* The catalogues are written with HDF5 */
+  if (dump_results)
+    snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
+
   /* Compute group properties and act on the results
    * (seed BHs, dump catalogues..) */
   fof_compute_group_props(e->fof_properties, e->black_holes_properties,
@@ -199,6 +199,9 @@ int engine_dump_restarts(struct engine *e, const int drifted_all,
 
     if (dump) {
 
+      /* Make sure the restart files come after any pending snapshot */
+      snapshot_writer_wait(&e->snapshot_writer, e->verbose);
+
       if (e->nodeID == 0) {
 
         /* Flush the time-step file to avoid gaps in case of crashes
@@ -321,33 +324,38 @@ void engine_dump_snapshot(struct engine *e, const int fof) {
             e->time_base, with_cosmology, e->cosmology);
   }
 
-/* Dump (depending on the chosen strategy) ... */
+  /* Hand the snapshot over to the background writer if we can... */
+  const int in_background = snapshot_writer_submit(&e->snapshot_writer, e, fof);
+
+  /* ... otherwise dump (depending on the chosen strategy) */
+  if (!in_background) {
 #if defined(HAVE_HDF5)
 #if defined(WITH_MPI)
 
-  MPI_Info info;
-  MPI_Info_create(&info);
+    MPI_Info info;
+    MPI_Info_create(&info);
 
-  if (e->snapshot_distributed) {
+    if (e->snapshot_distributed) {
 
-    write_output_distributed(e, e->internal_units, e->snapshot_units, fof,
-                             e->nodeID, e->nr_nodes, MPI_COMM_WORLD, info);
+      write_output_distributed(e, e->internal_units, e->snapshot_units, fof,
+                               e->nodeID, e->nr_nodes, MPI_COMM_WORLD, info);
 
-  } else {
+    } else {
 
 #if defined(HAVE_PARALLEL_HDF5)
-    write_output_parallel(e, e->internal_units, e->snapshot_units, fof,
-                          e->nodeID, e->nr_nodes, MPI_COMM_WORLD, info);
+      write_output_parallel(e, e->internal_units, e->snapshot_units, fof,
+                            e->nodeID, e->nr_nodes, MPI_COMM_WORLD, info);
 #else
-    write_output_serial(e, e->internal_units, e->snapshot_units, fof, e->nodeID,
-                        e->nr_nodes, MPI_COMM_WORLD, info);
+      write_output_serial(e, e->internal_units, e->snapshot_units, fof,
+                          e->nodeID, e->nr_nodes, MPI_COMM_WORLD, info);
 #endif
-  }
-  MPI_Info_free(&info);
+    }
+    MPI_Info_free(&info);
 #else
-  write_output_single(e, e->internal_units, e->snapshot_units, fof);
+    write_output_single(e, e->internal_units, e->snapshot_units, fof);
 #endif /* WITH_MPI */
 #endif /* WITH_HDF5 */
+  }
 
   /* Cancel any triggers that are switched on */
   if (num_snapshot_triggers_part > 0 || num_snapshot_triggers_spart > 0 ||
@@ -373,8 +381,9 @@ void engine_dump_snapshot(struct engine *e, const int fof) {
     message("writing particle properties took %.3f %s.",
             (float)clocks_diff(&time1, &time2), clocks_getunit());
 
-  /* Run the post-dump command if required */
-  if (e->nodeID == 0) {
+  /* Run the post-dump command if required (the background writer does it
+   * once the files are complete) */
+  if (e->nodeID == 0 && !in_background) {
     engine_run_on_dump(e);
   }
 }
@@ -531,6 +540,7 @@ void engine_io(struct engine *e) {
         if (with_stf && e->snapshot_invoke_stf && !e->stf_this_timestep) {
 
 #ifdef HAVE_VELOCIRAPTOR
+          snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
           velociraptor_invoke(e, /*linked_with_snap=*/1);
           e->step_props |= engine_step_prop_stf;
 #else
@@ -590,6 +600,7 @@ void engine_io(struct engine *e) {
 #ifdef HAVE_VELOCIRAPTOR
         /* Unleash the raptor! */
         if (!e->stf_this_timestep) {
+          snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
           velociraptor_invoke(e, /*linked_with_snap=*/0);
           e->step_props |= engine_step_prop_stf;
         }
@@ -613,6 +624,7 @@ void engine_io(struct engine *e) {
       case output_los:
 
         /* Compute the LoS */
+        snapshot_writer_wait_for_hdf5(&e->snapshot_writer, e->verbose);
         do_line_of_sight(e);
 
         /* Move on */
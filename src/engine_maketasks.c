@@ -1906,6 +1906,31 @@ void engine_make_hierarchical_tasks_mapper(void *map_data, int num_elements,
   }
 }
 
+/**
+ * @brief Should the pair task between two top-level cells be made in the
+ * given pass?
+ *
+ * The first pass only makes the pairs of local cells and can run before the
+ * foreign cells have arrived. The second one makes the pairs of a local cell
+ * with a foreign one.
+ *
+ * @param ci The first #cell.
+ * @param cj The second #cell.
+ * @param nodeID The ID of this node.
+ * @param foreign Is this the second pass?
+ */
+__attribute__((always_inline)) INLINE static int engine_maketasks_pair_in_pass(
+    const struct cell *ci, const struct cell *cj, const int nodeID,
+    const int foreign) {
+
+  const int local_i = (ci->nodeID == nodeID);
+  const int local_j = (cj->nodeID == nodeID);
+  if (foreign)
+    return local_i != local_j;
+  else
+    return local_i && local_j;
+}
+
 /**
  * @brief Constructs the top-level tasks for the short-range gravity
  * and long-range gravity interactions.
@@ -1913,11 +1938,17 @@ void engine_make_hierarchical_tasks_mapper(void *map_data, int num_elements,
  * - All top-cells get a self task.
  * - All pairs within range according to the multipole acceptance
  *   criterion get a pair task.
+ *
+ * @param map_data Offset of first index disguised as a pointer.
+ * @param num_elements Number of cells to traverse.
+ * @param e The #engine.
+ * @param foreign Make the pairs with foreign cells rather than the local
+ * self and pair tasks?
  */
-void engine_make_self_gravity_tasks_mapper(void *map_data, int num_elements,
-                                           void *extra_data) {
+static void engine_make_self_gravity_tasks(void *map_data, int num_elements,
+                                           struct engine *e,
+                                           const int foreign) {
 
-  struct engine *e = (struct engine *)extra_data;
   struct space *s = e->s;
   struct scheduler *sched = &e->sched;
   const int nodeID = e->nodeID;
@@ -1975,7 +2006,7 @@ void engine_make_self_gravity_tasks_mapper(void *map_data, int num_elements,
     if (ci->grav.count == 0) continue;
 
     /* If the cell is local build a self-interaction */
-    if (ci->nodeID == nodeID) {
+    if (ci->nodeID == nodeID && !foreign) {
       scheduler_addtask(sched, task_type_self, task_subtype_grav, 0, 0, ci,
                         NULL);
     }
@@ -2005,9 +2036,9 @@ void engine_make_self_gravity_tasks_mapper(void *map_data, int num_elements,
           const int cjd = cell_getid(cdim, iii, jjj, kkk);
           struct cell *cj = &cells[cjd];
 
-          /* Avoid duplicates, empty cells and completely foreign pairs */
+          /* Avoid duplicates, empty cells and pairs not made in this pass */
           if (cid >= cjd || cj->grav.count == 0 ||
-              (ci->nodeID != nodeID && cj->nodeID != nodeID))
+              !engine_maketasks_pair_in_pass(ci, cj, nodeID, foreign))
             continue;
 
 #ifdef WITH_MPI
@@ -4184,13 +4215,13 @@ void engine_make_extra_hydroloop_tasks_mapper(void *map_data, int num_elements,
  *
  * @param map_data Offset of first two indices disguised as a pointer.
  * @param num_elements Number of cells to traverse.
- * @param extra_data The #engine.
+ * @param e The #engine.
+ * @param foreign Make the pairs with foreign cells rather than the local
+ * self and pair tasks?
  */
-void engine_make_hydroloop_tasks_mapper(void *map_data, int num_elements,
-                                        void *extra_data) {
+static void engine_make_hydroloop_tasks(void *map_data, int num_elements,
+                                        struct engine *e, const int foreign) {
 
-  /* Extract the engine pointer. */
-  struct engine *e = (struct engine *)extra_data;
   const int periodic = e->s->periodic;
   const int with_feedback = (e->policy & engine_policy_feedback);
   const int with_stars = (e->policy & engine_policy_stars);
@@ -4224,7 +4255,7 @@ void engine_make_hydroloop_tasks_mapper(void *map_data, int num_elements,
       continue;
 
     /* If the cell is local build a self-interaction */
-    if (ci->nodeID == nodeID) {
+    if (ci->nodeID == nodeID && !foreign) {
       scheduler_addtask(sched, task_type_self, task_subtype_density, 0, 0, ci,
                         NULL);
     }
@@ -4253,7 +4284,7 @@ void engine_make_hydroloop_tasks_mapper(void *map_data, int num_elements,
                (!with_feedback || cj->stars.count == 0) &&
                (!with_sinks || cj->sinks.count == 0) &&
                (!with_black_holes || cj->black_holes.count == 0)) ||
-              (ci->nodeID != nodeID && cj->nodeID != nodeID))
+              !engine_maketasks_pair_in_pass(ci, cj, nodeID, foreign))
             continue;
 
           /* Construct the pair task */
@@ -4310,6 +4341,39 @@ void engine_make_hydroloop_tasks_mapper(void *map_data, int num_elements,
   }
 }
 
+/**
+ * @brief Mappers making the self tasks and the pairs of local cells, and
+ * then the pairs with foreign cells, for the first hydro loop and the
+ * self gravity.
+ *
+ * @param map_data Offset of first index disguised as a pointer.
+ * @param num_elements Number of cells to traverse.
+ * @param extra_data The #engine.
+ */
+void engine_make_hydroloop_tasks_local_mapper(void *map_data, int num_elements,
+                                              void *extra_data) {
+  engine_make_hydroloop_tasks(map_data, num_elements,
+                              (struct engine *)extra_data, /*foreign=*/0);
+}
+void engine_make_hydroloop_tasks_foreign_mapper(void *map_data,
+                                                int num_elements,
+                                                void *extra_data) {
+  engine_make_hydroloop_tasks(map_data, num_elements,
+                              (struct engine *)extra_data, /*foreign=*/1);
+}
+void engine_make_self_gravity_tasks_local_mapper(void *map_data,
+                                                 int num_elements,
+                                                 void *extra_data) {
+  engine_make_self_gravity_tasks(map_data, num_elements,
+                                 (struct engine *)extra_data, /*foreign=*/0);
+}
+void engine_make_self_gravity_tasks_foreign_mapper(void *map_data,
+                                                   int num_elements,
+                                                   void *extra_data) {
+  engine_make_self_gravity_tasks(map_data, num_elements,
+                                 (struct engine *)extra_data, /*foreign=*/1);
+}
+
 struct cell_type_pair {
   struct cell *ci, *cj;
   int type;
@@ -4672,9 +4736,46 @@ void engine_make_fof_tasks(struct engine *e) {
             clocks_getunit());
 }
 
+/**
+ * @brief Start filling the #space's task list with the top-level tasks
+ * involving only local cells.
+ *
+ * Nothing is needed from the foreign cells, so this can run while the cell
+ * structures and multipoles are exchanged with the other nodes. The list
+ * is completed by engine_maketasks().
+ *
+ * @param e The #engine we are working with.
+ */
+void engine_maketasks_local(struct engine *e) {
+
+  struct space *s = e->s;
+  struct scheduler *sched = &e->sched;
+  const ticks tic = getticks();
+
+  /* Re-set the scheduler. */
+  scheduler_reset(sched, engine_estimate_nr_tasks(e));
+
+  /* Construct the first hydro loop over neighbours */
+  if (e->policy & engine_policy_hydro)
+    threadpool_map(&e->threadpool, engine_make_hydroloop_tasks_local_mapper,
+                   NULL, s->nr_cells, 1, threadpool_auto_chunk_size, e);
+
+  /* Add the self gravity tasks. */
+  if (e->policy & engine_policy_self_gravity)
+    threadpool_map(&e->threadpool, engine_make_self_gravity_tasks_local_mapper,
+                   NULL, s->nr_cells, 1, threadpool_auto_chunk_size, e);
+
+  if (e->verbose)
+    message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+}
+
 /**
  * @brief Fill the #space's task list.
  *
+ * Must be called after engine_maketasks_local() and once the foreign cells
+ * have arrived.
+ *
  * @param e The #engine we are working with.
  */
 void engine_maketasks(struct engine *e) {
@@ -4685,30 +4786,31 @@ void engine_maketasks(struct engine *e) {
   const int nr_cells = s->nr_cells;
   const ticks tic = getticks();
 
-  /* Re-set the scheduler. */
-  scheduler_reset(sched, engine_estimate_nr_tasks(e));
+  /* The foreign cells are now known, make room for their tasks. */
+  scheduler_reserve(sched, engine_estimate_nr_tasks(e));
 
   ticks tic2 = getticks();
 
-  /* Construct the first hydro loop over neighbours */
-  if (e->policy & engine_policy_hydro)
-    threadpool_map(&e->threadpool, engine_make_hydroloop_tasks_mapper, NULL,
-                   s->nr_cells, 1, threadpool_auto_chunk_size, e);
+  /* Add the pairs of local and foreign cells to the first hydro loop. */
+  if ((e->policy & engine_policy_hydro) && e->nr_nodes > 1)
+    threadpool_map(&e->threadpool, engine_make_hydroloop_tasks_foreign_mapper,
+                   NULL, s->nr_cells, 1, threadpool_auto_chunk_size, e);
 
   if (e->verbose)
-    message("Making hydro tasks took %.3f %s.",
+    message("Making foreign hydro tasks took %.3f %s.",
             clocks_from_ticks(getticks() - tic2), clocks_getunit());
 
   tic2 = getticks();
 
-  /* Add the self gravity tasks. */
-  if (e->policy & engine_policy_self_gravity) {
-    threadpool_map(&e->threadpool, engine_make_self_gravity_tasks_mapper, NULL,
+  /* And to the self gravity. */
+  if ((e->policy & engine_policy_self_gravity) && e->nr_nodes > 1) {
+    threadpool_map(&e->threadpool,
+                   engine_make_self_gravity_tasks_foreign_mapper, NULL,
                    s->nr_cells, 1, threadpool_auto_chunk_size, e);
   }
 
   if (e->verbose)
-    message("Making gravity tasks took %.3f %s.",
+    message("Making foreign gravity tasks took %.3f %s.",
             clocks_from_ticks(getticks() - tic2), clocks_getunit());
 
   /* Add the external gravity tasks. */
@@ -236,6 +236,189 @@ static void *engine_do_redistribute(const char *label, int *counts, char *parts,
   /* And return new memory. */
   return parts_new;
 }
+
+/**
+ * @brief Rotate an array of particles to the left by a given number of
+ * particles, in place.
+ *
+ * @param parts the particle data.
+ * @param nr_parts the number of particles in the array.
+ * @param shift the number of particles to move from the front to the end.
+ * @param sizeofparts sizeof the particle struct.
+ */
+static void engine_redistribute_rotate(char *parts, size_t nr_parts,
+                                       size_t shift, size_t sizeofparts) {
+
+  if (shift == 0 || shift == nr_parts) return;
+
+  /* Three reversals: the two halves and then the whole lot. */
+  const size_t ranges[3][2] = {{0, shift}, {shift, nr_parts}, {0, nr_parts}};
+  for (int r = 0; r < 3; r++) {
+    size_t i = ranges[r][0];
+    size_t j = ranges[r][1];
+    while (i + 1 < j) {
+      j--;
+      memswap_unaligned(&parts[i * sizeofparts], &parts[j * sizeofparts],
+                        sizeofparts);
+      i++;
+    }
+  }
+}
+
+/**
+ * Do the exchange of one type of particles with all the other nodes in place,
+ * streaming the data in bounded messages.
+ *
+ * The particles that stay on this node are first moved to the front of the
+ * array and the ones that leave to its end. The nodes then exchange their
+ * data pairwise, sending to node (nodeID + d) and receiving from node
+ * (nodeID - d) at step d, at most one message of chunk bytes in each
+ * direction at a time. The particles we receive are written straight after
+ * the ones we keep, into the space freed by the ones already sent. Only
+ * when that space runs out is the array grown, once.
+ *
+ * On exit, the particles received from each node are stored after the ones
+ * we kept, in the order node (nodeID - 1), (nodeID - 2), etc. See
+ * engine_redistribute_recv_offsets().
+ *
+ * @param label a label for the memory allocations of this particle type.
+ * @param counts 2D array with the counts of particles to exchange with
+ *               each other node.
+ * @param parts the particle data to exchange, sorted by destination node.
+ * @param size (in/out) the allocated size of the particle array, in number of
+ *             particles.
+ * @param new_nr_parts the number of particles this node will have after all
+ *                     exchanges have completed.
+ * @param sizeofparts sizeof the particle struct.
+ * @param alignsize the memory alignment required for this particle type.
+ * @param mpi_type the MPI_Datatype for these particles.
+ * @param nr_nodes the number of nodes to exchange with.
+ * @param nodeID the id of this node.
+ * @param chunk the largest message to exchange, in bytes.
+ *
+ * @result the particle data, which is only a new array if it had to grow.
+ */
+static void *engine_do_redistribute_stream(
+    const char *label, int *counts, char *parts, size_t *size,
+    size_t new_nr_parts, size_t sizeofparts, size_t alignsize,
+    MPI_Datatype mpi_type, int nr_nodes, int nodeID, size_t chunk) {
+
+  /* What we keep, what leaves and where it sits in the sorted array. */
+  const size_t nr_keep = counts[nodeID * nr_nodes + nodeID];
+  size_t nr_before = 0, nr_parts = 0;
+  for (int k = 0; k < nr_nodes; k++) {
+    if (k < nodeID) nr_before += counts[nodeID * nr_nodes + k];
+    nr_parts += counts[nodeID * nr_nodes + k];
+  }
+  const size_t nr_out = nr_parts - nr_keep;
+
+  /* Move the particles we keep to the front. The ones leaving then come in
+   * the order of the nodes we send to. */
+  engine_redistribute_rotate(parts, nr_parts, nr_before, sizeofparts);
+
+  /* And move the ones leaving to the end of the array, the space left in
+   * between is where the first particles we receive go. */
+  size_t alloc = *size;
+  size_t first_out = alloc - nr_out;
+  if (first_out > nr_keep)
+    memmove(&parts[first_out * sizeofparts], &parts[nr_keep * sizeofparts],
+            nr_out * sizeofparts);
+
+  /* Number of particles in a message. */
+  size_t max_count = chunk / sizeofparts;
+  if (max_count == 0) max_count = 1;
+  if (max_count > INT_MAX / sizeofparts) max_count = INT_MAX / sizeofparts;
+
+  size_t sent = 0, recvd = 0;
+  for (int d = 1; d < nr_nodes; d++) {
+    const int send_node = (nodeID + d) % nr_nodes;
+    const int recv_node = (nodeID - d + nr_nodes) % nr_nodes;
+    const size_t nr_send = counts[nodeID * nr_nodes + send_node];
+    const size_t nr_recv = counts[recv_node * nr_nodes + nodeID];
+
+    size_t step_sent = 0, step_recvd = 0;
+    while (step_sent < nr_send || step_recvd < nr_recv) {
+
+      size_t sending = nr_send - step_sent;
+      if (sending > max_count) sending = max_count;
+      size_t receiving = nr_recv - step_recvd;
+      if (receiving > max_count) receiving = max_count;
+
+      /* Not enough space freed to receive in place? Time to grow, large
+       * enough for what is still to come. */
+      if (nr_keep + recvd + receiving > first_out + sent) {
+        const size_t nr_unsent = nr_out - sent;
+        size_t new_alloc = engine_redistribute_alloc_margin * new_nr_parts;
+        if (new_alloc < new_nr_parts + nr_unsent)
+          new_alloc = new_nr_parts + nr_unsent;
+
+        char *parts_new = NULL;
+        if (swift_memalign(label, (void **)&parts_new, alignsize,
+                           sizeofparts * new_alloc) != 0)
+          error("Failed to allocate new particle data.");
+        memcpy(parts_new, parts, (nr_keep + recvd) * sizeofparts);
+        memcpy(&parts_new[(new_alloc - nr_unsent) * sizeofparts],
+               &parts[(first_out + sent) * sizeofparts],
+               nr_unsent * sizeofparts);
+        swift_free(label, parts);
+        parts = parts_new;
+        alloc = new_alloc;
+        first_out = new_alloc - nr_out;
+      }
+
+      MPI_Request reqs[2] = {MPI_REQUEST_NULL, MPI_REQUEST_NULL};
+      if (sending > 0) {
+        int res = MPI_Isend(&parts[(first_out + sent) * sizeofparts],
+                            sending, mpi_type, send_node, d, MPI_COMM_WORLD,
+                            &reqs[0]);
+        if (res != MPI_SUCCESS)
+          mpi_error(res, "Failed to isend %s to node %i.", label, send_node);
+      }
+      if (receiving > 0) {
+        int res = MPI_Irecv(&parts[(nr_keep + recvd) * sizeofparts],
+                            receiving, mpi_type, recv_node, d, MPI_COMM_WORLD,
+                            &reqs[1]);
+        if (res != MPI_SUCCESS)
+          mpi_error(res, "Failed to irecv %s from node %i.", label, recv_node);
+      }
+
+      int res;
+      if ((res = MPI_Waitall(2, reqs, MPI_STATUSES_IGNORE)) != MPI_SUCCESS)
+        mpi_error(res, "Failed during waitall for %s data.", label);
+
+      sent += sending;
+      step_sent += sending;
+      recvd += receiving;
+      step_recvd += receiving;
+    }
+  }
+
+  *size = alloc;
+  return parts;
+}
+
+/**
+ * @brief Get where the particles received from each node start in the
+ * array built by the exchange.
+ *
+ * @param counts 2D array with the counts of particles exchanged with
+ *               each other node.
+ * @param nr_nodes the number of nodes.
+ * @param nodeID the id of this node.
+ * @param stream whether the exchange was done by
+ *               engine_do_redistribute_stream().
+ * @param offsets (return) the offset of the particles from each node.
+ */
+static void engine_redistribute_recv_offsets(const int *counts, int nr_nodes,
+                                             int nodeID, int stream,
+                                             size_t *offsets) {
+  size_t offset = 0;
+  for (int d = 0; d < nr_nodes; d++) {
+    const int node = stream ? (nodeID - d + nr_nodes) % nr_nodes : d;
+    offsets[node] = offset;
+    offset += counts[node * nr_nodes + nodeID];
+  }
+}
 #endif
 
 #ifdef WITH_MPI /* redist_mapper */
@@ -426,11 +609,12 @@ void ENGINE_REDISTRIBUTE_SAVELINK_MAPPER(sink, 0);
 struct relink_mapper_data {
   int nodeID;
   int nr_nodes;
-  int *counts;
-  int *s_counts;
   int *g_counts;
-  int *b_counts;
-  int *sink_counts;
+  size_t *offsets;
+  size_t *s_offsets;
+  size_t *g_offsets;
+  size_t *b_offsets;
+  size_t *sink_offsets;
   struct space *s;
 };
 
@@ -450,31 +634,19 @@ void engine_redistribute_relink_mapper(void *map_data, int num_elements,
 
   int nodeID = mydata->nodeID;
   int nr_nodes = mydata->nr_nodes;
-  int *counts = mydata->counts;
   int *g_counts = mydata->g_counts;
-  int *s_counts = mydata->s_counts;
-  int *b_counts = mydata->b_counts;
-  int *sink_counts = mydata->sink_counts;
   struct space *s = mydata->s;
 
   for (int i = 0; i < num_elements; i++) {
 
     int node = nodes[i];
 
-    /* Get offsets to correct parts of the counts arrays for this node. */
-    size_t offset_parts = 0;
-    size_t offset_gparts = 0;
-    size_t offset_sparts = 0;
-    size_t offset_bparts = 0;
-    size_t offset_sinks = 0;
-    for (int n = 0; n < node; n++) {
-      int ind_recv = n * nr_nodes + nodeID;
-      offset_parts += counts[ind_recv];
-      offset_gparts += g_counts[ind_recv];
-      offset_sparts += s_counts[ind_recv];
-      offset_bparts += b_counts[ind_recv];
-      offset_sinks += sink_counts[ind_recv];
-    }
+    /* Get where the particles received from this node start. */
+    const size_t offset_parts = mydata->offsets[node];
+    const size_t offset_gparts = mydata->g_offsets[node];
+    const size_t offset_sparts = mydata->s_offsets[node];
+    const size_t offset_bparts = mydata->b_offsets[node];
+    const size_t offset_sinks = mydata->sink_offsets[node];
 
     /* Number of gparts sent from this node. */
     int ind_recv = node * nr_nodes + nodeID;
@@ -1178,85 +1350,143 @@ void engine_redistribute(struct engine *e) {
 
   /* Now exchange the particles, type by type to keep the memory required
    * under control. */
+  const int stream = e->redist_chunk > 0;
+  if (stream) {
+
+    /* In place, in messages of bounded size. The parts and xparts arrays
+     * share their size and make the same decisions about growing. */
+    size_t size_parts = s->size_parts;
+    s->parts = (struct part *)engine_do_redistribute_stream(
+        "parts", counts, (char *)s->parts, &size_parts, nr_parts_new,
+        sizeof(struct part), part_align, part_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    size_t size_xparts = s->size_parts;
+    s->xparts = (struct xpart *)engine_do_redistribute_stream(
+        "xparts", counts, (char *)s->xparts, &size_xparts, nr_parts_new,
+        sizeof(struct xpart), xpart_align, xpart_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    if (size_xparts != size_parts)
+      error("Sizes of the parts and xparts arrays differ after exchange.");
+    s->nr_parts = nr_parts_new;
+    s->size_parts = size_parts;
+
+    s->gparts = (struct gpart *)engine_do_redistribute_stream(
+        "gparts", g_counts, (char *)s->gparts, &s->size_gparts, nr_gparts_new,
+        sizeof(struct gpart), gpart_align, gpart_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    s->nr_gparts = nr_gparts_new;
+
+    s->sparts = (struct spart *)engine_do_redistribute_stream(
+        "sparts", s_counts, (char *)s->sparts, &s->size_sparts, nr_sparts_new,
+        sizeof(struct spart), spart_align, spart_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    s->nr_sparts = nr_sparts_new;
+
+    s->bparts = (struct bpart *)engine_do_redistribute_stream(
+        "bparts", b_counts, (char *)s->bparts, &s->size_bparts, nr_bparts_new,
+        sizeof(struct bpart), bpart_align, bpart_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    s->nr_bparts = nr_bparts_new;
+
+    s->sinks = (struct sink *)engine_do_redistribute_stream(
+        "sinks", sink_counts, (char *)s->sinks, &s->size_sinks, nr_sinks_new,
+        sizeof(struct sink), sink_align, sink_mpi_type, nr_nodes, nodeID,
+        e->redist_chunk);
+    s->nr_sinks = nr_sinks_new;
 
-  /* SPH particles. */
-  void *new_parts = engine_do_redistribute(
-      "parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
-      part_align, part_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("parts", s->parts);
-  s->parts = (struct part *)new_parts;
-  s->nr_parts = nr_parts_new;
-  s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
-
-  /* Extra SPH particle properties. */
-  new_parts = engine_do_redistribute(
-      "xparts", counts, (char *)s->xparts, nr_parts_new, sizeof(struct xpart),
-      xpart_align, xpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("xparts", s->xparts);
-  s->xparts = (struct xpart *)new_parts;
-
-  /* Gravity particles. */
-  new_parts =
-      engine_do_redistribute("gparts", g_counts, (char *)s->gparts,
-                             nr_gparts_new, sizeof(struct gpart), gpart_align,
-                             gpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("gparts", s->gparts);
-  s->gparts = (struct gpart *)new_parts;
-  s->nr_gparts = nr_gparts_new;
-  s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
-
-  /* Star particles. */
-  new_parts =
-      engine_do_redistribute("sparts", s_counts, (char *)s->sparts,
-                             nr_sparts_new, sizeof(struct spart), spart_align,
-                             spart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("sparts", s->sparts);
-  s->sparts = (struct spart *)new_parts;
-  s->nr_sparts = nr_sparts_new;
-  s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
-
-  /* Black holes particles. */
-  new_parts =
-      engine_do_redistribute("bparts", b_counts, (char *)s->bparts,
-                             nr_bparts_new, sizeof(struct bpart), bpart_align,
-                             bpart_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("bparts", s->bparts);
-  s->bparts = (struct bpart *)new_parts;
-  s->nr_bparts = nr_bparts_new;
-  s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
-
-  /* Sink particles. */
-  new_parts = engine_do_redistribute(
-      "sinks", sink_counts, (char *)s->sinks, nr_sinks_new, sizeof(struct sink),
-      sink_align, sink_mpi_type, nr_nodes, nodeID, e->syncredist);
-  swift_free("sinks", s->sinks);
-  s->sinks = (struct sink *)new_parts;
-  s->nr_sinks = nr_sinks_new;
-  s->size_sinks = engine_redistribute_alloc_margin * nr_sinks_new;
+  } else {
+
+    /* SPH particles. */
+    void *new_parts = engine_do_redistribute(
+        "parts", counts, (char *)s->parts, nr_parts_new, sizeof(struct part),
+        part_align, part_mpi_type, nr_nodes, nodeID, e->syncredist);
+    swift_free("parts", s->parts);
+    s->parts = (struct part *)new_parts;
+    s->nr_parts = nr_parts_new;
+    s->size_parts = engine_redistribute_alloc_margin * nr_parts_new;
+
+    /* Extra SPH particle properties. */
+    new_parts = engine_do_redistribute(
+        "xparts", counts, (char *)s->xparts, nr_parts_new, sizeof(struct xpart),
+        xpart_align, xpart_mpi_type, nr_nodes, nodeID, e->syncredist);
+    swift_free("xparts", s->xparts);
+    s->xparts = (struct xpart *)new_parts;
+
+    /* Gravity particles. */
+    new_parts =
+        engine_do_redistribute("gparts", g_counts, (char *)s->gparts,
+                               nr_gparts_new, sizeof(struct gpart), gpart_align,
+                               gpart_mpi_type, nr_nodes, nodeID, e->syncredist);
+    swift_free("gparts", s->gparts);
+    s->gparts = (struct gpart *)new_parts;
+    s->nr_gparts = nr_gparts_new;
+    s->size_gparts = engine_redistribute_alloc_margin * nr_gparts_new;
+
+    /* Star particles. */
+    new_parts =
+        engine_do_redistribute("sparts", s_counts, (char *)s->sparts,
+                               nr_sparts_new, sizeof(struct spart), spart_align,
+                               spart_mpi_type, nr_nodes, nodeID, e->syncredist);
+    swift_free("sparts", s->sparts);
+    s->sparts = (struct spart *)new_parts;
+    s->nr_sparts = nr_sparts_new;
+    s->size_sparts = engine_redistribute_alloc_margin * nr_sparts_new;
+
+    /* Black holes particles. */
+    new_parts =
+        engine_do_redistribute("bparts", b_counts, (char *)s->bparts,
+                               nr_bparts_new, sizeof(struct bpart), bpart_align,
+                               bpart_mpi_type, nr_nodes, nodeID, e->syncredist);
+    swift_free("bparts", s->bparts);
+    s->bparts = (struct bpart *)new_parts;
+    s->nr_bparts = nr_bparts_new;
+    s->size_bparts = engine_redistribute_alloc_margin * nr_bparts_new;
+
+    /* Sink particles. */
+    new_parts = engine_do_redistribute("sinks", sink_counts, (char *)s->sinks,
+                                       nr_sinks_new, sizeof(struct sink),
+                                       sink_align, sink_mpi_type, nr_nodes,
+                                       nodeID, e->syncredist);
+    swift_free("sinks", s->sinks);
+    s->sinks = (struct sink *)new_parts;
+    s->nr_sinks = nr_sinks_new;
+    s->size_sinks = engine_redistribute_alloc_margin * nr_sinks_new;
+  }
+
+  /* Where the particles from each node now start. */
+  size_t *offsets = NULL, *g_offsets = NULL, *s_offsets = NULL,
+         *b_offsets = NULL, *sink_offsets = NULL;
+  if ((offsets = (size_t *)malloc(5 * nr_nodes * sizeof(size_t))) == NULL)
+    error("Failed to allocate offsets temporary buffer.");
+  g_offsets = offsets + nr_nodes;
+  s_offsets = offsets + 2 * nr_nodes;
+  b_offsets = offsets + 3 * nr_nodes;
+  sink_offsets = offsets + 4 * nr_nodes;
+  engine_redistribute_recv_offsets(counts, nr_nodes, nodeID, stream, offsets);
+  engine_redistribute_recv_offsets(g_counts, nr_nodes, nodeID, stream,
+                                   g_offsets);
+  engine_redistribute_recv_offsets(s_counts, nr_nodes, nodeID, stream,
+                                   s_offsets);
+  engine_redistribute_recv_offsets(b_counts, nr_nodes, nodeID, stream,
+                                   b_offsets);
+  engine_redistribute_recv_offsets(sink_counts, nr_nodes, nodeID, stream,
+                                   sink_offsets);
 
   /* All particles have now arrived. Time for some final operations on the
      stuff we just received */
 
 #ifdef WITH_CSDS
   if (!initial_redistribute && e->policy & engine_policy_csds) {
-    size_t part_offset = 0;
-    size_t spart_offset = 0;
-    size_t gpart_offset = 0;
-    size_t bpart_offset = 0;
-    size_t sink_offset = 0;
 
     for (int i = 0; i < nr_nodes; i++) {
       const size_t c_ind = i * nr_nodes + engine_rank;
 
       /* No need to log the local particles. */
-      if (i == engine_rank) {
-        part_offset += counts[c_ind];
-        spart_offset += s_counts[c_ind];
-        gpart_offset += g_counts[c_ind];
-        bpart_offset += b_counts[c_ind];
-        sink_offset += sink_counts[c_ind];
-        continue;
-      }
+      if (i == engine_rank) continue;
+
+      const size_t part_offset = offsets[i];
+      const size_t spart_offset = s_offsets[i];
+      const size_t gpart_offset = g_offsets[i];
 
       /* Log the hydro parts. */
       csds_log_parts(e->csds, &s->parts[part_offset], &s->xparts[part_offset],
@@ -1280,13 +1510,6 @@ void engine_redistribute(struct engine *e) {
       if (sink_counts[c_ind] > 0) {
         error("TODO");
       }
-
-      /* Update the counters */
-      part_offset += counts[c_ind];
-      spart_offset += s_counts[c_ind];
-      gpart_offset += g_counts[c_ind];
-      bpart_offset += b_counts[c_ind];
-      sink_offset += sink_counts[c_ind];
     }
   }
 #endif
@@ -1296,11 +1519,12 @@ void engine_redistribute(struct engine *e) {
    * at a time. */
   struct relink_mapper_data relink_data;
   relink_data.s = s;
-  relink_data.counts = counts;
   relink_data.g_counts = g_counts;
-  relink_data.s_counts = s_counts;
-  relink_data.b_counts = b_counts;
-  relink_data.sink_counts = sink_counts;
+  relink_data.offsets = offsets;
+  relink_data.g_offsets = g_offsets;
+  relink_data.s_offsets = s_offsets;
+  relink_data.b_offsets = b_offsets;
+  relink_data.sink_offsets = sink_offsets;
   relink_data.nodeID = nodeID;
   relink_data.nr_nodes = nr_nodes;
 
@@ -1309,6 +1533,7 @@ void engine_redistribute(struct engine *e) {
   free(nodes);
 
   /* Clean up the counts now we are done. */
+  free(offsets);
   free(counts);
   free(g_counts);
   free(s_counts);
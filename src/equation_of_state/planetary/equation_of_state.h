@@ -1449,6 +1449,88 @@ gas_soundspeed_from_internal_energy(float density, float u,
   }
 }
 
+/**
+ * @brief Returns the SESAME-style table of a material, if it uses one
+ *
+ * @param mat_id The material ID
+ * @return The table parameters or NULL for analytic EoS
+ */
+__attribute__((always_inline)) INLINE static const struct SESAME_params *
+gas_planetary_SESAME_table(enum eos_planetary_material_id mat_id) {
+
+  const enum eos_planetary_type_id type =
+      (enum eos_planetary_type_id)(mat_id / eos_planetary_type_factor);
+
+  switch (type) {
+
+    /* SESAME EoS */
+    case eos_planetary_type_SESAME:
+      switch (mat_id) {
+        case eos_planetary_id_SESAME_iron:
+          return &eos.SESAME_iron;
+        case eos_planetary_id_SESAME_basalt:
+          return &eos.SESAME_basalt;
+        case eos_planetary_id_SESAME_water:
+          return &eos.SESAME_water;
+        case eos_planetary_id_SS08_water:
+          return &eos.SS08_water;
+        default:
+          return NULL;
+      };
+
+    /* ANEOS -- using SESAME-style tables */
+    case eos_planetary_type_ANEOS:
+      switch (mat_id) {
+        case eos_planetary_id_ANEOS_forsterite:
+          return &eos.ANEOS_forsterite;
+        case eos_planetary_id_ANEOS_iron:
+          return &eos.ANEOS_iron;
+        case eos_planetary_id_ANEOS_Fe85Si15:
+          return &eos.ANEOS_Fe85Si15;
+        default:
+          return NULL;
+      };
+
+    /*! Generic user-provided custom tables */
+    case eos_planetary_type_custom:
+      return &eos.custom[mat_id -
+                         eos_planetary_type_custom * eos_planetary_type_factor];
+
+    default:
+      return NULL;
+  }
+}
+
+/**
+ * @brief Returns both the pressure and the sound speed given density and
+ * internal energy
+ *
+ * Equivalent to calling gas_pressure_from_internal_energy() and
+ * gas_soundspeed_from_internal_energy() but the tabulated EoS only locate
+ * the (rho, u) point in their table once.
+ *
+ * @param density The density \f$\rho\f$
+ * @param u The internal energy \f$u\f$
+ * @param mat_id The material ID
+ * @param P (return) The pressure \f$P\f$
+ * @param c (return) The sound speed \f$c\f$
+ */
+__attribute__((always_inline)) INLINE static void
+gas_pressure_and_soundspeed_from_internal_energy(
+    float density, float u, enum eos_planetary_material_id mat_id, float *P,
+    float *c) {
+
+  const struct SESAME_params *table = gas_planetary_SESAME_table(mat_id);
+
+  if (table != NULL) {
+    SESAME_pressure_and_soundspeed_from_internal_energy(density, u, table, P,
+                                                        c);
+  } else {
+    *P = gas_pressure_from_internal_energy(density, u, mat_id);
+    *c = gas_soundspeed_from_internal_energy(density, u, mat_id);
+  }
+}
+
 /**
  * @brief Returns the sound speed given density and pressure
  *
@@ -373,8 +373,9 @@ INLINE static float SESAME_internal_energy_from_entropy(
   // Sp. entropy at this and the next density (in relevant slice of s array)
   idx_s_1 = find_value_in_monot_incr_array(
       log_s, mat->table_log_s_rho_T + idx_rho * mat->num_T, mat->num_T);
-  idx_s_2 = find_value_in_monot_incr_array(
-      log_s, mat->table_log_s_rho_T + (idx_rho + 1) * mat->num_T, mat->num_T);
+  idx_s_2 = find_value_in_monot_incr_array_from_guess(
+      log_s, mat->table_log_s_rho_T + (idx_rho + 1) * mat->num_T, mat->num_T,
+      idx_s_1);
 
   // If outside the table then extrapolate from the edge and edge-but-one values
   if (idx_rho <= -1) {
@@ -476,31 +477,37 @@ INLINE static float SESAME_entropy_from_internal_energy(
   return 0.f;
 }
 
-// gas_pressure_from_internal_energy
-INLINE static float SESAME_pressure_from_internal_energy(
-    float density, float u, const struct SESAME_params *mat) {
-
-  float P, P_1, P_2, P_3, P_4;
+/**
+ * @brief Position of a (rho, u) point in the SESAME-style tables.
+ *
+ * The table indices and bilinear interpolation weights shared by all the
+ * quantities interpolated from (rho, u), so that several of them can be read
+ * for the cost of a single set of searches.
+ */
+struct SESAME_interp_u {
+  int idx_rho, idx_u_1, idx_u_2;
+  float intp_rho, intp_u_1, intp_u_2;
+};
 
-  if (u <= 0.f) {
-    return 0.f;
-  }
+// Find the table indices and weights for a given log(rho), log(u)
+INLINE static void SESAME_locate_internal_energy(
+    float log_rho, float log_u, const struct SESAME_params *mat,
+    struct SESAME_interp_u *w) {
 
   int idx_rho, idx_u_1, idx_u_2;
-  float intp_rho, intp_u_1, intp_u_2;
-  const float log_rho = logf(density);
-  const float log_u = logf(u);
 
-  // 2D interpolation (bilinear with log(rho), log(u)) to find P(rho, u))
+  // 2D interpolation (bilinear with log(rho), log(u))
   // Density index
   idx_rho =
       find_value_in_monot_incr_array(log_rho, mat->table_log_rho, mat->num_rho);
 
   // Sp. int. energy at this and the next density (in relevant slice of u array)
+  // The two slices are usually close, so start the second search at the first
   idx_u_1 = find_value_in_monot_incr_array(
       log_u, mat->table_log_u_rho_T + idx_rho * mat->num_T, mat->num_T);
-  idx_u_2 = find_value_in_monot_incr_array(
-      log_u, mat->table_log_u_rho_T + (idx_rho + 1) * mat->num_T, mat->num_T);
+  idx_u_2 = find_value_in_monot_incr_array_from_guess(
+      log_u, mat->table_log_u_rho_T + (idx_rho + 1) * mat->num_T, mat->num_T,
+      idx_u_1);
 
   // If outside the table then extrapolate from the edge and edge-but-one values
   if (idx_rho <= -1) {
@@ -521,30 +528,49 @@ INLINE static float SESAME_pressure_from_internal_energy(
 
   // Check for duplicates in SESAME tables before interpolation
   if (mat->table_log_rho[idx_rho + 1] != mat->table_log_rho[idx_rho]) {
-    intp_rho = (log_rho - mat->table_log_rho[idx_rho]) /
-               (mat->table_log_rho[idx_rho + 1] - mat->table_log_rho[idx_rho]);
+    w->intp_rho =
+        (log_rho - mat->table_log_rho[idx_rho]) /
+        (mat->table_log_rho[idx_rho + 1] - mat->table_log_rho[idx_rho]);
   } else {
-    intp_rho = 1.f;
+    w->intp_rho = 1.f;
   }
   if (mat->table_log_u_rho_T[idx_rho * mat->num_T + (idx_u_1 + 1)] !=
       mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]) {
-    intp_u_1 =
+    w->intp_u_1 =
         (log_u - mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]) /
         (mat->table_log_u_rho_T[idx_rho * mat->num_T + (idx_u_1 + 1)] -
          mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]);
   } else {
-    intp_u_1 = 1.f;
+    w->intp_u_1 = 1.f;
   }
   if (mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + (idx_u_2 + 1)] !=
       mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]) {
-    intp_u_2 =
+    w->intp_u_2 =
         (log_u - mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]) /
         (mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + (idx_u_2 + 1)] -
          mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]);
   } else {
-    intp_u_2 = 1.f;
+    w->intp_u_2 = 1.f;
   }
 
+  w->idx_rho = idx_rho;
+  w->idx_u_1 = idx_u_1;
+  w->idx_u_2 = idx_u_2;
+}
+
+// Interpolate the pressure at a located (rho, u) point
+INLINE static float SESAME_pressure_from_located_internal_energy(
+    const struct SESAME_interp_u *w, const struct SESAME_params *mat) {
+
+  float P, P_1, P_2, P_3, P_4;
+
+  const int idx_rho = w->idx_rho;
+  const int idx_u_1 = w->idx_u_1;
+  const int idx_u_2 = w->idx_u_2;
+  const float intp_rho = w->intp_rho;
+  float intp_u_1 = w->intp_u_1;
+  float intp_u_2 = w->intp_u_2;
+
   // Table values
   P_1 = mat->table_P_rho_T[idx_rho * mat->num_T + idx_u_1];
   P_2 = mat->table_P_rho_T[idx_rho * mat->num_T + idx_u_1 + 1];
@@ -592,83 +618,18 @@ INLINE static float SESAME_pressure_from_internal_energy(
   return P;
 }
 
-// gas_internal_energy_from_pressure
-INLINE static float SESAME_internal_energy_from_pressure(
-    float density, float P, const struct SESAME_params *mat) {
-
-  error("This EOS function is not yet implemented!");
-
-  return 0.f;
-}
-
-// gas_soundspeed_from_internal_energy
-INLINE static float SESAME_soundspeed_from_internal_energy(
-    float density, float u, const struct SESAME_params *mat) {
+// Interpolate the sound speed at a located (rho, u) point
+INLINE static float SESAME_soundspeed_from_located_internal_energy(
+    const struct SESAME_interp_u *w, const struct SESAME_params *mat) {
 
   float c, c_1, c_2, c_3, c_4;
 
-  if (u <= 0.f) {
-    return 0.f;
-  }
-
-  int idx_rho, idx_u_1, idx_u_2;
-  float intp_rho, intp_u_1, intp_u_2;
-  const float log_rho = logf(density);
-  const float log_u = logf(u);
-
-  // 2D interpolation (bilinear with log(rho), log(u)) to find c(rho, u))
-  // Density index
-  idx_rho =
-      find_value_in_monot_incr_array(log_rho, mat->table_log_rho, mat->num_rho);
-
-  // Sp. int. energy at this and the next density (in relevant slice of u array)
-  idx_u_1 = find_value_in_monot_incr_array(
-      log_u, mat->table_log_u_rho_T + idx_rho * mat->num_T, mat->num_T);
-  idx_u_2 = find_value_in_monot_incr_array(
-      log_u, mat->table_log_u_rho_T + (idx_rho + 1) * mat->num_T, mat->num_T);
-
-  // If outside the table then extrapolate from the edge and edge-but-one values
-  if (idx_rho <= -1) {
-    idx_rho = 0;
-  } else if (idx_rho >= mat->num_rho) {
-    idx_rho = mat->num_rho - 2;
-  }
-  if (idx_u_1 <= -1) {
-    idx_u_1 = 0;
-  } else if (idx_u_1 >= mat->num_T) {
-    idx_u_1 = mat->num_T - 2;
-  }
-  if (idx_u_2 <= -1) {
-    idx_u_2 = 0;
-  } else if (idx_u_2 >= mat->num_T) {
-    idx_u_2 = mat->num_T - 2;
-  }
-
-  // Check for duplicates in SESAME tables before interpolation
-  if (mat->table_log_rho[idx_rho + 1] != mat->table_log_rho[idx_rho]) {
-    intp_rho = (log_rho - mat->table_log_rho[idx_rho]) /
-               (mat->table_log_rho[idx_rho + 1] - mat->table_log_rho[idx_rho]);
-  } else {
-    intp_rho = 1.f;
-  }
-  if (mat->table_log_u_rho_T[idx_rho * mat->num_T + (idx_u_1 + 1)] !=
-      mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]) {
-    intp_u_1 =
-        (log_u - mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]) /
-        (mat->table_log_u_rho_T[idx_rho * mat->num_T + (idx_u_1 + 1)] -
-         mat->table_log_u_rho_T[idx_rho * mat->num_T + idx_u_1]);
-  } else {
-    intp_u_1 = 1.f;
-  }
-  if (mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + (idx_u_2 + 1)] !=
-      mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]) {
-    intp_u_2 =
-        (log_u - mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]) /
-        (mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + (idx_u_2 + 1)] -
-         mat->table_log_u_rho_T[(idx_rho + 1) * mat->num_T + idx_u_2]);
-  } else {
-    intp_u_2 = 1.f;
-  }
+  const int idx_rho = w->idx_rho;
+  const int idx_u_1 = w->idx_u_1;
+  const int idx_u_2 = w->idx_u_2;
+  const float intp_rho = w->intp_rho;
+  float intp_u_1 = w->intp_u_1;
+  float intp_u_2 = w->intp_u_2;
 
   // Table values
   c_1 = mat->table_c_rho_T[idx_rho * mat->num_T + idx_u_1];
@@ -719,6 +680,62 @@ INLINE static float SESAME_soundspeed_from_internal_energy(
   return c;
 }
 
+// gas_pressure_from_internal_energy
+INLINE static float SESAME_pressure_from_internal_energy(
+    float density, float u, const struct SESAME_params *mat) {
+
+  if (u <= 0.f) {
+    return 0.f;
+  }
+
+  struct SESAME_interp_u w;
+  SESAME_locate_internal_energy(logf(density), logf(u), mat, &w);
+
+  return SESAME_pressure_from_located_internal_energy(&w, mat);
+}
+
+// gas_internal_energy_from_pressure
+INLINE static float SESAME_internal_energy_from_pressure(
+    float density, float P, const struct SESAME_params *mat) {
+
+  error("This EOS function is not yet implemented!");
+
+  return 0.f;
+}
+
+// gas_soundspeed_from_internal_energy
+INLINE static float SESAME_soundspeed_from_internal_energy(
+    float density, float u, const struct SESAME_params *mat) {
+
+  if (u <= 0.f) {
+    return 0.f;
+  }
+
+  struct SESAME_interp_u w;
+  SESAME_locate_internal_energy(logf(density), logf(u), mat, &w);
+
+  return SESAME_soundspeed_from_located_internal_energy(&w, mat);
+}
+
+// gas_pressure_and_soundspeed_from_internal_energy
+INLINE static void SESAME_pressure_and_soundspeed_from_internal_energy(
+    float density, float u, const struct SESAME_params *mat, float *P,
+    float *c) {
+
+  if (u <= 0.f) {
+    *P = 0.f;
+    *c = 0.f;
+    return;
+  }
+
+  // Both quantities live on the same (rho, u) grid: search it only once
+  struct SESAME_interp_u w;
+  SESAME_locate_internal_energy(logf(density), logf(u), mat, &w);
+
+  *P = SESAME_pressure_from_located_internal_energy(&w, mat);
+  *c = SESAME_soundspeed_from_located_internal_energy(&w, mat);
+}
+
 // gas_soundspeed_from_pressure
 INLINE static float SESAME_soundspeed_from_pressure(
     float density, float P, const struct SESAME_params *mat) {
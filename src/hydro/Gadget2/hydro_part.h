@@ -101,6 +101,11 @@ struct part {
   /* Particle position. */
   double x[3];
 
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+  /*! Particle position relative to the corner of its top-level cell. */
+  float x_rel[3];
+#endif
+
   /* Particle predicted velocity. */
   float v[3];
 
@@ -166,6 +171,15 @@ struct part {
     } force;
   };
 
+  /*! RT sub-cycling time stepping data */
+  struct rt_timestepping_data rt_time_data;
+
+  /*! Time-step length */
+  timebin_t time_bin;
+
+  /*! Time-step limiter information */
+  struct timestep_limiter_data limiter_data;
+
   /*! Additional data used for adaptive softening */
   struct adaptive_softening_part_data adaptive_softening_data;
 
@@ -193,15 +207,6 @@ struct part {
   /*! Additional Radiative Transfer Data */
   struct rt_part_data rt_data;
 
-  /*! RT sub-cycling time stepping data */
-  struct rt_timestepping_data rt_time_data;
-
-  /*! Time-step length */
-  timebin_t time_bin;
-
-  /*! Time-step limiter information */
-  struct timestep_limiter_data limiter_data;
-
 #ifdef SWIFT_DEBUG_CHECKS
 
   /* Time of the last drift */
@@ -31,6 +31,11 @@ struct part {
   /*! Particle position. */
   double x[3];
 
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+  /*! Particle position relative to the corner of its top-level cell. */
+  float x_rel[3];
+#endif
+
   /* In MFM, the particle and fluid velocities are the same.
      We use an anonymous union to make sure we can reference the
      same array with both names. */
@@ -153,6 +158,15 @@ struct part {
 
   } timestepvars;
 
+  /*! RT sub-cycling time stepping data */
+  struct rt_timestepping_data rt_time_data;
+
+  /*! Time-step length */
+  timebin_t time_bin;
+
+  /*! Time-step limiter information */
+  struct timestep_limiter_data limiter_data;
+
   /*! Chemistry information */
   struct chemistry_part_data chemistry_data;
 
@@ -171,15 +185,6 @@ struct part {
   /*! Additional Radiative Transfer Data */
   struct rt_part_data rt_data;
 
-  /*! RT sub-cycling time stepping data */
-  struct rt_timestepping_data rt_time_data;
-
-  /*! Time-step length */
-  timebin_t time_bin;
-
-  /*! Time-step limiter information */
-  struct timestep_limiter_data limiter_data;
-
 #ifdef SWIFT_DEBUG_CHECKS
 
   /* Time of the last drift */
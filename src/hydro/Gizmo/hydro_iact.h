@@ -24,6 +24,7 @@
 #include "hydro_flux.h"
 #include "hydro_getters.h"
 #include "hydro_gradients.h"
+#include "hydro_pair_geometry.h"
 #include "hydro_setters.h"
 #include "hydro_velocities.h"
 #include "rt_additions.h"
@@ -127,6 +128,96 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_density(
   fvpm_update_centroid_left(pi, dx, wi);
 }
 
+/**
+ * @brief Compute the effective face area vector of the interface between
+ * particle i and particle j.
+ *
+ * This only depends on quantities that are frozen after the density loop, so
+ * it gives the same result in the gradient and the flux loops.
+ *
+ * @param r2 Comoving squared distance between particle i and particle j.
+ * @param dx Comoving distance vector between the particles (dx = pi->x -
+ * pj->x).
+ * @param hi Comoving smoothing-length of particle i.
+ * @param hj Comoving smoothing-length of particle j.
+ * @param pi Particle i.
+ * @param pj Particle j.
+ * @param A (return) The effective face area vector.
+ * @param Anorm2 (return) The square of the norm of A.
+ * @param wi_dr (return) The radial kernel derivative of particle i.
+ * @param wj_dr (return) The radial kernel derivative of particle j.
+ */
+__attribute__((always_inline)) INLINE static void runner_iact_face_geometry(
+    const float r2, const float dx[3], const float hi, const float hj,
+    const struct part *restrict pi, const struct part *restrict pj,
+    float A[3], float *Anorm2, float *wi_dr, float *wj_dr) {
+
+  /* Get r and 1/r. */
+  const float r = sqrtf(r2);
+  const float r_inv = r ? 1.0f / r : 0.0f;
+
+  const float Vi = pi->geometry.volume;
+  const float Vj = pj->geometry.volume;
+
+  /* Compute kernel of pi. */
+  float wi, wi_dx;
+  const float hi_inv = 1.0f / hi;
+  const float hi_inv_dim = pow_dimension(hi_inv);
+  const float xi = r * hi_inv;
+  kernel_deval(xi, &wi, &wi_dx);
+
+  /* Compute kernel of pj. */
+  float wj, wj_dx;
+  const float hj_inv = 1.0f / hj;
+  const float hj_inv_dim = pow_dimension(hj_inv);
+  const float xj = r * hj_inv;
+  kernel_deval(xj, &wj, &wj_dx);
+
+  /* Radial kernel derivatives, used for the SPH-like estimate of h_dt */
+  const float hidp1 = pow_dimension_plus_one(hi_inv);
+  const float hjdp1 = pow_dimension_plus_one(hj_inv);
+  *wi_dr = hidp1 * wi_dx;
+  *wj_dr = hjdp1 * wj_dx;
+
+  /* Compute (square of) area */
+  /* eqn. (7) */
+  if (fvpm_part_geometry_well_behaved(pi) &&
+      fvpm_part_geometry_well_behaved(pj)) {
+    /* in principle, we use Vi and Vj as weights for the left and right
+       contributions to the generalized surface vector.
+       However, if Vi and Vj are very different (because they have very
+       different
+       smoothing lengths), then the expressions below are more stable. */
+    float Xi = Vi;
+    float Xj = Vj;
+#ifdef GIZMO_VOLUME_CORRECTION
+    if (fabsf(Vi - Vj) / min(Vi, Vj) > 1.5f * hydro_dimension) {
+      Xi = (Vi * hj + Vj * hi) / (hi + hj);
+      Xj = Xi;
+    }
+#endif
+    const float(*Bi)[3] = pi->geometry.matrix_E;
+    const float(*Bj)[3] = pj->geometry.matrix_E;
+    *Anorm2 = 0.0f;
+    for (int k = 0; k < 3; k++) {
+      /* we add a minus sign since dx is pi->x - pj->x */
+      A[k] = -Xi * (Bi[k][0] * dx[0] + Bi[k][1] * dx[1] + Bi[k][2] * dx[2]) *
+                 wi * hi_inv_dim -
+             Xj * (Bj[k][0] * dx[0] + Bj[k][1] * dx[1] + Bj[k][2] * dx[2]) *
+                 wj * hj_inv_dim;
+      *Anorm2 += A[k] * A[k];
+    }
+  } else {
+    /* ill condition gradient matrix: revert to SPH face area */
+    const float Anorm =
+        -(hidp1 * Vi * Vi * wi_dx + hjdp1 * Vj * Vj * wj_dx) * r_inv;
+    A[0] = -Anorm * dx[0];
+    A[1] = -Anorm * dx[1];
+    A[2] = -Anorm * dx[2];
+    *Anorm2 = Anorm * Anorm * r2;
+  }
+}
+
 /**
  * @brief Calculate the gradient interaction between particle i and particle j
  *
@@ -149,6 +240,16 @@ __attribute__((always_inline)) INLINE static void runner_iact_gradient(
     const float H) {
 
   hydro_gradients_collect(r2, dx, hi, hj, pi, pj);
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  /* Store the face geometry for the flux loop */
+  if (hydro_pair_geometry_is_recording()) {
+    float A[3], Anorm2, wi_dr, wj_dr;
+    runner_iact_face_geometry(r2, dx, hi, hj, pi, pj, A, &Anorm2, &wi_dr,
+                              &wj_dr);
+    hydro_pair_geometry_record(pi, pj, A, wi_dr, wj_dr);
+  }
+#endif
 }
 
 /**
@@ -174,6 +275,18 @@ __attribute__((always_inline)) INLINE static void runner_iact_nonsym_gradient(
     const float H) {
 
   hydro_gradients_nonsym_collect(r2, dx, hi, hj, pi, pj);
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  /* Store the face geometry for the flux loop. If pj may also see pi, only
+   * one of the two sides does the work. */
+  if (hydro_pair_geometry_is_recording() &&
+      (pi < pj || r2 >= hj * hj * kernel_gamma2)) {
+    float A[3], Anorm2, wi_dr, wj_dr;
+    runner_iact_face_geometry(r2, dx, hi, hj, pi, pj, A, &Anorm2, &wi_dr,
+                              &wj_dr);
+    hydro_pair_geometry_record(pi, pj, A, wi_dr, wj_dr);
+  }
+#endif
 }
 
 /**
@@ -214,19 +327,11 @@ __attribute__((always_inline)) INLINE static void runner_iact_fluxes_common(
   const float r_inv = r ? 1.0f / r : 0.0f;
 
   /* Initialize local variables */
-  float Bi[3][3];
-  float Bj[3][3];
   float vi[3], vj[3];
   for (int k = 0; k < 3; k++) {
-    for (int l = 0; l < 3; l++) {
-      Bi[k][l] = pi->geometry.matrix_E[k][l];
-      Bj[k][l] = pj->geometry.matrix_E[k][l];
-    }
     vi[k] = pi->v[k]; /* particle velocities */
     vj[k] = pj->v[k];
   }
-  const float Vi = pi->geometry.volume;
-  const float Vj = pj->geometry.volume;
   float Wi[5], Wj[5];
   hydro_part_get_primitive_variables(pi, Wi);
   hydro_part_get_primitive_variables(pj, Wj);
@@ -263,25 +368,21 @@ __attribute__((always_inline)) INLINE static void runner_iact_fluxes_common(
     pj->timestepvars.vmax = max(pj->timestepvars.vmax, vmax);
   }
 
-  /* Compute kernel of pi. */
-  float wi, wi_dx;
-  const float hi_inv = 1.0f / hi;
-  const float hi_inv_dim = pow_dimension(hi_inv);
-  const float xi = r * hi_inv;
-  kernel_deval(xi, &wi, &wi_dx);
-
-  /* Compute kernel of pj. */
-  float wj, wj_dx;
-  const float hj_inv = 1.0f / hj;
-  const float hj_inv_dim = pow_dimension(hj_inv);
-  const float xj = r * hj_inv;
-  kernel_deval(xj, &wj, &wj_dx);
+  /* Get the face geometry, either from the gradient loop or from scratch */
+  float A[3], Anorm2, wi_dr, wj_dr;
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  if (hydro_pair_geometry_fetch(pi, pj, A, &wi_dr, &wj_dr)) {
+    Anorm2 = A[0] * A[0] + A[1] * A[1] + A[2] * A[2];
+  } else {
+    runner_iact_face_geometry(r2, dx, hi, hj, pi, pj, A, &Anorm2, &wi_dr,
+                              &wj_dr);
+  }
+#else
+  runner_iact_face_geometry(r2, dx, hi, hj, pi, pj, A, &Anorm2, &wi_dr,
+                            &wj_dr);
+#endif
 
   /* Compute h_dt. We are going to use an SPH-like estimate of div_v for that */
-  const float hidp1 = pow_dimension_plus_one(hi_inv);
-  const float hjdp1 = pow_dimension_plus_one(hj_inv);
-  const float wi_dr = hidp1 * wi_dx;
-  const float wj_dr = hjdp1 * wj_dx;
   dvdr *= r_inv;
   if (Wj[0] > 0.0f) {
     pi->force.h_dt -= pj->conserved.mass * dvdr / Wj[0] * wi_dr;
@@ -290,43 +391,6 @@ __attribute__((always_inline)) INLINE static void runner_iact_fluxes_common(
     pj->force.h_dt -= pi->conserved.mass * dvdr / Wi[0] * wj_dr;
   }
 
-  /* Compute (square of) area */
-  /* eqn. (7) */
-  float Anorm2 = 0.0f;
-  float A[3];
-  if (fvpm_part_geometry_well_behaved(pi) &&
-      fvpm_part_geometry_well_behaved(pj)) {
-    /* in principle, we use Vi and Vj as weights for the left and right
-       contributions to the generalized surface vector.
-       However, if Vi and Vj are very different (because they have very
-       different
-       smoothing lengths), then the expressions below are more stable. */
-    float Xi = Vi;
-    float Xj = Vj;
-#ifdef GIZMO_VOLUME_CORRECTION
-    if (fabsf(Vi - Vj) / min(Vi, Vj) > 1.5f * hydro_dimension) {
-      Xi = (Vi * hj + Vj * hi) / (hi + hj);
-      Xj = Xi;
-    }
-#endif
-    for (int k = 0; k < 3; k++) {
-      /* we add a minus sign since dx is pi->x - pj->x */
-      A[k] = -Xi * (Bi[k][0] * dx[0] + Bi[k][1] * dx[1] + Bi[k][2] * dx[2]) *
-                 wi * hi_inv_dim -
-             Xj * (Bj[k][0] * dx[0] + Bj[k][1] * dx[1] + Bj[k][2] * dx[2]) *
-                 wj * hj_inv_dim;
-      Anorm2 += A[k] * A[k];
-    }
-  } else {
-    /* ill condition gradient matrix: revert to SPH face area */
-    const float Anorm =
-        -(hidp1 * Vi * Vi * wi_dx + hjdp1 * Vj * Vj * wj_dx) * r_inv;
-    A[0] = -Anorm * dx[0];
-    A[1] = -Anorm * dx[1];
-    A[2] = -Anorm * dx[2];
-    Anorm2 = Anorm * Anorm * r2;
-  }
-
   /* if the interface has no area, nothing happens and we return */
   /* continuing results in dividing by zero and NaN's... */
   if (Anorm2 == 0.0f) {
@@ -349,7 +413,7 @@ __attribute__((always_inline)) INLINE static void runner_iact_fluxes_common(
   const float rdim = pow_dimension(r);
   if (dA_dot_dx > 1.e-6f * rdim) {
     message("Ill conditioned gradient matrix (%g %g %g %g %g)!", dA_dot_dx,
-            Anorm, Vi, Vj, r);
+            Anorm, pi->geometry.volume, pj->geometry.volume, r);
   }
 #endif
 
@@ -687,13 +687,10 @@ __attribute__((always_inline)) INLINE static void hydro_prepare_force(
   xp->u_full = p->u;
 #endif
 
-  /* Compute the pressure */
-  const float pressure =
-      gas_pressure_from_internal_energy(p->rho, p->u, p->mat_id);
-
-  /* Compute the sound speed */
-  const float soundspeed =
-      gas_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id);
+  /* Compute the pressure and sound speed */
+  float pressure, soundspeed;
+  gas_pressure_and_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id,
+                                                   &pressure, &soundspeed);
 
   /* Compute the "grad h" term  - Note here that we have \tilde{x}
    * as 1 as we use the local number density to find neighbours. This
@@ -788,13 +785,10 @@ __attribute__((always_inline)) INLINE static void hydro_reset_predicted_values(
   /* Re-set the internal energy */
   p->u = xp->u_full;
 
-  /* Compute the pressure */
-  const float pressure =
-      gas_pressure_from_internal_energy(p->rho, p->u, p->mat_id);
-
-  /* Compute the sound speed */
-  const float soundspeed =
-      gas_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id);
+  /* Compute the pressure and sound speed */
+  float pressure, soundspeed;
+  gas_pressure_and_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id,
+                                                   &pressure, &soundspeed);
 
   p->force.pressure = pressure;
   p->force.soundspeed = soundspeed;
@@ -852,13 +846,10 @@ __attribute__((always_inline)) INLINE static void hydro_predict_extra(
   else
     p->rho *= expf(w2);
 
-  /* Compute the new pressure */
-  const float pressure =
-      gas_pressure_from_internal_energy(p->rho, p->u, p->mat_id);
-
-  /* Compute the new sound speed */
-  const float soundspeed =
-      gas_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id);
+  /* Compute the new pressure and sound speed */
+  float pressure, soundspeed;
+  gas_pressure_and_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id,
+                                                   &pressure, &soundspeed);
 
   p->force.pressure = pressure;
   p->force.soundspeed = soundspeed;
@@ -940,13 +931,10 @@ __attribute__((always_inline)) INLINE static void hydro_convert_quantities(
     const struct cosmology *cosmo, const struct hydro_props *hydro_props,
     const struct pressure_floor_props *pressure_floor) {
 
-  /* Compute the pressure */
-  const float pressure =
-      gas_pressure_from_internal_energy(p->rho, p->u, p->mat_id);
-
-  /* Compute the sound speed */
-  const float soundspeed =
-      gas_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id);
+  /* Compute the pressure and sound speed */
+  float pressure, soundspeed;
+  gas_pressure_and_soundspeed_from_internal_energy(p->rho, p->u, p->mat_id,
+                                                   &pressure, &soundspeed);
 
   p->force.pressure = pressure;
   p->force.soundspeed = soundspeed;
@@ -0,0 +1,169 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Matthieu Schaller (schaller@strw.leidenuniv.nl)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* Some standard headers. */
+#include <strings.h>
+
+/* This object's header. */
+#include "hydro_pair_geometry.h"
+
+/* Local headers. */
+#include "cell.h"
+#include "error.h"
+#include "memuse.h"
+#include "scheduler.h"
+#include "task.h"
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+
+/*! Initial number of slots of a buffer. */
+#define hydro_pair_geometry_initial_size 64
+
+/* The cursor of the calling thread. */
+__thread struct hydro_pair_geometry_cursor hydro_pair_geometry_cursor = {NULL,
+                                                                         0};
+
+/**
+ * @brief Double the number of slots of a #hydro_pair_geometry_buffer and
+ * re-insert the interactions it already contains.
+ *
+ * @param b The buffer.
+ */
+void hydro_pair_geometry_buffer_grow(struct hydro_pair_geometry_buffer *b) {
+
+  const int new_size =
+      b->size > 0 ? 2 * b->size : hydro_pair_geometry_initial_size;
+
+  struct hydro_pair_geometry *new_entries =
+      (struct hydro_pair_geometry *)swift_calloc(
+          "pair_geometry", new_size, sizeof(struct hydro_pair_geometry));
+  if (new_entries == NULL) error("Failed to allocate pair geometry buffer.");
+
+  /* Re-hash what we already have */
+  const int mask = new_size - 1;
+  for (int k = 0; k < b->size; k++) {
+    const struct hydro_pair_geometry *g = &b->entries[k];
+    if (g->pi == NULL) continue;
+    int slot = hydro_pair_geometry_slot(g->pi, g->pj, new_size);
+    while (new_entries[slot].pi != NULL) slot = (slot + 1) & mask;
+    new_entries[slot] = *g;
+  }
+
+  if (b->entries != NULL) swift_free("pair_geometry", b->entries);
+  b->entries = new_entries;
+  b->size = new_size;
+}
+
+/**
+ * @brief Find the gradient task acting on the same cells as a given force
+ * task.
+ *
+ * @param t The force #task.
+ * @return The gradient #task or NULL if there is none.
+ */
+static const struct task *hydro_pair_geometry_find_gradient_task(
+    const struct task *t) {
+
+  for (const struct link *l = t->ci->hydro.gradient; l != NULL; l = l->next) {
+    const struct task *t_grad = l->t;
+    if (t_grad->type == t->type && t_grad->ci == t->ci && t_grad->cj == t->cj)
+      return t_grad;
+  }
+  return NULL;
+}
+
+#endif /* SWIFT_GIZMO_PAIR_GEOMETRY_CACHE */
+
+/**
+ * @brief Prepare the calling thread to run a task.
+ *
+ * Gradient tasks record the geometry of their interactions in the buffer
+ * associated with them. Force tasks replay the buffer of the gradient task
+ * acting on the same cells, provided that task has run since the scheduler
+ * was last started.
+ * Nothing happens for any other task.
+ *
+ * @param s The #scheduler.
+ * @param t The #task about to be run.
+ */
+void hydro_pair_geometry_task_begin(struct scheduler *s, const struct task *t) {
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+
+  if (t->type != task_type_self && t->type != task_type_pair &&
+      t->type != task_type_sub_self && t->type != task_type_sub_pair)
+    return;
+
+  if (t->subtype == task_subtype_gradient) {
+
+    /* Start from an empty table (keeping the memory of the last step) */
+    struct hydro_pair_geometry_buffer *b = &s->pair_geometry[t - s->tasks];
+    if (b->count > 0)
+      bzero(b->entries, b->size * sizeof(struct hydro_pair_geometry));
+    b->count = 0;
+    b->launch = s->pair_geometry_launch;
+
+    hydro_pair_geometry_cursor.buffer = b;
+    hydro_pair_geometry_cursor.recording = 1;
+
+  } else if (t->subtype == task_subtype_force) {
+
+    const struct task *t_grad = hydro_pair_geometry_find_gradient_task(t);
+    if (t_grad == NULL) return;
+
+    /* Only use what was recorded since the particles last moved */
+    struct hydro_pair_geometry_buffer *b = &s->pair_geometry[t_grad - s->tasks];
+    if (b->launch != s->pair_geometry_launch) return;
+
+    hydro_pair_geometry_cursor.buffer = b;
+    hydro_pair_geometry_cursor.recording = 0;
+  }
+#endif
+}
+
+/**
+ * @brief Detach the calling thread from the buffer of the task it just ran.
+ */
+void hydro_pair_geometry_task_end(void) {
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  hydro_pair_geometry_cursor.buffer = NULL;
+  hydro_pair_geometry_cursor.recording = 0;
+#endif
+}
+
+/**
+ * @brief Free the memory held by an array of buffers (but not the array).
+ *
+ * @param b The buffers.
+ * @param count The number of buffers.
+ */
+void hydro_pair_geometry_buffers_free(struct hydro_pair_geometry_buffer *b,
+                                      const int count) {
+
+  for (int k = 0; k < count; k++) {
+    if (b[k].entries != NULL) swift_free("pair_geometry", b[k].entries);
+    b[k].entries = NULL;
+    b[k].count = 0;
+    b[k].size = 0;
+  }
+}
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Matthieu Schaller (schaller@strw.leidenuniv.nl)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_HYDRO_PAIR_GEOMETRY_H
+#define SWIFT_HYDRO_PAIR_GEOMETRY_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* Standard headers. */
+#include <stddef.h>
+
+/* Local headers. */
+#include "inline.h"
+
+/* Pre-declarations */
+struct part;
+struct scheduler;
+struct task;
+
+/**
+ * @brief Geometric terms of one particle-particle interaction of the Gizmo
+ * scheme.
+ *
+ * These only depend on the positions, smoothing lengths, volumes and
+ * geometry matrices of the two particles, which are all frozen between the
+ * gradient and the flux loops of a given step.
+ */
+struct hydro_pair_geometry {
+
+  /*! The two particles this interaction was recorded for. */
+  const struct part *pi, *pj;
+
+  /*! Effective face area vector. */
+  float A[3];
+
+  /*! Radial kernel derivatives of both particles (for h_dt). */
+  float wi_dr, wj_dr;
+};
+
+/**
+ * @brief The interactions recorded by one gradient task.
+ *
+ * This is a small open-addressing hash table keyed on the (unordered) pair
+ * of particles since the gradient and flux loops do not visit the pairs in
+ * the same order nor with the same symmetry.
+ */
+struct hydro_pair_geometry_buffer {
+
+  /*! The recorded interactions (empty slots have pi == NULL). */
+  struct hydro_pair_geometry *entries;
+
+  /*! Number of recorded interactions. */
+  int count;
+
+  /*! Number of slots in #entries (a power of 2). */
+  int size;
+
+  /*! Scheduler launch during which the interactions were recorded. */
+  int launch;
+};
+
+/**
+ * @brief What the current thread does with the interactions it computes.
+ */
+struct hydro_pair_geometry_cursor {
+
+  /*! The buffer of the task being run (NULL outside of hydro tasks). */
+  struct hydro_pair_geometry_buffer *buffer;
+
+  /*! Are we recording (gradient loop) or replaying (flux loop)? */
+  int recording;
+};
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+
+/* The cursor of the calling thread. */
+extern __thread struct hydro_pair_geometry_cursor hydro_pair_geometry_cursor;
+
+void hydro_pair_geometry_buffer_grow(struct hydro_pair_geometry_buffer *b);
+
+/**
+ * @brief Are we currently recording the geometry of the interactions?
+ */
+__attribute__((always_inline)) INLINE static int
+hydro_pair_geometry_is_recording(void) {
+  return hydro_pair_geometry_cursor.recording;
+}
+
+/**
+ * @brief Slot at which to start looking for a pair of particles.
+ *
+ * @param pi The first #part (lowest address).
+ * @param pj The second #part (highest address).
+ * @param size The number of slots in the table.
+ */
+__attribute__((always_inline)) INLINE static int hydro_pair_geometry_slot(
+    const struct part *pi, const struct part *pj, const int size) {
+
+  /* The addresses are multiples of sizeof(struct part), so mix the bits
+   * properly before keeping only the lowest ones (murmur3 finaliser). */
+  unsigned long long key =
+      (unsigned long long)(size_t)pi ^
+      ((unsigned long long)(size_t)pj * 0x9E3779B97F4A7C15ULL);
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53ULL;
+  key ^= key >> 33;
+  return (int)(key & (unsigned long long)(size - 1));
+}
+
+/**
+ * @brief Store the geometry of one interaction in the buffer of the
+ * current gradient task.
+ *
+ * The pair is stored with the particles ordered by address. Swapping the two
+ * particles flips the sign of the face and swaps the kernel derivatives.
+ * Pairs that were already recorded (from the other side) are ignored.
+ *
+ * @param pi The first #part.
+ * @param pj The second #part.
+ * @param A The effective face area vector.
+ * @param wi_dr The radial kernel derivative of pi.
+ * @param wj_dr The radial kernel derivative of pj.
+ */
+__attribute__((always_inline)) INLINE static void hydro_pair_geometry_record(
+    const struct part *pi, const struct part *pj, const float A[3],
+    const float wi_dr, const float wj_dr) {
+
+  struct hydro_pair_geometry_buffer *b = hydro_pair_geometry_cursor.buffer;
+
+  /* Keep the table at most half full */
+  if (2 * (b->count + 1) > b->size) hydro_pair_geometry_buffer_grow(b);
+
+  const int swap = pi > pj;
+  const struct part *first = swap ? pj : pi;
+  const struct part *second = swap ? pi : pj;
+
+  const int mask = b->size - 1;
+  int slot = hydro_pair_geometry_slot(first, second, b->size);
+  while (b->entries[slot].pi != NULL) {
+    if (b->entries[slot].pi == first && b->entries[slot].pj == second) return;
+    slot = (slot + 1) & mask;
+  }
+
+  struct hydro_pair_geometry *g = &b->entries[slot];
+  const float sign = swap ? -1.f : 1.f;
+  g->pi = first;
+  g->pj = second;
+  g->A[0] = sign * A[0];
+  g->A[1] = sign * A[1];
+  g->A[2] = sign * A[2];
+  g->wi_dr = swap ? wj_dr : wi_dr;
+  g->wj_dr = swap ? wi_dr : wj_dr;
+  b->count++;
+}
+
+/**
+ * @brief Retrieve the geometry of an interaction recorded by the gradient
+ * loop.
+ *
+ * The flux loop can visit pairs the gradient loop skipped (it uses the
+ * larger of the two smoothing lengths). In that case (or if nothing was
+ * recorded) we return 0 and the caller has to compute the geometry itself.
+ *
+ * @param pi The first #part.
+ * @param pj The second #part.
+ * @param A (return) The effective face area vector.
+ * @param wi_dr (return) The radial kernel derivative of pi.
+ * @param wj_dr (return) The radial kernel derivative of pj.
+ * @return 1 if the geometry was found, 0 otherwise.
+ */
+__attribute__((always_inline)) INLINE static int hydro_pair_geometry_fetch(
+    const struct part *pi, const struct part *pj, float A[3], float *wi_dr,
+    float *wj_dr) {
+
+  const struct hydro_pair_geometry_buffer *b =
+      hydro_pair_geometry_cursor.buffer;
+  if (b == NULL || hydro_pair_geometry_cursor.recording || b->count == 0)
+    return 0;
+
+  const int swap = pi > pj;
+  const struct part *first = swap ? pj : pi;
+  const struct part *second = swap ? pi : pj;
+
+  const int mask = b->size - 1;
+  int slot = hydro_pair_geometry_slot(first, second, b->size);
+  while (b->entries[slot].pi != NULL) {
+    const struct hydro_pair_geometry *g = &b->entries[slot];
+    if (g->pi == first && g->pj == second) {
+      const float sign = swap ? -1.f : 1.f;
+      A[0] = sign * g->A[0];
+      A[1] = sign * g->A[1];
+      A[2] = sign * g->A[2];
+      *wi_dr = swap ? g->wj_dr : g->wi_dr;
+      *wj_dr = swap ? g->wi_dr : g->wj_dr;
+      return 1;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return 0;
+}
+
+#endif /* SWIFT_GIZMO_PAIR_GEOMETRY_CACHE */
+
+void hydro_pair_geometry_task_begin(struct scheduler *s, const struct task *t);
+void hydro_pair_geometry_task_end(void);
+void hydro_pair_geometry_buffers_free(struct hydro_pair_geometry_buffer *b,
+                                      const int count);
+
+#endif /* SWIFT_HYDRO_PAIR_GEOMETRY_H */
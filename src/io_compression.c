@@ -25,10 +25,19 @@
 
 /* Local includes. */
 #include "error.h"
+#include "minmax.h"
+#include "threadpool.h"
 
 /* Some standard headers. */
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+/* zlib headers. */
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
 
 /**
  * @brief Names of the compression levels, used in the select_output.yml
@@ -584,4 +593,442 @@ void set_hdf5_lossy_compression(hid_t* h_prop, hid_t* h_type,
     snprintf(filter_name, 32, "%s", lossy_compression_schemes_names[comp]);
 }
 
+#if defined(HAVE_LIBZ) && H5_VERSION_GE(1, 10, 3)
+
+/*! Parameter of the n-bit filter for an atomic datatype (see H5Zprivate.h) */
+#define io_nbit_atomic 1
+
+/*! Parameter of the n-bit filter for a little-endian datatype */
+#define io_nbit_order_le 0
+
+/*! Length of the check-sum appended by the fletcher32 filter */
+#define io_fletcher32_length 4
+
+/**
+ * @brief The filters applied to the chunks of a dataset and the data to
+ * compress.
+ */
+struct io_chunk_pipeline {
+
+  /*! The filters to apply (in this order) */
+  H5Z_filter_t filters[H5Z_MAX_NFILTERS];
+
+  /*! Number of filters */
+  int num_filters;
+
+  /*! Size in bytes of an element in the file */
+  size_t type_size;
+
+  /*! Deflate level */
+  int deflate_level;
+
+  /*! Does the n-bit filter leave the data unchanged? */
+  int nbit_no_op;
+
+  /*! Number of significant bits of an element for the n-bit filter */
+  size_t nbit_precision;
+
+  /*! Offset of the significant bits in an element for the n-bit filter */
+  size_t nbit_offset;
+
+  /*! The data (already converted to the type in the file) */
+  const char* data;
+
+  /*! Number of rows in the dataset */
+  size_t N;
+
+  /*! Number of values per row */
+  int dimension;
+
+  /*! Number of rows in a chunk */
+  size_t chunk_rows;
+
+  /*! Index of the first chunk of the current batch */
+  size_t first_chunk;
+
+  /*! The filtered chunks of the current batch */
+  char** chunks;
+
+  /*! The size in bytes of the filtered chunks */
+  size_t* chunk_sizes;
+};
+
+/**
+ * @brief Pack the significant bits of one byte of an element (n-bit filter).
+ *
+ * This is a copy of what H5Z__nbit_compress_one_byte() does in HDF5 such
+ * that the library can decode our chunks.
+ *
+ * @param val The byte.
+ * @param k The position of the byte in the element.
+ * @param begin_i The position of the most significant byte.
+ * @param end_i The position of the least significant byte.
+ * @param p The #io_chunk_pipeline.
+ * @param buffer The output buffer.
+ * @param j (in/out) The current byte in the output buffer.
+ * @param buf_len (in/out) The number of free bits in the current byte.
+ */
+static void io_nbit_compress_one_byte(unsigned char val, const int k,
+                                      const int begin_i, const int end_i,
+                                      const struct io_chunk_pipeline* p,
+                                      unsigned char* buffer, size_t* j,
+                                      size_t* buf_len) {
+
+  const size_t datatype_len = p->type_size * 8;
+  size_t dat_len;
+
+  if (begin_i != end_i) {
+    /* The significant bits span several bytes */
+    if (k == begin_i)
+      dat_len = 8 - (datatype_len - p->nbit_precision - p->nbit_offset) % 8;
+    else if (k == end_i) {
+      dat_len = 8 - p->nbit_offset % 8;
+      val >>= 8 - dat_len;
+    } else
+      dat_len = 8;
+  } else {
+    /* All the significant bits are in this byte */
+    val >>= p->nbit_offset % 8;
+    dat_len = p->nbit_precision;
+  }
+
+  if (*buf_len > dat_len) {
+    buffer[*j] |= (unsigned char)((val & ~(~0u << dat_len))
+                                  << (*buf_len - dat_len));
+    *buf_len -= dat_len;
+  } else {
+    buffer[*j] |= (unsigned char)((val >> (dat_len - *buf_len)) &
+                                  ~(~0u << *buf_len));
+    dat_len -= *buf_len;
+    ++(*j);
+    *buf_len = 8;
+    if (dat_len == 0) return;
+
+    buffer[*j] = (unsigned char)((val & ~(~0u << dat_len))
+                                 << (*buf_len - dat_len));
+    *buf_len -= dat_len;
+  }
+}
+
+/**
+ * @brief Apply the n-bit filter to a chunk.
+ *
+ * @param p The #io_chunk_pipeline.
+ * @param in The chunk.
+ * @param nbytes (in/out) The size of the chunk.
+ * @return The filtered chunk.
+ */
+static char* io_nbit_filter(const struct io_chunk_pipeline* p, char* in,
+                            size_t* nbytes) {
+
+  if (p->nbit_no_op) return in;
+
+  const size_t num_elements = *nbytes / p->type_size;
+  const size_t out_size = (num_elements * p->nbit_precision + 7) / 8 + 1;
+  unsigned char* out = (unsigned char*)calloc(out_size, 1);
+  if (out == NULL) error("Unable to allocate n-bit chunk buffer");
+
+  /* Range of the bytes containing significant bits */
+  const size_t top = p->nbit_precision + p->nbit_offset;
+  const int begin_i = (top % 8 != 0) ? top / 8 : top / 8 - 1;
+  const int end_i = p->nbit_offset / 8;
+
+  const unsigned char* data = (const unsigned char*)in;
+  size_t j = 0;
+  size_t buf_len = 8;
+  for (size_t i = 0; i < num_elements; ++i)
+    for (int k = begin_i; k >= end_i; k--)
+      io_nbit_compress_one_byte(data[i * p->type_size + k], k, begin_i, end_i,
+                                p, out, &j, &buf_len);
+
+  free(in);
+  *nbytes = j + 1;
+  return (char*)out;
+}
+
+/**
+ * @brief Apply the shuffle filter to a chunk.
+ *
+ * @param p The #io_chunk_pipeline.
+ * @param in The chunk.
+ * @param nbytes The size of the chunk.
+ * @return The filtered chunk.
+ */
+static char* io_shuffle_filter(const struct io_chunk_pipeline* p, char* in,
+                               const size_t nbytes) {
+
+  const size_t size = p->type_size;
+  const size_t num_elements = nbytes / size;
+  if (size == 1 || num_elements <= 1) return in;
+
+  char* out = (char*)malloc(nbytes);
+  if (out == NULL) error("Unable to allocate shuffled chunk buffer");
+
+  for (size_t b = 0; b < size; ++b)
+    for (size_t i = 0; i < num_elements; ++i)
+      out[b * num_elements + i] = in[i * size + b];
+
+  /* Left-over bytes are copied as-is */
+  const size_t leftover = nbytes % size;
+  if (leftover > 0)
+    memcpy(out + num_elements * size, in + num_elements * size, leftover);
+
+  free(in);
+  return out;
+}
+
+/**
+ * @brief Apply the deflate filter to a chunk.
+ *
+ * @param p The #io_chunk_pipeline.
+ * @param in The chunk.
+ * @param nbytes (in/out) The size of the chunk.
+ * @return The filtered chunk.
+ */
+static char* io_deflate_filter(const struct io_chunk_pipeline* p, char* in,
+                               size_t* nbytes) {
+
+  uLongf out_size = compressBound(*nbytes);
+  char* out = (char*)malloc(out_size);
+  if (out == NULL) error("Unable to allocate deflated chunk buffer");
+
+  if (compress2((Bytef*)out, &out_size, (const Bytef*)in, *nbytes,
+                p->deflate_level) != Z_OK)
+    error("Error while deflating a chunk");
+
+  free(in);
+  *nbytes = out_size;
+  return out;
+}
+
+/**
+ * @brief Append the fletcher32 check-sum to a chunk.
+ *
+ * Same algorithm as H5_checksum_fletcher32() in HDF5.
+ *
+ * @param in The chunk.
+ * @param nbytes (in/out) The size of the chunk.
+ * @return The filtered chunk.
+ */
+static char* io_fletcher32_filter(char* in, size_t* nbytes) {
+
+  const unsigned char* data = (const unsigned char*)in;
+  size_t len = *nbytes / 2;
+  uint32_t sum1 = 0, sum2 = 0;
+
+  while (len) {
+    size_t tlen = len > 360 ? 360 : len;
+    len -= tlen;
+    do {
+      sum1 += (uint32_t)(((uint16_t)data[0]) << 8) | ((uint16_t)data[1]);
+      data += 2;
+      sum2 += sum1;
+    } while (--tlen);
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+
+  /* Check for odd # of bytes */
+  if (*nbytes % 2) {
+    sum1 += (uint32_t)(((uint16_t)*data) << 8);
+    sum2 += sum1;
+    sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+    sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  }
+
+  /* Second reduction step to reduce sums to 16 bits */
+  sum1 = (sum1 & 0xffff) + (sum1 >> 16);
+  sum2 = (sum2 & 0xffff) + (sum2 >> 16);
+  const uint32_t fletcher = (sum2 << 16) | sum1;
+
+  char* out = (char*)realloc(in, *nbytes + io_fletcher32_length);
+  if (out == NULL) error("Unable to allocate check-summed chunk buffer");
+
+  /* Little-endian encoding */
+  unsigned char* dst = (unsigned char*)out + *nbytes;
+  for (int k = 0; k < io_fletcher32_length; ++k)
+    dst[k] = (unsigned char)((fletcher >> (8 * k)) & 0xff);
+
+  *nbytes += io_fletcher32_length;
+  return out;
+}
+
+/**
+ * @brief Mapper function running the filters on a batch of chunks.
+ */
+void io_compress_chunks_mapper(void* map_data, int num_chunks,
+                               void* extra_data) {
+
+  const struct io_chunk_pipeline* p =
+      (const struct io_chunk_pipeline*)extra_data;
+  char** chunks = (char**)map_data;
+  const size_t offset = chunks - p->chunks;
+  const size_t row_size = p->dimension * p->type_size;
+
+  for (int c = 0; c < num_chunks; ++c) {
+
+    /* Copy the data of this chunk (padding the last one) */
+    const size_t first_row = (p->first_chunk + offset + c) * p->chunk_rows;
+    const size_t num_rows = min(p->chunk_rows, p->N - first_row);
+    size_t nbytes = p->chunk_rows * row_size;
+    char* buffer = (char*)calloc(nbytes, 1);
+    if (buffer == NULL) error("Unable to allocate chunk buffer");
+    memcpy(buffer, p->data + first_row * row_size, num_rows * row_size);
+
+    /* Run the pipeline */
+    for (int f = 0; f < p->num_filters; ++f) {
+      switch (p->filters[f]) {
+        case H5Z_FILTER_NBIT:
+          buffer = io_nbit_filter(p, buffer, &nbytes);
+          break;
+        case H5Z_FILTER_SHUFFLE:
+          buffer = io_shuffle_filter(p, buffer, nbytes);
+          break;
+        case H5Z_FILTER_DEFLATE:
+          buffer = io_deflate_filter(p, buffer, &nbytes);
+          break;
+        case H5Z_FILTER_FLETCHER32:
+          buffer = io_fletcher32_filter(buffer, &nbytes);
+          break;
+        default:
+          error("Unsupported filter");
+      }
+    }
+
+    chunks[c] = buffer;
+    p->chunk_sizes[offset + c] = nbytes;
+  }
+}
+
+#endif /* HAVE_LIBZ && H5_VERSION_GE(1, 10, 3) */
+
+/**
+ * @brief Write a chunked dataset by running its filters on the threadpool.
+ *
+ * HDF5 runs the filter pipeline of a dataset on the calling thread. Instead,
+ * we convert the data to the type used in the file, apply the filters
+ * (n-bit, shuffle, deflate and fletcher32) to batches of chunks on the
+ * threadpool and hand the result to HDF5 via H5Dwrite_chunk().
+ *
+ * Nothing is written if the dataset uses a filter we do not know how to
+ * reproduce (e.g. scale-offset) or if zlib is not available. The caller then
+ * has to write the data the usual way.
+ *
+ * @param tp The #threadpool.
+ * @param h_data The (chunked) dataset.
+ * @param h_mem_type The type of the data in memory.
+ * @param h_file_type The type of the data in the file.
+ * @param data The data to write. Overwritten by the conversion to the file
+ * type.
+ * @param N The number of rows of the dataset.
+ * @param dimension The number of values per row.
+ * @return 1 if the data was written, 0 otherwise.
+ */
+int io_write_compressed_chunks(struct threadpool* tp, const hid_t h_data,
+                               const hid_t h_mem_type, const hid_t h_file_type,
+                               void* data, const size_t N,
+                               const int dimension) {
+
+#if defined(HAVE_LIBZ) && H5_VERSION_GE(1, 10, 3)
+
+  if (N == 0) return 0;
+
+  struct io_chunk_pipeline p;
+  bzero(&p, sizeof(struct io_chunk_pipeline));
+  p.type_size = H5Tget_size(h_file_type);
+  p.N = N;
+  p.dimension = dimension;
+
+  /* Can only convert in place if the type does not grow */
+  if (p.type_size > H5Tget_size(h_mem_type)) return 0;
+
+  /* Get the filter pipeline and chunking of the dataset */
+  const hid_t h_prop = H5Dget_create_plist(h_data);
+  if (h_prop < 0) error("Error while getting the dataset properties");
+
+  int supported = (H5Pget_layout(h_prop) == H5D_CHUNKED);
+
+  hsize_t chunk_shape[2] = {0, 0};
+  if (supported && H5Pget_chunk(h_prop, 2, chunk_shape) < 0)
+    error("Error while getting the chunk size");
+  p.chunk_rows = chunk_shape[0];
+
+  p.num_filters = H5Pget_nfilters(h_prop);
+  for (int f = 0; supported && f < p.num_filters; ++f) {
+
+    unsigned int flags, filter_config;
+    size_t cd_nelmts = 16;
+    unsigned int cd_values[16];
+    p.filters[f] = H5Pget_filter2(h_prop, f, &flags, &cd_nelmts, cd_values, 0,
+                                  NULL, &filter_config);
+
+    switch (p.filters[f]) {
+      case H5Z_FILTER_NBIT:
+        /* cd_values: # parms, no-op flag, # elements, class, size, order,
+         * precision, offset */
+        if (cd_nelmts < 8 || cd_values[3] != io_nbit_atomic ||
+            cd_values[5] != io_nbit_order_le ||
+            cd_values[2] != p.chunk_rows * dimension) {
+          supported = 0;
+          break;
+        }
+        p.nbit_no_op = cd_values[1];
+        p.nbit_precision = cd_values[6];
+        p.nbit_offset = cd_values[7];
+        break;
+      case H5Z_FILTER_DEFLATE:
+        p.deflate_level = cd_values[0];
+        break;
+      case H5Z_FILTER_SHUFFLE:
+      case H5Z_FILTER_FLETCHER32:
+        break;
+      default:
+        supported = 0;
+    }
+  }
+  H5Pclose(h_prop);
+  if (!supported) return 0;
+
+  /* Convert the data to the type used in the file */
+  if (H5Tequal(h_mem_type, h_file_type) <= 0) {
+    if (H5Tconvert(h_mem_type, h_file_type, N * dimension, data, NULL,
+                   H5P_DEFAULT) < 0)
+      error("Error while converting the data to the file type");
+  }
+  p.data = (const char*)data;
+
+  /* Process the chunks in batches of a few per thread */
+  const size_t num_chunks = (N + p.chunk_rows - 1) / p.chunk_rows;
+  const size_t batch_size = 2 * tp->num_threads;
+  p.chunks = (char**)malloc(batch_size * sizeof(char*));
+  p.chunk_sizes = (size_t*)malloc(batch_size * sizeof(size_t));
+  if (p.chunks == NULL || p.chunk_sizes == NULL)
+    error("Unable to allocate the chunk lists");
+
+  for (p.first_chunk = 0; p.first_chunk < num_chunks;
+       p.first_chunk += batch_size) {
+
+    const size_t count = min(batch_size, num_chunks - p.first_chunk);
+    threadpool_map(tp, io_compress_chunks_mapper, p.chunks, count,
+                   sizeof(char*), /*chunk=*/1, &p);
+
+    /* Hand the filtered chunks to HDF5 */
+    for (size_t c = 0; c < count; ++c) {
+      const hsize_t offset[2] = {(p.first_chunk + c) * p.chunk_rows, 0};
+      if (H5Dwrite_chunk(h_data, H5P_DEFAULT, /*filters=*/0, offset,
+                         p.chunk_sizes[c], p.chunks[c]) < 0)
+        error("Error while writing a compressed chunk");
+      free(p.chunks[c]);
+    }
+  }
+
+  free(p.chunks);
+  free(p.chunk_sizes);
+  return 1;
+
+#else
+  return 0;
+#endif
+}
+
 #endif /* HAVE_HDF5 */
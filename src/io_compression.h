@@ -67,6 +67,11 @@ void set_hdf5_lossy_compression(hid_t* h_prop, hid_t* h_type,
                                 const enum lossy_compression_schemes comp,
                                 const char* field_name, char filter_name[32]);
 
+struct threadpool;
+int io_write_compressed_chunks(struct threadpool* tp, const hid_t h_data,
+                               const hid_t h_mem_type, const hid_t h_file_type,
+                               void* data, const size_t N, const int dimension);
+
 #endif /* HAVE_HDF5 */
 
 #endif /* SWIFT_IO_COMPRESSION_H */
@@ -148,6 +148,9 @@ struct io_props {
   /* The size of the particles */
   size_t partSize;
 
+  /* Indices of the particles to write in the arrays (NULL for all of them) */
+  const size_t *index;
+
   /* The particle arrays */
   const struct part *parts;
   const struct xpart *xparts;
@@ -195,6 +198,17 @@ struct io_props {
   };
 };
 
+/**
+ * @brief Index in the particle arrays of the k-th element to write.
+ *
+ * @param props The #io_props of the field.
+ * @param k The position in the list of particles to write.
+ */
+__attribute__((always_inline)) INLINE static size_t io_props_index(
+    const struct io_props *props, const size_t k) {
+  return props->index != NULL ? props->index[k] : k;
+}
+
 /**
  * @brief Copies a string safely (avoids buffer overrun).
  *
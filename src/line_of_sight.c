@@ -41,9 +41,14 @@
 /**
  * @brief Will the line of sight intersect a given cell?
  *
+ * The cell can be at any level of the tree. The test is conservative: it
+ * uses the distance between the sightline and the projection of the cell
+ * onto the plane orthogonal to the sightline, and the largest smoothing length
+ * of the particles in the cell.
+ *
  * Also return 0 if the cell is empty.
  *
- * @param c The top level cell.
+ * @param c The cell.
  * @param los The line of sight structure.
  */
 static INLINE int does_los_intersect(const struct cell *c,
@@ -56,41 +61,77 @@ static INLINE int does_los_intersect(const struct cell *c,
   if (c->hydro.h_max <= 0.) error("Invalid h_max for does_los_intersect");
 #endif
 
-  /* Distance from LOS to left and bottom cell edge. */
-  const double cx_min = c->loc[los->xaxis];
-  const double cy_min = c->loc[los->yaxis];
+  /* Half-widths of the cell in the plane of the LOS. */
+  const double half_width_x = 0.5 * c->width[los->xaxis];
+  const double half_width_y = 0.5 * c->width[los->yaxis];
+
+  /* Distance from LOS to the centre of the cell. */
+  double dx = c->loc[los->xaxis] + half_width_x - los->Xpos;
+  double dy = c->loc[los->yaxis] + half_width_y - los->Ypos;
+
+  if (los->periodic) {
+    dx = nearest(dx, los->dim[los->xaxis]);
+    dy = nearest(dy, los->dim[los->yaxis]);
+  }
 
-  /* Distance from LOS to right and top cell edge. */
-  const double cx_max = c->loc[los->xaxis] + c->width[los->xaxis];
-  const double cy_max = c->loc[los->yaxis] + c->width[los->yaxis];
+  /* Distance from LOS to the edges of the cell (0 if directly within). */
+  dx = fabs(dx) - half_width_x;
+  dy = fabs(dy) - half_width_y;
+  if (dx < 0.) dx = 0.;
+  if (dy < 0.) dy = 0.;
 
-  /* Maximum smoothing length of a part in this top level cell. */
+  /* Maximum smoothing length of a part in this cell. */
   const double hsml = c->hydro.h_max * kernel_gamma;
-  const double hsml2 = hsml * hsml;
 
-  double dx, dy;
+  /* Is the sightline directly within this cell or could a part from this
+   * cell smooth into the sightline? */
+  return dx * dx + dy * dy <= hsml * hsml;
+}
 
-  if (los->periodic) {
-    dx = min(fabs(nearest(cx_min - los->Xpos, los->dim[los->xaxis])),
-             fabs(nearest(cx_max - los->Xpos, los->dim[los->xaxis])));
-    dy = min(fabs(nearest(cy_min - los->Ypos, los->dim[los->yaxis])),
-             fabs(nearest(cy_max - los->Ypos, los->dim[los->yaxis])));
-  } else {
-    dx = fabs(cx_max - los->Xpos);
-    dy = fabs(cy_max - los->Ypos);
-  }
+/**
+ * @brief Does a particle intersect a line of sight?
+ *
+ * @param p The #part.
+ * @param los The line of sight structure.
+ */
+static INLINE int does_los_intersect_part(const struct part *p,
+                                          const struct line_of_sight *los) {
 
-  /* Is sightline directly within this top level cell? */
-  if (dx < (1.01 * c->width[los->xaxis]) / 2. &&
-      dy < (1.01 * c->width[los->yaxis]) / 2.) {
-    return 1;
-    /* Could a part from this top level cell smooth into the sightline? */
-  } else if (dx * dx + dy * dy < hsml2) {
-    return 1;
-    /* Don't need to work with this top level cell. */
-  } else {
+  /* Don't consider part if outwith allowed z-range. */
+  if (p->x[los->zaxis] < los->range_when_shooting_down_axis[0] ||
+      p->x[los->zaxis] > los->range_when_shooting_down_axis[1])
     return 0;
-  }
+
+  /* Distance from this part to LOS along x dim. */
+  double dx = p->x[los->xaxis] - los->Xpos;
+
+  /* Periodic wrap. */
+  if (los->periodic) dx = nearest(dx, los->dim[los->xaxis]);
+
+  /* Square. */
+  const double dx2 = dx * dx;
+
+  /* Smoothing length of this part. */
+  const double hsml = p->h * kernel_gamma;
+  const double hsml2 = hsml * hsml;
+
+  /* Does this particle fall into our LOS? */
+  if (dx2 >= hsml2) return 0;
+
+  /* Distance from this part to LOS along y dim. */
+  double dy = p->x[los->yaxis] - los->Ypos;
+
+  /* Periodic wrap. */
+  if (los->periodic) dy = nearest(dy, los->dim[los->yaxis]);
+
+  /* Square. */
+  const double dy2 = dy * dy;
+
+  /* Does this part still fall into our LOS? */
+  if (dy2 >= hsml2) return 0;
+
+  /* 2D distance to LOS. */
+  return dx2 + dy2 <= hsml2;
 }
 
 /**
@@ -615,6 +656,9 @@ void write_hdf5_header(hid_t h_file, const struct engine *e,
 /**
  * @brief Loop over each part to see which ones intersect the LOS.
  *
+ * This brute-force version is only used to check the result of the
+ * tree walk.
+ *
  * @param map_data The parts.
  * @param count The number of parts.
  * @param extra_data The line_of_sight structure for this LOS.
@@ -632,113 +676,456 @@ void los_first_loop_mapper(void *restrict map_data, int count,
 
     /* Don't consider inhibited parts. */
     if (parts[i].time_bin == time_bin_inhibited) continue;
+    if (parts[i].time_bin == time_bin_not_created) continue;
 
-    /* Don't consider part if outwith allowed z-range. */
-    if (parts[i].x[LOS_list->zaxis] <
-            LOS_list->range_when_shooting_down_axis[0] ||
-        parts[i].x[LOS_list->zaxis] >
-            LOS_list->range_when_shooting_down_axis[1])
-      continue;
+    /* We've found one. */
+    if (does_los_intersect_part(&parts[i], LOS_list)) los_particle_count++;
+
+  } /* End of loop over all parts */
+
+  atomic_add(&LOS_list->particles_in_los_local, los_particle_count);
+}
+
+/**
+ * @brief 2D bin index over the positions of all the sightlines shooting down
+ * one simulation axis.
+ */
+struct los_plane_index {
+
+  /*! The two axes defining the plane of the sightlines. */
+  enum los_direction xaxis, yaxis;
 
-    /* Distance from this part to LOS along x dim. */
-    double dx = parts[i].x[LOS_list->xaxis] - LOS_list->Xpos;
+  /*! Number of sightlines in the index. */
+  int count;
 
-    /* Periodic wrap. */
-    if (LOS_list->periodic) dx = nearest(dx, LOS_list->dim[LOS_list->xaxis]);
+  /*! Number of bins along each axis of the plane. */
+  int nbins[2];
 
-    /* Square. */
-    const double dx2 = dx * dx;
+  /*! Inverse width of the bins along each axis of the plane. */
+  double inv_bin_width[2];
 
-    /* Smoothing length of this part. */
-    const double hsml = parts[i].h * kernel_gamma;
-    const double hsml2 = hsml * hsml;
+  /*! Start of each bin in the list of sightlines (nbins[0] * nbins[1] + 1
+   * elements). */
+  int *bin_offsets;
 
-    /* Does this particle fall into our LOS? */
-    if (dx2 < hsml2) {
+  /*! Index in the list of LOS of the sightlines sorted by bin. */
+  int *los_ids;
+};
 
-      /* Distance from this part to LOS along y dim. */
-      double dy = parts[i].x[LOS_list->yaxis] - LOS_list->Ypos;
+/**
+ * @brief Data used by the tree walk collecting the parts in the sightlines.
+ */
+struct los_tree_data {
 
-      /* Periodic wrap. */
-      if (LOS_list->periodic) dy = nearest(dy, LOS_list->dim[LOS_list->yaxis]);
+  /*! The #space we walk. */
+  const struct space *s;
 
-      /* Square. */
-      const double dy2 = dy * dy;
+  /*! The list of all sightlines. */
+  struct line_of_sight *LOS_list;
 
-      /* Does this part still fall into our LOS? */
-      if (dy2 < hsml2) {
+  /*! The bin index of the sightlines shooting down each simulation axis. */
+  struct los_plane_index planes[3];
 
-        /* 2D distance to LOS. */
-        if (dx2 + dy2 <= hsml2) {
+  /*! Are we filling the lists of parts (or only counting them)? */
+  int fill;
 
-          /* We've found one. */
-          los_particle_count++;
+  /*! Start of the parts of each LOS in #part_ids. */
+  size_t *offsets;
+
+  /*! Number of parts already stored for each LOS. */
+  int *cursors;
+
+  /*! Index in the #space of the local parts in each LOS. */
+  size_t *part_ids;
+};
+
+/**
+ * @brief Build the 2D bin index of the sightlines shooting down one axis.
+ *
+ * @param index The #los_plane_index to construct.
+ * @param LOS_list The list of all sightlines.
+ * @param num_los The number of sightlines.
+ * @param zaxis The simulation axis the sightlines of this index shoot down.
+ * @param dim The dimensions of the space.
+ */
+static void los_plane_index_init(struct los_plane_index *index,
+                                 const struct line_of_sight *LOS_list,
+                                 const int num_los,
+                                 const enum los_direction zaxis,
+                                 const double dim[3]) {
+
+  index->xaxis = (zaxis == simulation_x_axis) ? simulation_y_axis
+                                               : simulation_x_axis;
+  index->yaxis = (zaxis == simulation_z_axis) ? simulation_y_axis
+                                               : simulation_z_axis;
+
+  index->count = 0;
+  for (int j = 0; j < num_los; j++)
+    if (LOS_list[j].zaxis == zaxis) index->count++;
+
+  /* Aim for about one sightline per bin */
+  int nbins = (int)ceil(sqrt((double)index->count));
+  if (nbins < 1) nbins = 1;
+  if (nbins > los_max_bins_per_axis) nbins = los_max_bins_per_axis;
+  index->nbins[0] = nbins;
+  index->nbins[1] = nbins;
+  index->inv_bin_width[0] = nbins / dim[index->xaxis];
+  index->inv_bin_width[1] = nbins / dim[index->yaxis];
+
+  const int nr_bins = nbins * nbins;
+  index->bin_offsets = (int *)calloc(nr_bins + 1, sizeof(int));
+  index->los_ids = (int *)malloc((index->count + 1) * sizeof(int));
+  int *bin_of_los = (int *)malloc((num_los + 1) * sizeof(int));
+  if (index->bin_offsets == NULL || index->los_ids == NULL ||
+      bin_of_los == NULL)
+    error("Failed to allocate the LOS bin index.");
+
+  /* Count the sightlines in each bin */
+  for (int j = 0; j < num_los; j++) {
+    if (LOS_list[j].zaxis != zaxis) continue;
+
+    int i = (int)floor(LOS_list[j].Xpos * index->inv_bin_width[0]);
+    int k = (int)floor(LOS_list[j].Ypos * index->inv_bin_width[1]);
+    if (i < 0) i = 0;
+    if (i >= nbins) i = nbins - 1;
+    if (k < 0) k = 0;
+    if (k >= nbins) k = nbins - 1;
+
+    bin_of_los[j] = i * nbins + k;
+    index->bin_offsets[bin_of_los[j] + 1]++;
+  }
+
+  for (int b = 0; b < nr_bins; b++)
+    index->bin_offsets[b + 1] += index->bin_offsets[b];
+
+  /* Sort the sightlines by bin */
+  int *fill = (int *)malloc(nr_bins * sizeof(int));
+  if (fill == NULL) error("Failed to allocate the LOS bin index.");
+  memcpy(fill, index->bin_offsets, nr_bins * sizeof(int));
+  for (int j = 0; j < num_los; j++)
+    if (LOS_list[j].zaxis == zaxis) index->los_ids[fill[bin_of_los[j]]++] = j;
+
+  free(fill);
+  free(bin_of_los);
+}
+
+/**
+ * @brief Free the memory used by a #los_plane_index.
+ *
+ * @param index The #los_plane_index.
+ */
+static void los_plane_index_clean(struct los_plane_index *index) {
+  free(index->bin_offsets);
+  free(index->los_ids);
+}
+
+/**
+ * @brief Find the range of bins of an index overlapping a segment.
+ *
+ * @param index The #los_plane_index.
+ * @param dir The axis of the plane (0 or 1).
+ * @param x_min The start of the segment.
+ * @param x_max The end of the segment.
+ * @param periodic Is the space periodic?
+ * @param i_min (return) The first bin.
+ * @param i_max (return) The last bin (can be beyond the last bin of the index
+ * in periodic spaces, in which case the bins wrap).
+ */
+static INLINE void los_plane_index_range(const struct los_plane_index *index,
+                                         const int dir, const double x_min,
+                                         const double x_max,
+                                         const int periodic, int *i_min,
+                                         int *i_max) {
+
+  const int nbins = index->nbins[dir];
+  int i0 = (int)floor(x_min * index->inv_bin_width[dir]);
+  int i1 = (int)floor(x_max * index->inv_bin_width[dir]);
+
+  if (periodic && i1 - i0 + 1 < nbins) {
+    /* Wrap the start into the index */
+    const int shift = ((i0 % nbins) + nbins) % nbins - i0;
+    i0 += shift;
+    i1 += shift;
+  } else {
+    if (i0 < 0) i0 = 0;
+    if (i0 >= nbins) i0 = nbins - 1;
+    if (i1 < i0) i1 = i0;
+    if (i1 >= nbins) i1 = nbins - 1;
+  }
+
+  *i_min = i0;
+  *i_max = i1;
+}
+
+/**
+ * @brief Collect the sightlines that may intersect a top-level cell.
+ *
+ * @param data The #los_tree_data.
+ * @param c The top-level #cell.
+ * @param candidates (return) The index of the sightlines intersecting the
+ * cell.
+ * @return The number of sightlines found.
+ */
+static int los_find_top_level_candidates(const struct los_tree_data *data,
+                                         const struct cell *c,
+                                         int *candidates) {
+
+  const int periodic = data->s->periodic;
+  const double hsml = c->hydro.h_max * kernel_gamma;
+  int num_candidates = 0;
+
+  for (int k = 0; k < 3; k++) {
+
+    const struct los_plane_index *index = &data->planes[k];
+    if (index->count == 0) continue;
+
+    /* Range of bins the cell and its particles' kernels can cover */
+    int i_min, i_max, j_min, j_max;
+    los_plane_index_range(index, 0, c->loc[index->xaxis] - hsml,
+                          c->loc[index->xaxis] + c->width[index->xaxis] + hsml,
+                          periodic, &i_min, &i_max);
+    los_plane_index_range(index, 1, c->loc[index->yaxis] - hsml,
+                          c->loc[index->yaxis] + c->width[index->yaxis] + hsml,
+                          periodic, &j_min, &j_max);
+
+    for (int i = i_min; i <= i_max; i++) {
+      const int ii = i % index->nbins[0];
+      for (int j = j_min; j <= j_max; j++) {
+        const int jj = j % index->nbins[1];
+        const int bin = ii * index->nbins[1] + jj;
+
+        for (int n = index->bin_offsets[bin]; n < index->bin_offsets[bin + 1];
+             n++) {
+          const int id = index->los_ids[n];
+          if (does_los_intersect(c, &data->LOS_list[id]))
+            candidates[num_candidates++] = id;
         }
       }
     }
-  } /* End of loop over all parts */
+  }
 
-  atomic_add(&LOS_list->particles_in_los_local, los_particle_count);
+  return num_candidates;
 }
 
 /**
- * @brief Find all top level cells that a LOS will intersect.
+ * @brief Recursively descend the tree, collecting the parts in the
+ * sightlines.
  *
- * This includes the top level cells the LOS directly passes through
- * and the neighbouring top level cells whose parts could smooth into the LOS.
+ * @param data The #los_tree_data.
+ * @param c The #cell.
+ * @param candidates The sightlines that may intersect this cell.
+ * @param num_candidates The number of such sightlines.
+ * @param buffer Scratch space for the candidates of the progenies.
+ */
+static void los_collect_recursive(struct los_tree_data *data,
+                                  const struct cell *c,
+                                  const int *candidates,
+                                  const int num_candidates, int *buffer) {
+
+  struct line_of_sight *LOS_list = data->LOS_list;
+
+  if (c->split) {
+
+    /* Only keep the sightlines intersecting each progeny */
+    for (int k = 0; k < 8; k++) {
+      const struct cell *cp = c->progeny[k];
+      if (cp == NULL) continue;
+
+      int num_progeny_candidates = 0;
+      for (int n = 0; n < num_candidates; n++)
+        if (does_los_intersect(cp, &LOS_list[candidates[n]]))
+          buffer[num_progeny_candidates++] = candidates[n];
+
+      if (num_progeny_candidates > 0)
+        los_collect_recursive(data, cp, buffer, num_progeny_candidates,
+                              buffer + num_progeny_candidates);
+    }
+
+  } else {
+
+    const struct part *parts = c->hydro.parts;
+    const size_t offset = parts - data->s->parts;
+
+    for (int i = 0; i < c->hydro.count; i++) {
+
+      /* Don't consider inhibited parts. */
+      if (parts[i].time_bin == time_bin_inhibited) continue;
+      if (parts[i].time_bin == time_bin_not_created) continue;
+
+      for (int n = 0; n < num_candidates; n++) {
+        const int id = candidates[n];
+        if (!does_los_intersect_part(&parts[i], &LOS_list[id])) continue;
+
+        if (data->fill) {
+          const int slot = atomic_inc(&data->cursors[id]);
+          data->part_ids[data->offsets[id] + slot] = offset + i;
+        } else {
+          atomic_inc(&LOS_list[id].particles_in_los_local);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Walk the tree of a series of top-level cells and collect the parts
+ * in the sightlines.
+ *
+ * @param map_data The indices of the local top-level cells with particles.
+ * @param num_elements The number of cells.
+ * @param extra_data The #los_tree_data.
+ */
+static void los_collect_mapper(void *map_data, int num_elements,
+                               void *extra_data) {
+
+  struct los_tree_data *data = (struct los_tree_data *)extra_data;
+  const int *local_cells = (int *)map_data;
+  const struct cell *cells = data->s->cells_top;
+
+  int *candidates = (int *)malloc(
+      (data->s->e->los_properties->num_tot + 1) * sizeof(int));
+  if (candidates == NULL) error("Failed to allocate LOS candidates.");
+
+  for (int ind = 0; ind < num_elements; ind++) {
+    const struct cell *c = &cells[local_cells[ind]];
+
+    const int num_candidates =
+        los_find_top_level_candidates(data, c, candidates);
+    if (num_candidates == 0) continue;
+
+    /* Keep track of how many top level cells each LOS intersects. */
+    if (!data->fill)
+      for (int n = 0; n < num_candidates; n++)
+        atomic_inc(&data->LOS_list[candidates[n]]
+                        .num_intersecting_top_level_cells);
+
+    /* Each level of the tree needs at most as many candidates as its
+     * parent */
+    const int num_levels = c->maxdepth - c->depth + 1;
+    int *buffer =
+        (int *)malloc((size_t)num_candidates * num_levels * sizeof(int));
+    if (buffer == NULL) error("Failed to allocate LOS candidates.");
+
+    los_collect_recursive(data, c, candidates, num_candidates, buffer);
+
+    free(buffer);
+  }
+
+  free(candidates);
+}
+
+/**
+ * @brief Sort function for the indices of the parts in a LOS.
+ */
+static int los_part_id_cmp(const void *a, const void *b) {
+  const size_t ia = *(const size_t *)a;
+  const size_t ib = *(const size_t *)b;
+  return (ia > ib) - (ia < ib);
+}
+
+/**
+ * @brief Find the local parts in all the sightlines.
+ *
+ * All the sightlines are handled in one walk of the cell tree. The
+ * sightlines shooting down each axis are binned on a 2D grid in their plane
+ * so that each top-level cell only considers the sightlines in its vicinity,
+ * and the sightlines are then only passed down to the progenies they
+ * intersect.
+ *
+ * Also counts the number of top-level cells intersected by each sightline.
  *
  * @param e The engine.
- * @param los The line_of_sight structure.
- * @param los_cells_top (return) Array indicating whether this cell is
- * intersected.
- * @param cells The array of top-level cells.
- * @param local_cells_with_particles The list of local non-empty top-level
- * cells.
- * @param nr_local_cells_with_particles The number of local non-empty top-level
- * cells.
+ * @param LOS_list The list of sightlines.
+ * @param offsets (return) Start of the parts of each LOS in the returned
+ * array.
+ * @return The indices of the parts of each LOS in the space, sorted.
  */
-void find_intersecting_top_level_cells(
-    const struct engine *e, struct line_of_sight *los,
-    int *restrict los_cells_top, const struct cell *cells,
-    const int *restrict local_cells_with_particles,
-    const int nr_local_cells_with_particles) {
+static size_t *los_collect_parts(struct engine *e,
+                                 struct line_of_sight *LOS_list,
+                                 size_t *offsets) {
 
-  /* Keep track of how many top level cells we intersect. */
-  int num_intersecting_top_level_cells = 0;
+  const struct space *s = e->s;
+  const int num_los = e->los_properties->num_tot;
 
-  /* Loop over each top level cell */
-  for (int n = 0; n < nr_local_cells_with_particles; n++) {
+  struct los_tree_data data;
+  data.s = s;
+  data.LOS_list = LOS_list;
+  for (int k = 0; k < 3; k++)
+    los_plane_index_init(&data.planes[k], LOS_list, num_los,
+                         (enum los_direction)k, s->dim);
 
-    /* This top level cell. */
-    const struct cell *c = &cells[local_cells_with_particles[n]];
+  /* First count the parts in each LOS... */
+  for (int j = 0; j < num_los; j++) {
+    LOS_list[j].particles_in_los_local = 0;
+    LOS_list[j].num_intersecting_top_level_cells = 0;
+  }
+  data.fill = 0;
+  threadpool_map(&e->threadpool, los_collect_mapper,
+                 s->local_cells_with_particles_top,
+                 s->nr_local_cells_with_particles, sizeof(int),
+                 /*chunk=*/1, &data);
+
+  size_t total = 0;
+  for (int j = 0; j < num_los; j++) {
+    offsets[j] = total;
+    total += LOS_list[j].particles_in_los_local;
+  }
 
-    if (does_los_intersect(c, los)) {
-      num_intersecting_top_level_cells++;
-      los_cells_top[n] = 1;
-    }
+  /* ... then collect them */
+  size_t *part_ids = (size_t *)swift_malloc("los_part_ids",
+                                            (total + 1) * sizeof(size_t));
+  int *cursors = (int *)calloc(num_los + 1, sizeof(int));
+  if (part_ids == NULL || cursors == NULL)
+    error("Failed to allocate the list of LOS parts.");
+
+  data.fill = 1;
+  data.offsets = offsets;
+  data.cursors = cursors;
+  data.part_ids = part_ids;
+  threadpool_map(&e->threadpool, los_collect_mapper,
+                 s->local_cells_with_particles_top,
+                 s->nr_local_cells_with_particles, sizeof(int),
+                 /*chunk=*/1, &data);
+
+  /* Keep the parts in the order of the space */
+  for (int j = 0; j < num_los; j++) {
+#ifdef SWIFT_DEBUG_CHECKS
+    if (cursors[j] != LOS_list[j].particles_in_los_local)
+      error("LOS counts don't add up");
+#endif
+    qsort(&part_ids[offsets[j]], LOS_list[j].particles_in_los_local,
+          sizeof(size_t), los_part_id_cmp);
   }
 
 #ifdef WITH_MPI
-  if (MPI_Allreduce(MPI_IN_PLACE, &num_intersecting_top_level_cells, 1, MPI_INT,
-                    MPI_SUM, MPI_COMM_WORLD) != MPI_SUCCESS)
+  /* Make sure all nodes know how many top level cells each LOS intersects */
+  int *num_cells = (int *)malloc((num_los + 1) * sizeof(int));
+  if (num_cells == NULL) error("Failed to allocate LOS cell counts.");
+  for (int j = 0; j < num_los; j++)
+    num_cells[j] = LOS_list[j].num_intersecting_top_level_cells;
+  if (MPI_Allreduce(MPI_IN_PLACE, num_cells, num_los, MPI_INT, MPI_SUM,
+                    MPI_COMM_WORLD) != MPI_SUCCESS)
     error("Failed to allreduce num_intersecting_top_level_cells.");
+  for (int j = 0; j < num_los; j++)
+    LOS_list[j].num_intersecting_top_level_cells = num_cells[j];
+  free(num_cells);
 #endif
 
-  /* Store how many top level cells this LOS intersects. */
-  los->num_intersecting_top_level_cells = num_intersecting_top_level_cells;
+  free(cursors);
+  for (int k = 0; k < 3; k++) los_plane_index_clean(&data.planes[k]);
+
+  return part_ids;
 }
 
 /**
  * @brief Main work function for computing line of sights.
  *
  * 1) Construct N random line of sight positions.
- * 2) Loop over each line of sight.
- *  - 2.1) Find which top level cells sightline intersects.
- *  - 2.2) Loop over each part in these top level cells to see which intersect
- * sightline.
- *  - 2.3) Use this count to construct a LOS parts/xparts array.
- *  - 2.4) Loop over each part and extract those in sightline to new array.
- *  - 2.5) Save sightline parts to HDF5 file.
+ * 2) Walk the cell tree once to find the parts in all the sightlines.
+ * 3) Loop over each line of sight.
+ *  - 3.1) Use the count to construct a LOS parts/xparts array.
+ *  - 3.2) Extract the parts in the sightline to the new array.
+ *  - 3.3) Save sightline parts to HDF5 file.
  *
  * @param e The engine.
  */
@@ -799,38 +1186,38 @@ void do_line_of_sight(struct engine *e) {
   /* Main loop over each random LOS. */
   /* ------------------------------- */
 
-  /* Get list of local non-empty top level cells. */
-  const struct cell *cells = e->s->cells_top;
-  const int *local_cells_with_particles = e->s->local_cells_with_particles_top;
-  const int nr_local_cells_with_particles = s->nr_local_cells_with_particles;
+  /* Find the parts in all the sightlines in one walk of the tree. */
+  const ticks tic_collect = getticks();
+  size_t *LOS_offsets =
+      (size_t *)malloc((LOS_params->num_tot + 1) * sizeof(size_t));
+  if (LOS_offsets == NULL) error("Failed to allocate LOS offsets.");
+  size_t *LOS_part_ids = los_collect_parts(e, LOS_list, LOS_offsets);
+
+  if (verbose)
+    message("Finding the parts in the sightlines took %.3f %s.",
+            clocks_from_ticks(getticks() - tic_collect), clocks_getunit());
+
+#ifdef WITH_MPI
+  /* Make sure all nodes know how many parts each rank has in each LOS */
+  int *LOS_counts =
+      (int *)malloc(sizeof(int) * e->nr_nodes * LOS_params->num_tot);
+  int *LOS_local_counts = (int *)malloc(sizeof(int) * LOS_params->num_tot);
+  if (LOS_counts == NULL || LOS_local_counts == NULL)
+    error("Failed to allocate LOS counts.");
+  for (int j = 0; j < LOS_params->num_tot; j++)
+    LOS_local_counts[j] = LOS_list[j].particles_in_los_local;
+  MPI_Allgather(LOS_local_counts, LOS_params->num_tot, MPI_INT, LOS_counts,
+                LOS_params->num_tot, MPI_INT, MPI_COMM_WORLD);
+  free(LOS_local_counts);
+#endif
 
   /* Loop over each random LOS. */
   for (int j = 0; j < LOS_params->num_tot; j++) {
 
-    /* Create empty top level cell list for this LOS */
-    int *los_cells_top = (int *)swift_malloc(
-        "tl_cells_los", nr_local_cells_with_particles * sizeof(int));
-    bzero(los_cells_top, nr_local_cells_with_particles * sizeof(int));
-
-    /* Find all top level cells this LOS will intersect. */
-    find_intersecting_top_level_cells(e, &LOS_list[j], los_cells_top, cells,
-                                      local_cells_with_particles,
-                                      nr_local_cells_with_particles);
-
-    /* Next count all the parts that intersect with this line of sight */
-    for (int n = 0; n < nr_local_cells_with_particles; n++) {
-      if (los_cells_top[n] == 1) {
-        const struct cell *c = &cells[local_cells_with_particles[n]];
-        threadpool_map(&s->e->threadpool, los_first_loop_mapper, c->hydro.parts,
-                       c->hydro.count, sizeof(struct part),
-                       threadpool_auto_chunk_size, &LOS_list[j]);
-      }
-    }
-
 #ifdef SWIFT_DEBUG_CHECKS
     /* Confirm we are capturing all the parts that intersect the LOS by redoing
      * the count looping over all parts in the space (not just those in the
-     * subset of top level cells). */
+     * cells intersected by the LOS). */
 
     struct part *parts = s->parts;
     const size_t nr_parts = s->nr_parts;
@@ -854,8 +1241,8 @@ void do_line_of_sight(struct engine *e) {
     int *offsets = (int *)malloc(sizeof(int) * e->nr_nodes);
 
     /* How many parts does each rank have for this LOS? */
-    MPI_Allgather(&LOS_list[j].particles_in_los_local, 1, MPI_INT, counts, 1,
-                  MPI_INT, MPI_COMM_WORLD);
+    for (int k = 0; k < e->nr_nodes; k++)
+      counts[k] = LOS_counts[k * LOS_params->num_tot + j];
 
     int offset_count = 0;
     for (int k = 0; k < e->nr_nodes; k++) {
@@ -887,7 +1274,6 @@ void do_line_of_sight(struct engine *e) {
       free(offsets);
       offsets = NULL;
 #endif
-      swift_free("tl_cells_los", los_cells_top);
       continue;
     }
 
@@ -931,82 +1317,18 @@ void do_line_of_sight(struct engine *e) {
         error("Failed to allocate LOS gpart memory.");
     }
 
-    /* Loop over each part again, pulling out those in LOS. */
-    int count = 0;
-
-    for (int n = 0; n < e->s->nr_local_cells_with_particles; ++n) {
-
-      if (los_cells_top[n] == 0) continue;
-
-      const struct cell *c = &cells[local_cells_with_particles[n]];
-      const struct part *cell_parts = c->hydro.parts;
-      const struct xpart *cell_xparts = c->hydro.xparts;
-      const size_t num_parts_in_cell = c->hydro.count;
-
-      for (size_t i = 0; i < num_parts_in_cell; i++) {
-
-        /* Don't consider inhibited parts. */
-        if (cell_parts[i].time_bin == time_bin_inhibited) continue;
-        if (cell_parts[i].time_bin == time_bin_not_created) continue;
-
-        /* Don't consider part if outwith allowed z-range. */
-        if (cell_parts[i].x[LOS_list[j].zaxis] <
-                LOS_list[j].range_when_shooting_down_axis[0] ||
-            cell_parts[i].x[LOS_list[j].zaxis] >
-                LOS_list[j].range_when_shooting_down_axis[1])
-          continue;
+    /* Pull out the parts in LOS. */
+    const size_t *part_ids = &LOS_part_ids[LOS_offsets[j]];
+    for (int i = 0; i < LOS_list[j].particles_in_los_local; i++) {
 
-        /* Distance from this part to LOS along x dim. */
-        double dx = cell_parts[i].x[LOS_list[j].xaxis] - LOS_list[j].Xpos;
+      const struct part *p = &s->parts[part_ids[i]];
 
-        /* Periodic wrap. */
-        if (LOS_list[j].periodic)
-          dx = nearest(dx, LOS_list[j].dim[LOS_list[j].xaxis]);
-
-        /* Square */
-        const double dx2 = dx * dx;
-
-        /* Smoothing length of this part. */
-        const double hsml = cell_parts[i].h * kernel_gamma;
-        const double hsml2 = hsml * hsml;
-
-        /* Does this part fall into our LOS? */
-        if (dx2 < hsml2) {
-
-          /* Distance from this part to LOS along y dim. */
-          double dy = cell_parts[i].x[LOS_list[j].yaxis] - LOS_list[j].Ypos;
-
-          /* Periodic wrap. */
-          if (LOS_list[j].periodic)
-            dy = nearest(dy, LOS_list[j].dim[LOS_list[j].yaxis]);
-
-          /* Square */
-          const double dy2 = dy * dy;
-
-          /* Does this part still fall into our LOS? */
-          if (dy2 < hsml2) {
-            /* 2D distance to LOS. */
-
-            if (dx2 + dy2 <= hsml2) {
-
-              /* Store part and xpart properties. */
-              memcpy(&LOS_parts[count], &cell_parts[i], sizeof(struct part));
-              memcpy(&LOS_xparts[count], &cell_xparts[i], sizeof(struct xpart));
-              memcpy(&LOS_gparts[count], cell_parts[i].gpart,
-                     sizeof(struct gpart));
-
-              count++;
-            }
-          }
-        }
-      }
+      /* Store part and xpart properties. */
+      memcpy(&LOS_parts[i], p, sizeof(struct part));
+      memcpy(&LOS_xparts[i], &s->xparts[part_ids[i]], sizeof(struct xpart));
+      memcpy(&LOS_gparts[i], p->gpart, sizeof(struct gpart));
     }
 
-#ifdef SWIFT_DEBUG_CHECKS
-    if (count != LOS_list[j].particles_in_los_local)
-      error("LOS counts don't add up");
-#endif
-
 #ifdef WITH_MPI
     /* Collect all parts in this LOS to rank 0. */
     if (e->nodeID == 0) {
@@ -1076,13 +1398,18 @@ void do_line_of_sight(struct engine *e) {
     free(counts);
     free(offsets);
 #endif
-    swift_free("tl_cells_los", los_cells_top);
     swift_free("los_parts_array", LOS_parts);
     swift_free("los_xparts_array", LOS_xparts);
     swift_free("los_gparts_array", LOS_gparts);
 
   } /* End of loop over each LOS */
 
+#ifdef WITH_MPI
+  free(LOS_counts);
+#endif
+  swift_free("los_part_ids", LOS_part_ids);
+  free(LOS_offsets);
+
   if (e->nodeID == 0) {
     /* Write header */
     write_hdf5_header(h_file, e, LOS_params, total_num_parts_in_los);
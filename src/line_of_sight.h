@@ -30,6 +30,9 @@
 /* Pre-declarations */
 struct engine;
 
+/*! Maximal number of bins along each axis of the index of the sightlines */
+#define los_max_bins_per_axis 1024
+
 /**
  * @brief Maps the LOS axis geometry to the simulation axis geometry.
  *
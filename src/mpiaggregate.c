@@ -0,0 +1,575 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Peter W. Draper (p.w.draper@durham.ac.uk)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+#ifdef WITH_MPI
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* This object's header. */
+#include "mpiaggregate.h"
+
+/* Local includes. */
+#include "clocks.h"
+#include "error.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "task.h"
+
+/*! Number of buckets of the hash table of recv messages. */
+#define mpiaggregate_nr_buckets 4096
+
+/*! Alignment of the messages packed in an aggregated message. */
+#define mpiaggregate_align 8
+
+/**
+ * @brief Header of each task message packed in an aggregated message.
+ */
+struct mpiaggregate_header {
+
+  /*! The tag of the message. */
+  long long tag;
+
+  /*! The size of the message in bytes. */
+  size_t size;
+
+  /*! The sub-type of the task. */
+  int subtype;
+
+  /*! Padding to keep the data aligned. */
+  int padding;
+};
+
+/**
+ * @brief Size of a message once packed, including its header.
+ *
+ * @param size The size of the message in bytes.
+ */
+static size_t mpiaggregate_packed_size(const size_t size) {
+  const size_t padded = (size + mpiaggregate_align - 1) /
+                        mpiaggregate_align * mpiaggregate_align;
+  return sizeof(struct mpiaggregate_header) + padded;
+}
+
+/**
+ * @brief Bucket of the hash table of recv messages for a given message.
+ *
+ * @param rank The rank that sends the message.
+ * @param subtype The sub-type of the task.
+ * @param tag The tag of the message.
+ */
+static size_t mpiaggregate_bucket(const int rank, const int subtype,
+                                  const long long tag) {
+  const unsigned long long key = ((unsigned long long)tag * task_subtype_count +
+                                  (unsigned long long)subtype) *
+                                     1000003ULL +
+                                 (unsigned long long)rank;
+  return (key ^ (key >> 17)) % mpiaggregate_nr_buckets;
+}
+
+/**
+ * @brief Find and remove a message from a bucket of the recv hash table.
+ *
+ * Needs to be called with the lock held.
+ *
+ * @param bucket The bucket.
+ * @param rank The rank that sends the message.
+ * @param subtype The sub-type of the task.
+ * @param tag The tag of the message.
+ *
+ * @return The message or NULL if not found.
+ */
+static struct mpiaggregate_message *mpiaggregate_remove(
+    struct mpiaggregate_message **bucket, const int rank, const int subtype,
+    const long long tag) {
+
+  for (struct mpiaggregate_message **m = bucket; *m != NULL; m = &(*m)->next) {
+    if ((*m)->rank == rank && (*m)->subtype == subtype && (*m)->tag == tag) {
+      struct mpiaggregate_message *found = *m;
+      *m = found->next;
+      return found;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Hand a task whose message has been exchanged back to the
+ * #scheduler.
+ *
+ * @param a The #mpiaggregate.
+ * @param t The #task.
+ * @param qid The queue to insert the task into.
+ */
+static void mpiaggregate_task_done(struct mpiaggregate *a, struct task *t,
+                                   const int qid) {
+
+  struct scheduler *s = a->s;
+  queue_insert(&s->queues[qid], t);
+
+  /* Wake up any runner waiting for a task. */
+  pthread_mutex_lock(&s->sleep_mutex);
+  pthread_cond_broadcast(&s->sleep_cond);
+  pthread_mutex_unlock(&s->sleep_mutex);
+}
+
+/**
+ * @brief Send all the messages waiting for a rank as one aggregated message.
+ *
+ * The messages are copied, so their tasks are done as soon as the aggregated
+ * message has been posted.
+ *
+ * @param a The #mpiaggregate.
+ * @param rank The rank to send to.
+ * @param list The messages to send.
+ */
+static void mpiaggregate_send_list(struct mpiaggregate *a, const int rank,
+                                   struct mpiaggregate_message *list) {
+
+  /* Size of the aggregated message. */
+  size_t total = 0;
+  int count = 0;
+  for (struct mpiaggregate_message *m = list; m != NULL; m = m->next) {
+    total += mpiaggregate_packed_size(m->size);
+    count++;
+  }
+
+  struct mpiaggregate_flight *flight =
+      (struct mpiaggregate_flight *)malloc(sizeof(struct mpiaggregate_flight));
+  if (flight == NULL) error("Failed to allocate aggregated message.");
+  if ((flight->buff = (char *)malloc(total)) == NULL)
+    error("Failed to allocate buffer of aggregated message.");
+
+  /* Pack the messages. */
+  char *buff = flight->buff;
+  for (struct mpiaggregate_message *m = list; m != NULL; m = m->next) {
+    struct mpiaggregate_header *header = (struct mpiaggregate_header *)buff;
+    header->tag = m->tag;
+    header->size = m->size;
+    header->subtype = m->subtype;
+    header->padding = 0;
+    if (m->size > 0)
+      memcpy(buff + sizeof(struct mpiaggregate_header), m->buff, m->size);
+    buff += mpiaggregate_packed_size(m->size);
+  }
+
+  int err = MPI_Isend(flight->buff, (int)total, MPI_BYTE, rank, 0, a->comm,
+                      &flight->req);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to send aggregated message.");
+
+  flight->next = a->flights;
+  a->flights = flight;
+  a->nr_messages += count;
+  a->nr_aggregates++;
+
+  /* The data has been copied, the send tasks are done. */
+  while (list != NULL) {
+    struct mpiaggregate_message *next = list->next;
+    mpiaggregate_task_done(a, list->t, list->qid);
+    free(list);
+    list = next;
+  }
+}
+
+/**
+ * @brief Send the messages that have waited long enough.
+ *
+ * @param a The #mpiaggregate.
+ *
+ * @return Whether anything was sent.
+ */
+static int mpiaggregate_flush(struct mpiaggregate *a) {
+
+  int progress = 0;
+
+  for (int rank = 0; rank < a->nr_nodes; rank++) {
+
+    struct mpiaggregate_message *list = NULL;
+    pthread_mutex_lock(&a->lock);
+    if (a->sends[rank] != NULL &&
+        getticks() - a->sends_tic[rank] >= a->window) {
+      list = a->sends[rank];
+      a->sends[rank] = NULL;
+      for (struct mpiaggregate_message *m = list; m != NULL; m = m->next)
+        a->nr_sends--;
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    if (list != NULL) {
+      mpiaggregate_send_list(a, rank, list);
+      progress = 1;
+    }
+  }
+  return progress;
+}
+
+/**
+ * @brief Unpack an aggregated message and deliver its messages to their recv
+ * tasks, or keep them until their task is enqueued.
+ *
+ * @param a The #mpiaggregate.
+ * @param rank The rank that sent the message.
+ * @param buff The aggregated message.
+ * @param total The size of the aggregated message.
+ */
+static void mpiaggregate_deliver(struct mpiaggregate *a, const int rank,
+                                 const char *buff, const size_t total) {
+
+  size_t offset = 0;
+  while (offset < total) {
+
+    const struct mpiaggregate_header *header =
+        (const struct mpiaggregate_header *)(buff + offset);
+    const char *data = buff + offset + sizeof(struct mpiaggregate_header);
+    offset += mpiaggregate_packed_size(header->size);
+    if (offset > total) error("Corrupted aggregated message.");
+
+    struct mpiaggregate_message **bucket =
+        &a->recvs[mpiaggregate_bucket(rank, header->subtype, header->tag)];
+
+    pthread_mutex_lock(&a->lock);
+    struct mpiaggregate_message *m =
+        mpiaggregate_remove(bucket, rank, header->subtype, header->tag);
+
+    /* The task is already waiting, give it its data. */
+    if (m != NULL) {
+      if (m->t == NULL)
+        error("Received the same message twice (rank=%d %s tag=%lld).", rank,
+              subtaskID_names[header->subtype], header->tag);
+      a->nr_recvs--;
+      pthread_mutex_unlock(&a->lock);
+
+      if (m->size != header->size)
+        error("Mismatched size of message (%s tag=%lld: %zd != %zd).",
+              subtaskID_names[header->subtype], header->tag, m->size,
+              header->size);
+      if (m->size > 0) memcpy(m->buff, data, m->size);
+      mpiaggregate_task_done(a, m->t, m->qid);
+      free(m);
+    }
+
+    /* Otherwise, keep a copy until the task gets enqueued. */
+    else {
+      m = (struct mpiaggregate_message *)malloc(
+          sizeof(struct mpiaggregate_message));
+      if (m == NULL) error("Failed to allocate early message.");
+      m->t = NULL;
+      m->size = header->size;
+      m->tag = header->tag;
+      m->subtype = header->subtype;
+      m->rank = rank;
+      m->qid = -1;
+      if ((m->buff = malloc(m->size > 0 ? m->size : 1)) == NULL)
+        error("Failed to allocate early message data.");
+      if (m->size > 0) memcpy(m->buff, data, m->size);
+      m->next = *bucket;
+      *bucket = m;
+      pthread_mutex_unlock(&a->lock);
+    }
+  }
+}
+
+/**
+ * @brief Receive all the aggregated messages that have arrived.
+ *
+ * @param a The #mpiaggregate.
+ *
+ * @return Whether anything was received.
+ */
+static int mpiaggregate_poll(struct mpiaggregate *a) {
+
+  int progress = 0;
+  while (1) {
+    int flag = 0;
+    MPI_Message msg;
+    MPI_Status status;
+    int err = MPI_Improbe(MPI_ANY_SOURCE, 0, a->comm, &flag, &msg, &status);
+    if (err != MPI_SUCCESS) mpi_error(err, "Failed to probe for messages.");
+    if (!flag) break;
+
+    int count = 0;
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    char *buff = (char *)malloc(count > 0 ? count : 1);
+    if (buff == NULL) error("Failed to allocate aggregated message.");
+    err = MPI_Mrecv(buff, count, MPI_BYTE, &msg, MPI_STATUS_IGNORE);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to receive aggregated message.");
+
+    mpiaggregate_deliver(a, status.MPI_SOURCE, buff, count);
+    free(buff);
+    progress = 1;
+  }
+  return progress;
+}
+
+/**
+ * @brief Release the aggregated messages whose send completed.
+ *
+ * @param a The #mpiaggregate.
+ *
+ * @return Whether any send completed.
+ */
+static int mpiaggregate_test_flights(struct mpiaggregate *a) {
+
+  int progress = 0;
+  struct mpiaggregate_flight **f = &a->flights;
+  while (*f != NULL) {
+    int flag = 0;
+    int err = MPI_Test(&(*f)->req, &flag, MPI_STATUS_IGNORE);
+    if (err != MPI_SUCCESS)
+      mpi_error(err, "Failed to test aggregated message.");
+    if (flag) {
+      struct mpiaggregate_flight *done = *f;
+      *f = done->next;
+      free(done->buff);
+      free(done);
+      progress = 1;
+    } else {
+      f = &(*f)->next;
+    }
+  }
+  return progress;
+}
+
+/**
+ * @brief The progress thread.
+ *
+ * Sleeps while there are no messages to exchange, otherwise polls MPI and
+ * naps for the length of the aggregation window when nothing happened.
+ *
+ * @param data The #mpiaggregate.
+ */
+static void *mpiaggregate_progress(void *data) {
+
+  struct mpiaggregate *a = (struct mpiaggregate *)data;
+  const double window_ns = clocks_from_ticks(a->window) * 1e6;
+  struct timespec nap;
+  nap.tv_sec = 0;
+  nap.tv_nsec = window_ns > 1000. ? (long)window_ns : 1000;
+
+  pthread_mutex_lock(&a->lock);
+  while (!a->done) {
+
+    /* Nothing to do? Wait for a task to hand over a message. */
+    if (a->nr_sends == 0 && a->nr_recvs == 0 && a->flights == NULL) {
+      pthread_cond_wait(&a->cond, &a->lock);
+      continue;
+    }
+    pthread_mutex_unlock(&a->lock);
+
+    int progress = mpiaggregate_flush(a);
+    progress |= mpiaggregate_poll(a);
+    progress |= mpiaggregate_test_flights(a);
+    if (!progress) nanosleep(&nap, NULL);
+
+    pthread_mutex_lock(&a->lock);
+  }
+  pthread_mutex_unlock(&a->lock);
+
+  return NULL;
+}
+
+/**
+ * @brief Initialise the aggregation layer and start its progress thread.
+ *
+ * @param a The #mpiaggregate.
+ * @param s The #scheduler whose tasks we serve.
+ * @param nr_nodes The number of ranks.
+ * @param size_limit Largest message, in bytes, to aggregate.
+ * @param window Time in micro-seconds a message waits for others.
+ */
+void mpiaggregate_init(struct mpiaggregate *a, struct scheduler *s,
+                       int nr_nodes, size_t size_limit, double window) {
+
+  a->s = s;
+  a->nr_nodes = nr_nodes;
+  a->size_limit = size_limit;
+  a->window = clocks_to_ticks(window * 1e-3);
+  a->done = 0;
+  a->nr_sends = 0;
+  a->nr_recvs = 0;
+  a->flights = NULL;
+  a->nr_messages = 0;
+  a->nr_aggregates = 0;
+
+  if (MPI_Comm_dup(MPI_COMM_WORLD, &a->comm) != MPI_SUCCESS)
+    error("Failed to create communicator for aggregated messages.");
+
+  a->sends = (struct mpiaggregate_message **)calloc(
+      nr_nodes, sizeof(struct mpiaggregate_message *));
+  a->sends_tic = (ticks *)calloc(nr_nodes, sizeof(ticks));
+  a->recvs = (struct mpiaggregate_message **)calloc(
+      mpiaggregate_nr_buckets, sizeof(struct mpiaggregate_message *));
+  if (a->sends == NULL || a->sends_tic == NULL || a->recvs == NULL)
+    error("Failed to allocate lists of aggregated messages.");
+
+  if (pthread_mutex_init(&a->lock, NULL) != 0 ||
+      pthread_cond_init(&a->cond, NULL) != 0)
+    error("Failed to initialise lock of aggregated messages.");
+
+  if (pthread_create(&a->thread, NULL, &mpiaggregate_progress, a) != 0)
+    error("Failed to create MPI progress thread.");
+}
+
+/**
+ * @brief Hand the message of a send task over to the aggregation layer.
+ *
+ * The task is inserted in its queue once the message has been packed.
+ *
+ * @param a The #mpiaggregate.
+ * @param t The send #task.
+ * @param buff The data to send.
+ * @param size The size of the data in bytes.
+ * @param qid The queue to insert the task into.
+ */
+void mpiaggregate_send(struct mpiaggregate *a, struct task *t, void *buff,
+                       size_t size, int qid) {
+
+  struct mpiaggregate_message *m = (struct mpiaggregate_message *)malloc(
+      sizeof(struct mpiaggregate_message));
+  if (m == NULL) error("Failed to allocate message.");
+  m->t = t;
+  m->buff = buff;
+  m->size = size;
+  m->tag = t->flags;
+  m->subtype = t->subtype;
+  m->rank = t->cj->nodeID;
+  m->qid = qid;
+
+  pthread_mutex_lock(&a->lock);
+  if (a->sends[m->rank] == NULL) a->sends_tic[m->rank] = getticks();
+  m->next = a->sends[m->rank];
+  a->sends[m->rank] = m;
+  a->nr_sends++;
+  pthread_cond_signal(&a->cond);
+  pthread_mutex_unlock(&a->lock);
+}
+
+/**
+ * @brief Hand a recv task over to the aggregation layer.
+ *
+ * The task is inserted in its queue once its message has been received,
+ * possibly straight away if it arrived earlier.
+ *
+ * @param a The #mpiaggregate.
+ * @param t The recv #task.
+ * @param buff The buffer to receive into.
+ * @param size The size of the data in bytes.
+ * @param qid The queue to insert the task into.
+ */
+void mpiaggregate_recv(struct mpiaggregate *a, struct task *t, void *buff,
+                       size_t size, int qid) {
+
+  const int rank = t->ci->nodeID;
+  struct mpiaggregate_message **bucket =
+      &a->recvs[mpiaggregate_bucket(rank, t->subtype, t->flags)];
+
+  pthread_mutex_lock(&a->lock);
+  struct mpiaggregate_message *m =
+      mpiaggregate_remove(bucket, rank, t->subtype, t->flags);
+
+  /* Did the message arrive already? */
+  if (m != NULL) {
+    pthread_mutex_unlock(&a->lock);
+    if (m->t != NULL)
+      error("Recv task enqueued twice (%s tag=%lld).",
+            subtaskID_names[t->subtype], t->flags);
+    if (m->size != size)
+      error("Mismatched size of message (%s tag=%lld: %zd != %zd).",
+            subtaskID_names[t->subtype], t->flags, size, m->size);
+    if (size > 0) memcpy(buff, m->buff, size);
+    free(m->buff);
+    free(m);
+    mpiaggregate_task_done(a, t, qid);
+    return;
+  }
+
+  /* No, wait for it. */
+  if ((m = (struct mpiaggregate_message *)malloc(
+           sizeof(struct mpiaggregate_message))) == NULL)
+    error("Failed to allocate message.");
+  m->t = t;
+  m->buff = buff;
+  m->size = size;
+  m->tag = t->flags;
+  m->subtype = t->subtype;
+  m->rank = rank;
+  m->qid = qid;
+  m->next = *bucket;
+  *bucket = m;
+  a->nr_recvs++;
+  pthread_cond_signal(&a->cond);
+  pthread_mutex_unlock(&a->lock);
+}
+
+/**
+ * @brief Stop the progress thread and release the aggregation layer.
+ *
+ * @param a The #mpiaggregate.
+ */
+void mpiaggregate_clean(struct mpiaggregate *a) {
+
+  pthread_mutex_lock(&a->lock);
+  a->done = 1;
+  pthread_cond_signal(&a->cond);
+  pthread_mutex_unlock(&a->lock);
+  pthread_join(a->thread, NULL);
+
+  /* Complete the messages still in flight, unless MPI is gone already. */
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  while (a->flights != NULL) {
+    struct mpiaggregate_flight *f = a->flights;
+    if (!finalized) MPI_Wait(&f->req, MPI_STATUS_IGNORE);
+    a->flights = f->next;
+    free(f->buff);
+    free(f);
+  }
+  if (!finalized) MPI_Comm_free(&a->comm);
+
+  /* Drop any message left over. */
+  for (int k = 0; k < mpiaggregate_nr_buckets; k++) {
+    while (a->recvs[k] != NULL) {
+      struct mpiaggregate_message *m = a->recvs[k];
+      a->recvs[k] = m->next;
+      if (m->t == NULL) free(m->buff);
+      free(m);
+    }
+  }
+  for (int k = 0; k < a->nr_nodes; k++) {
+    while (a->sends[k] != NULL) {
+      struct mpiaggregate_message *m = a->sends[k];
+      a->sends[k] = m->next;
+      free(m);
+    }
+  }
+  free(a->recvs);
+  free(a->sends);
+  free(a->sends_tic);
+
+  pthread_mutex_destroy(&a->lock);
+  pthread_cond_destroy(&a->cond);
+}
+
+#endif /* WITH_MPI */
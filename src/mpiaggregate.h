@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Peter W. Draper (p.w.draper@durham.ac.uk)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_MPIAGGREGATE_H
+#define SWIFT_MPIAGGREGATE_H
+
+/* Config parameters. */
+#include <config.h>
+
+#ifdef WITH_MPI
+
+/* MPI headers. */
+#include <mpi.h>
+
+/* Some standard headers. */
+#include <pthread.h>
+#include <stddef.h>
+
+/* Local includes. */
+#include "cycle.h"
+
+/* Forward declarations. */
+struct scheduler;
+struct task;
+
+/**
+ * @brief A message of a send or recv task handled by the aggregation layer.
+ */
+struct mpiaggregate_message {
+
+  /*! The task, NULL for a message that arrived before its recv task. */
+  struct task *t;
+
+  /*! The data of the message. */
+  void *buff;
+
+  /*! The size of the message in bytes. */
+  size_t size;
+
+  /*! The tag of the message (task flags). */
+  long long tag;
+
+  /*! The sub-type of the task. */
+  int subtype;
+
+  /*! The rank we exchange the message with. */
+  int rank;
+
+  /*! The queue the task goes to once the message is exchanged. */
+  int qid;
+
+  /*! Next message in the same list. */
+  struct mpiaggregate_message *next;
+};
+
+/**
+ * @brief An aggregated message sent to another rank and not yet completed.
+ */
+struct mpiaggregate_flight {
+
+  /*! The MPI request of the send. */
+  MPI_Request req;
+
+  /*! The aggregated data. */
+  char *buff;
+
+  /*! Next message in flight. */
+  struct mpiaggregate_flight *next;
+};
+
+/**
+ * @brief Layer exchanging all the small task messages between two ranks as
+ * single aggregated messages.
+ *
+ * The send and recv tasks hand their messages over when enqueued. A
+ * dedicated thread packs all the messages waiting for the same rank once the
+ * oldest one has waited for the aggregation window, receives the aggregated
+ * messages from the other ranks and inserts the tasks in the queues of the
+ * #scheduler once their message has been exchanged.
+ */
+struct mpiaggregate {
+
+  /*! The #scheduler whose tasks we serve. */
+  struct scheduler *s;
+
+  /*! Communicator used for the aggregated messages. */
+  MPI_Comm comm;
+
+  /*! Number of ranks. */
+  int nr_nodes;
+
+  /*! Largest message, in bytes, that gets aggregated. */
+  size_t size_limit;
+
+  /*! Time a message can wait for others to the same rank. */
+  ticks window;
+
+  /*! The progress thread. */
+  pthread_t thread;
+
+  /*! Lock and condition protecting the lists below. */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  /*! Should the progress thread stop? */
+  int done;
+
+  /*! Messages waiting to be sent, per rank. */
+  struct mpiaggregate_message **sends;
+
+  /*! Time at which the oldest message of each rank was added. */
+  ticks *sends_tic;
+
+  /*! Total number of messages waiting to be sent. */
+  int nr_sends;
+
+  /*! Hash table of the recv tasks waiting for their message and of the
+   * messages that arrived before their task. */
+  struct mpiaggregate_message **recvs;
+
+  /*! Number of recv tasks waiting for their message. */
+  int nr_recvs;
+
+  /*! Aggregated messages in flight (only used by the progress thread). */
+  struct mpiaggregate_flight *flights;
+
+  /*! Number of task messages and of aggregated messages sent so far. */
+  long long nr_messages, nr_aggregates;
+};
+
+void mpiaggregate_init(struct mpiaggregate *a, struct scheduler *s,
+                       int nr_nodes, size_t size_limit, double window);
+void mpiaggregate_send(struct mpiaggregate *a, struct task *t, void *buff,
+                       size_t size, int qid);
+void mpiaggregate_recv(struct mpiaggregate *a, struct task *t, void *buff,
+                       size_t size, int qid);
+void mpiaggregate_clean(struct mpiaggregate *a);
+
+#endif /* WITH_MPI */
+
+#endif /* SWIFT_MPIAGGREGATE_H */
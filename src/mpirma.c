@@ -0,0 +1,589 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Peter W. Draper (p.w.draper@durham.ac.uk)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+#ifdef WITH_MPI
+
+/* Standard includes. */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* This object's header. */
+#include "mpirma.h"
+
+/* Local includes. */
+#include "cell.h"
+#include "clocks.h"
+#include "error.h"
+#include "queue.h"
+#include "scheduler.h"
+#include "task.h"
+
+/*! Number of buckets of the hash tables of slots. */
+#define mpirma_nr_buckets 4096
+
+/*! Alignment of the slots in the window. */
+#define mpirma_align 8
+
+/*! Offsets of the counters in the header of a slot and size of the header. */
+#define mpirma_flag 0
+#define mpirma_consumed (1 * sizeof(long long))
+#define mpirma_size (2 * sizeof(long long))
+#define mpirma_header_size (3 * sizeof(long long))
+
+/**
+ * @brief Description of a slot sent to the rank that feeds it.
+ */
+struct mpirma_entry {
+
+  /*! The tag of the messages. */
+  long long tag;
+
+  /*! Offset of the slot in the window. */
+  size_t offset;
+
+  /*! Largest message the slot can hold. */
+  size_t capacity;
+
+  /*! The sub-type of the tasks. */
+  int subtype;
+
+  /*! Padding. */
+  int padding;
+};
+
+/**
+ * @brief Bucket of the hash tables of slots for a given message.
+ *
+ * @param rank The rank at the other end.
+ * @param subtype The sub-type of the task.
+ * @param tag The tag of the message.
+ */
+static size_t mpirma_bucket(const int rank, const int subtype,
+                            const long long tag) {
+  const unsigned long long key = ((unsigned long long)tag * task_subtype_count +
+                                  (unsigned long long)subtype) *
+                                     1000003ULL +
+                                 (unsigned long long)rank;
+  return (key ^ (key >> 17)) % mpirma_nr_buckets;
+}
+
+/**
+ * @brief Hand a task whose message has been exchanged back to the
+ * #scheduler.
+ *
+ * @param r The #mpirma.
+ * @param t The #task.
+ * @param qid The queue to insert the task into.
+ */
+static void mpirma_task_done(struct mpirma *r, struct task *t, const int qid) {
+
+  struct scheduler *s = r->s;
+  queue_insert(&s->queues[qid], t);
+
+  /* Wake up any runner waiting for a task. */
+  pthread_mutex_lock(&s->sleep_mutex);
+  pthread_cond_broadcast(&s->sleep_cond);
+  pthread_mutex_unlock(&s->sleep_mutex);
+}
+
+/**
+ * @brief Try to put the pending message of a slot into the window of the
+ * receiving rank.
+ *
+ * The message is only put once the previous one has been consumed. The data
+ * is flushed before the counter of messages is bumped, so the receiving rank
+ * never sees the counter before the data.
+ *
+ * @param r The #mpirma.
+ * @param slot The slot.
+ *
+ * @return Whether the message was put.
+ */
+static int mpirma_put(struct mpirma *r, struct mpirma_slot *slot) {
+
+  const int rank = slot->rank;
+  const MPI_Aint offset = (MPI_Aint)slot->offset;
+
+  long long consumed = 0;
+  int err = MPI_Fetch_and_op(NULL, &consumed, MPI_LONG_LONG, rank,
+                             offset + mpirma_consumed, MPI_NO_OP, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to read slot counter.");
+  if ((err = MPI_Win_flush(rank, r->win)) != MPI_SUCCESS)
+    mpi_error(err, "Failed to flush window.");
+  if (consumed < slot->seq) return 0;
+  if (consumed != slot->seq)
+    error("Inconsistent slot counters (%s tag=%lld: %lld != %lld).",
+          subtaskID_names[slot->subtype], slot->tag, consumed, slot->seq);
+
+  const long long size = (long long)slot->size;
+  if (size > 0) {
+    err = MPI_Put(slot->buff, (int)size, MPI_BYTE, rank,
+                  offset + mpirma_header_size, (int)size, MPI_BYTE, r->win);
+    if (err != MPI_SUCCESS) mpi_error(err, "Failed to put message.");
+  }
+  err = MPI_Put(&size, 1, MPI_LONG_LONG, rank, offset + mpirma_size, 1,
+                MPI_LONG_LONG, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to put message size.");
+  if ((err = MPI_Win_flush(rank, r->win)) != MPI_SUCCESS)
+    mpi_error(err, "Failed to flush window.");
+
+  /* Now tell the receiving rank the message is there. */
+  const long long seq = slot->seq + 1;
+  err = MPI_Accumulate(&seq, 1, MPI_LONG_LONG, rank, offset + mpirma_flag, 1,
+                       MPI_LONG_LONG, MPI_REPLACE, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to update slot counter.");
+  if ((err = MPI_Win_flush(rank, r->win)) != MPI_SUCCESS)
+    mpi_error(err, "Failed to flush window.");
+
+  slot->seq = seq;
+  return 1;
+}
+
+/**
+ * @brief Try to take the pending message of a slot out of our window.
+ *
+ * @param r The #mpirma.
+ * @param slot The slot.
+ *
+ * @return Whether the message had arrived.
+ */
+static int mpirma_get(struct mpirma *r, struct mpirma_slot *slot) {
+
+  const MPI_Aint offset = (MPI_Aint)slot->offset;
+
+  long long flag = 0;
+  int err = MPI_Fetch_and_op(NULL, &flag, MPI_LONG_LONG, r->rank,
+                             offset + mpirma_flag, MPI_NO_OP, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to read slot counter.");
+  if ((err = MPI_Win_flush(r->rank, r->win)) != MPI_SUCCESS)
+    mpi_error(err, "Failed to flush window.");
+  if (flag == slot->seq) return 0;
+  if (flag != slot->seq + 1)
+    error("Inconsistent slot counters (%s tag=%lld: %lld != %lld).",
+          subtaskID_names[slot->subtype], slot->tag, flag, slot->seq + 1);
+
+  /* Make sure we see the data put by the other rank. */
+  MPI_Win_sync(r->win);
+
+  const char *data = r->base + slot->offset;
+  const long long size = *(const long long *)(data + mpirma_size);
+  if (size != (long long)slot->size)
+    error("Mismatched size of message (%s tag=%lld: %zd != %lld).",
+          subtaskID_names[slot->subtype], slot->tag, slot->size, size);
+  if (size > 0) memcpy(slot->buff, data + mpirma_header_size, slot->size);
+
+  /* The slot can be written again. */
+  const long long seq = slot->seq + 1;
+  err = MPI_Accumulate(&seq, 1, MPI_LONG_LONG, r->rank,
+                       offset + mpirma_consumed, 1, MPI_LONG_LONG,
+                       MPI_REPLACE, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to update slot counter.");
+  if ((err = MPI_Win_flush(r->rank, r->win)) != MPI_SUCCESS)
+    mpi_error(err, "Failed to flush window.");
+
+  slot->seq = seq;
+  return 1;
+}
+
+/**
+ * @brief The progress thread.
+ *
+ * Sleeps while there are no messages to exchange, otherwise tries to put or
+ * take the pending messages and pokes the MPI progress engine then naps
+ * briefly when none could be.
+ *
+ * @param data The #mpirma.
+ */
+static void *mpirma_progress(void *data) {
+
+  struct mpirma *r = (struct mpirma *)data;
+  struct timespec nap;
+  nap.tv_sec = 0;
+  nap.tv_nsec = 1000;
+
+  pthread_mutex_lock(&r->lock);
+  while (!r->done) {
+
+    /* Nothing to do? Wait for a task to hand over a message. */
+    if (r->pending == NULL) {
+      pthread_cond_wait(&r->cond, &r->lock);
+      continue;
+    }
+    struct mpirma_slot *list = r->pending;
+    r->pending = NULL;
+    pthread_mutex_unlock(&r->lock);
+
+    int progress = 0;
+    struct mpirma_slot *left = NULL, *last = NULL;
+    while (list != NULL) {
+      struct mpirma_slot *slot = list;
+      list = slot->next_pending;
+
+      struct task *t = slot->t;
+      const int send = (t->type == task_type_send);
+      if (send ? mpirma_put(r, slot) : mpirma_get(r, slot)) {
+        slot->t = NULL;
+        if (send) r->nr_messages++;
+        mpirma_task_done(r, t, slot->qid);
+        progress = 1;
+      } else {
+        slot->next_pending = left;
+        if (left == NULL) last = slot;
+        left = slot;
+      }
+    }
+    /* The runners may all be waiting for messages of the window and no
+     * longer call MPI. Keep the two-sided messages progressing meanwhile. */
+    if (!progress) {
+      int flag = 0;
+      MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, r->comm, &flag,
+                 MPI_STATUS_IGNORE);
+      nanosleep(&nap, NULL);
+    }
+
+    /* Put the slots still waiting back in the list. */
+    pthread_mutex_lock(&r->lock);
+    if (left != NULL) {
+      last->next_pending = r->pending;
+      r->pending = left;
+    }
+  }
+  pthread_mutex_unlock(&r->lock);
+
+  return NULL;
+}
+
+/**
+ * @brief Release the window and the slots.
+ *
+ * @param r The #mpirma.
+ * @param finalized Whether MPI has been finalized already.
+ */
+static void mpirma_free_window(struct mpirma *r, const int finalized) {
+
+  if (r->have_win && !finalized) {
+    MPI_Win_unlock_all(r->win);
+    MPI_Win_free(&r->win);
+  }
+  r->have_win = 0;
+  r->base = NULL;
+
+  free(r->recv_slots);
+  free(r->send_slots);
+  r->recv_slots = NULL;
+  r->send_slots = NULL;
+  r->nr_recv_slots = 0;
+  r->nr_send_slots = 0;
+  memset(r->recv_table, 0, mpirma_nr_buckets * sizeof(struct mpirma_slot *));
+  memset(r->send_table, 0, mpirma_nr_buckets * sizeof(struct mpirma_slot *));
+}
+
+/**
+ * @brief Initialise the one-sided transport and start its progress thread.
+ *
+ * The window is only created by mpirma_rebuild(), once the tasks exist.
+ *
+ * @param r The #mpirma.
+ * @param s The #scheduler whose tasks we serve.
+ * @param nr_nodes The number of ranks.
+ * @param size_limit Largest message, in bytes, to send through the window.
+ */
+void mpirma_init(struct mpirma *r, struct scheduler *s, int nr_nodes,
+                 size_t size_limit) {
+
+  r->s = s;
+  r->nr_nodes = nr_nodes;
+  r->size_limit = size_limit;
+  r->have_win = 0;
+  r->base = NULL;
+  r->recv_slots = NULL;
+  r->send_slots = NULL;
+  r->nr_recv_slots = 0;
+  r->nr_send_slots = 0;
+  r->done = 0;
+  r->pending = NULL;
+  r->nr_messages = 0;
+
+  if (MPI_Comm_dup(MPI_COMM_WORLD, &r->comm) != MPI_SUCCESS)
+    error("Failed to create communicator for the RMA window.");
+  MPI_Comm_rank(r->comm, &r->rank);
+
+  r->recv_table = (struct mpirma_slot **)calloc(mpirma_nr_buckets,
+                                                sizeof(struct mpirma_slot *));
+  r->send_table = (struct mpirma_slot **)calloc(mpirma_nr_buckets,
+                                                sizeof(struct mpirma_slot *));
+  if (r->recv_table == NULL || r->send_table == NULL)
+    error("Failed to allocate tables of RMA slots.");
+
+  if (pthread_mutex_init(&r->lock, NULL) != 0 ||
+      pthread_cond_init(&r->cond, NULL) != 0)
+    error("Failed to initialise lock of RMA messages.");
+
+  if (pthread_create(&r->thread, NULL, &mpirma_progress, r) != 0)
+    error("Failed to create MPI progress thread.");
+}
+
+/**
+ * @brief Create the window for the current set of tasks.
+ *
+ * Gives a slot to every recv task whose message currently fits within the
+ * size limit, sends the layout of the slots to the ranks that feed them and
+ * creates the window. This is a collective call to make after the tasks and
+ * the foreign particles have been (re-)created.
+ *
+ * @param r The #mpirma.
+ * @param verbose Are we talkative?
+ */
+void mpirma_rebuild(struct mpirma *r, int verbose) {
+
+  const ticks tic = getticks();
+  const struct scheduler *s = r->s;
+  const int nr_nodes = r->nr_nodes;
+
+  pthread_mutex_lock(&r->lock);
+  if (r->pending != NULL)
+    error("Rebuilding the RMA window with messages still pending.");
+  pthread_mutex_unlock(&r->lock);
+
+  mpirma_free_window(r, /*finalized=*/0);
+
+  /* Count the slots we expose to each rank. */
+  int *counts_out = (int *)calloc(nr_nodes, sizeof(int));
+  int *counts_in = (int *)calloc(nr_nodes, sizeof(int));
+  int *displs_out = (int *)calloc(nr_nodes, sizeof(int));
+  int *displs_in = (int *)calloc(nr_nodes, sizeof(int));
+  if (counts_out == NULL || counts_in == NULL || displs_out == NULL ||
+      displs_in == NULL)
+    error("Failed to allocate counts of RMA slots.");
+
+  int nr_recv = 0;
+  for (int k = 0; k < s->nr_tasks; k++) {
+    const struct task *t = &s->tasks[k];
+    if (t->type != task_type_recv) continue;
+    if (scheduler_mpi_message_size(t) > r->size_limit) continue;
+    counts_out[t->ci->nodeID]++;
+    nr_recv++;
+  }
+  for (int k = 1; k < nr_nodes; k++)
+    displs_out[k] = displs_out[k - 1] + counts_out[k - 1];
+
+  /* Lay the slots out in our window. */
+  struct mpirma_entry *entries_out = (struct mpirma_entry *)malloc(
+      (nr_recv > 0 ? nr_recv : 1) * sizeof(struct mpirma_entry));
+  r->recv_slots = (struct mpirma_slot *)calloc(nr_recv > 0 ? nr_recv : 1,
+                                               sizeof(struct mpirma_slot));
+  if (entries_out == NULL || r->recv_slots == NULL)
+    error("Failed to allocate RMA slots.");
+
+  size_t total = 0;
+  for (int k = 0; k < s->nr_tasks; k++) {
+    const struct task *t = &s->tasks[k];
+    if (t->type != task_type_recv) continue;
+    const size_t size = scheduler_mpi_message_size(t);
+    if (size > r->size_limit) continue;
+
+    const int rank = t->ci->nodeID;
+    struct mpirma_entry *entry = &entries_out[displs_out[rank]++];
+    entry->tag = t->flags;
+    entry->offset = total;
+    entry->capacity = size;
+    entry->subtype = t->subtype;
+    entry->padding = 0;
+
+    struct mpirma_slot *slot = &r->recv_slots[r->nr_recv_slots++];
+    slot->tag = t->flags;
+    slot->subtype = t->subtype;
+    slot->rank = rank;
+    slot->offset = total;
+    slot->capacity = size;
+    const size_t bucket = mpirma_bucket(rank, t->subtype, t->flags);
+    slot->next = r->recv_table[bucket];
+    r->recv_table[bucket] = slot;
+
+    total += mpirma_header_size +
+             (size + mpirma_align - 1) / mpirma_align * mpirma_align;
+  }
+
+  /* Send the layout to the ranks that feed the slots. */
+  MPI_Alltoall(counts_out, 1, MPI_INT, counts_in, 1, MPI_INT, r->comm);
+  displs_out[0] = 0;
+  for (int k = 1; k < nr_nodes; k++)
+    displs_out[k] = displs_out[k - 1] + counts_out[k - 1];
+  int nr_send = 0;
+  for (int k = 0; k < nr_nodes; k++) {
+    displs_in[k] = nr_send;
+    nr_send += counts_in[k];
+  }
+  struct mpirma_entry *entries_in = (struct mpirma_entry *)malloc(
+      (nr_send > 0 ? nr_send : 1) * sizeof(struct mpirma_entry));
+  r->send_slots = (struct mpirma_slot *)calloc(nr_send > 0 ? nr_send : 1,
+                                               sizeof(struct mpirma_slot));
+  if (entries_in == NULL || r->send_slots == NULL)
+    error("Failed to allocate RMA slots.");
+
+  MPI_Datatype entry_type;
+  if (MPI_Type_contiguous(sizeof(struct mpirma_entry), MPI_BYTE,
+                          &entry_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&entry_type) != MPI_SUCCESS)
+    error("Failed to create MPI type for RMA slots.");
+  int err = MPI_Alltoallv(entries_out, counts_out, displs_out, entry_type,
+                          entries_in, counts_in, displs_in, entry_type,
+                          r->comm);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to exchange RMA slots.");
+  MPI_Type_free(&entry_type);
+
+  for (int rank = 0; rank < nr_nodes; rank++) {
+    for (int k = displs_in[rank]; k < displs_in[rank] + counts_in[rank];
+         k++) {
+      const struct mpirma_entry *entry = &entries_in[k];
+      struct mpirma_slot *slot = &r->send_slots[r->nr_send_slots++];
+      slot->tag = entry->tag;
+      slot->subtype = entry->subtype;
+      slot->rank = rank;
+      slot->offset = entry->offset;
+      slot->capacity = entry->capacity;
+      const size_t bucket = mpirma_bucket(rank, entry->subtype, entry->tag);
+      slot->next = r->send_table[bucket];
+      r->send_table[bucket] = slot;
+    }
+  }
+
+  free(entries_out);
+  free(entries_in);
+  free(counts_out);
+  free(counts_in);
+  free(displs_out);
+  free(displs_in);
+
+  /* Create the window with all the counters at zero. */
+  err = MPI_Win_allocate((MPI_Aint)total, 1, MPI_INFO_NULL, r->comm, &r->base,
+                         &r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to create RMA window.");
+  if (total > 0) memset(r->base, 0, total);
+  MPI_Barrier(r->comm);
+  err = MPI_Win_lock_all(MPI_MODE_NOCHECK, r->win);
+  if (err != MPI_SUCCESS) mpi_error(err, "Failed to lock RMA window.");
+  r->have_win = 1;
+
+  if (verbose)
+    message("Window of %zd KB for %d recv slots, %d send slots, took %.3f %s.",
+            total / 1024, r->nr_recv_slots, r->nr_send_slots,
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+}
+
+/**
+ * @brief Find the slot that will carry the message of a send or recv task.
+ *
+ * The sending and receiving ranks make the same choice as they know the same
+ * slots and the same size of message.
+ *
+ * @param r The #mpirma.
+ * @param t The send or recv #task.
+ * @param size The size of the message in bytes.
+ *
+ * @return The slot or NULL if the message has to be exchanged with two-sided
+ * MPI.
+ */
+struct mpirma_slot *mpirma_find(struct mpirma *r, const struct task *t,
+                                size_t size) {
+
+  if (!r->have_win || size > r->size_limit) return NULL;
+
+  int rank;
+  struct mpirma_slot **table;
+  if (t->type == task_type_send) {
+    rank = t->cj->nodeID;
+    table = r->send_table;
+  } else {
+    rank = t->ci->nodeID;
+    table = r->recv_table;
+  }
+
+  for (struct mpirma_slot *slot =
+           table[mpirma_bucket(rank, t->subtype, t->flags)];
+       slot != NULL; slot = slot->next) {
+    if (slot->rank == rank && slot->subtype == t->subtype &&
+        slot->tag == t->flags)
+      return size <= slot->capacity ? slot : NULL;
+  }
+  return NULL;
+}
+
+/**
+ * @brief Hand the message of a send or recv task over to the progress
+ * thread.
+ *
+ * The task is inserted in its queue once its message has been put into or
+ * taken out of the slot.
+ *
+ * @param r The #mpirma.
+ * @param slot The slot found by mpirma_find().
+ * @param t The send or recv #task.
+ * @param buff The data to send or the buffer to receive into.
+ * @param size The size of the message in bytes.
+ * @param qid The queue to insert the task into.
+ */
+void mpirma_post(struct mpirma *r, struct mpirma_slot *slot, struct task *t,
+                 void *buff, size_t size, int qid) {
+
+  pthread_mutex_lock(&r->lock);
+  if (slot->t != NULL)
+    error("Two messages pending in the same RMA slot (%s tag=%lld).",
+          subtaskID_names[t->subtype], t->flags);
+  slot->t = t;
+  slot->buff = buff;
+  slot->size = size;
+  slot->qid = qid;
+  slot->next_pending = r->pending;
+  r->pending = slot;
+  pthread_cond_signal(&r->cond);
+  pthread_mutex_unlock(&r->lock);
+}
+
+/**
+ * @brief Stop the progress thread and release the one-sided transport.
+ *
+ * @param r The #mpirma.
+ */
+void mpirma_clean(struct mpirma *r) {
+
+  pthread_mutex_lock(&r->lock);
+  r->done = 1;
+  pthread_cond_signal(&r->cond);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+
+  /* Release the window, unless MPI is gone already. */
+  int finalized = 0;
+  MPI_Finalized(&finalized);
+  mpirma_free_window(r, finalized);
+  if (!finalized) MPI_Comm_free(&r->comm);
+
+  free(r->recv_table);
+  free(r->send_table);
+
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->cond);
+}
+
+#endif /* WITH_MPI */
@@ -0,0 +1,151 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Peter W. Draper (p.w.draper@durham.ac.uk)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_MPIRMA_H
+#define SWIFT_MPIRMA_H
+
+/* Config parameters. */
+#include <config.h>
+
+#ifdef WITH_MPI
+
+/* MPI headers. */
+#include <mpi.h>
+
+/* Some standard headers. */
+#include <pthread.h>
+#include <stddef.h>
+
+/* Forward declarations. */
+struct scheduler;
+struct task;
+
+/**
+ * @brief A slot of the receive window, seen from the rank that receives
+ * through it or from the rank that sends into it.
+ *
+ * Each slot holds the messages of one recv task. It starts with a header of
+ * three counters (messages put, messages consumed and size of the last
+ * message) followed by the data.
+ */
+struct mpirma_slot {
+
+  /*! The tag of the messages (task flags). */
+  long long tag;
+
+  /*! The sub-type of the tasks. */
+  int subtype;
+
+  /*! The rank at the other end. */
+  int rank;
+
+  /*! Offset of the slot in the window of the receiving rank. */
+  size_t offset;
+
+  /*! Largest message, in bytes, the slot can hold. */
+  size_t capacity;
+
+  /*! Number of messages exchanged through the slot since it was created. */
+  long long seq;
+
+  /*! The task waiting for its message to be exchanged, if any. */
+  struct task *t;
+
+  /*! The data to send or the buffer to receive into. */
+  void *buff;
+
+  /*! The size of the pending message in bytes. */
+  size_t size;
+
+  /*! The queue the task goes to once the message is exchanged. */
+  int qid;
+
+  /*! Next slot in the same bucket of the hash table. */
+  struct mpirma_slot *next;
+
+  /*! Next slot with a pending message. */
+  struct mpirma_slot *next_pending;
+};
+
+/**
+ * @brief One-sided transport of the small task messages.
+ *
+ * Every rank exposes a window with one slot per recv task whose message is
+ * small enough. The layout of the window is sent to the ranks that feed it
+ * at every rebuild. Senders then put their data straight into the slot and
+ * bump its counter of messages, so no matching recv has to be posted and no
+ * rendezvous takes place. The slots are only written again once the
+ * receiving rank has consumed their previous message. A dedicated thread
+ * does the puts, watches the counters of the slots and inserts the tasks in
+ * the queues of the #scheduler once their message has been exchanged.
+ */
+struct mpirma {
+
+  /*! The #scheduler whose tasks we serve. */
+  struct scheduler *s;
+
+  /*! Communicator of the window. */
+  MPI_Comm comm;
+
+  /*! Number of ranks and our rank. */
+  int nr_nodes, rank;
+
+  /*! Largest message, in bytes, that goes through the window. */
+  size_t size_limit;
+
+  /*! The window and its local memory, if created. */
+  MPI_Win win;
+  char *base;
+  int have_win;
+
+  /*! Slots we receive through and slots we send into. */
+  struct mpirma_slot *recv_slots, *send_slots;
+  int nr_recv_slots, nr_send_slots;
+
+  /*! Hash tables of the slots. */
+  struct mpirma_slot **recv_table, **send_table;
+
+  /*! The progress thread. */
+  pthread_t thread;
+
+  /*! Lock and condition protecting the pending list. */
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+
+  /*! Should the progress thread stop? */
+  int done;
+
+  /*! Slots with a message waiting to be exchanged. */
+  struct mpirma_slot *pending;
+
+  /*! Number of task messages exchanged through the window so far. */
+  long long nr_messages;
+};
+
+void mpirma_init(struct mpirma *r, struct scheduler *s, int nr_nodes,
+                 size_t size_limit);
+void mpirma_rebuild(struct mpirma *r, int verbose);
+struct mpirma_slot *mpirma_find(struct mpirma *r, const struct task *t,
+                                size_t size);
+void mpirma_post(struct mpirma *r, struct mpirma_slot *slot, struct task *t,
+                 void *buff, size_t size, int qid);
+void mpirma_clean(struct mpirma *r);
+
+#endif /* WITH_MPI */
+
+#endif /* SWIFT_MPIRMA_H */
@@ -33,6 +33,7 @@
 
 /* MPI data type for the multipole transfer and reduction */
 MPI_Datatype multipole_mpi_type;
+MPI_Datatype multipole_compact_mpi_type;
 MPI_Op multipole_mpi_reduce_op;
 
 /**
@@ -81,6 +82,12 @@ void multipole_create_mpi_types(void) {
       MPI_Type_commit(&multipole_mpi_type) != MPI_SUCCESS) {
     error("Failed to create MPI type for multipole.");
   }
+  if (MPI_Type_contiguous(sizeof(struct gravity_tensors_compact) /
+                              sizeof(unsigned char),
+                          MPI_BYTE, &multipole_compact_mpi_type) != MPI_SUCCESS ||
+      MPI_Type_commit(&multipole_compact_mpi_type) != MPI_SUCCESS) {
+    error("Failed to create MPI type for compact multipole.");
+  }
 
   /* And the reduction operator */
   MPI_Op_create(gravity_tensors_mpi_reduce, 1, &multipole_mpi_reduce_op);
@@ -88,6 +95,7 @@ void multipole_create_mpi_types(void) {
 
 void multipole_free_mpi_types(void) {
   MPI_Type_free(&multipole_mpi_type);
+  MPI_Type_free(&multipole_compact_mpi_type);
   MPI_Op_free(&multipole_mpi_reduce_op);
 }
 #endif
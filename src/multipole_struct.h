@@ -219,6 +219,35 @@ struct gravity_tensors {
   };
 } SWIFT_STRUCT_ALIGN;
 
+/**
+ * @brief Compact form of the #gravity_tensors of a top-level cell used when
+ * exchanging them between ranks.
+ *
+ * The positions are stored in single precision relative to the centre of the
+ * cell. The field tensor only makes sense on the rank owning the cell and is
+ * not sent.
+ */
+struct gravity_tensors_compact {
+
+  /*! Multipole mass */
+  struct multipole m_pole;
+
+  /*! Centre of mass relative to the centre of the cell */
+  float CoM[3];
+
+  /*! Centre of mass at the last rebuild relative to the centre of the cell */
+  float CoM_rebuild[3];
+
+  /*! Upper limit of the CoM<->gpart distance */
+  float r_max;
+
+  /*! Upper limit of the CoM<->gpart distance at the last rebuild */
+  float r_max_rebuild;
+
+  /*! Index of the top-level cell */
+  int cid;
+};
+
 /**
  * @brief Values returned by the M2P kernel.
  */
@@ -236,6 +265,7 @@ struct reduced_grav_tensor {
 #ifdef WITH_MPI
 /* MPI datatypes for transfers */
 extern MPI_Datatype multipole_mpi_type;
+extern MPI_Datatype multipole_compact_mpi_type;
 extern MPI_Op multipole_mpi_reduce_op;
 
 void multipole_create_mpi_types(void);
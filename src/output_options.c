@@ -34,6 +34,7 @@
 #include "common_io.h"
 #include "error.h"
 #include "parser.h"
+#include "space.h"
 
 /**
  * @brief Initialise the output options struct with the information read
@@ -122,6 +123,10 @@ void output_options_struct_dump(struct output_options* output_options,
   restart_write_blocks(output_options->subsample_fractions,
                        count_sub * sizeof(float), 1, stream,
                        "output_options_subsample_fractions", "output options");
+
+  restart_write_blocks(output_options->regions, sizeof(struct output_region),
+                       OUTPUT_LIST_MAX_NUM_OF_SELECT_OUTPUT_STYLES + 1, stream,
+                       "output_options_regions", "output options");
 }
 
 /**
@@ -159,6 +164,10 @@ void output_options_struct_restore(struct output_options* output_options,
   restart_read_blocks(output_options->subsample_fractions,
                       count_sub * sizeof(float), 1, stream, NULL,
                       "output_options_subsample_fractions");
+
+  restart_read_blocks(output_options->regions, sizeof(struct output_region),
+                      OUTPUT_LIST_MAX_NUM_OF_SELECT_OUTPUT_STYLES + 1, stream,
+                      NULL, "output_options_regions");
 }
 
 /**
@@ -415,3 +424,52 @@ void output_options_get_subsampling(
            sizeof(float) * swift_type_count);
   }
 }
+
+/**
+ * @brief Return the region of interest of the current output selection.
+ *
+ * @param output_options The #output_options structure.
+ * @param selection_name The current output selection name.
+ * @param s The #space we are writing.
+ * @param region (return) The region of interest.
+ *
+ * @return A pointer to region or NULL if the whole volume is written.
+ */
+const struct output_region* output_options_get_region(
+    const struct output_options* output_options, const char* selection_name,
+    const struct space* s, struct output_region* region) {
+
+  /* Get the ID of the output selection in the structure */
+  int selection_id =
+      parser_get_section_id(output_options->select_output, selection_name);
+
+  /* Special treatment for absent `Default` section */
+  if (selection_id < 0) {
+    selection_id = output_options->select_output->sectionCount;
+  }
+
+  if (output_options->regions[selection_id].type == output_region_none)
+    return NULL;
+
+  memcpy(region, &output_options->regions[selection_id],
+         sizeof(struct output_region));
+
+  /* Attach the box the region lives in */
+  for (int k = 0; k < 3; ++k) region->dim[k] = s->dim[k];
+  region->periodic = s->periodic;
+  region->s = s;
+
+  /* The box wrapping only works for regions smaller than half the box */
+  for (int k = 0; k < 3; ++k) {
+    const double extent = region->type == output_region_sphere
+                              ? region->radius
+                              : region->half_size[k];
+    if (region->periodic && extent > 0.5 * region->dim[k])
+      error(
+          "The region of interest of output selection '%s' is larger than "
+          "half the box size.",
+          selection_name);
+  }
+
+  return region;
+}
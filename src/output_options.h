@@ -20,11 +20,19 @@
 #define SWIFT_OUTPUT_OPTIONS_H
 
 /* Local headers. */
+#include "inline.h"
 #include "io_compression.h"
 #include "output_list.h"
 #include "part_type.h"
+#include "periodic.h"
 #include "restart.h"
 
+/* Standard headers. */
+#include <math.h>
+
+/* Pre-declarations */
+struct space;
+
 /*! Default value for SelectOutput */
 #define compression_level_default compression_write_lossless
 
@@ -35,6 +43,128 @@
 #define select_output_default_subsample -1
 #define select_output_default_subsample_fraction -1.f
 
+/**
+ * @brief The shapes of region of interest an output selection can be
+ * restricted to.
+ */
+enum output_region_type {
+  output_region_none = 0, /* Full volume */
+  output_region_sphere,
+  output_region_box,
+};
+
+/**
+ * @brief A region of interest (in internal comoving co-ordinates) an output
+ * selection is restricted to.
+ */
+struct output_region {
+
+  /*! The shape of the region */
+  enum output_region_type type;
+
+  /*! The centre of the region */
+  double centre[3];
+
+  /*! The radius of the region (sphere) */
+  double radius;
+
+  /*! The half-side lengths of the region (box) */
+  double half_size[3];
+
+  /*! The dimensions of the simulation box */
+  double dim[3];
+
+  /*! Is the simulation box periodic? */
+  int periodic;
+
+  /*! The #space whose cells are used to locate the region */
+  const struct space* s;
+};
+
+/**
+ * @brief Distance vector from the centre of an #output_region to a position,
+ * taking the box wrapping into account.
+ *
+ * @param region The #output_region.
+ * @param x The position.
+ * @param dx (return) The distance vector.
+ */
+__attribute__((always_inline)) INLINE static void output_region_distance(
+    const struct output_region* region, const double x[3], double dx[3]) {
+
+  for (int k = 0; k < 3; ++k) {
+    dx[k] = x[k] - region->centre[k];
+    if (region->periodic) dx[k] = nearest(dx[k], region->dim[k]);
+  }
+}
+
+/**
+ * @brief Is a position inside an #output_region?
+ *
+ * @param region The #output_region.
+ * @param x The position.
+ */
+__attribute__((always_inline)) INLINE static int output_region_contains(
+    const struct output_region* region, const double x[3]) {
+
+  double dx[3];
+  output_region_distance(region, x, dx);
+
+  if (region->type == output_region_sphere)
+    return dx[0] * dx[0] + dx[1] * dx[1] + dx[2] * dx[2] <=
+           region->radius * region->radius;
+
+  return fabs(dx[0]) <= region->half_size[0] &&
+         fabs(dx[1]) <= region->half_size[1] &&
+         fabs(dx[2]) <= region->half_size[2];
+}
+
+/**
+ * @brief How does a cell overlap an #output_region?
+ *
+ * @param region The #output_region.
+ * @param loc The bottom-left corner of the cell.
+ * @param width The width of the cell.
+ *
+ * @return 0 if the cell is entirely outside the region, 2 if it is entirely
+ * inside and 1 otherwise.
+ */
+__attribute__((always_inline)) INLINE static int output_region_overlap(
+    const struct output_region* region, const double loc[3],
+    const double width[3]) {
+
+  /* Distance from the centre of the region to the centre of the cell */
+  const double centre[3] = {loc[0] + 0.5 * width[0], loc[1] + 0.5 * width[1],
+                            loc[2] + 0.5 * width[2]};
+  double dx[3];
+  output_region_distance(region, centre, dx);
+
+  /* Distance to the closest and furthest points of the cell along each axis */
+  double d_min[3], d_max[3];
+  for (int k = 0; k < 3; ++k) {
+    d_min[k] = fabs(dx[k]) - 0.5 * width[k];
+    if (d_min[k] < 0.) d_min[k] = 0.;
+    d_max[k] = fabs(dx[k]) + 0.5 * width[k];
+  }
+
+  if (region->type == output_region_sphere) {
+    const double r2 = region->radius * region->radius;
+    if (d_min[0] * d_min[0] + d_min[1] * d_min[1] + d_min[2] * d_min[2] > r2)
+      return 0;
+    if (d_max[0] * d_max[0] + d_max[1] * d_max[1] + d_max[2] * d_max[2] <= r2)
+      return 2;
+    return 1;
+  }
+
+  if (d_min[0] > region->half_size[0] || d_min[1] > region->half_size[1] ||
+      d_min[2] > region->half_size[2])
+    return 0;
+  if (d_max[0] <= region->half_size[0] && d_max[1] <= region->half_size[1] &&
+      d_max[2] <= region->half_size[2])
+    return 2;
+  return 1;
+}
+
 /**
  * @brief Output selection properties, including the parsed files.
  **/
@@ -72,6 +202,10 @@ struct output_options {
    * snapshot section of the param file. */
   float subsample_fractions[OUTPUT_LIST_MAX_NUM_OF_SELECT_OUTPUT_STYLES + 1]
                            [swift_type_count];
+
+  /*! Region of interest the snapshots of the given selection are restricted
+   * to (output_region_none for the full volume). */
+  struct output_region regions[OUTPUT_LIST_MAX_NUM_OF_SELECT_OUTPUT_STYLES + 1];
 };
 
 /* Create and destroy */
@@ -113,4 +247,8 @@ void output_options_get_subsampling(
     const float default_subsample_fraction[swift_type_count],
     int subsample[swift_type_count],
     float subsample_fraction[swift_type_count]);
+
+const struct output_region* output_options_get_region(
+    const struct output_options* output_options, const char* selection_name,
+    const struct space* s, struct output_region* region);
 #endif
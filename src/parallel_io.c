@@ -80,8 +80,10 @@ static const int io_max_size_output_list = 100;
  * @param h_data The HDF5 dataset to write to.
  * @param h_plist_id the parallel HDF5 properties.
  * @param props The #io_props of the field to read.
- * @param N The number of particles to write.
- * @param offset Offset in the array where this mpi task starts writing.
+ * @param N The number of particles to read.
+ * @param num_runs The number of contiguous runs of particles to read.
+ * @param run_offsets The offset in the array of each run.
+ * @param run_counts The number of particles in each run.
  * @param internal_units The #unit_system used internally.
  * @param ic_units The #unit_system used in the snapshots.
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -92,7 +94,9 @@ static const int io_max_size_output_list = 100;
  */
 void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
                                const struct io_props props, size_t N,
-                               long long offset,
+                               const int num_runs,
+                               const long long* run_offsets,
+                               const long long* run_counts,
                                const struct unit_system* internal_units,
                                const struct unit_system* ic_units,
                                int cleanup_h, int cleanup_sqrt_a, double h,
@@ -117,22 +121,28 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
     rank = 2;
     shape[0] = N;
     shape[1] = props.dimension;
-    offsets[0] = offset;
+    offsets[0] = 0;
     offsets[1] = 0;
   } else {
     rank = 2;
     shape[0] = N;
     shape[1] = 1;
-    offsets[0] = offset;
+    offsets[0] = 0;
     offsets[1] = 0;
   }
 
   /* Create data space in memory */
   const hid_t h_memspace = H5Screate_simple(rank, shape, NULL);
 
-  /* Select hyper-slab in file */
+  /* Select the union of the runs' hyper-slabs in file */
   const hid_t h_filespace = H5Dget_space(h_data);
-  H5Sselect_hyperslab(h_filespace, H5S_SELECT_SET, offsets, NULL, shape, NULL);
+  if (num_runs == 0) H5Sselect_none(h_filespace);
+  for (int r = 0; r < num_runs; ++r) {
+    hsize_t run_shape[2] = {(hsize_t)run_counts[r], shape[1]};
+    offsets[0] = run_offsets[r];
+    H5Sselect_hyperslab(h_filespace, r == 0 ? H5S_SELECT_SET : H5S_SELECT_OR,
+                        offsets, NULL, run_shape, NULL);
+  }
 
   /* Read HDF5 dataspace in temporary buffer */
   /* Dirty version that happens to work for vectors but should be improved */
@@ -238,7 +248,10 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
  * @param N The number of particles on that rank.
  * @param N_total The total number of particles.
  * @param mpi_rank The MPI rank of this node.
- * @param offset The offset in the array on disk for this rank.
+ * @param num_runs The number of contiguous runs of particles read by this
+ * rank.
+ * @param run_offsets The offset in the array on disk of each run.
+ * @param run_counts The number of particles in each run.
  * @param internal_units The #unit_system used internally.
  * @param ic_units The #unit_system used in the ICs.
  * @param cleanup_h Are we removing h-factors from the ICs?
@@ -248,7 +261,9 @@ void read_array_parallel_chunk(hid_t h_data, hid_t h_plist_id,
  * @param a The current value of the scale-factor.
  */
 void read_array_parallel(hid_t grp, struct io_props props, size_t N,
-                         long long N_total, int mpi_rank, long long offset,
+                         long long N_total, int mpi_rank, const int num_runs,
+                         const long long* run_offsets,
+                         const long long* run_counts,
                          const struct unit_system* internal_units,
                          const struct unit_system* ic_units, int cleanup_h,
                          int cleanup_sqrt_a, double h, double a) {
@@ -337,8 +352,18 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
   const hid_t h_plist_id = H5Pcreate(H5P_DATASET_XFER);
   H5Pset_dxpl_mpio(h_plist_id, H5FD_MPIO_COLLECTIVE);
 
+  /* The (pieces of) runs read in one pass */
+  long long* chunk_offsets =
+      (long long*)malloc(max(num_runs, 1) * sizeof(long long));
+  long long* chunk_counts =
+      (long long*)malloc(max(num_runs, 1) * sizeof(long long));
+  if (chunk_offsets == NULL || chunk_counts == NULL)
+    error("Unable to allocate memory for the list of runs");
+
   /* Given the limitations of ROM-IO we will need to read the data in chunk of
      HDF5_PARALLEL_IO_MAX_BYTES bytes per node until all the nodes are done. */
+  int run = 0;
+  long long run_done = 0;
   char redo = 1;
   while (redo) {
 
@@ -346,28 +371,41 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
     const size_t max_chunk_size =
         HDF5_PARALLEL_IO_MAX_BYTES / (props.dimension * typeSize);
 
-    /* Write the first chunk */
-    const size_t this_chunk = (N > max_chunk_size) ? max_chunk_size : N;
-    read_array_parallel_chunk(h_data, h_plist_id, props, this_chunk, offset,
+    /* Collect the runs (or the parts thereof) fitting in this chunk */
+    size_t this_chunk = 0;
+    int num_chunk_runs = 0;
+    while (run < num_runs && this_chunk < max_chunk_size) {
+      const long long left = run_counts[run] - run_done;
+      const long long room = max_chunk_size - this_chunk;
+      const long long take = min(left, room);
+      if (take > 0) {
+        chunk_offsets[num_chunk_runs] = run_offsets[run] + run_done;
+        chunk_counts[num_chunk_runs] = take;
+        num_chunk_runs++;
+      }
+      this_chunk += take;
+      run_done += take;
+      if (run_done == run_counts[run]) {
+        run++;
+        run_done = 0;
+      }
+    }
+
+    /* Read this chunk */
+    read_array_parallel_chunk(h_data, h_plist_id, props, this_chunk,
+                              num_chunk_runs, chunk_offsets, chunk_counts,
                               internal_units, ic_units, cleanup_h,
                               cleanup_sqrt_a, h, a);
 
-    /* Compute how many items are left */
-    if (N > max_chunk_size) {
-      N -= max_chunk_size;
-      props.field += max_chunk_size * props.partSize; /* char* on the field */
-      props.parts += max_chunk_size;                  /* part* on the part */
-      props.xparts += max_chunk_size;                 /* xpart* on the xpart */
-      props.gparts += max_chunk_size;                 /* gpart* on the gpart */
-      props.sparts += max_chunk_size;                 /* spart* on the spart */
-      props.bparts += max_chunk_size;                 /* bpart* on the bpart */
-      offset += max_chunk_size;
-      redo = 1;
-    } else {
-      N = 0;
-      offset += 0;
-      redo = 0;
-    }
+    /* Move on to the next chunk */
+    N -= this_chunk;
+    props.field += this_chunk * props.partSize; /* char* on the field */
+    props.parts += this_chunk;                  /* part* on the part */
+    props.xparts += this_chunk;                 /* xpart* on the xpart */
+    props.gparts += this_chunk;                 /* gpart* on the gpart */
+    props.sparts += this_chunk;                 /* spart* on the spart */
+    props.bparts += this_chunk;                 /* bpart* on the bpart */
+    redo = (run < num_runs);
 
     /* Do we need to run again ? */
     MPI_Allreduce(MPI_IN_PLACE, &redo, 1, MPI_SIGNED_CHAR, MPI_MAX,
@@ -377,7 +415,13 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
       message("Need to redo one iteration for array '%s'", props.name);
   }
 
+#ifdef SWIFT_DEBUG_CHECKS
+  if (N != 0) error("Not all the particles of '%s' were read.", props.name);
+#endif
+
   /* Close everything */
+  free(chunk_offsets);
+  free(chunk_counts);
   H5Pclose(h_plist_id);
   H5Dclose(h_data);
 }
@@ -392,6 +436,8 @@ void read_array_parallel(hid_t grp, struct io_props props, size_t N,
  * @param partTypeGroupName The name of the group we are writing to.
  * @param props The #io_props of the field to write.
  * @param N_total The total number of particles to write in this array.
+ * @param lossy_compression Level of lossy compression to use for this field.
+ * @param chunk_size The number of particles per chunk (0 for the default).
  * @param snapshot_units The units used for the data in this snapshot.
  */
 void prepare_array_parallel(
@@ -399,7 +445,7 @@ void prepare_array_parallel(
     const char* partTypeGroupName, const struct io_props props,
     const long long N_total,
     const enum lossy_compression_schemes lossy_compression,
-    const struct unit_system* snapshot_units) {
+    const long long chunk_size, const struct unit_system* snapshot_units) {
 
   /* Create data space */
   const hid_t h_space = H5Screate(H5S_SIMPLE);
@@ -423,6 +469,9 @@ void prepare_array_parallel(
     chunk_shape[1] = 0;
   }
 
+  /* Use the chunk size aligned on the top-level cells if we have one */
+  if (chunk_size > 0) chunk_shape[0] = chunk_size;
+
   /* Make sure the chunks are not larger than the dataset */
   if ((long long)chunk_shape[0] > N_total) chunk_shape[0] = N_total;
 
@@ -689,12 +738,16 @@ void write_array_parallel(const struct engine* e, hid_t grp,
     /* Compute how many items are left */
     if (N > max_chunk_size) {
       N -= max_chunk_size;
-      props.field += max_chunk_size * props.partSize; /* char* on the field */
-      props.parts += max_chunk_size;                  /* part* on the part */
-      props.xparts += max_chunk_size;                 /* xpart* on the xpart */
-      props.gparts += max_chunk_size;                 /* gpart* on the gpart */
-      props.sparts += max_chunk_size;                 /* spart* on the spart */
-      props.bparts += max_chunk_size;                 /* bpart* on the bpart */
+      if (props.index != NULL) {
+        props.index += max_chunk_size; /* size_t* on the indices */
+      } else {
+        props.field += max_chunk_size * props.partSize; /* char* on field */
+        props.parts += max_chunk_size;                  /* part* on part */
+        props.xparts += max_chunk_size;                 /* xpart* on xpart */
+        props.gparts += max_chunk_size;                 /* gpart* on gpart */
+        props.sparts += max_chunk_size;                 /* spart* on spart */
+        props.bparts += max_chunk_size;                 /* bpart* on bpart */
+      }
       offset += max_chunk_size;
       redo = 1;
     } else {
@@ -722,6 +775,179 @@ void write_array_parallel(const struct engine* e, hid_t grp,
 #endif
 }
 
+/**
+ * @brief Comparison function used to sort runs of particles by offset.
+ */
+static int read_ic_run_compare(const void* a, const void* b) {
+  const long long* run_a = (const long long*)a;
+  const long long* run_b = (const long long*)b;
+  if (run_a[0] < run_b[0]) return -1;
+  if (run_a[0] > run_b[0]) return 1;
+  return 0;
+}
+
+/**
+ * @brief Construct the list of runs of particles to read on this rank from the
+ * top-level cell meta-data of the ICs.
+ *
+ * The top-level cells of the ICs are assigned to the ranks based on the
+ * position of their centre in a regular grid of ranks, the same way
+ * the "grid" initial partition assigns the cells of the #space. Each rank then
+ * reads the particles of its cells, which avoids a full all-to-all exchange
+ * of the particles when the domain decomposition is first applied.
+ *
+ * @param h_file The (opened) ICs file.
+ * @param box The size of the box in the units of the ICs.
+ * @param grid The number of ranks along each axis.
+ * @param N_total The total number of particles of each type in the ICs.
+ * @param mpi_rank The MPI rank of this node.
+ * @param N (output) The number of particles of each type to read on this rank.
+ * @param num_runs (output) The number of runs of particles of each type.
+ * @param run_offsets (output) The offset in the arrays of each run.
+ * @param run_counts (output) The number of particles in each run.
+ *
+ * @return 1 if the ICs contain the meta-data required, 0 otherwise (in which
+ * case nothing is returned).
+ */
+static int read_ic_parallel_cell_runs(
+    hid_t h_file, const double box[3], const int grid[3],
+    const long long N_total[swift_type_count], const int mpi_rank,
+    size_t N[swift_type_count], int num_runs[swift_type_count],
+    long long* run_offsets[swift_type_count],
+    long long* run_counts[swift_type_count]) {
+
+  /* Do we have the cell meta-data? */
+  if (H5Lexists(h_file, "/Cells", H5P_DEFAULT) <= 0) return 0;
+  const hid_t h_grp = H5Gopen(h_file, "/Cells", H5P_DEFAULT);
+  if (h_grp < 0) error("Error while opening the cells group");
+
+  const char* groups[4] = {"Meta-data", "Centres", "Counts", "OffsetsInFile"};
+  for (int k = 0; k < 4; ++k) {
+    if (H5Lexists(h_grp, groups[k], H5P_DEFAULT) <= 0) {
+      H5Gclose(h_grp);
+      return 0;
+    }
+  }
+
+  /* Read the number of cells and their centres */
+  const hid_t h_meta = H5Gopen(h_grp, "Meta-data", H5P_DEFAULT);
+  if (h_meta < 0) error("Error while opening the cells meta-data group");
+  int nr_cells = 0;
+  io_read_attribute(h_meta, "nr_cells", INT, &nr_cells);
+  H5Gclose(h_meta);
+
+  double* centres = (double*)malloc(3 * nr_cells * sizeof(double));
+  long long* counts = (long long*)malloc(nr_cells * sizeof(long long));
+  long long* offsets = (long long*)malloc(nr_cells * sizeof(long long));
+  int* owner = (int*)malloc(nr_cells * sizeof(int));
+  if (centres == NULL || counts == NULL || offsets == NULL || owner == NULL)
+    error("Unable to allocate memory for the cell meta-data");
+
+  io_read_array_dataset(h_grp, "Centres", DOUBLE, centres, 3 * nr_cells);
+
+  /* Which rank owns each cell? */
+  for (int i = 0; i < nr_cells; ++i) {
+    int ind[3];
+    for (int j = 0; j < 3; ++j) {
+      ind[j] = (int)(centres[i * 3 + j] / box[j] * grid[j]);
+      if (ind[j] < 0) ind[j] = 0;
+      if (ind[j] >= grid[j]) ind[j] = grid[j] - 1;
+    }
+    owner[i] = ind[0] + grid[0] * (ind[1] + grid[1] * ind[2]);
+  }
+
+  const hid_t h_counts = H5Gopen(h_grp, "Counts", H5P_DEFAULT);
+  const hid_t h_offsets = H5Gopen(h_grp, "OffsetsInFile", H5P_DEFAULT);
+  if (h_counts < 0 || h_offsets < 0)
+    error("Error while opening the cell counts and offsets groups");
+
+  int success = 1;
+  for (int ptype = 0; ptype < swift_type_count && success; ++ptype) {
+
+    N[ptype] = 0;
+    num_runs[ptype] = 0;
+    run_offsets[ptype] = NULL;
+    run_counts[ptype] = NULL;
+
+    if (N_total[ptype] == 0) continue;
+
+    char name[PARTICLE_GROUP_BUFFER_SIZE];
+    snprintf(name, PARTICLE_GROUP_BUFFER_SIZE, "PartType%d", ptype);
+    if (H5Lexists(h_counts, name, H5P_DEFAULT) <= 0 ||
+        H5Lexists(h_offsets, name, H5P_DEFAULT) <= 0) {
+      success = 0;
+      break;
+    }
+
+    io_read_array_dataset(h_counts, name, LONGLONG, counts, nr_cells);
+    io_read_array_dataset(h_offsets, name, LONGLONG, offsets, nr_cells);
+
+    /* The cells must cover the whole array (i.e. not a multi-file set) */
+    long long count_total = 0;
+    for (int i = 0; i < nr_cells; ++i) count_total += counts[i];
+    if (count_total != N_total[ptype]) {
+      success = 0;
+      break;
+    }
+
+    /* Collect the (offset, count) pairs of our cells */
+    long long* runs = (long long*)malloc(2 * nr_cells * sizeof(long long));
+    if (runs == NULL) error("Unable to allocate memory for the runs");
+    int n = 0;
+    for (int i = 0; i < nr_cells; ++i) {
+      if (owner[i] != mpi_rank || counts[i] == 0) continue;
+      runs[2 * n + 0] = offsets[i];
+      runs[2 * n + 1] = counts[i];
+      n++;
+    }
+
+    /* Sort them and merge the adjacent ones */
+    qsort(runs, n, 2 * sizeof(long long), read_ic_run_compare);
+    int num = 0;
+    for (int r = 0; r < n; ++r) {
+      if (num > 0 &&
+          runs[2 * (num - 1) + 0] + runs[2 * (num - 1) + 1] == runs[2 * r]) {
+        runs[2 * (num - 1) + 1] += runs[2 * r + 1];
+      } else {
+        runs[2 * num + 0] = runs[2 * r + 0];
+        runs[2 * num + 1] = runs[2 * r + 1];
+        num++;
+      }
+    }
+
+    run_offsets[ptype] = (long long*)malloc(max(num, 1) * sizeof(long long));
+    run_counts[ptype] = (long long*)malloc(max(num, 1) * sizeof(long long));
+    if (run_offsets[ptype] == NULL || run_counts[ptype] == NULL)
+      error("Unable to allocate memory for the runs");
+    for (int r = 0; r < num; ++r) {
+      run_offsets[ptype][r] = runs[2 * r + 0];
+      run_counts[ptype][r] = runs[2 * r + 1];
+      N[ptype] += runs[2 * r + 1];
+    }
+    num_runs[ptype] = num;
+    free(runs);
+  }
+
+  /* Undo everything if we could not use the meta-data */
+  if (!success) {
+    for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+      free(run_offsets[ptype]);
+      free(run_counts[ptype]);
+      run_offsets[ptype] = NULL;
+      run_counts[ptype] = NULL;
+    }
+  }
+
+  H5Gclose(h_counts);
+  H5Gclose(h_offsets);
+  H5Gclose(h_grp);
+  free(centres);
+  free(counts);
+  free(offsets);
+  free(owner);
+  return success;
+}
+
 /**
  * @brief Reads an HDF5 initial condition file (GADGET-3 type) in parallel
  *
@@ -762,6 +988,9 @@ void write_array_parallel(const struct engine* e, hid_t grp,
  * @param dry_run If 1, don't read the particle. Only allocates the arrays.
  * @param remap_ids Are we ignoring the ICs' IDs and remapping them to [1, N[ ?
  * @param ics_metadata Will store metadata group copied from the ICs file
+ * @param read_grid If not NULL, the number of ranks along each axis of the
+ * regular grid used to read the particles by top-level cells (when the ICs
+ * contain the cell meta-data).
  *
  */
 void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
@@ -777,7 +1006,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       const int cleanup_sqrt_a, const double h, const double a,
                       const int mpi_rank, const int mpi_size, MPI_Comm comm,
                       MPI_Info info, const int n_threads, const int dry_run,
-                      const int remap_ids, struct ic_info* ics_metadata) {
+                      const int remap_ids, struct ic_info* ics_metadata,
+                      const int* read_grid) {
 
   hid_t h_file = 0, h_grp = 0;
   /* GADGET has only cubic boxes (in cosmological mode) */
@@ -787,6 +1017,9 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   size_t N[swift_type_count] = {0};
   long long N_total[swift_type_count] = {0};
   long long offset[swift_type_count] = {0};
+  int num_runs[swift_type_count] = {0};
+  long long* run_offsets[swift_type_count] = {NULL};
+  long long* run_counts[swift_type_count] = {NULL};
   int dimension = 3; /* Assume 3D if nothing is specified */
   size_t Ndm = 0;
   size_t Ndm_background = 0;
@@ -863,6 +1096,9 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   else if (hydro_dimension == 1)
     dim[2] = dim[1] = dim[0];
 
+  /* Box size in the units of the ICs */
+  const double box_ics[3] = {dim[0], dim[1], dim[2]};
+
   /* Convert the box size if we want to clean-up h-factors */
   if (cleanup_h) {
     dim[0] /= h;
@@ -873,10 +1109,38 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
   /* message("Found %lld particles in a %speriodic box of size [%f %f %f].", */
   /* 	  N_total[0], (periodic ? "": "non-"), dim[0], dim[1], dim[2]); */
 
-  /* Divide the particles among the tasks. */
-  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
-    offset[ptype] = mpi_rank * N_total[ptype] / mpi_size;
-    N[ptype] = (mpi_rank + 1) * N_total[ptype] / mpi_size - offset[ptype];
+  /* Read the particles by top-level cells if we can */
+  int read_by_cells = 0;
+  if (read_grid != NULL) {
+    read_by_cells =
+        read_ic_parallel_cell_runs(h_file, box_ics, read_grid, N_total,
+                                   mpi_rank, N, num_runs, run_offsets,
+                                   run_counts);
+    if (mpi_rank == 0) {
+      if (read_by_cells)
+        message("Reading the particles by top-level cells on a [%d %d %d] "
+                "grid of ranks.",
+                read_grid[0], read_grid[1], read_grid[2]);
+      else
+        message("No top-level cell meta-data in the ICs. Reading the "
+                "particles in contiguous slabs.");
+    }
+  }
+
+  /* Otherwise, divide the particles among the tasks. */
+  if (!read_by_cells) {
+    for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+      offset[ptype] = mpi_rank * N_total[ptype] / mpi_size;
+      N[ptype] = (mpi_rank + 1) * N_total[ptype] / mpi_size - offset[ptype];
+
+      num_runs[ptype] = 1;
+      run_offsets[ptype] = (long long*)malloc(sizeof(long long));
+      run_counts[ptype] = (long long*)malloc(sizeof(long long));
+      if (run_offsets[ptype] == NULL || run_counts[ptype] == NULL)
+        error("Unable to allocate memory for the runs");
+      run_offsets[ptype][0] = offset[ptype];
+      run_counts[ptype][0] = N[ptype];
+    }
   }
 
   /* Close header */
@@ -1080,7 +1344,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
 
         /* Read array. */
         read_array_parallel(h_grp, list[i], Nparticles, N_total[ptype],
-                            mpi_rank, offset[ptype], internal_units, ic_units,
+                            mpi_rank, num_runs[ptype], run_offsets[ptype],
+                            run_counts[ptype], internal_units, ic_units,
                             cleanup_h, cleanup_sqrt_a, h, a);
       }
 
@@ -1136,6 +1401,10 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
 
   /* Clean up */
   free(ic_units);
+  for (int ptype = 0; ptype < swift_type_count; ++ptype) {
+    free(run_offsets[ptype]);
+    free(run_counts[ptype]);
+  }
 
   /* Close property handler */
   H5Pclose(h_plist_id);
@@ -1152,22 +1421,28 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
  * @param N_total The total number of particles of each type to write.
  * @param to_write Whether or not specific particle types must be written.
  * @param numFields The number of fields to write for each particle type.
+ * @param chunk_sizes The number of particles per chunk for each particle type
+ * (0 for the default).
  * @param internal_units The #unit_system used internally.
  * @param snapshot_units The #unit_system used in the snapshots.
  * @param fof Is this a snapshot related to a stand-alone FOF call?
  * @param subsample_any Are any fields being subsampled?
  * @param subsample_fraction The subsampling fraction of each particle type.
+ * @param region The region of interest the output is restricted to (NULL for
+ * the full volume).
  */
 void prepare_file(struct engine* e, const char* fileName,
                   const char* xmfFileName,
                   const long long N_total[swift_type_count],
                   const int to_write[swift_type_count],
                   const int numFields[swift_type_count],
+                  const long long chunk_sizes[swift_type_count],
                   const char current_selection_name[FIELD_BUFFER_SIZE],
                   const struct unit_system* internal_units,
                   const struct unit_system* snapshot_units, const int fof,
                   const int subsample_any,
-                  const float subsample_fraction[swift_type_count]) {
+                  const float subsample_fraction[swift_type_count],
+                  const struct output_region* region) {
 
   struct output_options* output_options = e->output_options;
   const int with_cosmology = e->policy & engine_policy_cosmology;
@@ -1292,13 +1567,7 @@ void prepare_file(struct engine* e, const char* fileName,
   io_write_attribute_i(h_grp, "Virtual", 0);
   io_write_attribute(h_grp, "CanHaveTypes", INT, to_write, swift_type_count);
 
-  if (subsample_any) {
-    io_write_attribute_s(h_grp, "OutputType", "SubSampled");
-    io_write_attribute(h_grp, "SubSampleFractions", FLOAT, subsample_fraction,
-                       swift_type_count);
-  } else {
-    io_write_attribute_s(h_grp, "OutputType", "FullVolume");
-  }
+  io_write_output_type(h_grp, subsample_any, subsample_fraction, region);
 
   /* Close header */
   H5Gclose(h_grp);
@@ -1416,7 +1685,7 @@ void prepare_file(struct engine* e, const char* fileName,
       if (compression_level != compression_do_not_write) {
         prepare_array_parallel(e, h_grp, fileName, xmfFile, partTypeGroupName,
                                list[i], N_total[ptype], compression_level,
-                               snapshot_units);
+                               chunk_sizes[ptype], snapshot_units);
         num_fields_written++;
       }
     }
@@ -1551,6 +1820,11 @@ void write_output_parallel(struct engine* e,
     if (!subsample[i]) subsample_fraction[i] = 1.f;
   }
 
+  /* Are we restricting the output to a region of interest? */
+  struct output_region region_buffer;
+  const struct output_region* region = output_options_get_region(
+      output_options, current_selection_name, e->s, &region_buffer);
+
   /* Total number of fields to write per ptype */
   int numFields[swift_type_count] = {0};
   for (int ptype = 0; ptype < swift_type_count; ++ptype) {
@@ -1562,37 +1836,38 @@ void write_output_parallel(struct engine* e,
   size_t Ngas_written, Ndm_written, Ndm_background, Ndm_neutrino,
       Nsinks_written, Nstars_written, Nblackholes_written;
 
-  if (subsample[swift_type_gas]) {
-    Ngas_written = io_count_gas_to_write(e->s, /*subsample=*/1,
+  if (subsample[swift_type_gas] || region != NULL) {
+    Ngas_written = io_count_gas_to_write(e->s, subsample[swift_type_gas],
                                          subsample_fraction[swift_type_gas],
-                                         e->snapshot_output_count);
+                                         region, e->snapshot_output_count);
   } else {
     Ngas_written =
         e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
   }
 
-  if (subsample[swift_type_stars]) {
+  if (subsample[swift_type_stars] || region != NULL) {
     Nstars_written = io_count_stars_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_stars],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_stars], subsample_fraction[swift_type_stars],
+        region, e->snapshot_output_count);
   } else {
     Nstars_written =
         e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
   }
 
-  if (subsample[swift_type_black_hole]) {
+  if (subsample[swift_type_black_hole] || region != NULL) {
     Nblackholes_written = io_count_black_holes_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_black_hole],
+        e->s, subsample[swift_type_black_hole],
+        subsample_fraction[swift_type_black_hole], region,
         e->snapshot_output_count);
   } else {
     Nblackholes_written =
         e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   }
 
-  if (subsample[swift_type_sink]) {
+  if (subsample[swift_type_sink] || region != NULL) {
     Nsinks_written = io_count_sinks_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_sink],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_sink], subsample_fraction[swift_type_sink],
+        region, e->snapshot_output_count);
   } else {
     Nsinks_written =
         e->s->nr_sinks - e->s->nr_inhibited_sinks - e->s->nr_extra_sinks;
@@ -1600,13 +1875,14 @@ void write_output_parallel(struct engine* e,
 
   Ndm_written = io_count_dark_matter_to_write(
       e->s, subsample[swift_type_dark_matter],
-      subsample_fraction[swift_type_dark_matter], e->snapshot_output_count);
+      subsample_fraction[swift_type_dark_matter], region,
+      e->snapshot_output_count);
 
   if (with_DM_background) {
     Ndm_background = io_count_background_dark_matter_to_write(
         e->s, subsample[swift_type_dark_matter_background],
         subsample_fraction[swift_type_dark_matter_background],
-        e->snapshot_output_count);
+        region, e->snapshot_output_count);
   } else {
     Ndm_background = 0;
   }
@@ -1614,7 +1890,8 @@ void write_output_parallel(struct engine* e,
   if (with_neutrinos) {
     Ndm_neutrino = io_count_neutrinos_to_write(
         e->s, subsample[swift_type_neutrino],
-        subsample_fraction[swift_type_neutrino], e->snapshot_output_count);
+        subsample_fraction[swift_type_neutrino], region,
+        e->snapshot_output_count);
   } else {
     Ndm_neutrino = 0;
   }
@@ -1645,11 +1922,18 @@ void write_output_parallel(struct engine* e,
 
   };
 
+  /* Size the chunks of the arrays after the top-level cells if requested */
+  long long chunk_sizes[swift_type_count];
+  io_get_cell_aligned_chunk_sizes(e->s->cells_top, e->s->nr_cells, mpi_rank,
+                                  e->snapshot_chunks_per_cell, N_total,
+                                  chunk_sizes, comm);
+
   /* Rank 0 prepares the file */
   if (mpi_rank == 0)
     prepare_file(e, fileName, xmfFileName, N_total, to_write, numFields,
-                 current_selection_name, internal_units, snapshot_units, fof,
-                 subsample_any, subsample_fraction);
+                 chunk_sizes, current_selection_name, internal_units,
+                 snapshot_units, fof, subsample_any, subsample_fraction,
+                 region);
 
   MPI_Barrier(MPI_COMM_WORLD);
 
@@ -1677,11 +1961,12 @@ void write_output_parallel(struct engine* e,
   }
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp_cells, e->s->cdim, e->s->dim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, mpi_rank,
-                        /*distributed=*/0, subsample, subsample_fraction,
-                        e->snapshot_output_count, N_total, offset, to_write,
-                        numFields, internal_units, snapshot_units);
+  io_write_cell_offsets(
+      h_grp_cells, e->s->cdim, e->s->dim, e->s->cells_top, e->s->nr_cells,
+      e->s->width, mpi_rank, /*distributed=*/0, subsample, subsample_fraction,
+      region, e->snapshot_output_count, N_total, offset, to_write, numFields,
+      e->snapshot_chunks_per_cell ? chunk_sizes : NULL, internal_units,
+      snapshot_units, comm);
 
   /* Close everything */
   if (mpi_rank == 0) {
@@ -1777,13 +2062,9 @@ void write_output_parallel(struct engine* e,
     bzero(list, 100 * sizeof(struct io_props));
     size_t Nparticles = 0;
 
-    struct part* parts_written = NULL;
-    struct xpart* xparts_written = NULL;
-    struct gpart* gparts_written = NULL;
-    struct velociraptor_gpart_data* gpart_group_data_written = NULL;
-    struct spart* sparts_written = NULL;
-    struct bpart* bparts_written = NULL;
-    struct sink* sinks_written = NULL;
+    /* The particle collection runs on the threadpool */
+    struct threadpool* tp = (struct threadpool*)&e->threadpool;
+    size_t* index_written = NULL;
 
     /* Write particle fields from the particle structure */
     switch (ptype) {
@@ -1794,37 +2075,28 @@ void write_output_parallel(struct engine* e,
           /* No inhibted particles: easy case */
           Nparticles = Ngas;
 
-          /* Select the fields to write */
-          io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
-                                 with_temperature, with_fof, with_stf, with_rt,
-                                 e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Ngas_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("parts_written", (void**)&parts_written,
-                             part_align,
-                             Ngas_written * sizeof(struct part)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ngas_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for parts");
-          if (swift_memalign("xparts_written", (void**)&xparts_written,
-                             xpart_align,
-                             Ngas_written * sizeof(struct xpart)) != 0)
-            error("Error while allocating temporary memory for xparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_parts_to_write(
-              parts, xparts, parts_written, xparts_written,
-              subsample[swift_type_gas], subsample_fraction[swift_type_gas],
+              tp, parts, index_written, subsample[swift_type_gas],
+              subsample_fraction[swift_type_gas], region,
               e->snapshot_output_count, Ngas, Ngas_written);
-
-          /* Select the fields to write */
-          io_select_hydro_fields(parts_written, xparts_written, with_cosmology,
-                                 with_cooling, with_temperature, with_fof,
-                                 with_stf, with_rt, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
+                               with_temperature, with_fof, with_stf, with_rt,
+                               e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter: {
@@ -1833,42 +2105,28 @@ void write_output_parallel(struct engine* e,
           /* This is a DM-only run without inhibited particles */
           Nparticles = Ntot;
 
-          /* Select the fields to write */
-          io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
-                              with_stf, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Ndm_written;
 
           /* Allocate temporary array */
-          if (swift_memalign("gparts_written", (void**)&gparts_written,
-                             gpart_align,
-                             Ndm_written * sizeof(struct gpart)) != 0)
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ndm_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for gparts");
 
-          if (with_stf) {
-            if (swift_memalign(
-                    "gpart_group_written", (void**)&gpart_group_data_written,
-                    gpart_align,
-                    Ndm_written * sizeof(struct velociraptor_gpart_data)) != 0)
-              error(
-                  "Error while allocating temporary memory for gparts STF "
-                  "data");
-          }
-
-          /* Collect the non-inhibited DM particles from gpart */
+          /* Collect the indices of the non-inhibited DM particles */
           io_collect_gparts_to_write(
-              gparts, e->s->gpart_group_data, gparts_written,
-              gpart_group_data_written, subsample[swift_type_dark_matter],
+              tp, gparts, index_written, swift_type_dark_matter,
+              subsample[swift_type_dark_matter],
               subsample_fraction[swift_type_dark_matter],
-              e->snapshot_output_count, Ntot, Ndm_written, with_stf);
-
-          /* Select the fields to write */
-          io_select_dm_fields(gparts_written, gpart_group_data_written,
-                              with_fof, with_stf, e, &num_fields, list);
+              region, e->snapshot_output_count, Ntot, Ndm_written);
         }
+
+        /* Select the fields to write */
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
+                            with_stf, e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter_background: {
@@ -1877,32 +2135,22 @@ void write_output_parallel(struct engine* e,
         Nparticles = Ndm_background;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_background * sizeof(struct gpart)) != 0)
-          error("Error while allocating temporart memory for gparts");
-
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_background * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporart memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_background_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written,
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_background * sizeof(size_t)) != 0)
+          error("Error while allocating temporary memory for gparts");
+
+        /* Collect the indices of the non-inhibited background particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_dark_matter_background,
             subsample[swift_type_dark_matter_background],
             subsample_fraction[swift_type_dark_matter_background],
-            e->snapshot_output_count, Ntot, Ndm_background, with_stf);
+            region, e->snapshot_output_count, Ntot, Ndm_background);
 
         /* Select the fields to write */
-        io_select_dm_fields(gparts_written, gpart_group_data_written, with_fof,
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
                             with_stf, e, &num_fields, list);
+
       } break;
 
       case swift_type_neutrino: {
@@ -1911,31 +2159,21 @@ void write_output_parallel(struct engine* e,
         Nparticles = Ndm_neutrino;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_neutrino * sizeof(struct gpart)) != 0)
-          error("Error while allocating temporart memory for gparts");
-
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_neutrino * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporart memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_neutrino_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written, subsample[swift_type_neutrino],
-            subsample_fraction[swift_type_neutrino], e->snapshot_output_count,
-            Ntot, Ndm_neutrino, with_stf);
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_neutrino * sizeof(size_t)) != 0)
+          error("Error while allocating temporary memory for gparts");
+
+        /* Collect the indices of the non-inhibited neutrino particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_neutrino,
+            subsample[swift_type_neutrino],
+            subsample_fraction[swift_type_neutrino],
+            region, e->snapshot_output_count, Ntot, Ndm_neutrino);
 
         /* Select the fields to write */
-        io_select_neutrino_fields(gparts_written, gpart_group_data_written,
-                                  with_fof, with_stf, e, &num_fields, list);
+        io_select_neutrino_fields(gparts, e->s->gpart_group_data, with_fof,
+                                  with_stf, e, &num_fields, list);
 
       } break;
 
@@ -1945,103 +2183,94 @@ void write_output_parallel(struct engine* e,
           /* No inhibted particles: easy case */
           Nparticles = Nsinks;
 
-          /* Select the fields to write */
-          io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
-                                &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nsinks_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sinks_written", (void**)&sinks_written,
-                             sink_align,
-                             Nsinks_written * sizeof(struct sink)) != 0)
-            error("Error while allocating temporary memory for sink");
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nsinks_written * sizeof(size_t)) != 0)
+            error("Error while allocating temporary memory for sinks");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sinks_to_write(
-              sinks, sinks_written, subsample[swift_type_sink],
-              subsample_fraction[swift_type_sink], e->snapshot_output_count,
-              Nsinks, Nsinks_written);
-
-          /* Select the fields to write */
-          io_select_sink_fields(sinks_written, with_cosmology, with_fof,
-                                with_stf, e, &num_fields, list);
+              tp, sinks, index_written, subsample[swift_type_sink],
+              subsample_fraction[swift_type_sink], region,
+              e->snapshot_output_count, Nsinks, Nsinks_written);
         }
+
+        /* Select the fields to write */
+        io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
+                              &num_fields, list);
       } break;
 
       case swift_type_stars: {
         if (Nstars == Nstars_written) {
 
-          /* No inhibted particles: easy case */
+          /* No inhibited particles: easy case */
           Nparticles = Nstars;
 
-          /* Select the fields to write */
-          io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
-                                with_rt, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nstars_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sparts_written", (void**)&sparts_written,
-                             spart_align,
-                             Nstars_written * sizeof(struct spart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nstars_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for sparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sparts_to_write(
-              sparts, sparts_written, subsample[swift_type_stars],
-              subsample_fraction[swift_type_stars], e->snapshot_output_count,
-              Nstars, Nstars_written);
-
-          /* Select the fields to write */
-          io_select_star_fields(sparts_written, with_cosmology, with_fof,
-                                with_stf, with_rt, e, &num_fields, list);
+              tp, sparts, index_written, subsample[swift_type_stars],
+              subsample_fraction[swift_type_stars], region,
+              e->snapshot_output_count, Nstars, Nstars_written);
         }
+
+        /* Select the fields to write */
+        io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
+                              with_rt, e, &num_fields, list);
       } break;
 
       case swift_type_black_hole: {
         if (Nblackholes == Nblackholes_written) {
 
-          /* No inhibted particles: easy case */
+          /* No inhibited particles: easy case */
           Nparticles = Nblackholes;
 
-          /* Select the fields to write */
-          io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
-                              &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           Nparticles = Nblackholes_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("bparts_written", (void**)&bparts_written,
-                             bpart_align,
-                             Nblackholes_written * sizeof(struct bpart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nblackholes_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for bparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_bparts_to_write(
-              bparts, bparts_written, subsample[swift_type_black_hole],
-              subsample_fraction[swift_type_black_hole],
+              tp, bparts, index_written, subsample[swift_type_black_hole],
+              subsample_fraction[swift_type_black_hole], region,
               e->snapshot_output_count, Nblackholes, Nblackholes_written);
-
-          /* Select the fields to write */
-          io_select_bh_fields(bparts_written, with_cosmology, with_fof,
-                              with_stf, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
+                            &num_fields, list);
       } break;
 
       default:
         error("Particle Type %d not yet supported. Aborting", ptype);
     }
 
+    /* Read the particles through the index list if we collected one */
+    io_props_set_index(list, num_fields, index_written);
+
     /* Did the user specify a non-standard default for the entire particle
      * type? */
     const enum lossy_compression_schemes compression_level_current_default =
@@ -2067,14 +2296,7 @@ void write_output_parallel(struct engine* e,
     }
 
     /* Free temporary array */
-    if (parts_written) swift_free("parts_written", parts_written);
-    if (xparts_written) swift_free("xparts_written", xparts_written);
-    if (gparts_written) swift_free("gparts_written", gparts_written);
-    if (gpart_group_data_written)
-      swift_free("gpart_group_written", gpart_group_data_written);
-    if (sparts_written) swift_free("sparts_written", sparts_written);
-    if (bparts_written) swift_free("bparts_written", bparts_written);
-    if (sinks_written) swift_free("sinks_written", sinks_written);
+    if (index_written) swift_free("index_written", index_written);
 
 #ifdef IO_SPEED_MEASUREMENT
     MPI_Barrier(MPI_COMM_WORLD);
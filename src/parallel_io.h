@@ -47,7 +47,8 @@ void read_ic_parallel(char* fileName, const struct unit_system* internal_units,
                       const int cleanup_sqrt_a, const double h, const double a,
                       const int mpi_rank, const int mpi_size, MPI_Comm comm,
                       MPI_Info info, const int nr_threads, const int dry_run,
-                      const int remap_ids, struct ic_info* ics_metadata);
+                      const int remap_ids, struct ic_info* ics_metadata,
+                      const int* read_grid);
 
 void write_output_parallel(struct engine* e,
                            const struct unit_system* internal_units,
@@ -546,6 +546,73 @@ MPI_Datatype spart_mpi_type;
 MPI_Datatype bpart_mpi_type;
 MPI_Datatype sink_mpi_type;
 
+/* Blocks of a #part sent by the rho and gradient messages */
+struct part_mpi_fields part_mpi_update_fields;
+
+/**
+ * @brief Builds the list of blocks of bytes of a #part that are sent by the
+ * messages updating the foreign particles (rho and gradient).
+ *
+ * Everything but the fields that are only modified before the xv message
+ * (drift) or after the end of the force loop (kicks, time-steps, sub-grid
+ * physics) is sent. The gpart pointer is meaningless on the receiving side.
+ *
+ * @param fields The #part_mpi_fields to fill.
+ */
+static void part_create_mpi_update_fields(struct part_mpi_fields *fields) {
+
+#ifndef MPI_FULL_PART_UPDATES
+#define PART_FIELD(name) \
+  { offsetof(struct part, name), sizeof(((struct part *)NULL)->name) }
+
+  /* The fields sent by the xv message only, as pairs of (offset, length) */
+  size_t skip[][2] = {PART_FIELD(id),
+                      PART_FIELD(gpart),
+                      PART_FIELD(x),
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+                      PART_FIELD(x_rel),
+#endif
+                      PART_FIELD(v),
+                      PART_FIELD(mass)};
+  const int nr_skip = sizeof(skip) / sizeof(skip[0]);
+#undef PART_FIELD
+
+  /* Sort them by offset */
+  for (int i = 1; i < nr_skip; ++i) {
+    for (int j = i; j > 0 && skip[j][0] < skip[j - 1][0]; --j) {
+      const size_t offset = skip[j][0], length = skip[j][1];
+      skip[j][0] = skip[j - 1][0];
+      skip[j][1] = skip[j - 1][1];
+      skip[j - 1][0] = offset;
+      skip[j - 1][1] = length;
+    }
+  }
+
+  /* And send the gaps between them */
+  fields->nr_blocks = 0;
+  fields->size = 0;
+  size_t start = 0;
+  for (int i = 0; i <= nr_skip; ++i) {
+    const size_t end = (i < nr_skip) ? skip[i][0] : sizeof(struct part);
+    if (end > start) {
+      if (fields->nr_blocks == part_mpi_max_blocks)
+        error("Too many blocks of fields to send.");
+      fields->offset[fields->nr_blocks] = start;
+      fields->length[fields->nr_blocks] = end - start;
+      fields->size += end - start;
+      fields->nr_blocks++;
+    }
+    if (i < nr_skip && skip[i][0] + skip[i][1] > start)
+      start = skip[i][0] + skip[i][1];
+  }
+#else
+  fields->offset[0] = 0;
+  fields->length[0] = sizeof(struct part);
+  fields->nr_blocks = 1;
+  fields->size = sizeof(struct part);
+#endif
+}
+
 /**
  * @brief Registers MPI particle types.
  */
@@ -587,6 +654,8 @@ void part_create_mpi_types(void) {
       MPI_Type_commit(&sink_mpi_type) != MPI_SUCCESS) {
     error("Failed to create MPI type for sink.");
   }
+
+  part_create_mpi_update_fields(&part_mpi_update_fields);
 }
 
 void part_free_mpi_types(void) {
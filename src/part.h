@@ -32,6 +32,7 @@
 
 /* Local headers. */
 #include "align.h"
+#include "inline.h"
 #include "part_type.h"
 
 /* Pre-declarations */
@@ -73,10 +74,12 @@ struct threadpool;
 #define hydro_need_extra_init_loop 0
 #define EXTRA_HYDRO_LOOP
 #define MPI_SYMMETRIC_FORCE_INTERACTION
+#define MPI_FULL_PART_UPDATES
 #elif defined(SHADOWSWIFT)
 #include "./hydro/Shadowswift/hydro_part.h"
 #define hydro_need_extra_init_loop 0
 #define EXTRA_HYDRO_LOOP
+#define MPI_FULL_PART_UPDATES
 #elif defined(PLANETARY_SPH)
 #include "./hydro/Planetary/hydro_part.h"
 #define hydro_need_extra_init_loop 0
@@ -138,6 +141,65 @@ struct threadpool;
 #error "Invalid choice of sink particle"
 #endif
 
+/**
+ * @brief Update the single-precision position of a #part relative to the
+ * corner of the top-level cell it is stored in.
+ *
+ * Does nothing unless SWIFT_HYDRO_RELATIVE_POSITIONS is defined.
+ *
+ * @param p The #part.
+ * @param top_loc The position of the corner of the particle's top-level cell.
+ */
+__attribute__((always_inline)) INLINE void part_update_relative_position(
+    struct part *p, const double top_loc[3]) {
+
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+  p->x_rel[0] = (float)(p->x[0] - top_loc[0]);
+  p->x_rel[1] = (float)(p->x[1] - top_loc[1]);
+  p->x_rel[2] = (float)(p->x[2] - top_loc[2]);
+#endif
+}
+
+/* Position of a #part along axis k in a local frame whose origin is frame[k].
+ * With relative positions, the frame origin must itself be expressed relative
+ * to the corner of the particle's top-level cell (see
+ * part_get_relative_frame()). */
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+#define part_get_frame_position(p, frame, k) ((p)->x_rel[k] - (frame)[k])
+#else
+#define part_get_frame_position(p, frame, k) ((float)((p)->x[k] - (frame)[k]))
+#endif
+
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+/*! Type of the origin of the local frames used in the hydro loops. */
+typedef float part_frame_t;
+#else
+/*! Type of the origin of the local frames used in the hydro loops. */
+typedef double part_frame_t;
+#endif
+
+/**
+ * @brief Construct the origin of a local frame in the form expected by
+ * part_get_frame_position() for the particles of a given top-level cell.
+ *
+ * @param origin The origin of the frame in absolute coordinates.
+ * @param top_loc The corner of the top-level cell the particles belong to.
+ * @param frame (return) The frame origin to use with these particles.
+ */
+__attribute__((always_inline)) INLINE void part_get_relative_frame(
+    const double origin[3], const double top_loc[3], part_frame_t frame[3]) {
+
+#ifdef SWIFT_HYDRO_RELATIVE_POSITIONS
+  frame[0] = (float)(origin[0] - top_loc[0]);
+  frame[1] = (float)(origin[1] - top_loc[1]);
+  frame[2] = (float)(origin[2] - top_loc[2]);
+#else
+  frame[0] = origin[0];
+  frame[1] = origin[1];
+  frame[2] = origin[2];
+#endif
+}
+
 void part_relink_gparts_to_parts(struct part *parts, const size_t N,
                                  const ptrdiff_t offset);
 void part_relink_gparts_to_sparts(struct spart *sparts, const size_t N,
@@ -173,6 +235,36 @@ extern MPI_Datatype spart_mpi_type;
 extern MPI_Datatype bpart_mpi_type;
 extern MPI_Datatype sink_mpi_type;
 
+/*! Maximal number of blocks of bytes in a #part_mpi_fields */
+#define part_mpi_max_blocks 8
+
+/**
+ * @brief The blocks of bytes of a #part sent by the MPI messages that update
+ * foreign particles already received earlier in the same step.
+ *
+ * The rho and gradient messages follow the xv one, which carries the whole
+ * #part. The fields that cannot change in-between (e.g. the positions,
+ * velocities and masses) are hence not sent again. Schemes that update their
+ * velocities in the density or gradient loops define MPI_FULL_PART_UPDATES
+ * and always send the whole #part.
+ */
+struct part_mpi_fields {
+
+  /*! Offset of each block in a #part */
+  size_t offset[part_mpi_max_blocks];
+
+  /*! Length of each block in bytes */
+  size_t length[part_mpi_max_blocks];
+
+  /*! Number of blocks */
+  int nr_blocks;
+
+  /*! Total size in bytes of the packed blocks of one #part */
+  size_t size;
+};
+
+extern struct part_mpi_fields part_mpi_update_fields;
+
 void part_create_mpi_types(void);
 void part_free_mpi_types(void);
 #endif
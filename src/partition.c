@@ -51,6 +51,11 @@
 #ifdef HAVE_METIS
 #include <metis.h>
 #endif
+#if !defined(HAVE_METIS) && !defined(HAVE_PARMETIS)
+/* Index type of the cell graph, as used by METIS. */
+typedef int idx_t;
+#define IDX_MAX INT32_MAX
+#endif
 #endif
 
 /* Local headers. */
@@ -68,13 +73,18 @@ const char *initial_partition_name[] = {
     "axis aligned grids of cells", "vectorized point associated cells",
     "memory balanced, using particle weighted cells",
     "similar sized regions, using unweighted cells",
-    "memory and edge balanced cells using particle weights"};
+    "memory and edge balanced cells using particle weights",
+    "memory balanced pieces of a Hilbert curve through the cells"};
 
 /* Simple descriptions of repartition types for reports. */
 const char *repartition_name[] = {
-    "none", "edge and vertex task cost weights", "task cost edge weights",
+    "none",
+    "edge and vertex task cost weights",
+    "task cost edge weights",
     "memory balanced, using particle vertex weights",
-    "vertex task costs and edge delta timebin weights"};
+    "vertex task costs and edge delta timebin weights",
+    "diffusion of boundary cells using vertex task cost weights",
+    "pieces of a Hilbert curve using vertex task cost weights"};
 
 /* Local functions, if needed. */
 static int check_complete(struct space *s, int verbose, int nregions);
@@ -83,7 +93,7 @@ static int check_complete(struct space *s, int verbose, int nregions);
  * Repartition fixed costs per type/subtype. These are determined from the
  * statistics output produced when running with task debugging enabled.
  */
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 static double repartition_costs[task_type_count][task_subtype_count];
 #endif
 #if defined(WITH_MPI)
@@ -168,6 +178,154 @@ static void split_vector(struct space *s, int nregions, int *samplecells) {
 }
 #endif
 
+/*  Space-filling curve support */
+/*  =========================== */
+
+#if defined(WITH_MPI)
+/**
+ * @brief Position of a cell along the 3D Hilbert curve.
+ *
+ * Uses the transposed form of Skilling (2004, AIP Conf. Proc. 707, 381),
+ * with the bits of the transposed coordinates interleaved into the key.
+ *
+ * @param i the cell index along x.
+ * @param j the cell index along y.
+ * @param k the cell index along z.
+ * @param bits the number of bits of each index.
+ * @return the Hilbert key of the cell.
+ */
+static unsigned long long hilbert_key(int i, int j, int k, int bits) {
+
+  unsigned int x[3] = {(unsigned int)i, (unsigned int)j, (unsigned int)k};
+  const unsigned int m = 1u << (bits - 1);
+
+  /* Inverse undo. */
+  for (unsigned int q = m; q > 1; q >>= 1) {
+    const unsigned int p = q - 1;
+    for (int n = 0; n < 3; n++) {
+      if (x[n] & q) {
+        x[0] ^= p;
+      } else {
+        const unsigned int t = (x[0] ^ x[n]) & p;
+        x[0] ^= t;
+        x[n] ^= t;
+      }
+    }
+  }
+
+  /* Gray encode. */
+  for (int n = 1; n < 3; n++) x[n] ^= x[n - 1];
+  unsigned int t = 0;
+  for (unsigned int q = m; q > 1; q >>= 1)
+    if (x[2] & q) t ^= q - 1;
+  for (int n = 0; n < 3; n++) x[n] ^= t;
+
+  /* Interleave. */
+  unsigned long long key = 0;
+  for (int b = bits - 1; b >= 0; b--)
+    for (int n = 0; n < 3; n++) key = (key << 1) | ((x[n] >> b) & 1);
+  return key;
+}
+
+/* qsort support. */
+struct hilbertcell {
+  unsigned long long key;
+  int cid;
+};
+static int hilbertcellcmp(const void *p1, const void *p2) {
+  const struct hilbertcell *c1 = (const struct hilbertcell *)p1;
+  const struct hilbertcell *c2 = (const struct hilbertcell *)p2;
+  if (c1->key < c2->key) return -1;
+  if (c1->key > c2->key) return 1;
+  return 0;
+}
+
+/**
+ * @brief Partition the cells by cutting the Hilbert curve through them into
+ *        pieces of equal weight.
+ *
+ * The cuts are placed at the exact fractions of the total weight and the
+ * cell a cut goes through joins the region holding most of its weight. Each
+ * node sums the weights of one part of the curve, so that the positions of
+ * the cells along the weights are found with a parallel prefix sum over the
+ * nodes. All nodes must call this with the same weights.
+ *
+ * @param nodeID our nodeID.
+ * @param s the space of cells.
+ * @param nregions the number of regions, one per node.
+ * @param weights the weights of the cells, NULL for unweighted.
+ * @param celllist on exit the region of each cell, size s->nr_cells.
+ */
+static void pick_hilbert(int nodeID, struct space *s, int nregions,
+                         const double *weights, int *celllist) {
+
+  const int nr_cells = s->nr_cells;
+  const int *cdim = s->cdim;
+
+  /* Bits needed for the largest dimension. */
+  const int maxdim = max3(cdim[0], cdim[1], cdim[2]);
+  int bits = 1;
+  while ((1 << bits) < maxdim) bits++;
+
+  /* Order the cells along the curve. */
+  struct hilbertcell *order = NULL;
+  if ((order = (struct hilbertcell *)malloc(sizeof(struct hilbertcell) *
+                                            nr_cells)) == NULL)
+    error("Failed to allocate Hilbert order");
+  for (int i = 0; i < cdim[0]; i++) {
+    for (int j = 0; j < cdim[1]; j++) {
+      for (int k = 0; k < cdim[2]; k++) {
+        const int cid = cell_getid(cdim, i, j, k);
+        order[cid].key = hilbert_key(i, j, k, bits);
+        order[cid].cid = cid;
+      }
+    }
+  }
+  qsort(order, nr_cells, sizeof(struct hilbertcell), hilbertcellcmp);
+
+  /* Our part of the curve and its weight. */
+  const int first = (int)((long long)nr_cells * nodeID / nregions);
+  const int last = (int)((long long)nr_cells * (nodeID + 1) / nregions);
+  double sum = 0.0;
+  for (int n = first; n < last; n++)
+    sum += (weights != NULL) ? weights[order[n].cid] : 1.0;
+
+  /* Weight of the curve before our part and in total. */
+  double offset = 0.0;
+  int res = MPI_Exscan(&sum, &offset, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to scan the curve weights.");
+  if (nodeID == 0) offset = 0.0;
+  double total = 0.0;
+  res = MPI_Allreduce(&sum, &total, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to sum the curve weights.");
+
+  /* Place our cells between the cuts. Without any weight we cut by number
+   * of cells. */
+  bzero(celllist, sizeof(int) * nr_cells);
+  for (int n = first; n < last; n++) {
+    double w, mid;
+    if (total > 0.0) {
+      w = (weights != NULL) ? weights[order[n].cid] : 1.0;
+      mid = (offset + 0.5 * w) / total;
+    } else {
+      w = 0.0;
+      mid = (n + 0.5) / nr_cells;
+    }
+    int region = (int)(mid * nregions);
+    if (region >= nregions) region = nregions - 1;
+    celllist[order[n].cid] = region;
+    offset += w;
+  }
+
+  /* Every cell was set by one node only. */
+  res = MPI_Allreduce(MPI_IN_PLACE, celllist, nr_cells, MPI_INT, MPI_SUM,
+                      MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to reduce the cell list.");
+
+  free(order);
+}
+#endif
+
 /* METIS/ParMETIS support (optional)
  * =================================
  *
@@ -326,7 +484,7 @@ static void graph_init(struct space *s, int periodic, idx_t *weights_e,
 }
 #endif
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 struct counts_mapper_data {
   double *counts;
   size_t size;
@@ -522,6 +680,9 @@ static void accumulate_sizes(struct space *s, int verbose, double *counts) {
   }
 }
 
+#endif
+
+#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
 /**
  * @brief Make edge weights from the accumulated particle sizes per cell.
  *
@@ -1349,7 +1510,7 @@ static void pick_metis(int nodeID, struct space *s, int nregions,
 }
 #endif
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 
 /* Helper struct for partition_gather weights. */
 struct weights_mapper_data {
@@ -1365,7 +1526,8 @@ struct weights_mapper_data {
   struct cell *cells;
 };
 
-#ifdef SWIFT_DEBUG_CHECKS
+#if defined(SWIFT_DEBUG_CHECKS) && \
+    (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
 static void check_weights(struct task *tasks, int nr_tasks,
                           struct weights_mapper_data *weights_data,
                           double *weights_v, double *weights_e);
@@ -1535,7 +1697,9 @@ void partition_gather_weights(void *map_data, int num_elements,
     }
   }
 }
+#endif /* WITH_MPI */
 
+#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
 /**
  * @brief Repartition the cells amongst the nodes using weights of
  *        various kinds.
@@ -1618,6 +1782,7 @@ static void repart_edge_metis(int vweights, int eweights, int timebins,
                         MPI_COMM_WORLD);
     if (res != MPI_SUCCESS)
       mpi_error(res, "Failed to allreduce vertex weights.");
+    repart_check_split(repartition, nodeID, nr_nodes, s, weights_v);
   }
 
   if (eweights) {
@@ -1852,6 +2017,338 @@ static void repart_memory_metis(struct repartition *repartition, int nodeID,
 }
 #endif /* WITH_MPI && (HAVE_METIS || HAVE_PARMETIS) */
 
+#if defined(WITH_MPI)
+/**
+ * @brief Ask for the top-level cells to be split when the heaviest one is too
+ *        large a part of the work a node should do.
+ *
+ * No partition made of whole top-level cells can balance a cell that costs
+ * more than the share of a node. In that case the smallest top-level cell
+ * width is halved, so that the next regrid makes the progeny of the
+ * top-level cells the new top-level cells, which the following repartitions
+ * can spread over the nodes.
+ *
+ * @param repartition the partition struct of the local engine.
+ * @param nodeID our nodeID.
+ * @param nr_nodes the number of nodes.
+ * @param s the space of cells.
+ * @param weights_v the vertex weights of the cells summed over all nodes.
+ */
+static void repart_check_split(struct repartition *repartition, int nodeID,
+                               int nr_nodes, struct space *s,
+                               const double *weights_v) {
+
+  if (repartition->nr_splits >= repartition->split_depth) return;
+
+  /* Decided by one node, so that all agree. */
+  int split = 0;
+  if (nodeID == 0) {
+    double sum = 0.0;
+    double wmax = 0.0;
+    for (int k = 0; k < s->nr_cells; k++) {
+      sum += weights_v[k];
+      if (weights_v[k] > wmax) wmax = weights_v[k];
+    }
+    const double share = sum / nr_nodes;
+    if (share > 0.0 && wmax > repartition->split_fraction * share) {
+      split = 1;
+      message(
+          "heaviest top-level cell costs %.2f of the share of a node, "
+          "splitting the top-level cells at the next regrid",
+          wmax / share);
+    }
+  }
+  int res = MPI_Bcast(&split, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to bcast the split flag.");
+
+  if (split) {
+    s->cell_min *= 0.5;
+    s->split_top_cells = 1;
+    repartition->nr_splits++;
+  }
+}
+
+/**
+ * @brief Gather the vertex weights of the cells from the costs of our tasks.
+ *
+ * Only the contributions of our node are gathered, the caller has to reduce
+ * the weights over all the nodes.
+ *
+ * @param repartition the partition struct of the local engine.
+ * @param nodeID our nodeID.
+ * @param s the space of cells holding our local particles.
+ * @param tasks the completed tasks from the last engine step for our node.
+ * @param nr_tasks the number of tasks.
+ * @param weights_v the vertex weights, size s->nr_cells, zeroed on entry.
+ */
+static void gather_vertex_weights(struct repartition *repartition, int nodeID,
+                                  struct space *s, struct task *tasks,
+                                  int nr_tasks, double *weights_v) {
+
+  struct weights_mapper_data weights_data;
+  weights_data.cells = s->cells_top;
+  weights_data.eweights = 0;
+  weights_data.inds = NULL;
+  weights_data.nodeID = nodeID;
+  weights_data.nr_cells = s->nr_cells;
+  weights_data.timebins = 0;
+  weights_data.vweights = 1;
+  weights_data.weights_e = NULL;
+  weights_data.weights_v = weights_v;
+  weights_data.use_ticks = repartition->use_ticks;
+
+  threadpool_map(&s->e->threadpool, partition_gather_weights, tasks, nr_tasks,
+                 sizeof(struct task), threadpool_auto_chunk_size,
+                 &weights_data);
+}
+
+/**
+ * @brief Repartition the cells amongst the nodes by cutting the Hilbert
+ *        curve through the cells into pieces of equal task costs.
+ *
+ * @param repartition the partition struct of the local engine.
+ * @param nodeID our nodeID.
+ * @param nr_nodes the number of nodes.
+ * @param s the space of cells holding our local particles.
+ * @param tasks the completed tasks from the last engine step for our node.
+ * @param nr_tasks the number of tasks.
+ */
+static void repart_hilbert(struct repartition *repartition, int nodeID,
+                           int nr_nodes, struct space *s, struct task *tasks,
+                           int nr_tasks) {
+
+  const int nr_cells = s->nr_cells;
+
+  double *weights_v = NULL;
+  if ((weights_v = (double *)malloc(sizeof(double) * nr_cells)) == NULL)
+    error("Failed to allocate vertex weights array.");
+  bzero(weights_v, sizeof(double) * nr_cells);
+
+  gather_vertex_weights(repartition, nodeID, s, tasks, nr_tasks, weights_v);
+  int res = MPI_Allreduce(MPI_IN_PLACE, weights_v, nr_cells, MPI_DOUBLE,
+                          MPI_SUM, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to allreduce vertex weights.");
+  repart_check_split(repartition, nodeID, nr_nodes, s, weights_v);
+
+  /* Allocate cell list for the partition. If not already done. */
+  if (repartition->ncelllist != nr_cells) {
+    free(repartition->celllist);
+    repartition->ncelllist = 0;
+    if ((repartition->celllist = (int *)malloc(sizeof(int) * nr_cells)) == NULL)
+      error("Failed to allocate celllist");
+    repartition->ncelllist = nr_cells;
+  }
+
+  pick_hilbert(nodeID, s, nr_nodes, weights_v, repartition->celllist);
+
+  /* Check that the partition is complete and all nodes have some work. */
+  int present[nr_nodes];
+  int failed = 0;
+  for (int i = 0; i < nr_nodes; i++) present[i] = 0;
+  for (int i = 0; i < nr_cells; i++) present[repartition->celllist[i]]++;
+  for (int i = 0; i < nr_nodes; i++) {
+    if (!present[i]) {
+      failed = 1;
+      if (nodeID == 0) message("Node %d is not present after repartition", i);
+    }
+  }
+
+  /* If partition failed continue with the current one, but make this clear. */
+  if (failed) {
+    if (nodeID == 0)
+      message(
+          "WARNING: repartition has failed, continuing with the current"
+          " partition, load balance will not be optimal");
+    for (int k = 0; k < nr_cells; k++)
+      repartition->celllist[k] = s->cells_top[k].nodeID;
+  }
+
+  /* And apply to our cells. */
+  for (int k = 0; k < nr_cells; k++)
+    s->cells_top[k].nodeID = repartition->celllist[k];
+
+  free(weights_v);
+}
+
+/**
+ * @brief Rebalance the cells amongst the nodes by diffusing the load across
+ *        the existing domain boundaries.
+ *
+ * Unlike the METIS schemes, which compute a new partition from scratch, this
+ * only hands over top-level cells that touch a less loaded domain, so only
+ * the particles of these cells need to move. Each sweep moves at most one
+ * layer of cells across each boundary, the load flowing from the overloaded
+ * nodes to their less loaded neighbours. A cell is only moved when that
+ * lowers the larger of the two loads, so the sum of the squared loads
+ * decreases at every move and the process ends. The bytes of particles moved
+ * are capped at a fraction of the total.
+ *
+ * @param repartition the partition struct of the local engine.
+ * @param nodeID our nodeID.
+ * @param nr_nodes the number of nodes.
+ * @param s the space of cells holding our local particles.
+ * @param tasks the completed tasks from the last engine step for our node.
+ * @param nr_tasks the number of tasks.
+ */
+static void repart_diffusion(struct repartition *repartition, int nodeID,
+                             int nr_nodes, struct space *s, struct task *tasks,
+                             int nr_tasks) {
+
+  const int nr_cells = s->nr_cells;
+  struct cell *cells = s->cells_top;
+  const int *cdim = s->cdim;
+  const int periodic = s->periodic;
+
+  /* Vertex weights of the cells from the task costs and bytes of particles
+   * in the cells, gathered together for a single reduction. */
+  double *weights = NULL;
+  if ((weights = (double *)malloc(sizeof(double) * 2 * nr_cells)) == NULL)
+    error("Failed to allocate cell weights buffer.");
+  bzero(weights, sizeof(double) * 2 * nr_cells);
+  double *weights_v = weights;
+  double *bytes = &weights[nr_cells];
+
+  gather_vertex_weights(repartition, nodeID, s, tasks, nr_tasks, weights_v);
+
+  for (int k = 0; k < nr_cells; k++) {
+    const struct cell *c = &cells[k];
+    if (c->nodeID != nodeID) continue;
+    bytes[k] = (double)c->hydro.count * sizeof(struct part) +
+               (double)c->grav.count * sizeof(struct gpart) +
+               (double)c->stars.count * sizeof(struct spart) +
+               (double)c->sinks.count * sizeof(struct sink) +
+               (double)c->black_holes.count * sizeof(struct bpart);
+  }
+
+  int res = MPI_Allreduce(MPI_IN_PLACE, weights, 2 * nr_cells, MPI_DOUBLE,
+                          MPI_SUM, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to allreduce cell weights.");
+  repart_check_split(repartition, nodeID, nr_nodes, s, weights_v);
+
+  /* Allocate cell list for the partition. If not already done. */
+  if (repartition->ncelllist != nr_cells) {
+    free(repartition->celllist);
+    repartition->ncelllist = 0;
+    if ((repartition->celllist = (int *)malloc(sizeof(int) * nr_cells)) == NULL)
+      error("Failed to allocate celllist");
+    repartition->ncelllist = nr_cells;
+  }
+  int *celllist = repartition->celllist;
+  for (int k = 0; k < nr_cells; k++) celllist[k] = cells[k].nodeID;
+
+  /* The diffusion is done by one node, so that all use the same result. */
+  if (nodeID == 0) {
+
+    /* Current loads and numbers of cells of the nodes. */
+    double loads[nr_nodes];
+    int ncells[nr_nodes];
+    for (int i = 0; i < nr_nodes; i++) {
+      loads[i] = 0.0;
+      ncells[i] = 0;
+    }
+    double total = 0.0;
+    double total_bytes = 0.0;
+    for (int k = 0; k < nr_cells; k++) {
+      loads[celllist[k]] += weights_v[k];
+      ncells[celllist[k]]++;
+      total += weights_v[k];
+      total_bytes += bytes[k];
+    }
+    const double mean = total / nr_nodes;
+    double maxload = 0.0;
+    for (int i = 0; i < nr_nodes; i++)
+      if (loads[i] > maxload) maxload = loads[i];
+
+    /* Partition at the start of each sweep, so that the boundaries only
+     * move by one cell per sweep. */
+    int *oldlist = NULL;
+    if ((oldlist = (int *)malloc(sizeof(int) * nr_cells)) == NULL)
+      error("Failed to allocate old cell list");
+
+    const double budget = repartition->diffusion_fraction * total_bytes;
+    double moved_bytes = 0.0;
+    int nr_moved = 0;
+    int nr_sweeps = 0;
+    int nr_moves = (total > 0.0);
+    while (nr_moves > 0) {
+      nr_moves = 0;
+      nr_sweeps++;
+      memcpy(oldlist, celllist, sizeof(int) * nr_cells);
+
+      for (int i = 0; i < cdim[0]; i++) {
+        for (int j = 0; j < cdim[1]; j++) {
+          for (int k = 0; k < cdim[2]; k++) {
+            const int cid = cell_getid(cdim, i, j, k);
+            const int owner = celllist[cid];
+            const double w = weights_v[cid];
+
+            /* Only the cells of overloaded nodes that carry some work and
+             * still fit in the budget can move. Never empty a node. */
+            if (loads[owner] <= mean || w <= 0.0 || ncells[owner] == 1 ||
+                moved_bytes + bytes[cid] > budget)
+              continue;
+
+            /* Look for the least loaded neighbouring domain. */
+            int target = -1;
+            for (int ii = -1; ii <= 1; ii++) {
+              int iii = i + ii;
+              if (!periodic && (iii < 0 || iii >= cdim[0])) continue;
+              iii = (iii + cdim[0]) % cdim[0];
+              for (int jj = -1; jj <= 1; jj++) {
+                int jjj = j + jj;
+                if (!periodic && (jjj < 0 || jjj >= cdim[1])) continue;
+                jjj = (jjj + cdim[1]) % cdim[1];
+                for (int kk = -1; kk <= 1; kk++) {
+                  int kkk = k + kk;
+                  if (!periodic && (kkk < 0 || kkk >= cdim[2])) continue;
+                  kkk = (kkk + cdim[2]) % cdim[2];
+                  const int n = oldlist[cell_getid(cdim, iii, jjj, kkk)];
+                  if (n != owner && (target == -1 || loads[n] < loads[target]))
+                    target = n;
+                }
+              }
+            }
+
+            /* Move the cell if that lowers the larger of the two loads. */
+            if (target != -1 && loads[target] + w < loads[owner]) {
+              celllist[cid] = target;
+              loads[owner] -= w;
+              loads[target] += w;
+              ncells[owner]--;
+              ncells[target]++;
+              moved_bytes += bytes[cid];
+              nr_moved++;
+              nr_moves++;
+            }
+          }
+        }
+      }
+    }
+    free(oldlist);
+
+    if (s->e->verbose) {
+      double newmaxload = 0.0;
+      for (int i = 0; i < nr_nodes; i++)
+        if (loads[i] > newmaxload) newmaxload = loads[i];
+      message(
+          "moved %d cells (%.2f%% of the particle bytes) in %d sweeps, "
+          "imbalance %.3f -> %.3f",
+          nr_moved, total_bytes > 0.0 ? 100.0 * moved_bytes / total_bytes : 0.0,
+          nr_sweeps, mean > 0.0 ? maxload / mean : 1.0,
+          mean > 0.0 ? newmaxload / mean : 1.0);
+    }
+  }
+
+  res = MPI_Bcast(celllist, nr_cells, MPI_INT, 0, MPI_COMM_WORLD);
+  if (res != MPI_SUCCESS) mpi_error(res, "Failed to bcast the cell list.");
+
+  /* And apply to our cells. */
+  for (int k = 0; k < nr_cells; k++) cells[k].nodeID = celllist[k];
+
+  free(weights);
+}
+#endif /* WITH_MPI */
+
 /**
  * @brief Repartition the space using the given repartition type.
  *
@@ -1869,11 +2366,18 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
                            int nr_nodes, struct space *s, struct task *tasks,
                            int nr_tasks) {
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
 
   ticks tic = getticks();
 
-  if (reparttype->type == REPART_METIS_VERTEX_EDGE_COSTS) {
+  if (reparttype->type == REPART_DIFFUSION) {
+    repart_diffusion(reparttype, nodeID, nr_nodes, s, tasks, nr_tasks);
+
+  } else if (reparttype->type == REPART_HILBERT) {
+    repart_hilbert(reparttype, nodeID, nr_nodes, s, tasks, nr_tasks);
+
+#if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
+  } else if (reparttype->type == REPART_METIS_VERTEX_EDGE_COSTS) {
     repart_edge_metis(1, 1, 0, reparttype, nodeID, nr_nodes, s, tasks,
                       nr_tasks);
 
@@ -1887,6 +2391,7 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
 
   } else if (reparttype->type == REPART_METIS_VERTEX_COUNTS) {
     repart_memory_metis(reparttype, nodeID, nr_nodes, s);
+#endif
 
   } else if (reparttype->type == REPART_NONE) {
     /* Doing nothing. */
@@ -1899,7 +2404,7 @@ void partition_repartition(struct repartition *reparttype, int nodeID,
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
 #else
-  error("SWIFT was not compiled with METIS or ParMETIS support.");
+  error("SWIFT was not compiled with MPI support.");
 #endif
 }
 
@@ -1952,6 +2457,39 @@ void partition_initial_partition(struct partition *initial_partition,
       return;
     }
 
+  } else if (initial_partition->type == INITPART_HILBERT) {
+#if defined(WITH_MPI)
+    /* Cut the Hilbert curve through the cells into pieces with the same
+     * memory use of particles. */
+    double *weights = NULL;
+    int *celllist = NULL;
+    if ((weights = (double *)malloc(sizeof(double) * s->nr_cells)) == NULL)
+      error("Failed to allocate weights buffer.");
+    if ((celllist = (int *)malloc(sizeof(int) * s->nr_cells)) == NULL)
+      error("Failed to allocate celllist");
+
+    /* Check each particle and accumulate the sizes per cell. */
+    accumulate_sizes(s, s->e->verbose, weights);
+
+    pick_hilbert(nodeID, s, nr_nodes, weights, celllist);
+    for (int k = 0; k < s->nr_cells; k++)
+      s->cells_top[k].nodeID = celllist[k];
+    free(weights);
+    free(celllist);
+
+    /* A few heavy cells can leave a node without cells. */
+    if (!check_complete(s, (nodeID == 0), nr_nodes)) {
+      if (nodeID == 0)
+        message(
+            "Hilbert initial partition failed, using a vectorised partition");
+      initial_partition->type = INITPART_VECTORIZE;
+      partition_initial_partition(initial_partition, nodeID, nr_nodes, s);
+      return;
+    }
+#else
+    error("SWIFT was not compiled with MPI support");
+#endif
+
   } else if (initial_partition->type == INITPART_METIS_WEIGHT ||
              initial_partition->type == INITPART_METIS_WEIGHT_EDGE ||
              initial_partition->type == INITPART_METIS_NOWEIGHT) {
@@ -2098,6 +2636,9 @@ void partition_init(struct partition *partition,
     case 'v':
       partition->type = INITPART_VECTORIZE;
       break;
+    case 'h':
+      partition->type = INITPART_HILBERT;
+      break;
 #if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
     case 'r':
       partition->type = INITPART_METIS_NOWEIGHT;
@@ -2111,14 +2652,14 @@ void partition_init(struct partition *partition,
     default:
       message("Invalid choice of initial partition type '%s'.", part_type);
       error(
-          "Permitted values are: 'grid', 'region', 'memory', 'edgememory' or "
-          "'vectorized'");
+          "Permitted values are: 'grid', 'region', 'memory', 'edgememory', "
+          "'hilbert' or 'vectorized'");
 #else
     default:
       message("Invalid choice of initial partition type '%s'.", part_type);
       error(
-          "Permitted values are: 'grid' or 'vectorized' when compiled "
-          "without METIS or ParMETIS.");
+          "Permitted values are: 'grid', 'hilbert' or 'vectorized' when "
+          "compiled without METIS or ParMETIS.");
 #endif
   }
 
@@ -2135,6 +2676,12 @@ void partition_init(struct partition *partition,
   if (strcmp("none", part_type) == 0) {
     repartition->type = REPART_NONE;
 
+  } else if (strcmp("diffusion", part_type) == 0) {
+    repartition->type = REPART_DIFFUSION;
+
+  } else if (strcmp("hilbert", part_type) == 0) {
+    repartition->type = REPART_HILBERT;
+
 #if defined(HAVE_METIS) || defined(HAVE_PARMETIS)
   } else if (strcmp("fullcosts", part_type) == 0) {
     repartition->type = REPART_METIS_VERTEX_EDGE_COSTS;
@@ -2152,13 +2699,13 @@ void partition_init(struct partition *partition,
     message("Invalid choice of re-partition type '%s'.", part_type);
     error(
         "Permitted values are: 'none', 'fullcosts', 'edgecosts' "
-        "'memory' or 'timecosts'");
+        "'memory', 'timecosts', 'diffusion' or 'hilbert'");
 #else
   } else {
     message("Invalid choice of re-partition type '%s'.", part_type);
     error(
-        "Permitted values are: 'none' when compiled without "
-        "METIS or ParMETIS.");
+        "Permitted values are: 'none', 'diffusion' or 'hilbert' when "
+        "compiled without METIS or ParMETIS.");
 #endif
   }
 
@@ -2195,6 +2742,29 @@ void partition_init(struct partition *partition,
   repartition->itr =
       parser_get_opt_param_float(params, "DomainDecomposition:itr", 100.0f);
 
+  /* Largest fraction of the particle data moved by a diffusion repartition. */
+  repartition->diffusion_fraction = parser_get_opt_param_float(
+      params, "DomainDecomposition:diffusion_fraction", 0.1f);
+  if (repartition->diffusion_fraction <= 0.f ||
+      repartition->diffusion_fraction > 1.f)
+    error(
+        "Invalid DomainDecomposition:diffusion_fraction, must be greater "
+        "than 0 and less than equal to 1");
+
+  /* Number of times the top-level cells can be split when one of them costs
+   * more than the given fraction of the share of a node. */
+  repartition->split_depth =
+      parser_get_opt_param_int(params, "DomainDecomposition:split_depth", 0);
+  if (repartition->split_depth < 0)
+    error("Invalid DomainDecomposition:split_depth, must be positive");
+  repartition->split_fraction = parser_get_opt_param_float(
+      params, "DomainDecomposition:split_fraction", 0.5f);
+  if (repartition->split_fraction <= 0.f)
+    error(
+        "Invalid DomainDecomposition:split_fraction, must be greater than "
+        "zero");
+  repartition->nr_splits = 0;
+
   /* Do we have fixed costs available? These can be used to force
    * repartitioning at any time. Not required if not repartitioning.*/
   repartition->use_fixed_costs = parser_get_opt_param_int(
@@ -2253,7 +2823,7 @@ void partition_clean(struct partition *partition,
  */
 static int repart_init_fixed_costs(void) {
 
-#if defined(WITH_MPI) && (defined(HAVE_METIS) || defined(HAVE_PARMETIS))
+#if defined(WITH_MPI)
   /* Set the default fixed cost. */
   for (int j = 0; j < task_type_count; j++) {
     for (int k = 0; k < task_subtype_count; k++) {
@@ -2547,10 +3117,13 @@ int partition_space_to_space(double *oldh, double *oldcdim, int *oldnodeIDs,
     for (int j = 0; j < s->cdim[1]; j++) {
       for (int k = 0; k < s->cdim[2]; k++) {
 
-        /* Scale indices to old cell space. */
-        const int ii = rint(i * s->iwidth[0] * oldh[0]);
-        const int jj = rint(j * s->iwidth[1] * oldh[1]);
-        const int kk = rint(k * s->iwidth[2] * oldh[2]);
+        /* Old cell containing the centre of the new one. */
+        const int ii = min((int)((i + 0.5) * s->width[0] / oldh[0]),
+                           (int)oldcdim[0] - 1);
+        const int jj = min((int)((j + 0.5) * s->width[1] / oldh[1]),
+                           (int)oldcdim[1] - 1);
+        const int kk = min((int)((k + 0.5) * s->width[2] / oldh[2]),
+                           (int)oldcdim[2] - 1);
 
         const int cid = cell_getid(s->cdim, i, j, k);
         const int oldcid = cell_getid(oldcdim, ii, jj, kk);
@@ -29,7 +29,8 @@ enum partition_type {
   INITPART_VECTORIZE,
   INITPART_METIS_WEIGHT,
   INITPART_METIS_NOWEIGHT,
-  INITPART_METIS_WEIGHT_EDGE
+  INITPART_METIS_WEIGHT_EDGE,
+  INITPART_HILBERT
 };
 
 /* Simple descriptions of types for reports. */
@@ -48,7 +49,9 @@ enum repartition_type {
   REPART_METIS_VERTEX_EDGE_COSTS,
   REPART_METIS_EDGE_COSTS,
   REPART_METIS_VERTEX_COUNTS,
-  REPART_METIS_VERTEX_COSTS_TIMEBINS
+  REPART_METIS_VERTEX_COSTS_TIMEBINS,
+  REPART_DIFFUSION,
+  REPART_HILBERT
 };
 
 /* Repartition preferences. */
@@ -59,6 +62,12 @@ struct repartition {
   float itr;
   int usemetis;
   int adaptive;
+  float diffusion_fraction;
+
+  /* Splitting of the top-level cells. */
+  int split_depth;
+  int nr_splits;
+  float split_fraction;
 
   int use_fixed_costs;
   int use_ticks;
@@ -468,7 +468,11 @@ void proxy_cells_exchange_first_mapper(void *map_data, int num_elements,
 #endif  // WITH_MPI
 
 /**
- * @brief Exchange the cell structures with all proxies.
+ * @brief Start exchanging the cell structures with all proxies.
+ *
+ * The local cells are packed and sent, and the foreign ones are posted for
+ * reception. The exchange is completed by proxy_cells_exchange_end(), work
+ * not needing the foreign cells can be done in between.
  *
  * @param proxies The list of #proxy that will send/recv cells.
  * @param num_proxies The number of proxies.
@@ -476,8 +480,8 @@ void proxy_cells_exchange_first_mapper(void *map_data, int num_elements,
  * @param with_gravity Are we running with gravity and hence need
  *      to exchange multipoles?
  */
-void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
-                          struct space *s, const int with_gravity) {
+void proxy_cells_exchange_begin(struct proxy *proxies, int num_proxies,
+                                struct space *s, const int with_gravity) {
 
 #ifdef WITH_MPI
 
@@ -536,6 +540,10 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
     reqs_out[k] = proxies[k].req_cells_count_out;
   }
 
+  /* The pcells have been copied to the proxies' buffers. */
+  swift_free("pcells", pcells);
+  swift_free("proxy_cell_offset", offset);
+
   /* Wait for each count to come in and start the recv. */
   for (int k = 0; k < num_proxies; k++) {
     int pid = MPI_UNDEFINED;
@@ -551,13 +559,42 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
   if (MPI_Waitall(num_proxies, reqs_out, MPI_STATUSES_IGNORE) != MPI_SUCCESS)
     error("MPI_Waitall on sends failed.");
 
+  free(reqs);
+
+#else
+  error("SWIFT was not compiled with MPI support.");
+#endif
+}
+
+/**
+ * @brief Complete the exchange of the cell structures with all proxies
+ * started by proxy_cells_exchange_begin().
+ *
+ * @param proxies The list of #proxy that will send/recv cells.
+ * @param num_proxies The number of proxies.
+ * @param s The space into which the particles will be unpacked.
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
+ */
+void proxy_cells_exchange_end(struct proxy *proxies, int num_proxies,
+                              struct space *s, const int with_gravity) {
+
+#ifdef WITH_MPI
+
+  MPI_Request *reqs;
+  if ((reqs = (MPI_Request *)malloc(sizeof(MPI_Request) * 2 * num_proxies)) ==
+      NULL)
+    error("Failed to allocate request buffers.");
+  MPI_Request *reqs_in = reqs;
+  MPI_Request *reqs_out = &reqs[num_proxies];
+
   /* Set the requests for the cells. */
   for (int k = 0; k < num_proxies; k++) {
     reqs_in[k] = proxies[k].req_cells_in;
     reqs_out[k] = proxies[k].req_cells_out;
   }
 
-  tic2 = getticks();
+  ticks tic2 = getticks();
 
   /* Wait for each pcell array to come in from the proxies. */
   for (int k = 0; k < num_proxies; k++) {
@@ -582,8 +619,6 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
 
   /* Clean up. */
   free(reqs);
-  swift_free("pcells", pcells);
-  swift_free("proxy_cell_offset", offset);
   for (int k = 0; k < num_proxies; k++) {
     swift_free("pcells_in", proxies[k].pcells_in);
     swift_free("pcells_out", proxies[k].pcells_out);
@@ -596,6 +631,22 @@ void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
 #endif
 }
 
+/**
+ * @brief Exchange the cell structures with all proxies.
+ *
+ * @param proxies The list of #proxy that will send/recv cells.
+ * @param num_proxies The number of proxies.
+ * @param s The space into which the particles will be unpacked.
+ * @param with_gravity Are we running with gravity and hence need
+ *      to exchange multipoles?
+ */
+void proxy_cells_exchange(struct proxy *proxies, int num_proxies,
+                          struct space *s, const int with_gravity) {
+
+  proxy_cells_exchange_begin(proxies, num_proxies, s, with_gravity);
+  proxy_cells_exchange_end(proxies, num_proxies, s, with_gravity);
+}
+
 /**
  * @brief Add a cell to the given proxy's input list.
  *
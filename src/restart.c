@@ -29,16 +29,25 @@
 #include "engine.h"
 #include "error.h"
 #include "restart.h"
+#include "threadpool.h"
 #include "version.h"
 
 #include <errno.h>
 #include <glob.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
+/* zlib headers. */
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
 /* The signature for restart files. */
 #define SWIFT_RESTART_SIGNATURE "SWIFT-restart-file"
 #define SWIFT_RESTART_END_SIGNATURE "SWIFT-restart-file:end"
@@ -52,6 +61,105 @@ struct header {
   char label[LABLEN + 1]; /* A label for data */
 };
 
+/* Label of the block describing the restart file format. Only present when
+ * the particle arrays are written in blocks or aligned. */
+#define RESTART_FORMAT_LABEL "restart_format"
+
+/* Version of the restart file format. */
+#define RESTART_FORMAT_VERSION 2
+
+/* Magic number starting the arrays written in blocks. */
+#define RESTART_ARRAY_MAGIC "SWIFTARR"
+
+/* Size in bytes of the blocks the particle arrays are split into. */
+#define RESTART_BLOCK_SIZE (1 << 20)
+
+/* The ways a block of an array can be stored. */
+enum restart_block_kind {
+  restart_block_raw = 0,     /* As in memory. */
+  restart_block_deflate = 1, /* Compressed with zlib. */
+  restart_block_in_base = 2, /* Unchanged since the last full dump. */
+};
+
+/* Description of the format of the file. */
+struct restart_format {
+  int version;          /* Version of the format. */
+  int compression;      /* Deflate level used for the blocks. */
+  long long stamp;      /* Unique identifier of this dump. */
+  long long base_stamp; /* Identifier of the full dump we depend on or 0. */
+  int blocked;          /* Are the particle arrays written in blocks? */
+  int alignment;        /* Alignment of the particle arrays in the file. */
+};
+
+/* Header of an array written in blocks. */
+struct restart_array_header {
+  char magic[8];     /* RESTART_ARRAY_MAGIC. */
+  size_t len;        /* Length of the array in bytes. */
+  size_t block_size; /* Length of a block in bytes. */
+  size_t nr_blocks;  /* Number of blocks. */
+};
+
+/* Header of a block of an array. */
+struct restart_block_header {
+  uint64_t checksum;    /* (crc32 << 32) | adler32 of the data. */
+  uint64_t stored;      /* Length of the data following in bytes. */
+  uint64_t base_offset; /* Position of the block in the full dump. */
+  int32_t kind;         /* A #restart_block_kind. */
+  int32_t padding;
+};
+
+/* Check-sums and positions of the blocks of an array in the last full dump.
+ */
+struct restart_base_array {
+  char label[LABLEN + 1];
+  size_t len;
+  size_t nr_blocks;
+  uint64_t *checksums;
+  uint64_t *offsets;
+};
+
+/* State of the writer and reader of the arrays written in blocks. */
+static struct {
+
+  /* Are the arrays of the current file written in blocks? */
+  int blocked;
+
+  /* Alignment of the arrays of the current file (0 if not aligned). */
+  size_t alignment;
+
+  /* Deflate level used when writing. */
+  int compression;
+
+  /* Threadpool used to process the blocks when writing. */
+  struct threadpool *tp;
+
+  /* Is the current dump incremental? */
+  int incremental;
+
+  /* Is the current dump the new base of the incremental ones? */
+  int record_base;
+
+  /* The arrays of the last full dump. */
+  struct restart_base_array *base_arrays;
+  int nr_base_arrays;
+
+  /* Identifier of the last full dump (0 if there is none). */
+  long long base_stamp;
+
+  /* Number of incremental dumps written since the last full one. */
+  int nr_incremental;
+
+  /* The full dump, when reading an incremental one. */
+  FILE *base;
+
+  /* Length of the particle arrays and of what was stored. */
+  size_t len_total, len_stored;
+
+  /* Length of the particle arrays memory-mapped when restoring. */
+  size_t len_mapped;
+
+} restart_blocks;
+
 /**
  * @brief generate a name for a restart file.
  *
@@ -120,6 +228,262 @@ void restart_locate_free(int nfiles, char **files) {
   free(files);
 }
 
+#ifdef HAVE_LIBZ
+
+/**
+ * @brief Compute the check-sum of a block of data.
+ *
+ * The crc32 and adler32 check-sums of the data are combined into a single
+ * 64-bit number, (crc32 << 32) | adler32, which can be recomputed with
+ * python's zlib module.
+ *
+ * @param data the data.
+ * @param len the length of the data in bytes.
+ */
+static uint64_t restart_checksum(const char *data, const size_t len) {
+  const uint64_t crc =
+      crc32(crc32(0L, Z_NULL, 0), (const Bytef *)data, (uInt)len);
+  const uint64_t adler =
+      adler32(adler32(0L, Z_NULL, 0), (const Bytef *)data, (uInt)len);
+  return (crc << 32) | adler;
+}
+
+/**
+ * @brief Length in bytes of a block of an array written in blocks.
+ *
+ * @param len the length of the array in bytes.
+ * @param block_size the length of the blocks in bytes.
+ * @param block the index of the block.
+ */
+static size_t restart_block_length(const size_t len, const size_t block_size,
+                                   const size_t block) {
+  const size_t remaining = len - block * block_size;
+  return remaining < block_size ? remaining : block_size;
+}
+
+/**
+ * @brief Data shared by the threads processing a batch of blocks.
+ */
+struct restart_blocks_batch {
+
+  /* The array. */
+  const char *data;
+
+  /* Length of the array in bytes. */
+  size_t len;
+
+  /* The array in the last full dump (NULL for a full dump). */
+  const struct restart_base_array *base;
+
+  /* Deflate level. */
+  int compression;
+
+  /* Index of the first block of the batch. */
+  size_t first_block;
+
+  /* The headers of the blocks of the batch. */
+  struct restart_block_header *records;
+
+  /* The data to write for each block of the batch. */
+  const char **payloads;
+
+  /* Buffers receiving the compressed blocks. */
+  char **buffers;
+};
+
+/**
+ * @brief Mapper function computing the check-sums and compressing a batch of
+ * blocks of an array.
+ */
+static void restart_blocks_mapper(void *map_data, int num_blocks,
+                                  void *extra_data) {
+
+  struct restart_blocks_batch *b = (struct restart_blocks_batch *)extra_data;
+  struct restart_block_header *records =
+      (struct restart_block_header *)map_data;
+  const size_t offset = records - b->records;
+
+  for (int k = 0; k < num_blocks; k++) {
+
+    const size_t i = offset + k;
+    const size_t block = b->first_block + i;
+    const char *data = b->data + block * RESTART_BLOCK_SIZE;
+    const size_t len = restart_block_length(b->len, RESTART_BLOCK_SIZE, block);
+    struct restart_block_header *r = &records[k];
+    memset(r, 0, sizeof(struct restart_block_header));
+    r->checksum = restart_checksum(data, len);
+
+    /* Unchanged since the last full dump? */
+    if (b->base != NULL && block < b->base->nr_blocks &&
+        b->base->checksums[block] == r->checksum &&
+        restart_block_length(b->base->len, RESTART_BLOCK_SIZE, block) == len) {
+      r->kind = restart_block_in_base;
+      r->base_offset = b->base->offsets[block];
+      b->payloads[i] = NULL;
+      continue;
+    }
+
+    r->kind = restart_block_raw;
+    r->stored = len;
+    b->payloads[i] = data;
+
+    /* Only keep the compressed version if it is smaller. */
+    if (b->compression > 0) {
+      uLongf stored = compressBound(RESTART_BLOCK_SIZE);
+      if (compress2((Bytef *)b->buffers[i], &stored, (const Bytef *)data, len,
+                    b->compression) == Z_OK &&
+          stored < len) {
+        r->kind = restart_block_deflate;
+        r->stored = stored;
+        b->payloads[i] = b->buffers[i];
+      }
+    }
+  }
+}
+
+/**
+ * @brief Read a block of an array and verify its check-sum.
+ *
+ * @param stream the file stream, positioned after the block header.
+ * @param r the block header.
+ * @param dest where to store the block.
+ * @param len the length of the block in bytes.
+ * @param buffer a buffer for the compressed data.
+ * @param buffer_size the size of the buffer.
+ * @param block the index of the block.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_read_block(FILE *stream,
+                               const struct restart_block_header *r,
+                               char *dest, const size_t len, char *buffer,
+                               const size_t buffer_size, const size_t block,
+                               const char *errstr) {
+
+  switch (r->kind) {
+    case restart_block_raw:
+      if (r->stored != len)
+        error("Mismatched length of block %zu of %s in restart file", block,
+              errstr);
+      if (fread(dest, 1, len, stream) != len)
+        error("Failed to restore %s from restart file (%s)", errstr,
+              ferror(stream) ? strerror(errno) : "unexpected end of file");
+      break;
+
+    case restart_block_deflate: {
+      if (r->stored > buffer_size)
+        error("Mismatched length of block %zu of %s in restart file", block,
+              errstr);
+      if (fread(buffer, 1, r->stored, stream) != r->stored)
+        error("Failed to restore %s from restart file (%s)", errstr,
+              ferror(stream) ? strerror(errno) : "unexpected end of file");
+      uLongf dest_len = len;
+      if (uncompress((Bytef *)dest, &dest_len, (const Bytef *)buffer,
+                     r->stored) != Z_OK ||
+          dest_len != len)
+        error("Failed to decompress block %zu of %s from restart file", block,
+              errstr);
+      break;
+    }
+
+    default:
+      error("Invalid kind of block %zu of %s in restart file (%d)", block,
+            errstr, r->kind);
+  }
+
+  if (restart_checksum(dest, len) != r->checksum)
+    error("Check-sum mismatch in block %zu of %s in restart file", block,
+          errstr);
+}
+
+#endif /* HAVE_LIBZ */
+
+/**
+ * @brief Release the description of the arrays of the last full dump.
+ */
+static void restart_free_base_arrays(void) {
+  for (int k = 0; k < restart_blocks.nr_base_arrays; k++) {
+    free(restart_blocks.base_arrays[k].checksums);
+    free(restart_blocks.base_arrays[k].offsets);
+  }
+  free(restart_blocks.base_arrays);
+  restart_blocks.base_arrays = NULL;
+  restart_blocks.nr_base_arrays = 0;
+  restart_blocks.base_stamp = 0;
+}
+
+/**
+ * @brief Read the block describing the format of a restart file, if present.
+ *
+ * Leaves the stream untouched if the next block is not the format one, as
+ * is the case for restart files without arrays written in blocks or aligned.
+ *
+ * @param stream the file stream, positioned after the version.
+ * @param format the format read.
+ *
+ * @result 1 if the format was found.
+ */
+static int restart_read_format(FILE *stream, struct restart_format *format) {
+
+  const long pos = ftell(stream);
+  struct header head;
+  if (fread(&head, sizeof(struct header), 1, stream) != 1)
+    error("Failed to read a header from restart file (%s)", strerror(errno));
+  head.label[LABLEN] = '\0';
+
+  /* The first version of the format was shorter and always blocked. */
+  if (strcmp(head.label, RESTART_FORMAT_LABEL) == 0 &&
+      head.len <= sizeof(struct restart_format)) {
+    memset(format, 0, sizeof(struct restart_format));
+    if (fread(format, head.len, 1, stream) != 1)
+      error("Failed to read the restart file format (%s)", strerror(errno));
+    if (format->version == 1) format->blocked = 1;
+    return 1;
+  }
+
+  if (fseek(stream, pos, SEEK_SET) != 0)
+    error("Failed to seek in restart file (%s)", strerror(errno));
+  return 0;
+}
+
+/**
+ * @brief Open the full restart file an incremental one depends on.
+ *
+ * @param filename name of the incremental restart file.
+ * @param stamp the identifier of the full dump expected.
+ */
+static FILE *restart_open_base(const char *filename, const long long stamp) {
+
+  char basename[FNAMELEN];
+  if (snprintf(basename, FNAMELEN, "%s.base", filename) >= FNAMELEN)
+    error("Restart file name too long: %s", filename);
+
+  FILE *base = fopen(basename, "r");
+  if (base == NULL)
+    error(
+        "Failed to open the full restart file '%s' the incremental file '%s' "
+        "depends on (%s)",
+        basename, filename, strerror(errno));
+
+  /* Skip the signature and version. */
+  for (int k = 0; k < 2; k++) {
+    struct header head;
+    if (fread(&head, sizeof(struct header), 1, base) != 1 ||
+        fseek(base, head.len, SEEK_CUR) != 0)
+      error("Failed to read restart file '%s' (%s)", basename,
+            strerror(errno));
+  }
+
+  struct restart_format format;
+  if (!restart_read_format(base, &format) || format.stamp != stamp)
+    error(
+        "'%s' is not the full restart file '%s' was written against. "
+        "Incremental restart files written before the last full dump (e.g. "
+        "the .prev files) cannot be used.",
+        basename, filename);
+
+  return base;
+}
+
 /**
  * @brief Write a restart file for the state of the given engine struct.
  *
@@ -133,6 +497,12 @@ void restart_write(struct engine *e, const char *filename) {
   /* Save a backup the existing restart file, if requested. */
   if (e->restart_save) restart_save_previous(filename);
 
+  /* The particles restored from this file may still be memory-mapped to it.
+   * Make sure we do not overwrite it in place. */
+  if (restart_blocks.len_mapped > 0 && unlink(filename) != 0 &&
+      errno != ENOENT)
+    message("Failed to unlink file '%s' (%s)", filename, strerror(errno));
+
   /* Use a single Lustre stripe with a rank-based OST offset? */
   if (e->restart_lustre_OST_count != 0) {
 
@@ -163,6 +533,42 @@ void restart_write(struct engine *e, const char *filename) {
   restart_write_blocks((void *)package_version(), strlen(package_version()), 1,
                        stream, "version", "SWIFT version");
 
+  /* Are the particle arrays written in blocks or aligned? */
+  struct restart_format format;
+  memset(&format, 0, sizeof(struct restart_format));
+  restart_blocks.blocked = e->restart_compression > 0 ||
+                           e->restart_checksums ||
+                           e->restart_incremental_dumps > 0;
+  restart_blocks.alignment = 0;
+  if (!restart_blocks.blocked && e->restart_page_aligned)
+    restart_blocks.alignment = RESTART_ARRAY_ALIGNMENT;
+  if (restart_blocks.blocked) {
+    restart_blocks.compression = e->restart_compression;
+    restart_blocks.tp = &e->threadpool;
+    restart_blocks.len_total = 0;
+    restart_blocks.len_stored = 0;
+
+    /* Incremental dump or new full one? */
+    restart_blocks.incremental =
+        e->restart_incremental_dumps > 0 && restart_blocks.base_stamp != 0 &&
+        restart_blocks.nr_incremental < e->restart_incremental_dumps;
+    restart_blocks.record_base =
+        e->restart_incremental_dumps > 0 && !restart_blocks.incremental;
+    if (!restart_blocks.incremental) restart_free_base_arrays();
+
+    format.compression = e->restart_compression;
+    format.base_stamp =
+        restart_blocks.incremental ? restart_blocks.base_stamp : 0;
+  }
+  if (restart_blocks.blocked || restart_blocks.alignment > 0) {
+    format.version = RESTART_FORMAT_VERSION;
+    format.stamp = ((long long)time(NULL) << 24) ^ (long long)getticks();
+    format.blocked = restart_blocks.blocked;
+    format.alignment = restart_blocks.alignment;
+    restart_write_blocks(&format, sizeof(struct restart_format), 1, stream,
+                         RESTART_FORMAT_LABEL, "restart format");
+  }
+
   engine_struct_dump(e, stream);
 
   /* Just an END statement to spot truncated files. */
@@ -172,6 +578,40 @@ void restart_write(struct engine *e, const char *filename) {
 
   fclose(stream);
 
+  if (restart_blocks.blocked) {
+
+    /* Keep a link to a new full dump for the incremental ones to follow. */
+    if (restart_blocks.record_base) {
+      char basename[FNAMELEN];
+      if (snprintf(basename, FNAMELEN, "%s.base", filename) >= FNAMELEN)
+        error("Restart file name too long: %s", filename);
+      if (unlink(basename) != 0 && errno != ENOENT)
+        message("Failed to unlink file '%s' (%s)", basename, strerror(errno));
+      if (link(filename, basename) != 0) {
+        message(
+            "WARNING: failed to link '%s' to '%s' (%s). The next restart dump "
+            "will be a full one.",
+            filename, basename, strerror(errno));
+        restart_free_base_arrays();
+      } else {
+        restart_blocks.base_stamp = format.stamp;
+      }
+      restart_blocks.nr_incremental = 0;
+    } else if (restart_blocks.incremental) {
+      restart_blocks.nr_incremental++;
+    }
+
+    if (e->verbose)
+      message("Particle arrays stored using %.1f%% of their size (%s dump).",
+              restart_blocks.len_total > 0
+                  ? 100. * restart_blocks.len_stored / restart_blocks.len_total
+                  : 100.,
+              restart_blocks.incremental ? "incremental" : "full");
+
+    restart_blocks.blocked = 0;
+  }
+  restart_blocks.alignment = 0;
+
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -215,9 +655,37 @@ void restart_read(struct engine *e, const char *filename) {
         " badly.",
         package_version(), version);
 
+  /* Are the particle arrays written in blocks or aligned? */
+  struct restart_format format;
+  memset(&format, 0, sizeof(struct restart_format));
+  if (restart_read_format(stream, &format) &&
+      (format.version < 1 || format.version > RESTART_FORMAT_VERSION))
+    error("Unknown restart file format version: %d", format.version);
+  restart_blocks.blocked = format.blocked;
+  restart_blocks.alignment = format.alignment;
+  if (restart_blocks.blocked) {
+#ifndef HAVE_LIBZ
+    error(
+        "Restart file '%s' stores its particle arrays in blocks, which "
+        "requires SWIFT to be compiled with zlib.",
+        filename);
+#endif
+    if (format.base_stamp != 0)
+      restart_blocks.base = restart_open_base(filename, format.base_stamp);
+  }
+
   engine_struct_restore(e, stream);
   fclose(stream);
 
+  if (restart_blocks.base != NULL) fclose(restart_blocks.base);
+  restart_blocks.base = NULL;
+  restart_blocks.blocked = 0;
+  restart_blocks.alignment = 0;
+
+  if (e->verbose && restart_blocks.len_mapped > 0)
+    message("Memory-mapped %.3f MB of particle arrays.",
+            restart_blocks.len_mapped / (1024. * 1024.));
+
   if (e->verbose)
     message("took %.3f %s.", clocks_from_ticks(getticks() - tic),
             clocks_getunit());
@@ -297,6 +765,358 @@ void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
   }
 }
 
+/**
+ * @brief Write an array aligned on RESTART_ARRAY_ALIGNMENT bytes in the file.
+ *
+ * The header is followed by the padding needed to align the data, which is
+ * included in the length stored in the header.
+ *
+ * @param ptr pointer to the memory
+ * @param len the length of the array in bytes.
+ * @param stream the file stream
+ * @param label a label for the content, can only be 20 characters.
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_write_aligned(void *ptr, const size_t len, FILE *stream,
+                                  const char *label, const char *errstr) {
+
+  if (len == 0) return;
+
+  const size_t align = restart_blocks.alignment;
+  const size_t pos = ftell(stream) + sizeof(struct header);
+  const size_t padding = (align - pos % align) % align;
+
+  struct header head;
+  memset(&head, 0, sizeof(struct header));
+  head.len = padding + len;
+  strncpy(head.label, label, LABLEN);
+  head.label[LABLEN] = '\0';
+
+  /* Skipping the padding leaves a hole in the file. */
+  if (fwrite(&head, sizeof(struct header), 1, stream) != 1 ||
+      fseek(stream, padding, SEEK_CUR) != 0)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+
+  if (fwrite(ptr, 1, len, stream) != len)
+    error("Failed to save %s to restart file (%s)", errstr, strerror(errno));
+}
+
+/**
+ * @brief Read an array aligned on RESTART_ARRAY_ALIGNMENT bytes in the file.
+ *
+ * When the memory is page-aligned, the whole pages of the array are
+ * memory-mapped from the file in place of the memory allocated for it
+ * rather than read. The pages are then only read from the file when first
+ * accessed and copied when first modified, i.e. by the thread that first
+ * updates the particles. Whatever could not be mapped is read.
+ *
+ * @param ptr pointer to the memory
+ * @param len the length of the array in bytes.
+ * @param stream the file stream
+ * @param label the label recovered for the block, needs to be at least 20
+ *              characters, set to NULL if not required
+ * @param errstr a context string to qualify any errors.
+ */
+static void restart_read_aligned(void *ptr, const size_t len, FILE *stream,
+                                 char *label, const char *errstr) {
+
+  if (len == 0) return;
+
+  struct header head;
+  if (fread(&head, sizeof(struct header), 1, stream) != 1)
+    error("Failed to read the %s header from restart file (%s)", errstr,
+          strerror(errno));
+
+  /* Check that the stored length is the same as the expected one. */
+  const size_t align = restart_blocks.alignment;
+  if (head.len < len || head.len - len >= align)
+    error("Mismatched data length in restart file for %s (%zu != %zu)",
+          errstr, head.len, len);
+
+  /* Return label, if required. */
+  if (label != NULL) {
+    head.label[LABLEN] = '\0';
+    strncpy(label, head.label, LABLEN + 1);
+  }
+
+  const long offset = ftell(stream) + (head.len - len);
+  if (offset % align != 0)
+    error("Misaligned %s in restart file", errstr);
+
+  /* Map the whole pages we can. */
+  size_t mapped = 0;
+  const long page = sysconf(_SC_PAGESIZE);
+  if (page > 0 && align % page == 0 && (uintptr_t)ptr % page == 0) {
+    mapped = len - len % page;
+    if (mapped > 0 &&
+        mmap(ptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+             fileno(stream), offset) == MAP_FAILED) {
+
+      /* The failed attempt may have released the memory. */
+      if (mmap(ptr, mapped, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+        error("Failed to restore the memory of %s (%s)", errstr,
+              strerror(errno));
+      mapped = 0;
+    }
+#ifdef MADV_WILLNEED
+    /* Start reading the pages in the background. */
+    if (mapped > 0) madvise(ptr, mapped, MADV_WILLNEED);
+#endif
+  }
+  restart_blocks.len_mapped += mapped;
+
+  /* Read the rest. */
+  if (fseek(stream, offset + mapped, SEEK_SET) != 0)
+    error("Failed to seek in restart file (%s)", strerror(errno));
+  if (fread((char *)ptr + mapped, 1, len - mapped, stream) != len - mapped)
+    error("Failed to restore %s from restart file (%s)", errstr,
+          ferror(stream) ? strerror(errno) : "unexpected end of file");
+}
+
+/**
+ * @brief Write a particle array to a file stream.
+ *
+ * Unless compression, check-sums or incremental dumps are requested, this is
+ * the same as restart_write_blocks() except for the array being aligned in
+ * the file (see Restarts:page_aligned). Otherwise, the array is split into
+ * blocks of RESTART_BLOCK_SIZE bytes, each stored with its check-sum and,
+ * optionally, compressed. In an incremental dump, the blocks unchanged since
+ * the last full dump are only stored as a reference to that dump. The
+ * check-sums and compression are computed on the engine's threadpool.
+ *
+ * Exits the application if the write fails and does nothing if the size is
+ * zero.
+ *
+ * @param ptr pointer to the memory
+ * @param size the blocks
+ * @param nblocks number of blocks to write
+ * @param stream the file stream
+ * @param label a label for the content, can only be 20 characters.
+ * @param errstr a context string to qualify any errors.
+ */
+void restart_write_array(void *ptr, size_t size, size_t nblocks, FILE *stream,
+                         const char *label, const char *errstr) {
+
+  if (!restart_blocks.blocked) {
+    if (restart_blocks.alignment > 0)
+      restart_write_aligned(ptr, size * nblocks, stream, label, errstr);
+    else
+      restart_write_blocks(ptr, size, nblocks, stream, label, errstr);
+    return;
+  }
+
+#ifdef HAVE_LIBZ
+  const size_t len = size * nblocks;
+  if (len == 0) return;
+
+  struct header head;
+  memset(&head, 0, sizeof(struct header));
+  strncpy(head.label, label, LABLEN);
+  head.label[LABLEN] = '\0';
+
+  struct restart_array_header array;
+  memcpy(array.magic, RESTART_ARRAY_MAGIC, sizeof(array.magic));
+  array.len = len;
+  array.block_size = RESTART_BLOCK_SIZE;
+  array.nr_blocks = (len + RESTART_BLOCK_SIZE - 1) / RESTART_BLOCK_SIZE;
+
+  /* Where was this array in the last full dump? */
+  struct restart_blocks_batch b;
+  memset(&b, 0, sizeof(struct restart_blocks_batch));
+  if (restart_blocks.incremental) {
+    for (int k = 0; k < restart_blocks.nr_base_arrays; k++)
+      if (strcmp(restart_blocks.base_arrays[k].label, head.label) == 0)
+        b.base = &restart_blocks.base_arrays[k];
+  }
+
+  /* Or are we writing the new full dump? */
+  struct restart_base_array *record = NULL;
+  if (restart_blocks.record_base) {
+    restart_blocks.base_arrays = (struct restart_base_array *)realloc(
+        restart_blocks.base_arrays, (restart_blocks.nr_base_arrays + 1) *
+                                        sizeof(struct restart_base_array));
+    if (restart_blocks.base_arrays == NULL)
+      error("Failed to allocate the list of restart arrays");
+    record = &restart_blocks.base_arrays[restart_blocks.nr_base_arrays++];
+    strcpy(record->label, head.label);
+    record->len = len;
+    record->nr_blocks = array.nr_blocks;
+    record->checksums = (uint64_t *)malloc(array.nr_blocks * sizeof(uint64_t));
+    record->offsets = (uint64_t *)malloc(array.nr_blocks * sizeof(uint64_t));
+    if (record->checksums == NULL || record->offsets == NULL)
+      error("Failed to allocate the description of restart array %s", errstr);
+  }
+
+  /* Write the headers. The length is only known at the end. */
+  const long head_pos = ftell(stream);
+  if (fwrite(&head, sizeof(struct header), 1, stream) != 1 ||
+      fwrite(&array, sizeof(struct restart_array_header), 1, stream) != 1)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+
+  /* Process the blocks in batches of a few per thread. */
+  struct threadpool *tp = restart_blocks.tp;
+  const size_t batch_size = 2 * tp->num_threads;
+  b.data = (const char *)ptr;
+  b.len = len;
+  b.compression = restart_blocks.compression;
+  b.records = (struct restart_block_header *)malloc(
+      batch_size * sizeof(struct restart_block_header));
+  b.payloads = (const char **)malloc(batch_size * sizeof(char *));
+  b.buffers = (char **)calloc(batch_size, sizeof(char *));
+  if (b.records == NULL || b.payloads == NULL || b.buffers == NULL)
+    error("Failed to allocate the restart blocks");
+  if (b.compression > 0) {
+    for (size_t i = 0; i < batch_size; i++) {
+      b.buffers[i] = (char *)malloc(compressBound(RESTART_BLOCK_SIZE));
+      if (b.buffers[i] == NULL)
+        error("Failed to allocate the restart compression buffers");
+    }
+  }
+
+  for (b.first_block = 0; b.first_block < array.nr_blocks;
+       b.first_block += batch_size) {
+
+    size_t count = array.nr_blocks - b.first_block;
+    if (count > batch_size) count = batch_size;
+    threadpool_map(tp, restart_blocks_mapper, b.records, count,
+                   sizeof(struct restart_block_header), /*chunk=*/1, &b);
+
+    for (size_t i = 0; i < count; i++) {
+      const struct restart_block_header *r = &b.records[i];
+      if (record != NULL) {
+        record->checksums[b.first_block + i] = r->checksum;
+        record->offsets[b.first_block + i] = ftell(stream);
+      }
+      if (fwrite(r, sizeof(struct restart_block_header), 1, stream) != 1 ||
+          (r->stored > 0 &&
+           fwrite(b.payloads[i], 1, r->stored, stream) != r->stored))
+        error("Failed to save %s to restart file (%s)", errstr,
+              strerror(errno));
+      restart_blocks.len_stored +=
+          r->stored + sizeof(struct restart_block_header);
+    }
+  }
+  restart_blocks.len_total += len;
+
+  for (size_t i = 0; i < batch_size; i++) free(b.buffers[i]);
+  free(b.buffers);
+  free(b.payloads);
+  free(b.records);
+
+  /* Complete the header now that we know what was written. */
+  const long end_pos = ftell(stream);
+  head.len = end_pos - head_pos - sizeof(struct header);
+  if (fseek(stream, head_pos, SEEK_SET) != 0 ||
+      fwrite(&head, sizeof(struct header), 1, stream) != 1 ||
+      fseek(stream, end_pos, SEEK_SET) != 0)
+    error("Failed to save %s header to restart file (%s)", errstr,
+          strerror(errno));
+#else
+  error("Writing restart arrays in blocks requires zlib.");
+#endif
+}
+
+/**
+ * @brief Read a particle array written by restart_write_array() from a file
+ *        stream into a memory location.
+ *
+ * The check-sums of arrays written in blocks are verified and the aligned
+ * arrays are memory-mapped. Exits the application if the read fails and does
+ * nothing if the size is zero.
+ *
+ * @param ptr pointer to the memory
+ * @param size size of a block
+ * @param nblocks number of blocks to read
+ * @param stream the file stream
+ * @param label the label recovered for the block, needs to be at least 20
+ *              characters, set to NULL if not required
+ * @param errstr a context string to qualify any errors.
+ */
+void restart_read_array(void *ptr, size_t size, size_t nblocks, FILE *stream,
+                        char *label, const char *errstr) {
+
+  if (!restart_blocks.blocked) {
+    if (restart_blocks.alignment > 0)
+      restart_read_aligned(ptr, size * nblocks, stream, label, errstr);
+    else
+      restart_read_blocks(ptr, size, nblocks, stream, label, errstr);
+    return;
+  }
+
+#ifdef HAVE_LIBZ
+  const size_t len = size * nblocks;
+  if (len == 0) return;
+
+  struct header head;
+  struct restart_array_header array;
+  if (fread(&head, sizeof(struct header), 1, stream) != 1 ||
+      fread(&array, sizeof(struct restart_array_header), 1, stream) != 1)
+    error("Failed to read the %s header from restart file (%s)", errstr,
+          strerror(errno));
+
+  if (memcmp(array.magic, RESTART_ARRAY_MAGIC, sizeof(array.magic)) != 0)
+    error("%s is not stored in blocks in restart file", errstr);
+
+  /* Check that the stored length is the same as the expected one. */
+  if (array.len != len || array.block_size == 0 ||
+      array.block_size > RESTART_BLOCK_SIZE ||
+      array.nr_blocks != (len + array.block_size - 1) / array.block_size)
+    error("Mismatched data length in restart file for %s (%zu != %zu)",
+          errstr, array.len, len);
+
+  /* Return label, if required. */
+  if (label != NULL) {
+    head.label[LABLEN] = '\0';
+    strncpy(label, head.label, LABLEN + 1);
+  }
+
+  const size_t buffer_size = compressBound(array.block_size);
+  char *buffer = (char *)malloc(buffer_size);
+  if (buffer == NULL) error("Failed to allocate the restart block buffer");
+
+  for (size_t block = 0; block < array.nr_blocks; block++) {
+
+    char *dest = (char *)ptr + block * array.block_size;
+    const size_t block_len =
+        restart_block_length(len, array.block_size, block);
+
+    struct restart_block_header r;
+    if (fread(&r, sizeof(struct restart_block_header), 1, stream) != 1)
+      error("Failed to restore %s from restart file (%s)", errstr,
+            ferror(stream) ? strerror(errno) : "unexpected end of file");
+
+    if (r.kind != restart_block_in_base) {
+      restart_read_block(stream, &r, dest, block_len, buffer, buffer_size,
+                         block, errstr);
+      continue;
+    }
+
+    /* The block is in the full dump. */
+    FILE *base = restart_blocks.base;
+    if (base == NULL)
+      error("Block %zu of %s refers to a missing full restart file", block,
+            errstr);
+    struct restart_block_header base_r;
+    if (fseek(base, r.base_offset, SEEK_SET) != 0 ||
+        fread(&base_r, sizeof(struct restart_block_header), 1, base) != 1)
+      error("Failed to restore %s from full restart file (%s)", errstr,
+            ferror(base) ? strerror(errno) : "unexpected end of file");
+    if (base_r.kind == restart_block_in_base || base_r.checksum != r.checksum)
+      error("Block %zu of %s does not match the full restart file", block,
+            errstr);
+    restart_read_block(base, &base_r, dest, block_len, buffer, buffer_size,
+                       block, errstr);
+  }
+
+  free(buffer);
+#else
+  error("Reading restart arrays stored in blocks requires zlib.");
+#endif
+}
+
 /**
  * @brief check if the stop file exists in the given directory and optionally
  *        remove it if found.
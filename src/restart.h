@@ -23,6 +23,10 @@
 
 struct engine;
 
+/* Alignment of the particle arrays in the restart files and in memory when
+ * restoring them, such that they can be memory-mapped. */
+#define RESTART_ARRAY_ALIGNMENT 65536
+
 void restart_write(struct engine *e, const char *filename);
 void restart_read(struct engine *e, const char *filename);
 
@@ -35,6 +39,10 @@ void restart_read_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
                          char *label, const char *errstr);
 void restart_write_blocks(void *ptr, size_t size, size_t nblocks, FILE *stream,
                           const char *label, const char *errstr);
+void restart_read_array(void *ptr, size_t size, size_t nblocks, FILE *stream,
+                        char *label, const char *errstr);
+void restart_write_array(void *ptr, size_t size, size_t nblocks, FILE *stream,
+                         const char *label, const char *errstr);
 
 int restart_stop_now(const char *dir, int cleanup);
 
@@ -1122,6 +1122,13 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
   const float H = cosmo->H;
   GET_MU0();
 
+  /* Frames centred on cj in which to express the particle positions */
+  const double origin_i[3] = {cj->loc[0] + shift[0], cj->loc[1] + shift[1],
+                              cj->loc[2] + shift[2]};
+  part_frame_t frame_i[3], frame_j[3];
+  part_get_relative_frame(origin_i, ci->top->loc, frame_i);
+  part_get_relative_frame(cj->loc, cj->top->loc, frame_j);
+
   if (CELL_IS_ACTIVE(ci, e)) {
 
     /* Loop over the parts in ci. */
@@ -1141,9 +1148,9 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
       /* Get some additional information about pi */
       const float hig2 = hi * hi * kernel_gamma2;
-      const float pix = pi->x[0] - (cj->loc[0] + shift[0]);
-      const float piy = pi->x[1] - (cj->loc[1] + shift[1]);
-      const float piz = pi->x[2] - (cj->loc[2] + shift[2]);
+      const float pix = part_get_frame_position(pi, frame_i, 0);
+      const float piy = part_get_frame_position(pi, frame_i, 1);
+      const float piz = part_get_frame_position(pi, frame_i, 2);
 
       /* Loop over the parts in cj. */
       for (int pjd = 0; pjd < count_j && sort_j[pjd].d < di; pjd++) {
@@ -1155,9 +1162,9 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         if (part_is_inhibited(pj, e)) continue;
 
         const float hj = pj->h;
-        const float pjx = pj->x[0] - cj->loc[0];
-        const float pjy = pj->x[1] - cj->loc[1];
-        const float pjz = pj->x[2] - cj->loc[2];
+        const float pjx = part_get_frame_position(pj, frame_j, 0);
+        const float pjy = part_get_frame_position(pj, frame_j, 1);
+        const float pjz = part_get_frame_position(pj, frame_j, 2);
 
         /* Compute the pairwise distance. */
         float dx[3] = {pix - pjx, piy - pjy, piz - pjz};
@@ -1241,9 +1248,9 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
       /* Get some additional information about pj */
       const float hjg2 = hj * hj * kernel_gamma2;
-      const float pjx = pj->x[0] - cj->loc[0];
-      const float pjy = pj->x[1] - cj->loc[1];
-      const float pjz = pj->x[2] - cj->loc[2];
+      const float pjx = part_get_frame_position(pj, frame_j, 0);
+      const float pjy = part_get_frame_position(pj, frame_j, 1);
+      const float pjz = part_get_frame_position(pj, frame_j, 2);
 
       /* Loop over the parts in ci. */
       for (int pid = count_i - 1; pid >= 0 && sort_i[pid].d > dj; pid--) {
@@ -1255,9 +1262,9 @@ void DOPAIR1(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         if (part_is_inhibited(pi, e)) continue;
 
         const float hi = pi->h;
-        const float pix = pi->x[0] - (cj->loc[0] + shift[0]);
-        const float piy = pi->x[1] - (cj->loc[1] + shift[1]);
-        const float piz = pi->x[2] - (cj->loc[2] + shift[2]);
+        const float pix = part_get_frame_position(pi, frame_i, 0);
+        const float piy = part_get_frame_position(pi, frame_i, 1);
+        const float piz = part_get_frame_position(pi, frame_i, 2);
 
         /* Compute the pairwise distance. */
         float dx[3] = {pjx - pix, pjy - piy, pjz - piz};
@@ -1487,6 +1494,11 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
                              cj->loc[2] + shift[2]};
   const double shift_j[3] = {cj->loc[0], cj->loc[1], cj->loc[2]};
 
+  /* The same frames for the particle positions as they are stored */
+  part_frame_t frame_i[3], frame_j[3];
+  part_get_relative_frame(shift_i, ci->top->loc, frame_i);
+  part_get_relative_frame(shift_j, cj->top->loc, frame_j);
+
   int count_active_i = 0, count_active_j = 0;
   struct sort_entry *restrict sort_active_i = NULL;
   struct sort_entry *restrict sort_active_j = NULL;
@@ -1550,9 +1562,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
     /* Get some additional information about pi */
     const float hig2 = hi * hi * kernel_gamma2;
-    const float pix = pi->x[0] - shift_i[0];
-    const float piy = pi->x[1] - shift_i[1];
-    const float piz = pi->x[2] - shift_i[2];
+    const float pix = part_get_frame_position(pi, frame_i, 0);
+    const float piy = part_get_frame_position(pi, frame_i, 1);
+    const float piz = part_get_frame_position(pi, frame_i, 2);
 
     /* Do we need to only check active parts in cj
        (i.e. pi does not need updating) ? */
@@ -1575,9 +1587,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         const float hj = pj->h;
 
         /* Get the position of pj in the right frame */
-        const float pjx = pj->x[0] - shift_j[0];
-        const float pjy = pj->x[1] - shift_j[1];
-        const float pjz = pj->x[2] - shift_j[2];
+        const float pjx = part_get_frame_position(pj, frame_j, 0);
+        const float pjy = part_get_frame_position(pj, frame_j, 1);
+        const float pjz = part_get_frame_position(pj, frame_j, 2);
 
         /* Compute the pairwise distance. */
         const float dx[3] = {pjx - pix, pjy - piy, pjz - piz};
@@ -1656,9 +1668,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         const float hj = pj->h;
 
         /* Get the position of pj in the right frame */
-        const float pjx = pj->x[0] - shift_j[0];
-        const float pjy = pj->x[1] - shift_j[1];
-        const float pjz = pj->x[2] - shift_j[2];
+        const float pjx = part_get_frame_position(pj, frame_j, 0);
+        const float pjy = part_get_frame_position(pj, frame_j, 1);
+        const float pjz = part_get_frame_position(pj, frame_j, 2);
 
         /* Compute the pairwise distance. */
         const float dx[3] = {pix - pjx, piy - pjy, piz - pjz};
@@ -1765,9 +1777,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
 
     /* Get some additional information about pj */
     const float hjg2 = hj * hj * kernel_gamma2;
-    const float pjx = pj->x[0] - shift_j[0];
-    const float pjy = pj->x[1] - shift_j[1];
-    const float pjz = pj->x[2] - shift_j[2];
+    const float pjx = part_get_frame_position(pj, frame_j, 0);
+    const float pjy = part_get_frame_position(pj, frame_j, 1);
+    const float pjz = part_get_frame_position(pj, frame_j, 2);
 
     /* Do we need to only check active parts in ci
        (i.e. pj does not need updating) ? */
@@ -1791,9 +1803,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         const float hig2 = hi * hi * kernel_gamma2;
 
         /* Get the position of pi in the right frame */
-        const float pix = pi->x[0] - shift_i[0];
-        const float piy = pi->x[1] - shift_i[1];
-        const float piz = pi->x[2] - shift_i[2];
+        const float pix = part_get_frame_position(pi, frame_i, 0);
+        const float piy = part_get_frame_position(pi, frame_i, 1);
+        const float piz = part_get_frame_position(pi, frame_i, 2);
 
         /* Compute the pairwise distance. */
         const float dx[3] = {pix - pjx, piy - pjy, piz - pjz};
@@ -1873,9 +1885,9 @@ void DOPAIR2(struct runner *r, struct cell *ci, struct cell *cj, const int sid,
         const float hig2 = hi * hi * kernel_gamma2;
 
         /* Get the position of pi in the right frame */
-        const float pix = pi->x[0] - shift_i[0];
-        const float piy = pi->x[1] - shift_i[1];
-        const float piz = pi->x[2] - shift_i[2];
+        const float pix = part_get_frame_position(pi, frame_i, 0);
+        const float piy = part_get_frame_position(pi, frame_i, 1);
+        const float piz = part_get_frame_position(pi, frame_i, 2);
 
         /* Compute the pairwise distance. */
         const float dx[3] = {pjx - pix, pjy - piy, pjz - piz};
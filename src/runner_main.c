@@ -33,6 +33,7 @@
 /* Local headers. */
 #include "engine.h"
 #include "feedback.h"
+#include "hydro_pair_geometry.h"
 #include "scheduler.h"
 #include "space_getsid.h"
 #include "timers.h"
@@ -201,6 +202,11 @@ void *runner_main(void *data) {
       r->t = t;
 #endif
 
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+      /* Attach the face geometry buffer of hydro tasks to this thread */
+      hydro_pair_geometry_task_begin(sched, t);
+#endif
+
       const ticks task_beg = getticks();
       /* Different types of tasks... */
       switch (t->type) {
@@ -512,6 +518,11 @@ void *runner_main(void *data) {
             free(t->buff);
           } else if (t->subtype == task_subtype_limiter) {
             free(t->buff);
+#ifndef MPI_FULL_PART_UPDATES
+          } else if (t->subtype == task_subtype_rho ||
+                     t->subtype == task_subtype_gradient) {
+            free(t->buff);
+#endif
           }
           break;
         case task_type_recv:
@@ -527,9 +538,12 @@ void *runner_main(void *data) {
             free(t->buff);
           } else if (t->subtype == task_subtype_xv) {
             runner_do_recv_part(r, ci, 1, 1);
-          } else if (t->subtype == task_subtype_rho) {
-            runner_do_recv_part(r, ci, 0, 1);
-          } else if (t->subtype == task_subtype_gradient) {
+          } else if (t->subtype == task_subtype_rho ||
+                     t->subtype == task_subtype_gradient) {
+#ifndef MPI_FULL_PART_UPDATES
+            cell_unpack_part_updates(ci, (const char *)t->buff);
+            free(t->buff);
+#endif
             runner_do_recv_part(r, ci, 0, 1);
           } else if (t->subtype == task_subtype_rt_gradient) {
             runner_do_recv_part(r, ci, 2, 1);
@@ -626,6 +640,10 @@ void *runner_main(void *data) {
       }
       r->active_time += (getticks() - task_beg);
 
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+      hydro_pair_geometry_task_end();
+#endif
+
 /* Mark that we have run this task on these cells */
 #ifdef SWIFT_DEBUG_CHECKS
       if (ci != NULL) {
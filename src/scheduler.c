@@ -47,6 +47,8 @@
 #include "intrinsics.h"
 #include "kernel_hydro.h"
 #include "memuse.h"
+#include "mpiaggregate.h"
+#include "mpirma.h"
 #include "mpiuse.h"
 #include "queue.h"
 #include "sort_part.h"
@@ -1927,6 +1929,13 @@ void scheduler_reset(struct scheduler *s, int size) {
     if ((s->tid_active =
              (int *)swift_malloc("tid_active", sizeof(int) * size)) == NULL)
       error("Failed to allocate aactive task lists.");
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+    if ((s->pair_geometry = (struct hydro_pair_geometry_buffer *)swift_calloc(
+             "pair_geometry", size,
+             sizeof(struct hydro_pair_geometry_buffer))) == NULL)
+      error("Failed to allocate pair geometry buffers.");
+#endif
   }
 
   /* Reset the counters. */
@@ -1943,6 +1952,57 @@ void scheduler_reset(struct scheduler *s, int size) {
   for (int k = 0; k < s->nr_queues; k++) s->queues[k].tasks = s->tasks;
 }
 
+/**
+ * @brief Make sure the #scheduler has room for a given number of tasks,
+ * keeping the tasks already added.
+ *
+ * Only valid before the unlocks of the tasks have been set.
+ *
+ * @param s The #scheduler.
+ * @param size The number of tasks needed.
+ */
+void scheduler_reserve(struct scheduler *s, int size) {
+
+  if (size <= s->size) return;
+
+  struct task *tasks = NULL;
+  if (swift_memalign("tasks", (void **)&tasks, task_align,
+                     size * sizeof(struct task)) != 0)
+    error("Failed to allocate task array.");
+  memcpy(tasks, s->tasks, s->tasks_next * sizeof(struct task));
+
+  int *tasks_ind = NULL;
+  if ((tasks_ind = (int *)swift_malloc("tasks_ind", sizeof(int) * size)) ==
+      NULL)
+    error("Failed to allocate task lists.");
+  memcpy(tasks_ind, s->tasks_ind, s->nr_tasks * sizeof(int));
+
+  /* Swap in the new lists, the rest holds nothing yet. */
+  const int nr_tasks = s->nr_tasks;
+  const int tasks_next = s->tasks_next;
+  scheduler_free_tasks(s);
+  s->tasks = tasks;
+  s->tasks_ind = tasks_ind;
+
+  if ((s->tid_active = (int *)swift_malloc("tid_active", sizeof(int) * size)) ==
+      NULL)
+    error("Failed to allocate aactive task lists.");
+
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  if ((s->pair_geometry = (struct hydro_pair_geometry_buffer *)swift_calloc(
+           "pair_geometry", size, sizeof(struct hydro_pair_geometry_buffer))) ==
+      NULL)
+    error("Failed to allocate pair geometry buffers.");
+#endif
+
+  s->size = size;
+  s->nr_tasks = nr_tasks;
+  s->tasks_next = tasks_next;
+
+  /* Set the task pointers in the queues. */
+  for (int k = 0; k < s->nr_queues; k++) s->queues[k].tasks = s->tasks;
+}
+
 /**
  * @brief Compute the task weights
  *
@@ -2411,6 +2471,11 @@ void scheduler_enqueue_mapper(void *map_data, int num_elements,
  */
 void scheduler_start(struct scheduler *s) {
 
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  /* Geometry recorded during earlier launches must not be replayed. */
+  s->pair_geometry_launch++;
+#endif
+
   /* Re-wait the tasks. */
   if (s->active_count > 1000) {
     threadpool_map(s->threadpool, scheduler_rewait_mapper, s->tid_active,
@@ -2436,6 +2501,62 @@ void scheduler_start(struct scheduler *s) {
   pthread_mutex_unlock(&s->sleep_mutex);
 }
 
+#ifdef WITH_MPI
+/**
+ * @brief Size in bytes of the message of a send or recv task.
+ *
+ * This is the size the task would exchange if enqueued now. It matches the
+ * sizes used by scheduler_enqueue() and only changes between rebuilds for the
+ * sub-types whose counts are updated at every step (e.g. the #spart).
+ *
+ * @param t The send or recv #task.
+ */
+size_t scheduler_mpi_message_size(const struct task *t) {
+
+  const struct cell *c = t->ci;
+
+  switch (t->subtype) {
+    case task_subtype_tend:
+      return c->mpi.pcell_size * sizeof(struct pcell_step);
+    case task_subtype_part_swallow:
+      return c->hydro.count * sizeof(struct black_holes_part_data);
+    case task_subtype_bpart_merger:
+      return c->black_holes.count * sizeof(struct black_holes_bpart_data);
+#ifndef MPI_FULL_PART_UPDATES
+    case task_subtype_rho:
+    case task_subtype_gradient:
+      return c->hydro.count * part_mpi_update_fields.size;
+#endif
+    case task_subtype_xv:
+#ifdef MPI_FULL_PART_UPDATES
+    case task_subtype_rho:
+    case task_subtype_gradient:
+#endif
+    case task_subtype_rt_gradient:
+    case task_subtype_rt_transport:
+    case task_subtype_part_prep1:
+      return c->hydro.count * sizeof(struct part);
+    case task_subtype_limiter:
+      return c->hydro.count * sizeof(timebin_t);
+    case task_subtype_gpart:
+      return c->grav.count * sizeof(struct gpart);
+    case task_subtype_spart_density:
+    case task_subtype_spart_prep2:
+      return c->stars.count * sizeof(struct spart);
+    case task_subtype_bpart_rho:
+    case task_subtype_bpart_feedback:
+      return c->black_holes.count * sizeof(struct bpart);
+    case task_subtype_sf_counts:
+      return c->mpi.pcell_size * sizeof(struct pcell_sf_stars);
+    case task_subtype_grav_counts:
+      return c->mpi.pcell_size * sizeof(struct pcell_sf_grav);
+    default:
+      error("Unknown communication sub-type");
+  }
+  return 0;
+}
+#endif
+
 /**
  * @brief Put a task on one of the queues.
  *
@@ -2473,6 +2594,12 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
   else {
 #ifdef WITH_MPI
     int err = MPI_SUCCESS;
+
+    /* Message left to the aggregation layer or to the RMA window, if any. */
+    int aggregate = 0;
+    struct mpirma_slot *rma_slot = NULL;
+    void *layer_buff = NULL;
+    size_t layer_size = 0;
 #endif
 
     /* Find the previous owner for each task type, and do
@@ -2545,6 +2672,15 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
               sizeof(struct black_holes_bpart_data) * t->ci->black_holes.count;
           buff = t->buff = malloc(count);
 
+#ifndef MPI_FULL_PART_UPDATES
+        } else if (t->subtype == task_subtype_rho ||
+                   t->subtype == task_subtype_gradient) {
+
+          /* Only the fields updated since the xv message */
+          count = size = t->ci->hydro.count * part_mpi_update_fields.size;
+          buff = t->buff = malloc(count);
+
+#endif
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient ||
@@ -2603,18 +2739,38 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           error("Unknown communication sub-type");
         }
 
-        err = MPI_Irecv(buff, count, type, t->ci->nodeID, t->flags,
-                        subtaskMPI_comms[t->subtype], &t->req);
+        qid = 1 % s->nr_queues;
+
+        if (s->mpi_rma != NULL &&
+            (rma_slot = mpirma_find(s->mpi_rma, t, size)) != NULL) {
+
+          /* Small message, the progress thread takes it out of the window. */
+          t->req = MPI_REQUEST_NULL;
+          layer_buff = buff;
+          layer_size = size;
+
+        } else if (s->mpi_aggregate != NULL &&
+                   size <= s->mpi_aggregate->size_limit) {
+
+          /* Small message, let the aggregation layer receive it. */
+          t->req = MPI_REQUEST_NULL;
+          aggregate = 1;
+          layer_buff = buff;
+          layer_size = size;
 
-        if (err != MPI_SUCCESS) {
-          mpi_error(err, "Failed to emit irecv for particle data.");
+        } else {
+
+          err = MPI_Irecv(buff, count, type, t->ci->nodeID, t->flags,
+                          subtaskMPI_comms[t->subtype], &t->req);
+
+          if (err != MPI_SUCCESS) {
+            mpi_error(err, "Failed to emit irecv for particle data.");
+          }
         }
 
         /* And log, if logging enabled. */
         mpiuse_log_allocation(t->type, t->subtype, &t->req, 1, size,
                               t->ci->nodeID, t->flags);
-
-        qid = 1 % s->nr_queues;
       }
 #else
         error("SWIFT was not compiled with MPI support.");
@@ -2649,6 +2805,16 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           cell_pack_bpart_swallow(t->ci,
                                   (struct black_holes_bpart_data *)t->buff);
 
+#ifndef MPI_FULL_PART_UPDATES
+        } else if (t->subtype == task_subtype_rho ||
+                   t->subtype == task_subtype_gradient) {
+
+          /* Only the fields updated since the xv message */
+          size = count = t->ci->hydro.count * part_mpi_update_fields.size;
+          buff = t->buff = malloc(size);
+          cell_pack_part_updates(t->ci, (char *)buff);
+
+#endif
         } else if (t->subtype == task_subtype_xv ||
                    t->subtype == task_subtype_rho ||
                    t->subtype == task_subtype_gradient ||
@@ -2706,16 +2872,36 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
           error("Unknown communication sub-type");
         }
 
-        if (size > s->mpi_message_limit) {
-          err = MPI_Isend(buff, count, type, t->cj->nodeID, t->flags,
-                          subtaskMPI_comms[t->subtype], &t->req);
+        if (s->mpi_rma != NULL &&
+            (rma_slot = mpirma_find(s->mpi_rma, t, size)) != NULL) {
+
+          /* Small message, the progress thread puts it into the window. */
+          t->req = MPI_REQUEST_NULL;
+          layer_buff = buff;
+          layer_size = size;
+
+        } else if (s->mpi_aggregate != NULL &&
+                   size <= s->mpi_aggregate->size_limit) {
+
+          /* Small message, let the aggregation layer send it. */
+          t->req = MPI_REQUEST_NULL;
+          aggregate = 1;
+          layer_buff = buff;
+          layer_size = size;
+
         } else {
-          err = MPI_Issend(buff, count, type, t->cj->nodeID, t->flags,
-                           subtaskMPI_comms[t->subtype], &t->req);
-        }
 
-        if (err != MPI_SUCCESS) {
-          mpi_error(err, "Failed to emit isend for particle data.");
+          if (size > s->mpi_message_limit) {
+            err = MPI_Isend(buff, count, type, t->cj->nodeID, t->flags,
+                            subtaskMPI_comms[t->subtype], &t->req);
+          } else {
+            err = MPI_Issend(buff, count, type, t->cj->nodeID, t->flags,
+                             subtaskMPI_comms[t->subtype], &t->req);
+          }
+
+          if (err != MPI_SUCCESS) {
+            mpi_error(err, "Failed to emit isend for particle data.");
+          }
         }
 
         /* And log, if logging enabled. */
@@ -2743,6 +2929,24 @@ void scheduler_enqueue(struct scheduler *s, struct task *t) {
     /* Increase the waiting counter. */
     atomic_inc(&s->waiting);
 
+#ifdef WITH_MPI
+    /* Aggregated messages: the task only goes into its queue once the
+     * message has been exchanged. */
+    if (aggregate) {
+      if (t->type == task_type_send)
+        mpiaggregate_send(s->mpi_aggregate, t, layer_buff, layer_size, qid);
+      else
+        mpiaggregate_recv(s->mpi_aggregate, t, layer_buff, layer_size, qid);
+      return;
+    }
+
+    /* Same for the messages exchanged through the RMA window. */
+    if (rma_slot != NULL) {
+      mpirma_post(s->mpi_rma, rma_slot, t, layer_buff, layer_size, qid);
+      return;
+    }
+#endif
+
     /* Insert the task into that queue. */
     queue_insert(&s->queues[qid], t);
   }
@@ -3033,11 +3237,19 @@ void scheduler_init(struct scheduler *s, struct space *space, int nr_tasks,
   s->space = space;
   s->nodeID = nodeID;
   s->threadpool = tp;
+#ifdef WITH_MPI
+  s->mpi_aggregate = NULL;
+  s->mpi_rma = NULL;
+#endif
 
   /* Init the tasks array. */
   s->size = 0;
   s->tasks = NULL;
   s->tasks_ind = NULL;
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  s->pair_geometry = NULL;
+  s->pair_geometry_launch = 0;
+#endif
   scheduler_reset(s, nr_tasks);
 
 #if defined(SWIFT_DEBUG_CHECKS)
@@ -3075,6 +3287,18 @@ void scheduler_print_tasks(const struct scheduler *s, const char *fileName) {
  * @brief Frees up the memory allocated for this #scheduler
  */
 void scheduler_clean(struct scheduler *s) {
+#ifdef WITH_MPI
+  if (s->mpi_aggregate != NULL) {
+    mpiaggregate_clean(s->mpi_aggregate);
+    free(s->mpi_aggregate);
+    s->mpi_aggregate = NULL;
+  }
+  if (s->mpi_rma != NULL) {
+    mpirma_clean(s->mpi_rma);
+    free(s->mpi_rma);
+    s->mpi_rma = NULL;
+  }
+#endif
   scheduler_free_tasks(s);
   swift_free("unlocks", s->unlocks);
   swift_free("unlock_ind", s->unlock_ind);
@@ -3098,6 +3322,13 @@ void scheduler_free_tasks(struct scheduler *s) {
     swift_free("tid_active", s->tid_active);
     s->tid_active = NULL;
   }
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  if (s->pair_geometry != NULL) {
+    hydro_pair_geometry_buffers_free(s->pair_geometry, s->size);
+    swift_free("pair_geometry", s->pair_geometry);
+    s->pair_geometry = NULL;
+  }
+#endif
   s->size = 0;
   s->nr_tasks = 0;
 }
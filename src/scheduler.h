@@ -33,6 +33,7 @@
 
 /* Includes. */
 #include "cell.h"
+#include "hydro_pair_geometry.h"
 #include "inline.h"
 #include "lock.h"
 #include "queue.h"
@@ -54,6 +55,10 @@
 #define scheduler_flag_none 0
 #define scheduler_flag_steal (1 << 1)
 
+/* Forward declarations. */
+struct mpiaggregate;
+struct mpirma;
+
 /* Data of a scheduler. */
 struct scheduler {
   /* Scheduler flags. */
@@ -81,6 +86,14 @@ struct scheduler {
   int *tid_active;
   int active_count;
 
+#ifdef SWIFT_GIZMO_PAIR_GEOMETRY_CACHE
+  /* Per-task buffers of Gizmo face geometry (indexed like the tasks). */
+  struct hydro_pair_geometry_buffer *pair_geometry;
+
+  /* Number of times the scheduler was started (stamps the buffers above). */
+  int pair_geometry_launch;
+#endif
+
   /* The task unlocks. */
   struct task **volatile unlocks;
   int *volatile unlock_ind;
@@ -106,6 +119,14 @@ struct scheduler {
    * MPI. */
   size_t mpi_message_limit;
 
+#ifdef WITH_MPI
+  /* Layer aggregating the small task messages, NULL if not used. */
+  struct mpiaggregate *mpi_aggregate;
+
+  /* One-sided transport of the small task messages, NULL if not used. */
+  struct mpirma *mpi_rma;
+#endif
+
   /* Total ticks spent running the tasks */
   ticks total_ticks;
 
@@ -291,6 +312,7 @@ struct task *scheduler_gettask(struct scheduler *s, int qid,
 void scheduler_enqueue(struct scheduler *s, struct task *t);
 void scheduler_start(struct scheduler *s);
 void scheduler_reset(struct scheduler *s, int nr_tasks);
+void scheduler_reserve(struct scheduler *s, int size);
 void scheduler_ranktasks(struct scheduler *s);
 void scheduler_reweight(struct scheduler *s, int verbose);
 struct task *scheduler_addtask(struct scheduler *s, enum task_types type,
@@ -313,5 +335,8 @@ void scheduler_write_task_level(const struct scheduler *s, int step);
 void scheduler_dump_queues(struct engine *e);
 void scheduler_report_task_times(const struct scheduler *s,
                                  const int nr_threads);
+#ifdef WITH_MPI
+size_t scheduler_mpi_message_size(const struct task *t);
+#endif
 
 #endif /* SWIFT_SCHEDULER_H */
@@ -233,6 +233,8 @@ void read_array_single(hid_t h_grp, const struct io_props props, size_t N,
  * the HDF5 file.
  * @param props The #io_props of the field to read
  * @param N The number of particles to write.
+ * @param lossy_compression Level of lossy compression to use for this field.
+ * @param chunk_size The number of particles per chunk (0 for the default).
  * @param internal_units The #unit_system used internally
  * @param snapshot_units The #unit_system used in the snapshots
  *
@@ -243,6 +245,7 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
                         FILE* xmfFile, const char* partTypeGroupName,
                         const struct io_props props, const size_t N,
                         const enum lossy_compression_schemes lossy_compression,
+                        const long long chunk_size,
                         const struct unit_system* internal_units,
                         const struct unit_system* snapshot_units) {
 
@@ -286,6 +289,9 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
     chunk_shape[1] = 0;
   }
 
+  /* Use the chunk size aligned on the top-level cells if we have one */
+  if (chunk_size > 0) chunk_shape[0] = chunk_size;
+
   /* Make sure the chunks are not larger than the dataset */
   if (chunk_shape[0] > N) chunk_shape[0] = N;
 
@@ -340,10 +346,19 @@ void write_array_single(const struct engine* e, hid_t grp, const char* fileName,
                                  h_prop, H5P_DEFAULT);
   if (h_data < 0) error("Error while creating dataspace '%s'.", props.name);
 
-  /* Write temporary buffer to HDF5 dataspace */
-  h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
-                   H5P_DEFAULT, temp);
-  if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  /* Compress the chunks on the threadpool if we can */
+  int written = 0;
+  if (e->snapshot_compress_on_threads)
+    written = io_write_compressed_chunks(
+        (struct threadpool*)&e->threadpool, h_data, io_hdf5_type(props.type),
+        h_type, temp, N, props.dimension);
+
+  /* Otherwise, write temporary buffer to HDF5 dataspace */
+  if (!written) {
+    h_err = H5Dwrite(h_data, io_hdf5_type(props.type), h_space, H5S_ALL,
+                     H5P_DEFAULT, temp);
+    if (h_err < 0) error("Error while writing data array '%s'.", props.name);
+  }
 
   /* Write XMF description for this data set */
   if (xmfFile != NULL)
@@ -903,6 +918,11 @@ void write_output_single(struct engine* e,
     if (!subsample[i]) subsample_fraction[i] = 1.f;
   }
 
+  /* Are we restricting the output to a region of interest? */
+  struct output_region region_buffer;
+  const struct output_region* region = output_options_get_region(
+      output_options, current_selection_name, e->s, &region_buffer);
+
   /* First time, we need to create the XMF file */
   if (e->snapshot_output_count == 0) xmf_create_file(xmfFileName);
 
@@ -917,37 +937,38 @@ void write_output_single(struct engine* e,
   size_t Ngas_written, Ndm_written, Ndm_background, Ndm_neutrino,
       Nsinks_written, Nstars_written, Nblackholes_written;
 
-  if (subsample[swift_type_gas]) {
-    Ngas_written = io_count_gas_to_write(e->s, /*subsample=*/1,
+  if (subsample[swift_type_gas] || region != NULL) {
+    Ngas_written = io_count_gas_to_write(e->s, subsample[swift_type_gas],
                                          subsample_fraction[swift_type_gas],
-                                         e->snapshot_output_count);
+                                         region, e->snapshot_output_count);
   } else {
     Ngas_written =
         e->s->nr_parts - e->s->nr_inhibited_parts - e->s->nr_extra_parts;
   }
 
-  if (subsample[swift_type_stars]) {
+  if (subsample[swift_type_stars] || region != NULL) {
     Nstars_written = io_count_stars_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_stars],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_stars], subsample_fraction[swift_type_stars],
+        region, e->snapshot_output_count);
   } else {
     Nstars_written =
         e->s->nr_sparts - e->s->nr_inhibited_sparts - e->s->nr_extra_sparts;
   }
 
-  if (subsample[swift_type_black_hole]) {
+  if (subsample[swift_type_black_hole] || region != NULL) {
     Nblackholes_written = io_count_black_holes_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_black_hole],
+        e->s, subsample[swift_type_black_hole],
+        subsample_fraction[swift_type_black_hole], region,
         e->snapshot_output_count);
   } else {
     Nblackholes_written =
         e->s->nr_bparts - e->s->nr_inhibited_bparts - e->s->nr_extra_bparts;
   }
 
-  if (subsample[swift_type_sink]) {
+  if (subsample[swift_type_sink] || region != NULL) {
     Nsinks_written = io_count_sinks_to_write(
-        e->s, /*subsample=*/1, subsample_fraction[swift_type_sink],
-        e->snapshot_output_count);
+        e->s, subsample[swift_type_sink], subsample_fraction[swift_type_sink],
+        region, e->snapshot_output_count);
   } else {
     Nsinks_written =
         e->s->nr_sinks - e->s->nr_inhibited_sinks - e->s->nr_extra_sinks;
@@ -955,13 +976,14 @@ void write_output_single(struct engine* e,
 
   Ndm_written = io_count_dark_matter_to_write(
       e->s, subsample[swift_type_dark_matter],
-      subsample_fraction[swift_type_dark_matter], e->snapshot_output_count);
+      subsample_fraction[swift_type_dark_matter], region,
+      e->snapshot_output_count);
 
   if (with_DM_background) {
     Ndm_background = io_count_background_dark_matter_to_write(
         e->s, subsample[swift_type_dark_matter_background],
         subsample_fraction[swift_type_dark_matter_background],
-        e->snapshot_output_count);
+        region, e->snapshot_output_count);
   } else {
     Ndm_background = 0;
   }
@@ -969,7 +991,8 @@ void write_output_single(struct engine* e,
   if (with_neutrinos) {
     Ndm_neutrino = io_count_neutrinos_to_write(
         e->s, subsample[swift_type_neutrino],
-        subsample_fraction[swift_type_neutrino], e->snapshot_output_count);
+        subsample_fraction[swift_type_neutrino], region,
+        e->snapshot_output_count);
   } else {
     Ndm_neutrino = 0;
   }
@@ -990,6 +1013,12 @@ void write_output_single(struct engine* e,
 
   };
 
+  /* Size the chunks of the arrays after the top-level cells if requested */
+  long long chunk_sizes[swift_type_count];
+  io_get_cell_aligned_chunk_sizes(e->s->cells_top, e->s->nr_cells, e->nodeID,
+                                  e->snapshot_chunks_per_cell, N_total,
+                                  chunk_sizes);
+
   /* Set the minimal API version to avoid issues with advanced features */
   hid_t h_props = H5Pcreate(H5P_FILE_ACCESS);
   herr_t err = H5Pset_libver_bounds(h_props, HDF5_LOWEST_FILE_FORMAT_VERSION,
@@ -1092,13 +1121,7 @@ void write_output_single(struct engine* e,
   io_write_attribute_i(h_grp, "Virtual", 0);
   io_write_attribute(h_grp, "CanHaveTypes", INT, to_write, swift_type_count);
 
-  if (subsample_any) {
-    io_write_attribute_s(h_grp, "OutputType", "SubSampled");
-    io_write_attribute(h_grp, "SubSampleFractions", FLOAT, subsample_fraction,
-                       swift_type_count);
-  } else {
-    io_write_attribute_s(h_grp, "OutputType", "FullVolume");
-  }
+  io_write_output_type(h_grp, subsample_any, subsample_fraction, region);
 
   /* Close header */
   H5Gclose(h_grp);
@@ -1115,11 +1138,12 @@ void write_output_single(struct engine* e,
   if (h_grp < 0) error("Error while creating cells group");
 
   /* Write the location of the particles in the arrays */
-  io_write_cell_offsets(h_grp, e->s->cdim, e->s->dim, e->s->cells_top,
-                        e->s->nr_cells, e->s->width, e->nodeID,
-                        /*distributed=*/0, subsample, subsample_fraction,
-                        e->snapshot_output_count, N_total, global_offsets,
-                        to_write, numFields, internal_units, snapshot_units);
+  io_write_cell_offsets(
+      h_grp, e->s->cdim, e->s->dim, e->s->cells_top, e->s->nr_cells,
+      e->s->width, e->nodeID, /*distributed=*/0, subsample, subsample_fraction,
+      region, e->snapshot_output_count, N_total, global_offsets, to_write,
+      numFields, e->snapshot_chunks_per_cell ? chunk_sizes : NULL,
+      internal_units, snapshot_units);
   H5Gclose(h_grp);
 
   /* Loop over all particle types */
@@ -1159,13 +1183,9 @@ void write_output_single(struct engine* e,
     bzero(list, io_max_size_output_list * sizeof(struct io_props));
     size_t N = 0;
 
-    struct part* parts_written = NULL;
-    struct xpart* xparts_written = NULL;
-    struct gpart* gparts_written = NULL;
-    struct velociraptor_gpart_data* gpart_group_data_written = NULL;
-    struct spart* sparts_written = NULL;
-    struct bpart* bparts_written = NULL;
-    struct sink* sinks_written = NULL;
+    /* The particle collection runs on the threadpool */
+    struct threadpool* tp = (struct threadpool*)&e->threadpool;
+    size_t* index_written = NULL;
 
     /* Write particle fields from the particle structure */
     switch (ptype) {
@@ -1176,37 +1196,28 @@ void write_output_single(struct engine* e,
           /* No inhibted particles: easy case */
           N = Ngas;
 
-          /* Select the fields to write */
-          io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
-                                 with_temperature, with_fof, with_stf, with_rt,
-                                 e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           N = Ngas_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("parts_written", (void**)&parts_written,
-                             part_align,
-                             Ngas_written * sizeof(struct part)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ngas_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for parts");
-          if (swift_memalign("xparts_written", (void**)&xparts_written,
-                             xpart_align,
-                             Ngas_written * sizeof(struct xpart)) != 0)
-            error("Error while allocating temporary memory for xparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_parts_to_write(
-              parts, xparts, parts_written, xparts_written,
-              subsample[swift_type_gas], subsample_fraction[swift_type_gas],
+              tp, parts, index_written, subsample[swift_type_gas],
+              subsample_fraction[swift_type_gas], region,
               e->snapshot_output_count, Ngas, Ngas_written);
-
-          /* Select the fields to write */
-          io_select_hydro_fields(parts_written, xparts_written, with_cosmology,
-                                 with_cooling, with_temperature, with_fof,
-                                 with_stf, with_rt, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_hydro_fields(parts, xparts, with_cosmology, with_cooling,
+                               with_temperature, with_fof, with_stf, with_rt,
+                               e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter: {
@@ -1216,42 +1227,28 @@ void write_output_single(struct engine* e,
            * neutrinos */
           N = Ntot;
 
-          /* Select the fields to write */
-          io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
-                              with_stf, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           N = Ndm_written;
 
           /* Allocate temporary array */
-          if (swift_memalign("gparts_written", (void**)&gparts_written,
-                             gpart_align,
-                             Ndm_written * sizeof(struct gpart)) != 0)
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Ndm_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for gparts");
 
-          if (with_stf) {
-            if (swift_memalign(
-                    "gpart_group_written", (void**)&gpart_group_data_written,
-                    gpart_align,
-                    Ndm_written * sizeof(struct velociraptor_gpart_data)) != 0)
-              error(
-                  "Error while allocating temporary memory for gparts STF "
-                  "data");
-          }
-
-          /* Collect the non-inhibited DM particles from gpart */
+          /* Collect the indices of the non-inhibited DM particles */
           io_collect_gparts_to_write(
-              gparts, e->s->gpart_group_data, gparts_written,
-              gpart_group_data_written, subsample[swift_type_dark_matter],
+              tp, gparts, index_written, swift_type_dark_matter,
+              subsample[swift_type_dark_matter],
               subsample_fraction[swift_type_dark_matter],
-              e->snapshot_output_count, Ntot, Ndm_written, with_stf);
-
-          /* Select the fields to write */
-          io_select_dm_fields(gparts_written, gpart_group_data_written,
-                              with_fof, with_stf, e, &num_fields, list);
+              region, e->snapshot_output_count, Ntot, Ndm_written);
         }
+
+        /* Select the fields to write */
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
+                            with_stf, e, &num_fields, list);
       } break;
 
       case swift_type_dark_matter_background: {
@@ -1260,31 +1257,20 @@ void write_output_single(struct engine* e,
         N = Ndm_background;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_background * sizeof(struct gpart)) != 0)
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_background * sizeof(size_t)) != 0)
           error("Error while allocating temporary memory for gparts");
 
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_background * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporary memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_background_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written,
+        /* Collect the indices of the non-inhibited background particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_dark_matter_background,
             subsample[swift_type_dark_matter_background],
             subsample_fraction[swift_type_dark_matter_background],
-            e->snapshot_output_count, Ntot, Ndm_background, with_stf);
+            region, e->snapshot_output_count, Ntot, Ndm_background);
 
         /* Select the fields to write */
-        io_select_dm_fields(gparts_written, gpart_group_data_written, with_fof,
+        io_select_dm_fields(gparts, e->s->gpart_group_data, with_fof,
                             with_stf, e, &num_fields, list);
 
       } break;
@@ -1295,31 +1281,21 @@ void write_output_single(struct engine* e,
         N = Ndm_neutrino;
 
         /* Allocate temporary array */
-        if (swift_memalign("gparts_written", (void**)&gparts_written,
-                           gpart_align,
-                           Ndm_neutrino * sizeof(struct gpart)) != 0)
+        if (swift_memalign("index_written", (void**)&index_written,
+                           IO_BUFFER_ALIGNMENT,
+                           Ndm_neutrino * sizeof(size_t)) != 0)
           error("Error while allocating temporary memory for gparts");
 
-        if (with_stf) {
-          if (swift_memalign(
-                  "gpart_group_written", (void**)&gpart_group_data_written,
-                  gpart_align,
-                  Ndm_neutrino * sizeof(struct velociraptor_gpart_data)) != 0)
-            error(
-                "Error while allocating temporary memory for gparts STF "
-                "data");
-        }
-
-        /* Collect the non-inhibited DM particles from gpart */
-        io_collect_gparts_neutrino_to_write(
-            gparts, e->s->gpart_group_data, gparts_written,
-            gpart_group_data_written, subsample[swift_type_neutrino],
-            subsample_fraction[swift_type_neutrino], e->snapshot_output_count,
-            Ntot, Ndm_neutrino, with_stf);
+        /* Collect the indices of the non-inhibited neutrino particles */
+        io_collect_gparts_to_write(
+            tp, gparts, index_written, swift_type_neutrino,
+            subsample[swift_type_neutrino],
+            subsample_fraction[swift_type_neutrino],
+            region, e->snapshot_output_count, Ntot, Ndm_neutrino);
 
         /* Select the fields to write */
-        io_select_neutrino_fields(gparts_written, gpart_group_data_written,
-                                  with_fof, with_stf, e, &num_fields, list);
+        io_select_neutrino_fields(gparts, e->s->gpart_group_data, with_fof,
+                                  with_stf, e, &num_fields, list);
 
       } break;
 
@@ -1329,30 +1305,27 @@ void write_output_single(struct engine* e,
           /* No inhibted particles: easy case */
           N = Nsinks;
 
-          /* Select the fields to write */
-          io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
-                                &num_fields, list);
         } else {
 
           /* Ok, we need to fish out the particles we want */
           N = Nsinks_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sinks_written", (void**)&sinks_written,
-                             sink_align,
-                             Nsinks_written * sizeof(struct sink)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nsinks_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for sinks");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sinks_to_write(
-              sinks, sinks_written, subsample[swift_type_sink],
-              subsample_fraction[swift_type_sink], e->snapshot_output_count,
-              Nsinks, Nsinks_written);
-
-          /* Select the fields to write */
-          io_select_sink_fields(sinks_written, with_cosmology, with_fof,
-                                with_stf, e, &num_fields, list);
+              tp, sinks, index_written, subsample[swift_type_sink],
+              subsample_fraction[swift_type_sink], region,
+              e->snapshot_output_count, Nsinks, Nsinks_written);
         }
+
+        /* Select the fields to write */
+        io_select_sink_fields(sinks, with_cosmology, with_fof, with_stf, e,
+                              &num_fields, list);
       } break;
 
       case swift_type_stars: {
@@ -1361,31 +1334,27 @@ void write_output_single(struct engine* e,
           /* No inhibited particles: easy case */
           N = Nstars;
 
-          /* Select the fields to write */
-          io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
-                                with_rt, e, &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           N = Nstars_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("sparts_written", (void**)&sparts_written,
-                             spart_align,
-                             Nstars_written * sizeof(struct spart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nstars_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for sparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_sparts_to_write(
-              sparts, sparts_written, subsample[swift_type_stars],
-              subsample_fraction[swift_type_stars], e->snapshot_output_count,
-              Nstars, Nstars_written);
-
-          /* Select the fields to write */
-          io_select_star_fields(sparts_written, with_cosmology, with_fof,
-                                with_stf, with_rt, e, &num_fields, list);
+              tp, sparts, index_written, subsample[swift_type_stars],
+              subsample_fraction[swift_type_stars], region,
+              e->snapshot_output_count, Nstars, Nstars_written);
         }
+
+        /* Select the fields to write */
+        io_select_star_fields(sparts, with_cosmology, with_fof, with_stf,
+                              with_rt, e, &num_fields, list);
       } break;
 
       case swift_type_black_hole: {
@@ -1394,37 +1363,36 @@ void write_output_single(struct engine* e,
           /* No inhibited particles: easy case */
           N = Nblackholes;
 
-          /* Select the fields to write */
-          io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
-                              &num_fields, list);
-
         } else {
 
           /* Ok, we need to fish out the particles we want */
           N = Nblackholes_written;
 
-          /* Allocate temporary arrays */
-          if (swift_memalign("bparts_written", (void**)&bparts_written,
-                             bpart_align,
-                             Nblackholes_written * sizeof(struct bpart)) != 0)
+          /* Allocate temporary array */
+          if (swift_memalign("index_written", (void**)&index_written,
+                             IO_BUFFER_ALIGNMENT,
+                             Nblackholes_written * sizeof(size_t)) != 0)
             error("Error while allocating temporary memory for bparts");
 
-          /* Collect the particles we want to write */
+          /* Collect the indices of the particles we want to write */
           io_collect_bparts_to_write(
-              bparts, bparts_written, subsample[swift_type_black_hole],
-              subsample_fraction[swift_type_black_hole],
+              tp, bparts, index_written, subsample[swift_type_black_hole],
+              subsample_fraction[swift_type_black_hole], region,
               e->snapshot_output_count, Nblackholes, Nblackholes_written);
-
-          /* Select the fields to write */
-          io_select_bh_fields(bparts_written, with_cosmology, with_fof,
-                              with_stf, e, &num_fields, list);
         }
+
+        /* Select the fields to write */
+        io_select_bh_fields(bparts, with_cosmology, with_fof, with_stf, e,
+                            &num_fields, list);
       } break;
 
       default:
         error("Particle Type %d not yet supported. Aborting", ptype);
     }
 
+    /* Read the particles through the index list if we collected one */
+    io_props_set_index(list, num_fields, index_written);
+
     /* Verify we are not going to crash when writing below */
     if (num_fields >= io_max_size_output_list)
       error("Too many fields to write for particle type %d", ptype);
@@ -1454,8 +1422,8 @@ void write_output_single(struct engine* e,
 
       if (compression_level != compression_do_not_write) {
         write_array_single(e, h_grp, fileName, xmfFile, partTypeGroupName,
-                           list[i], N, compression_level, internal_units,
-                           snapshot_units);
+                           list[i], N, compression_level, chunk_sizes[ptype],
+                           internal_units, snapshot_units);
         num_fields_written++;
       }
     }
@@ -1463,15 +1431,8 @@ void write_output_single(struct engine* e,
     /* Only write this now that we know exactly how many fields there are. */
     io_write_attribute_i(h_grp, "NumberOfFields", num_fields_written);
 
-    /* Free temporary arrays */
-    if (parts_written) swift_free("parts_written", parts_written);
-    if (xparts_written) swift_free("xparts_written", xparts_written);
-    if (gparts_written) swift_free("gparts_written", gparts_written);
-    if (gpart_group_data_written)
-      swift_free("gpart_group_written", gpart_group_data_written);
-    if (sparts_written) swift_free("sparts_written", sparts_written);
-    if (bparts_written) swift_free("bparts_written", bparts_written);
-    if (sinks_written) swift_free("sinks_written", sinks_written);
+    /* Free temporary array */
+    if (index_written) swift_free("index_written", index_written);
 
     /* Close particle group */
     H5Gclose(h_grp);
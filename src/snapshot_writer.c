@@ -0,0 +1,627 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Matthieu Schaller (schaller@strw.leidenuniv.nl)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+/* Config parameters. */
+#include <config.h>
+
+/* Some standard headers. */
+#include <string.h>
+
+/* HDF5 headers. */
+#ifdef HAVE_HDF5
+#include <hdf5.h>
+#endif
+
+/* This object's header. */
+#include "snapshot_writer.h"
+
+/* Local headers. */
+#include "cell.h"
+#include "clocks.h"
+#include "cooling_properties.h"
+#include "cosmology.h"
+#include "distributed_io.h"
+#include "engine.h"
+#include "error.h"
+#include "gravity_properties.h"
+#include "hydro_properties.h"
+#include "memuse.h"
+#include "output_list.h"
+#include "parser.h"
+#include "part.h"
+#include "rt_properties.h"
+#include "single_io.h"
+#include "space.h"
+#include "threadpool.h"
+#include "velociraptor_struct.h"
+
+/*! Size of the blocks used to copy the particle arrays in parallel. */
+#define snapshot_writer_copy_block (1 << 20)
+
+/**
+ * @brief A snapshot waiting to be written.
+ *
+ * The engine, space and time-dependent properties are copies of the ones of
+ * the simulation at the time of the dump, pointing to each other and to
+ * copies of the particles and top-level cells.
+ */
+struct snapshot_writer_job {
+
+  /*! Copy of the engine. */
+  struct engine e;
+
+  /*! Copy of the space. */
+  struct space s;
+
+  /*! Copies of the properties updated at every step. */
+  struct cosmology cosmology;
+  struct gravity_props gravity_properties;
+  struct hydro_props hydro_properties;
+  struct cooling_function_data cooling_func;
+  struct rt_props rt_props;
+  struct output_list output_list_snapshots;
+
+  /*! Is this a stand-alone FOF call? */
+  int fof;
+
+  /*! Memory used by the copies of the arrays. */
+  size_t size;
+
+  /*! Next snapshot in the queue. */
+  struct snapshot_writer_job *next;
+};
+
+/**
+ * @brief The data needed to copy an array with a #threadpool.
+ */
+struct snapshot_writer_copy_data {
+  const char *src;
+  char *dst;
+  size_t size;
+};
+
+/**
+ * @brief Copy a range of blocks of an array.
+ *
+ * @param map_data The first block to copy.
+ * @param num_elements The number of blocks to copy.
+ * @param extra_data The #snapshot_writer_copy_data.
+ */
+static void snapshot_writer_copy_mapper(void *map_data, int num_elements,
+                                        void *extra_data) {
+
+  const struct snapshot_writer_copy_data *data =
+      (const struct snapshot_writer_copy_data *)extra_data;
+
+  const size_t offset = (const char *)map_data - data->src;
+  size_t size = (size_t)num_elements * snapshot_writer_copy_block;
+  if (offset + size > data->size) size = data->size - offset;
+
+  memcpy(data->dst + offset, map_data, size);
+}
+
+/**
+ * @brief Allocate a copy of an array and fill it using a #threadpool.
+ *
+ * @param label The label of the allocation.
+ * @param src The array to copy (can be NULL).
+ * @param count The number of elements in the array.
+ * @param elem_size The size of one element.
+ * @param tp The #threadpool to use.
+ * @return The copy (NULL if there was nothing to copy).
+ */
+static void *snapshot_writer_copy_array(const char *label, const void *src,
+                                        const size_t count,
+                                        const size_t elem_size,
+                                        struct threadpool *tp) {
+
+  if (src == NULL || count == 0) return NULL;
+
+  struct snapshot_writer_copy_data data;
+  data.src = (const char *)src;
+  data.size = count * elem_size;
+
+  if (swift_memalign(label, (void **)&data.dst, SWIFT_STRUCT_ALIGNMENT,
+                     data.size) != 0)
+    error("Failed to allocate the copy of the %s for the snapshot writer.",
+          label);
+
+  const size_t nr_blocks =
+      (data.size + snapshot_writer_copy_block - 1) / snapshot_writer_copy_block;
+  threadpool_map(tp, snapshot_writer_copy_mapper, (void *)data.src, nr_blocks,
+                 snapshot_writer_copy_block, threadpool_auto_chunk_size,
+                 &data);
+
+  return data.dst;
+}
+
+/**
+ * @brief Move a pointer into an array to the same element of a copy of that
+ * array.
+ *
+ * Pointers that are not in the array (e.g. to foreign particles) are set to
+ * NULL.
+ *
+ * @param ptr The pointer to move.
+ * @param src The original array.
+ * @param dst The copy of the array.
+ * @param count The number of elements in the array.
+ * @param elem_size The size of one element.
+ */
+static void *snapshot_writer_rebase(const void *ptr, const void *src,
+                                    void *dst, const size_t count,
+                                    const size_t elem_size) {
+
+  if (ptr == NULL || src == NULL) return NULL;
+  const char *p = (const char *)ptr;
+  const char *first = (const char *)src;
+  if (p < first || p >= first + count * elem_size) return NULL;
+  return (char *)dst + (p - first);
+}
+
+/**
+ * @brief Memory needed to copy the arrays of a #space.
+ *
+ * @param s The #space.
+ */
+static size_t snapshot_writer_job_size(const struct space *s) {
+
+  size_t size = 0;
+  size += s->nr_parts * (sizeof(struct part) + sizeof(struct xpart));
+  size += s->nr_gparts * sizeof(struct gpart);
+  size += s->nr_sparts * sizeof(struct spart);
+  size += s->nr_bparts * sizeof(struct bpart);
+  size += s->nr_sinks * sizeof(struct sink);
+  size += s->nr_cells * sizeof(struct cell);
+  size += s->nr_local_cells * sizeof(int);
+  if (s->gpart_group_data != NULL)
+    size += s->nr_gparts * sizeof(struct velociraptor_gpart_data);
+  return size;
+}
+
+/**
+ * @brief Copy the current state of the simulation into a new job.
+ *
+ * @param e The #engine.
+ * @param fof Is this a stand-alone FOF call?
+ * @param size The memory needed by the copies of the arrays.
+ */
+static struct snapshot_writer_job *snapshot_writer_job_new(
+    const struct engine *e, const int fof, const size_t size) {
+
+  const struct space *s = e->s;
+  struct threadpool *tp = (struct threadpool *)&e->threadpool;
+
+  struct snapshot_writer_job *job = (struct snapshot_writer_job *)swift_malloc(
+      "snapshot_writer_job", sizeof(struct snapshot_writer_job));
+  if (job == NULL) error("Failed to allocate snapshot writer job.");
+  job->fof = fof;
+  job->size = size;
+  job->next = NULL;
+
+  /* Start with the structures themselves... */
+  memcpy(&job->e, e, sizeof(struct engine));
+  memcpy(&job->s, s, sizeof(struct space));
+  job->e.s = &job->s;
+  job->s.e = &job->e;
+
+  /* ... and the properties that change from one step to the next */
+  if (e->cosmology != NULL) {
+    job->cosmology = *e->cosmology;
+    job->e.cosmology = &job->cosmology;
+  }
+  if (e->gravity_properties != NULL) {
+    job->gravity_properties = *e->gravity_properties;
+    job->e.gravity_properties = &job->gravity_properties;
+  }
+  if (e->hydro_properties != NULL) {
+    job->hydro_properties = *e->hydro_properties;
+    job->e.hydro_properties = &job->hydro_properties;
+  }
+  if (e->cooling_func != NULL) {
+    job->cooling_func = *e->cooling_func;
+    job->e.cooling_func = &job->cooling_func;
+  }
+  if (e->rt_props != NULL) {
+    job->rt_props = *e->rt_props;
+    job->e.rt_props = &job->rt_props;
+  }
+  if (e->output_list_snapshots != NULL) {
+    job->output_list_snapshots = *e->output_list_snapshots;
+    job->e.output_list_snapshots = &job->output_list_snapshots;
+  }
+
+  /* Now the particles */
+  job->s.parts = (struct part *)snapshot_writer_copy_array(
+      "snapshot_parts", s->parts, s->nr_parts, sizeof(struct part), tp);
+  job->s.xparts = (struct xpart *)snapshot_writer_copy_array(
+      "snapshot_xparts", s->xparts, s->nr_parts, sizeof(struct xpart), tp);
+  job->s.gparts = (struct gpart *)snapshot_writer_copy_array(
+      "snapshot_gparts", s->gparts, s->nr_gparts, sizeof(struct gpart), tp);
+  job->s.sparts = (struct spart *)snapshot_writer_copy_array(
+      "snapshot_sparts", s->sparts, s->nr_sparts, sizeof(struct spart), tp);
+  job->s.bparts = (struct bpart *)snapshot_writer_copy_array(
+      "snapshot_bparts", s->bparts, s->nr_bparts, sizeof(struct bpart), tp);
+  job->s.sinks = (struct sink *)snapshot_writer_copy_array(
+      "snapshot_sinks", s->sinks, s->nr_sinks, sizeof(struct sink), tp);
+  job->s.gpart_group_data =
+      (struct velociraptor_gpart_data *)snapshot_writer_copy_array(
+          "snapshot_gpart_group_data", s->gpart_group_data, s->nr_gparts,
+          sizeof(struct velociraptor_gpart_data), tp);
+
+  /* Make the copies point to each other */
+  if (job->s.nr_gparts > 0)
+    part_relink_all_parts_to_gparts(job->s.gparts, job->s.nr_gparts,
+                                    job->s.parts, job->s.sinks, job->s.sparts,
+                                    job->s.bparts, tp);
+
+  /* And finally the top-level cells pointing to the copies */
+  job->s.cells_top = (struct cell *)snapshot_writer_copy_array(
+      "snapshot_cells_top", s->cells_top, s->nr_cells, sizeof(struct cell),
+      tp);
+  job->s.local_cells_top = (int *)snapshot_writer_copy_array(
+      "snapshot_local_cells_top", s->local_cells_top, s->nr_local_cells,
+      sizeof(int), tp);
+
+  for (int k = 0; k < s->nr_cells; k++) {
+    struct cell *c = &job->s.cells_top[k];
+    c->hydro.parts = (struct part *)snapshot_writer_rebase(
+        c->hydro.parts, s->parts, job->s.parts, s->nr_parts,
+        sizeof(struct part));
+    c->hydro.xparts = (struct xpart *)snapshot_writer_rebase(
+        c->hydro.xparts, s->xparts, job->s.xparts, s->nr_parts,
+        sizeof(struct xpart));
+    c->grav.parts = (struct gpart *)snapshot_writer_rebase(
+        c->grav.parts, s->gparts, job->s.gparts, s->nr_gparts,
+        sizeof(struct gpart));
+    c->stars.parts = (struct spart *)snapshot_writer_rebase(
+        c->stars.parts, s->sparts, job->s.sparts, s->nr_sparts,
+        sizeof(struct spart));
+    c->black_holes.parts = (struct bpart *)snapshot_writer_rebase(
+        c->black_holes.parts, s->bparts, job->s.bparts, s->nr_bparts,
+        sizeof(struct bpart));
+    c->sinks.parts = (struct sink *)snapshot_writer_rebase(
+        c->sinks.parts, s->sinks, job->s.sinks, s->nr_sinks,
+        sizeof(struct sink));
+  }
+
+  return job;
+}
+
+/**
+ * @brief Release the memory used by a job.
+ *
+ * @param job The #snapshot_writer_job.
+ */
+static void snapshot_writer_job_free(struct snapshot_writer_job *job) {
+
+  if (job->s.parts != NULL) swift_free("snapshot_parts", job->s.parts);
+  if (job->s.xparts != NULL) swift_free("snapshot_xparts", job->s.xparts);
+  if (job->s.gparts != NULL) swift_free("snapshot_gparts", job->s.gparts);
+  if (job->s.sparts != NULL) swift_free("snapshot_sparts", job->s.sparts);
+  if (job->s.bparts != NULL) swift_free("snapshot_bparts", job->s.bparts);
+  if (job->s.sinks != NULL) swift_free("snapshot_sinks", job->s.sinks);
+  if (job->s.gpart_group_data != NULL)
+    swift_free("snapshot_gpart_group_data", job->s.gpart_group_data);
+  if (job->s.cells_top != NULL)
+    swift_free("snapshot_cells_top", job->s.cells_top);
+  if (job->s.local_cells_top != NULL)
+    swift_free("snapshot_local_cells_top", job->s.local_cells_top);
+  swift_free("snapshot_writer_job", job);
+}
+
+/**
+ * @brief Write the snapshot of a job.
+ *
+ * Called from the writer thread.
+ *
+ * @param w The #snapshot_writer.
+ * @param job The #snapshot_writer_job.
+ */
+static void snapshot_writer_write(struct snapshot_writer *w,
+                                  struct snapshot_writer_job *job) {
+
+  struct engine *e = &job->e;
+
+  struct clocks_time time1, time2;
+  clocks_gettime(&time1);
+
+  /* The copy of the engine gets its own pool of threads */
+  threadpool_init(&e->threadpool, w->nr_threads);
+
+#if defined(HAVE_HDF5)
+#if defined(WITH_MPI)
+  MPI_Info info;
+  MPI_Info_create(&info);
+  write_output_distributed(e, e->internal_units, e->snapshot_units, job->fof,
+                           e->nodeID, e->nr_nodes, w->comm, info);
+  MPI_Info_free(&info);
+#else
+  write_output_single(e, e->internal_units, e->snapshot_units, job->fof);
+#endif /* WITH_MPI */
+#endif /* HAVE_HDF5 */
+
+  threadpool_clean(&e->threadpool);
+
+  clocks_gettime(&time2);
+  if (e->verbose)
+    message("writing particle properties in the background took %.3f %s.",
+            (float)clocks_diff(&time1, &time2), clocks_getunit());
+
+  /* Run the post-dump command now that the files are complete */
+  if (e->nodeID == 0) engine_run_on_dump(e);
+}
+
+/**
+ * @brief Main loop of the writer thread.
+ *
+ * @param data The #snapshot_writer.
+ */
+static void *snapshot_writer_runner(void *data) {
+
+  struct snapshot_writer *w = (struct snapshot_writer *)data;
+
+  while (1) {
+
+    /* Wait for something to write */
+    if (pthread_mutex_lock(&w->lock) != 0)
+      error("Failed to lock the snapshot writer.");
+    while (w->first == NULL && !w->stop)
+      pthread_cond_wait(&w->new_job, &w->lock);
+    struct snapshot_writer_job *job = w->first;
+    if (pthread_mutex_unlock(&w->lock) != 0)
+      error("Failed to unlock the snapshot writer.");
+
+    /* Nothing left and told to stop */
+    if (job == NULL) break;
+
+    snapshot_writer_write(w, job);
+
+    /* Remove the job from the queue and tell whoever is waiting */
+    const size_t size = job->size;
+    if (pthread_mutex_lock(&w->lock) != 0)
+      error("Failed to lock the snapshot writer.");
+    w->first = job->next;
+    if (w->first == NULL) w->last = NULL;
+    snapshot_writer_job_free(job);
+    w->memory -= size;
+    pthread_cond_broadcast(&w->job_done);
+    if (pthread_mutex_unlock(&w->lock) != 0)
+      error("Failed to unlock the snapshot writer.");
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Initialise the #snapshot_writer and start its thread if snapshots
+ * are to be written in the background.
+ *
+ * @param w The #snapshot_writer.
+ * @param params The parsed parameter file.
+ * @param e The #engine.
+ */
+void snapshot_writer_init(struct snapshot_writer *w,
+                          struct swift_params *params, const struct engine *e) {
+
+  memset(w, 0, sizeof(struct snapshot_writer));
+
+  w->enabled = parser_get_opt_param_int(params, "Snapshots:async_writer", 0);
+  w->nr_threads =
+      parser_get_opt_param_int(params, "Snapshots:async_writer_threads", 1);
+  w->max_memory = (size_t)parser_get_opt_param_int(
+                      params, "Snapshots:async_writer_max_memory_MB", 0) *
+                  1024 * 1024;
+  w->when_busy = (enum snapshot_writer_when_busy)parser_get_opt_param_int(
+      params, "Snapshots:async_writer_when_busy",
+      snapshot_writer_wait_when_busy);
+
+  if (!w->enabled) return;
+
+  if (w->nr_threads < 1)
+    error("Snapshots:async_writer_threads must be at least 1.");
+  if (w->when_busy != snapshot_writer_wait_when_busy &&
+      w->when_busy != snapshot_writer_queue_when_busy)
+    error("Invalid value for Snapshots:async_writer_when_busy (%d).",
+          w->when_busy);
+
+#if !defined(HAVE_HDF5)
+  w->enabled = 0;
+#elif defined(WITH_MPI)
+  /* Only the distributed writer can run on a communicator of its own. */
+  if (!e->snapshot_distributed) {
+    if (e->nodeID == 0)
+      message(
+          "WARNING: Snapshots can only be written in the background when "
+          "they are distributed (Snapshots:distributed). Writing them "
+          "synchronously.");
+    w->enabled = 0;
+  }
+#endif
+
+  if (!w->enabled) return;
+
+#ifdef HAVE_HDF5
+  hbool_t threadsafe = 0;
+  H5is_library_threadsafe(&threadsafe);
+  w->hdf5_threadsafe = threadsafe;
+#endif
+
+#ifdef WITH_MPI
+  /* The writer's collectives must not get mixed with the main thread's. */
+  if (MPI_Comm_dup(MPI_COMM_WORLD, &w->comm) != MPI_SUCCESS)
+    error("Failed to duplicate the MPI communicator for the snapshot writer.");
+#endif
+
+  if (pthread_mutex_init(&w->lock, NULL) != 0 ||
+      pthread_cond_init(&w->new_job, NULL) != 0 ||
+      pthread_cond_init(&w->job_done, NULL) != 0)
+    error("Failed to initialise the snapshot writer locks.");
+
+  if (pthread_create(&w->thread, NULL, &snapshot_writer_runner, w) != 0)
+    error("Failed to create the snapshot writer thread.");
+
+  if (e->nodeID == 0)
+    message(
+        "Snapshots will be written in the background using %d thread(s)%s.",
+        w->nr_threads,
+        w->hdf5_threadsafe ? "" : " (HDF5 is not thread-safe)");
+}
+
+/**
+ * @brief Hand a snapshot over to the #snapshot_writer.
+ *
+ * Copies everything needed to write the snapshot and queues it. If the copy
+ * does not fit within the memory limit, nothing is copied and the caller has
+ * to write the snapshot itself (the previous ones are complete by then).
+ *
+ * @param w The #snapshot_writer.
+ * @param e The #engine.
+ * @param fof Is this a stand-alone FOF call?
+ * @return 1 if the snapshot will be written in the background, 0 otherwise.
+ */
+int snapshot_writer_submit(struct snapshot_writer *w, struct engine *e,
+                           const int fof) {
+
+  if (!w->enabled) return 0;
+
+  const ticks tic = getticks();
+  const size_t size = snapshot_writer_job_size(e->s);
+
+  /* Can we afford a copy at all? All the ranks have to agree as otherwise
+   * they would call different writers. */
+  int fits = (w->max_memory == 0 || size <= w->max_memory);
+#ifdef WITH_MPI
+  MPI_Allreduce(MPI_IN_PLACE, &fits, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+#endif
+  if (!fits) {
+    if (e->verbose)
+      message("Snapshot too large for the writer's memory limit.");
+    snapshot_writer_wait(w, e->verbose);
+    return 0;
+  }
+
+  /* Make room for this one if need be */
+  if (pthread_mutex_lock(&w->lock) != 0)
+    error("Failed to lock the snapshot writer.");
+  const int busy = (w->first != NULL);
+  const int over_limit =
+      (w->max_memory > 0 && w->memory + size > w->max_memory);
+  if (pthread_mutex_unlock(&w->lock) != 0)
+    error("Failed to unlock the snapshot writer.");
+
+  if (busy && (w->when_busy == snapshot_writer_wait_when_busy || over_limit))
+    snapshot_writer_wait(w, e->verbose);
+
+  struct snapshot_writer_job *job = snapshot_writer_job_new(e, fof, size);
+
+  /* Queue it */
+  if (pthread_mutex_lock(&w->lock) != 0)
+    error("Failed to lock the snapshot writer.");
+  if (w->last != NULL)
+    w->last->next = job;
+  else
+    w->first = job;
+  w->last = job;
+  w->memory += size;
+  pthread_cond_signal(&w->new_job);
+  if (pthread_mutex_unlock(&w->lock) != 0)
+    error("Failed to unlock the snapshot writer.");
+
+  /* The writer increments its own copies of the counters */
+  e->snapshot_output_count++;
+  if (e->snapshot_invoke_stf) e->stf_output_count++;
+
+  if (e->verbose)
+    message("Copying %.3f MB for the snapshot writer took %.3f %s.",
+            size / (1024. * 1024.), clocks_from_ticks(getticks() - tic),
+            clocks_getunit());
+
+  return 1;
+}
+
+/**
+ * @brief Wait until all the snapshots handed over to the #snapshot_writer
+ * have been written.
+ *
+ * @param w The #snapshot_writer.
+ * @param verbose Are we talkative?
+ */
+void snapshot_writer_wait(struct snapshot_writer *w, const int verbose) {
+
+  if (!w->enabled) return;
+
+  const ticks tic = getticks();
+
+  if (pthread_mutex_lock(&w->lock) != 0)
+    error("Failed to lock the snapshot writer.");
+  const int busy = (w->first != NULL);
+  while (w->first != NULL) pthread_cond_wait(&w->job_done, &w->lock);
+  if (pthread_mutex_unlock(&w->lock) != 0)
+    error("Failed to unlock the snapshot writer.");
+
+  if (verbose && busy)
+    message("Waiting for the snapshot writer took %.3f %s.",
+            clocks_from_ticks(getticks() - tic), clocks_getunit());
+}
+
+/**
+ * @brief Make sure the #snapshot_writer is not using HDF5 unless the library
+ * can be used by several threads at once.
+ *
+ * To be called before any other HDF5 output.
+ *
+ * @param w The #snapshot_writer.
+ * @param verbose Are we talkative?
+ */
+void snapshot_writer_wait_for_hdf5(struct snapshot_writer *w,
+                                   const int verbose) {
+
+  if (w->enabled && !w->hdf5_threadsafe) snapshot_writer_wait(w, verbose);
+}
+
+/**
+ * @brief Write whatever is left and stop the writer thread.
+ *
+ * @param w The #snapshot_writer.
+ */
+void snapshot_writer_clean(struct snapshot_writer *w) {
+
+  if (!w->enabled) return;
+
+  if (pthread_mutex_lock(&w->lock) != 0)
+    error("Failed to lock the snapshot writer.");
+  w->stop = 1;
+  pthread_cond_signal(&w->new_job);
+  if (pthread_mutex_unlock(&w->lock) != 0)
+    error("Failed to unlock the snapshot writer.");
+
+  if (pthread_join(w->thread, /*retval=*/NULL) != 0)
+    error("Failed to join the snapshot writer thread.");
+
+  pthread_mutex_destroy(&w->lock);
+  pthread_cond_destroy(&w->new_job);
+  pthread_cond_destroy(&w->job_done);
+
+#ifdef WITH_MPI
+  MPI_Comm_free(&w->comm);
+#endif
+
+  w->enabled = 0;
+}
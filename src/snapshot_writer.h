@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * This file is part of SWIFT.
+ * Copyright (c) 2024 Matthieu Schaller (schaller@strw.leidenuniv.nl)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#ifndef SWIFT_SNAPSHOT_WRITER_H
+#define SWIFT_SNAPSHOT_WRITER_H
+
+/* Config parameters. */
+#include <config.h>
+
+/* Standard headers. */
+#include <pthread.h>
+#include <stddef.h>
+
+/* MPI headers. */
+#ifdef WITH_MPI
+#include <mpi.h>
+#endif
+
+/* Pre-declarations */
+struct engine;
+struct swift_params;
+struct snapshot_writer_job;
+
+/**
+ * @brief What to do when a snapshot is due while the previous ones are still
+ * being written.
+ */
+enum snapshot_writer_when_busy {
+
+  /*! Wait for the previous snapshots to be written. */
+  snapshot_writer_wait_when_busy = 0,
+
+  /*! Queue the new snapshot (within the memory limit). */
+  snapshot_writer_queue_when_busy = 1,
+};
+
+/**
+ * @brief Writes snapshots in the background while the simulation carries on.
+ *
+ * The engine hands over a copy of everything the snapshot writers need (the
+ * particles, the top-level cells and the time-dependent properties) and
+ * resumes the time integration straight away. A dedicated thread then runs
+ * the usual writer on the copy, one snapshot at a time in the order they were
+ * submitted.
+ */
+struct snapshot_writer {
+
+  /*! Are we writing snapshots in the background? */
+  int enabled;
+
+  /*! Number of threads used by the writer to prepare the fields. */
+  int nr_threads;
+
+  /*! Maximal amount of memory used by the copies (0 for no limit). */
+  size_t max_memory;
+
+  /*! What to do when a snapshot is due while the writer is busy. */
+  enum snapshot_writer_when_busy when_busy;
+
+  /*! Can HDF5 be used by other threads while the writer is running? */
+  int hdf5_threadsafe;
+
+  /*! The snapshots waiting to be (or being) written. */
+  struct snapshot_writer_job *first, *last;
+
+  /*! Memory used by the copies of these snapshots. */
+  size_t memory;
+
+  /*! Should the writer thread terminate? */
+  int stop;
+
+  /*! The writer thread. */
+  pthread_t thread;
+
+  /*! Lock protecting the queue. */
+  pthread_mutex_t lock;
+
+  /*! Signals a new snapshot in the queue. */
+  pthread_cond_t new_job;
+
+  /*! Signals a snapshot written. */
+  pthread_cond_t job_done;
+
+#ifdef WITH_MPI
+  /*! The communicator used by the writer (distinct from the main one). */
+  MPI_Comm comm;
+#endif
+};
+
+void snapshot_writer_init(struct snapshot_writer *w,
+                          struct swift_params *params, const struct engine *e);
+int snapshot_writer_submit(struct snapshot_writer *w, struct engine *e,
+                           const int fof);
+void snapshot_writer_wait(struct snapshot_writer *w, const int verbose);
+void snapshot_writer_wait_for_hdf5(struct snapshot_writer *w,
+                                   const int verbose);
+void snapshot_writer_clean(struct snapshot_writer *w);
+
+#endif /* SWIFT_SNAPSHOT_WRITER_H */
@@ -2579,25 +2579,25 @@ void space_struct_dump(struct space *s, FILE *stream) {
 
   /* More things to write. */
   if (s->nr_parts > 0) {
-    restart_write_blocks(s->parts, s->nr_parts, sizeof(struct part), stream,
-                         "parts", "parts");
-    restart_write_blocks(s->xparts, s->nr_parts, sizeof(struct xpart), stream,
-                         "xparts", "xparts");
+    restart_write_array(s->parts, s->nr_parts, sizeof(struct part), stream,
+                        "parts", "parts");
+    restart_write_array(s->xparts, s->nr_parts, sizeof(struct xpart), stream,
+                        "xparts", "xparts");
   }
   if (s->nr_gparts > 0)
-    restart_write_blocks(s->gparts, s->nr_gparts, sizeof(struct gpart), stream,
-                         "gparts", "gparts");
+    restart_write_array(s->gparts, s->nr_gparts, sizeof(struct gpart), stream,
+                        "gparts", "gparts");
 
   if (s->nr_sinks > 0)
-    restart_write_blocks(s->sinks, s->nr_sinks, sizeof(struct sink), stream,
-                         "sinks", "sinks");
+    restart_write_array(s->sinks, s->nr_sinks, sizeof(struct sink), stream,
+                        "sinks", "sinks");
 
   if (s->nr_sparts > 0)
-    restart_write_blocks(s->sparts, s->nr_sparts, sizeof(struct spart), stream,
-                         "sparts", "sparts");
+    restart_write_array(s->sparts, s->nr_sparts, sizeof(struct spart), stream,
+                        "sparts", "sparts");
   if (s->nr_bparts > 0)
-    restart_write_blocks(s->bparts, s->nr_bparts, sizeof(struct bpart), stream,
-                         "bparts", "bparts");
+    restart_write_array(s->bparts, s->nr_bparts, sizeof(struct bpart), stream,
+                        "bparts", "bparts");
 }
 
 /**
@@ -2686,57 +2686,58 @@ void space_struct_restore(struct space *s, FILE *stream) {
   s->xparts = NULL;
   if (s->nr_parts > 0) {
 
-    /* Need the memory for these. */
-    if (swift_memalign("parts", (void **)&s->parts, part_align,
+    /* Need the memory for these. Aligned such that the arrays can be
+     * memory-mapped from the restart file. */
+    if (swift_memalign("parts", (void **)&s->parts, RESTART_ARRAY_ALIGNMENT,
                        s->size_parts * sizeof(struct part)) != 0)
       error("Failed to allocate restore part array.");
 
-    if (swift_memalign("xparts", (void **)&s->xparts, xpart_align,
+    if (swift_memalign("xparts", (void **)&s->xparts, RESTART_ARRAY_ALIGNMENT,
                        s->size_parts * sizeof(struct xpart)) != 0)
       error("Failed to allocate restore xpart array.");
 
-    restart_read_blocks(s->parts, s->nr_parts, sizeof(struct part), stream,
-                        NULL, "parts");
-    restart_read_blocks(s->xparts, s->nr_parts, sizeof(struct xpart), stream,
-                        NULL, "xparts");
+    restart_read_array(s->parts, s->nr_parts, sizeof(struct part), stream,
+                       NULL, "parts");
+    restart_read_array(s->xparts, s->nr_parts, sizeof(struct xpart), stream,
+                       NULL, "xparts");
   }
   s->gparts = NULL;
   if (s->nr_gparts > 0) {
-    if (swift_memalign("gparts", (void **)&s->gparts, gpart_align,
+    if (swift_memalign("gparts", (void **)&s->gparts, RESTART_ARRAY_ALIGNMENT,
                        s->size_gparts * sizeof(struct gpart)) != 0)
       error("Failed to allocate restore gpart array.");
 
-    restart_read_blocks(s->gparts, s->nr_gparts, sizeof(struct gpart), stream,
-                        NULL, "gparts");
+    restart_read_array(s->gparts, s->nr_gparts, sizeof(struct gpart), stream,
+                       NULL, "gparts");
   }
 
   s->sinks = NULL;
   if (s->nr_sinks > 0) {
-    if (swift_memalign("sinks", (void **)&s->sinks, sink_align,
+    if (swift_memalign("sinks", (void **)&s->sinks, RESTART_ARRAY_ALIGNMENT,
                        s->size_sinks * sizeof(struct sink)) != 0)
       error("Failed to allocate restore sink array.");
 
-    restart_read_blocks(s->sinks, s->nr_sinks, sizeof(struct sink), stream,
-                        NULL, "sinks");
+    restart_read_array(s->sinks, s->nr_sinks, sizeof(struct sink), stream,
+                       NULL, "sinks");
   }
 
   s->sparts = NULL;
   if (s->nr_sparts > 0) {
-    if (swift_memalign("sparts", (void **)&s->sparts, spart_align,
+    if (swift_memalign("sparts", (void **)&s->sparts, RESTART_ARRAY_ALIGNMENT,
                        s->size_sparts * sizeof(struct spart)) != 0)
       error("Failed to allocate restore spart array.");
 
-    restart_read_blocks(s->sparts, s->nr_sparts, sizeof(struct spart), stream,
-                        NULL, "sparts");
+    restart_read_array(s->sparts, s->nr_sparts, sizeof(struct spart), stream,
+                       NULL, "sparts");
   }
   s->bparts = NULL;
   if (s->nr_bparts > 0) {
-    if (swift_memalign("bparts", (void **)&s->bparts, bpart_align,
+    if (swift_memalign("bparts", (void **)&s->bparts, RESTART_ARRAY_ALIGNMENT,
                        s->size_bparts * sizeof(struct bpart)) != 0)
       error("Failed to allocate restore bpart array.");
 
-    restart_read_blocks(s->bparts, s->nr_bparts, sizeof(struct bpart), stream,
-                        NULL, "bparts");
+    restart_read_array(s->bparts, s->nr_bparts, sizeof(struct bpart), stream,
+                       NULL, "bparts");
   }
 
   /* Need to reconnect the gravity parts to their hydro, star and BH particles.
@@ -133,6 +133,9 @@ struct space {
   /*! The minimum top-level cell width allowed. */
   double cell_min;
 
+  /*! Should the top-level cells be split at the next regrid? */
+  int split_top_cells;
+
   /*! Space dimensions in number of top-cells. */
   int cdim[3];
 
@@ -163,6 +163,9 @@ void space_parts_get_cell_index_mapper(void *map_data, int nr_parts,
       p->x[0] = pos_x;
       p->x[1] = pos_y;
       p->x[2] = pos_z;
+
+      /* Update the position relative to the top-level cell */
+      part_update_relative_position(p, s->cells_top[index].loc);
     }
   }
 
@@ -153,6 +153,15 @@ void space_regrid(struct space *s, int verbose) {
         " - particles with velocities so large that they move by more than two "
         "box sizes per time-step.\n");
 
+  /* Were we asked to split the top-level cells and do the smoothing lengths
+   * allow for a finer grid? */
+  const int split = s->split_top_cells && s->cells_top != NULL &&
+                    cdim[0] >= s->cdim[0] && cdim[1] >= s->cdim[1] &&
+                    cdim[2] >= s->cdim[2] &&
+                    (cdim[0] > s->cdim[0] || cdim[1] > s->cdim[1] ||
+                     cdim[2] > s->cdim[2]);
+  s->split_top_cells = 0;
+
 /* In MPI-Land, changing the top-level cell size requires that the
  * global partition is recomputed and the particles redistributed.
  * Be prepared to do that. */
@@ -160,7 +169,8 @@ void space_regrid(struct space *s, int verbose) {
   double oldwidth[3] = {0., 0., 0.};
   double oldcdim[3] = {0., 0., 0.};
   int *oldnodeIDs = NULL;
-  if (cdim[0] < s->cdim[0] || cdim[1] < s->cdim[1] || cdim[2] < s->cdim[2]) {
+  if (cdim[0] < s->cdim[0] || cdim[1] < s->cdim[1] || cdim[2] < s->cdim[2] ||
+      split) {
 
     /* Capture state of current space. */
     oldcdim[0] = s->cdim[0];
@@ -193,7 +203,7 @@ void space_regrid(struct space *s, int verbose) {
   /* Do we need to re-build the upper-level cells? */
   // tic = getticks();
   if (s->cells_top == NULL || cdim[0] < s->cdim[0] || cdim[1] < s->cdim[1] ||
-      cdim[2] < s->cdim[2]) {
+      cdim[2] < s->cdim[2] || split) {
 
 /* Be verbose about this. */
 #ifdef SWIFT_DEBUG_CHECKS
@@ -345,8 +355,9 @@ void space_regrid(struct space *s, int verbose) {
        * positions as a grid to resample. */
       if (s->e->nodeID == 0)
         message(
-            "basic cell dimensions have increased - recalculating the "
-            "global partition.");
+            "basic cell dimensions have %s - recalculating the "
+            "global partition.",
+            split ? "decreased" : "increased");
 
       if (!partition_space_to_space(oldwidth, oldcdim, oldnodeIDs, s)) {
 
@@ -42,6 +42,7 @@
 
 /* Keys for thread specific data. */
 static pthread_key_t threadpool_tid;
+static pthread_once_t threadpool_tid_once = PTHREAD_ONCE_INIT;
 
 /* Affinity mask shared by all threads, and if set. */
 #ifdef HAVE_SETAFFINITY
@@ -219,6 +220,13 @@ static void *threadpool_runner(void *data) {
   }
 }
 
+/**
+ * @brief Create the key used to store the thread IDs.
+ */
+static void threadpool_create_tid_key(void) {
+  pthread_key_create(&threadpool_tid, NULL);
+}
+
 /**
  * @brief Initialises the #threadpool with a given number of threads.
  *
@@ -230,8 +238,9 @@ void threadpool_init(struct threadpool *tp, int num_threads) {
   /* Initialize the thread counters. */
   tp->num_threads = num_threads;
 
-  /* Create thread local data areas. Only do this once for all threads. */
-  pthread_key_create(&threadpool_tid, NULL);
+  /* Create thread local data areas. Only do this once for all threads (and
+   * all pools, some may be running while others are created). */
+  pthread_once(&threadpool_tid_once, threadpool_create_tid_key);
 
   /* Store the main thread ID as thread specific data. */
   static int localtid = 0;
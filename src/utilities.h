@@ -56,4 +56,30 @@ INLINE static int find_value_in_monot_incr_array(const float x,
     return index_low;
 }
 
+/**
+ * @brief Search for a value in a monotonically increasing array, starting
+ *      from a guess of the index.
+ *
+ * Returns the same index as find_value_in_monot_incr_array() but only falls
+ * back to the full bisection if the value is not in the interval
+ * [array[guess], array[guess + 1]). This is useful when consecutive searches
+ * are expected to land close to each other (e.g. in neighbouring rows of an
+ * EoS table).
+ *
+ * @param x The value to find
+ * @param array The array to search
+ * @param n The length of the array
+ * @param guess The first index to try
+ */
+INLINE static int find_value_in_monot_incr_array_from_guess(const float x,
+                                                            const float *array,
+                                                            const int n,
+                                                            const int guess) {
+
+  if (guess >= 0 && guess < n - 1 && array[guess] <= x && x < array[guess + 1])
+    return guess;
+
+  return find_value_in_monot_incr_array(x, array, n);
+}
+
 #endif /* SWIFT_UTILITIES_H */
@@ -1078,6 +1078,10 @@ int main(int argc, char *argv[]) {
         params, "InitialConditions:generate_gas_in_ics", 0);
     const int remap_ids =
         parser_get_opt_param_int(params, "InitialConditions:remap_ids", 0);
+#if defined(WITH_MPI) && defined(HAVE_PARALLEL_HDF5)
+    const int read_by_cells =
+        parser_get_opt_param_int(params, "InitialConditions:read_by_cells", 0);
+#endif
 
     /* Initialise the cosmology */
     if (with_cosmology)
@@ -1264,7 +1268,8 @@ int main(int argc, char *argv[]) {
                      with_gravity, with_sinks, with_stars, with_black_holes,
                      with_cosmology, cleanup_h, cleanup_sqrt_a, cosmo.h,
                      cosmo.a, myrank, nr_nodes, MPI_COMM_WORLD, MPI_INFO_NULL,
-                     nr_threads, dry_run, remap_ids, &ics_metadata);
+                     nr_threads, dry_run, remap_ids, &ics_metadata,
+                     read_by_cells ? initial_partition.grid : NULL);
 #else
     read_ic_serial(ICfileName, &us, dim, &parts, &gparts, &sinks, &sparts,
                    &bparts, &Ngas, &Ngpart, &Ngpart_background, &Nnupart,
@@ -1917,6 +1922,7 @@ int main(int argc, char *argv[]) {
 
     /* Write out any remaining lightcone data at the end of the run */
 #ifdef WITH_LIGHTCONE
+    snapshot_writer_wait_for_hdf5(&e.snapshot_writer, e.verbose);
     lightcone_array_flush(e.lightcone_array_properties, &(e.threadpool),
                           e.cosmology, e.internal_units, e.snapshot_units,
                           /*flush_map_updates=*/1, /*flush_particles=*/1,
@@ -322,6 +322,11 @@ struct cell *make_cell(size_t n, const double offset[3], double size, double h,
   cell->loc[0] = offset[0];
   cell->loc[1] = offset[1];
   cell->loc[2] = offset[2];
+  cell->top = cell;
+
+  /* Positions relative to the top-level cell */
+  for (size_t k = 0; k < count; k++)
+    part_update_relative_position(&cell->hydro.parts[k], cell->loc);
 
   cell->hydro.super = cell;
   cell->hydro.ti_old_part = 8;
@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+"""
+Usage:
+    check_restart_file.py <LIST OF FILES>
+
+where <LIST OF FILES> are SWIFT restart files (e.g. restart/swift_000000.rst).
+
+This script verifies the restart files without loading them into SWIFT. It
+walks through all the blocks of each file, checks that the file is not
+truncated and, for the particle arrays stored with check-sums (i.e. written
+with one of the Restarts:compression, Restarts:checksums or
+Restarts:incremental_dumps options), decompresses every block and verifies
+its check-sum. The blocks of an incremental restart file that are stored in
+the full dump it was written against are verified in the corresponding
+<FILE>.base file.
+
+The script exits with a non-zero status if any of the files is invalid.
+
+This file is part of SWIFT.
+Copyright (C) 2024 Matthieu Schaller (schaller@strw.leidenuniv.nl)
+All Rights Reserved.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published
+by the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+"""
+
+import argparse
+import struct
+import sys
+import zlib
+
+# Layout of the structures written by src/restart.c (x86-64, little-endian)
+# struct header: size_t len; char label[21]; (+ padding)
+header = struct.Struct("<Q21s3x")
+# struct restart_format: int version, compression; long long stamp, base_stamp;
+#                        int blocked, alignment (only the first fields in the
+#                        first version)
+restart_format = struct.Struct("<iiqq")
+# struct restart_array_header: char magic[8]; size_t len, block_size, nr_blocks
+array_header = struct.Struct("<8sQQQ")
+# struct restart_block_header: uint64 checksum, stored, base_offset;
+#                              int32 kind, padding
+block_header = struct.Struct("<QQQii")
+
+array_magic = b"SWIFTARR"
+block_raw, block_deflate, block_in_base = 0, 1, 2
+
+
+def checksum(data):
+    """
+    The check-sum used by SWIFT: (crc32 << 32) | adler32.
+    """
+    return (zlib.crc32(data) << 32) | zlib.adler32(data)
+
+
+def read_block_data(stream, record, length):
+    """
+    Read the data of a block and return it uncompressed.
+    """
+    checksum_stored, stored, base_offset, kind, _ = record
+    data = stream.read(stored)
+    if len(data) != stored:
+        raise ValueError("unexpected end of file")
+    if kind == block_deflate:
+        data = zlib.decompress(data)
+    elif kind != block_raw:
+        raise ValueError(f"invalid kind of block ({kind})")
+    if len(data) != length:
+        raise ValueError("mismatched length of block")
+    if checksum(data) != checksum_stored:
+        raise ValueError("check-sum mismatch")
+    return data
+
+
+class BaseFile:
+    """
+    The full restart file an incremental one was written against.
+    """
+
+    def __init__(self, filename, stamp):
+        self.filename = filename
+        self.stream = open(filename, "rb")
+        for _ in range(2):
+            length, _ = header.unpack(self.stream.read(header.size))
+            self.stream.seek(length, 1)
+        length, label = header.unpack(self.stream.read(header.size))
+        if label.rstrip(b"\0") != b"restart_format":
+            raise ValueError(f"{filename} is not a full restart file")
+        format = restart_format.unpack(
+            self.stream.read(length)[: restart_format.size]
+        )
+        if format[2] != stamp:
+            raise ValueError(
+                f"{filename} is not the full dump the file was written against"
+            )
+
+    def check_block(self, offset, checksum_expected, length):
+        self.stream.seek(offset)
+        record = block_header.unpack(self.stream.read(block_header.size))
+        if record[3] == block_in_base or record[0] != checksum_expected:
+            raise ValueError(f"block does not match {self.filename}")
+        read_block_data(self.stream, record, length)
+
+
+def check_array(stream, label, length, base):
+    """
+    Verify all the blocks of an array stored in blocks.
+    """
+    start = stream.tell()
+    magic, array_len, block_size, nr_blocks = array_header.unpack(
+        stream.read(array_header.size)
+    )
+    counts = {block_raw: 0, block_deflate: 0, block_in_base: 0}
+    for block in range(nr_blocks):
+        block_len = min(block_size, array_len - block * block_size)
+        record = block_header.unpack(stream.read(block_header.size))
+        kind = record[3]
+        try:
+            if kind == block_in_base:
+                if base is None:
+                    raise ValueError("refers to a missing full restart file")
+                base.check_block(record[2], record[0], block_len)
+            else:
+                read_block_data(stream, record, block_len)
+        except (ValueError, zlib.error) as err:
+            raise ValueError(f"{label}, block {block}: {err}")
+        counts[kind] = counts.get(kind, 0) + 1
+
+    if stream.tell() - start != length:
+        raise ValueError(f"{label}: mismatched length")
+
+    print(
+        f"  {label:<20s} {array_len:14d} bytes in {nr_blocks:6d} blocks "
+        f"({counts[block_raw]} raw, {counts[block_deflate]} compressed, "
+        f"{counts[block_in_base]} in the full dump)"
+    )
+
+
+def check_file(filename):
+    """
+    Walk through a restart file and verify its content.
+    """
+    print(f"{filename}:")
+    base = None
+    checked = 0
+    last_label = None
+    with open(filename, "rb") as stream:
+        while True:
+            raw = stream.read(header.size)
+            if len(raw) == 0:
+                break
+            if len(raw) != header.size:
+                raise ValueError("truncated header")
+            length, label = header.unpack(raw)
+            label = label.split(b"\0")[0].decode()
+            last_label = label
+
+            if label == "restart_format":
+                format = restart_format.unpack(
+                    stream.read(length)[: restart_format.size]
+                )
+                if format[3] != 0:
+                    basename = filename
+                    if basename.endswith(".prev"):
+                        basename = basename[: -len(".prev")]
+                    base = BaseFile(basename + ".base", format[3])
+                continue
+
+            if length >= array_header.size:
+                magic = stream.read(len(array_magic))
+                stream.seek(-len(magic), 1)
+                if magic == array_magic:
+                    check_array(stream, label, length, base)
+                    checked += 1
+                    continue
+
+            stream.seek(length, 1)
+
+    if last_label != "endsignature":
+        raise ValueError("file is truncated")
+    if checked == 0:
+        print("  no check-sums stored in this file")
+    print("  OK")
+
+
+argparser = argparse.ArgumentParser("Verify SWIFT restart files.")
+argparser.add_argument("file", nargs="+", help="Restart file(s) to verify.")
+args = argparser.parse_args()
+
+status = 0
+for filename in args.file:
+    try:
+        check_file(filename)
+    except (OSError, ValueError, struct.error) as err:
+        print(f"  FAILED: {err}")
+        status = 1
+
+sys.exit(status)